@@ -499,10 +499,10 @@ void bluez_detect(void)
 		if (debug)
 			printf("; %s  %s\n", addr, name);
 		if (find_list(addr, at_prefixes)) {
-			print_config(addr, name, "blueat");
+			add_device(addr, name, "blueat", NULL);
 		}
 		if (find_list(addr, nokia_prefixes)) {
-			print_config(addr, name, "bluephonet");
+			add_device(addr, name, "bluephonet", NULL);
 		}
 	}
 
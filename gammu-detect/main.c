@@ -17,6 +17,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -28,6 +29,7 @@
 
 #include "config.h"
 #include "main.h"
+#include "probe.h"
 
 #ifdef GUDEV_FOUND
 #include "udev.h"
@@ -50,10 +52,20 @@ gint no_bluez = 0;
 gint no_win32_serial = 0;
 #endif
 gint show_version = 0;
+gint probe = 0;
+gint refresh = 0;
+
+/**
+ * Devices collected for probing.
+ */
+static ProbeDevice *devices = NULL;
+static int devices_count = 0;
 
 static GOptionEntry entries[] = {
 	{"debug", 'd', 0, G_OPTION_ARG_NONE, &debug, N_("Show debugging output for detecting devices."), NULL},
 	{"version", 'v', 0, G_OPTION_ARG_NONE, &show_version, N_("Show version information and compiled in features."), NULL},
+	{"probe", 'p', 0, G_OPTION_ARG_NONE, &probe, N_("Probe devices and list only those where phone answers."), NULL},
+	{"refresh", 'r', 0, G_OPTION_ARG_NONE, &refresh, N_("Ignore cached results of previous probing."), NULL},
 #ifdef GUDEV_FOUND
 	{"no-udev", 'u', 0, G_OPTION_ARG_NONE, &no_udev, N_("Disables scanning of udev."), NULL},
 #endif
@@ -117,6 +129,83 @@ void print_config(const gchar *device, const gchar *name, const gchar *connectio
 	g_print("\n");
 }
 
+void add_device(const gchar *device, const gchar *name, const gchar *connection, const gchar *key)
+{
+	ProbeDevice *tmp;
+
+	if (!probe) {
+		print_config(device, name, connection);
+		return;
+	}
+
+	tmp = (ProbeDevice *)realloc(devices, (devices_count + 1) * sizeof(ProbeDevice));
+	if (tmp == NULL) {
+		return;
+	}
+	devices = tmp;
+	memset(&devices[devices_count], 0, sizeof(ProbeDevice));
+	devices[devices_count].Device = strdup(device);
+	devices[devices_count].Name = (name == NULL) ? NULL : strdup(name);
+	devices[devices_count].Connection = strdup(connection);
+	if (key != NULL) {
+		devices[devices_count].Key = strdup(key);
+	} else {
+		/* One device can be listed with several connections */
+		devices[devices_count].Key = (char *)malloc(strlen(device) + strlen(connection) + 2);
+		if (devices[devices_count].Key != NULL) {
+			sprintf(devices[devices_count].Key, "%s %s", device, connection);
+		}
+	}
+	if (devices[devices_count].Device == NULL || devices[devices_count].Connection == NULL) {
+		free(devices[devices_count].Device);
+		free(devices[devices_count].Name);
+		free(devices[devices_count].Connection);
+		free(devices[devices_count].Key);
+		return;
+	}
+	devices_count++;
+}
+
+/**
+ * Probes collected devices and prints configuration for working ones.
+ */
+static void probe_detected(void)
+{
+	gchar *cache_dir, *cache_file, *name;
+	int i;
+
+	cache_dir = g_build_filename(g_get_user_cache_dir(), "gammu", NULL);
+	g_mkdir_with_parents(cache_dir, 0700);
+	cache_file = g_build_filename(cache_dir, "detect.cache", NULL);
+
+	probe_devices(devices, devices_count, cache_file, refresh);
+
+	for (i = 0; i < devices_count; i++) {
+		if (!devices[i].Found) {
+			if (debug) {
+				printf("; %s: %s\n", devices[i].Device, _("No phone answered"));
+			}
+			continue;
+		}
+		if (devices[i].Model[0] != 0) {
+			name = g_strdup_printf("%s %s", devices[i].Manufacturer, devices[i].Model);
+		} else {
+			name = g_strdup(devices[i].Name);
+		}
+		if (debug && devices[i].Cached) {
+			printf("; %s: %s\n", devices[i].Device, _("Using cached result"));
+		}
+		print_config(devices[i].Device, name, devices[i].Connection);
+		g_free(name);
+	}
+
+	probe_free(devices, devices_count);
+	devices = NULL;
+	devices_count = 0;
+	g_free(cache_file);
+	g_free(cache_dir);
+}
+
 int main(int argc, char *argv[])
 {
 	GError *error = NULL;
@@ -180,6 +269,10 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+	if (probe) {
+		probe_detected();
+	}
+
 	return 0;
 }
 
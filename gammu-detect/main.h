@@ -1,3 +1,10 @@
 extern gint debug;
 
 extern void print_config(const gchar *device, const gchar *name, const gchar *connection);
+
+/**
+ * Adds detected device, it is either printed directly or probed
+ * later. Key identifies device in cache of probing results, device
+ * and connection names are used if it is NULL.
+ */
+extern void add_device(const gchar *device, const gchar *name, const gchar *connection, const gchar *key);
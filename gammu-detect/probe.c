@@ -0,0 +1,328 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <gammu.h>
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#  define THREAD_RETURN void *
+#  define THREAD_RETURN_VAL NULL
+#elif defined(WIN32)
+#  define HAVE_WIN32_THREADS
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#  define THREAD_RETURN DWORD
+#  define THREAD_RETURN_VAL 0
+#else
+#  define THREAD_RETURN void *
+#  define THREAD_RETURN_VAL NULL
+#endif
+
+#include "probe.h"
+
+/**
+ * Connections tried on serial devices, most common first.
+ */
+static const char *serial_connections[] = {
+	"at",
+	"at19200",
+	"fbus",
+	"dku5",
+	"fbusdlr3",
+	NULL
+};
+
+/**
+ * Checks whether connection is one of serial ones, for other
+ * connections (eg. Bluetooth) only suggested one is tried.
+ */
+static gboolean probe_is_serial(const char *connection)
+{
+	int i;
+
+	for (i = 0; serial_connections[i] != NULL; i++) {
+		if (strcmp(serial_connections[i], connection) == 0) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * Tries to talk to phone on device using given connection.
+ */
+static GSM_Error probe_connection(ProbeDevice *device, const char *connection)
+{
+	GSM_StateMachine *sm;
+	GSM_Config *smcfg;
+	GSM_Error error;
+
+	sm = GSM_AllocStateMachine();
+	if (sm == NULL) {
+		return ERR_MOREMEMORY;
+	}
+
+	smcfg = GSM_GetConfig(sm, 0);
+	smcfg->Device = strdup(device->Device);
+	smcfg->Connection = strdup(connection);
+	smcfg->SyncTime = FALSE;
+	smcfg->Model[0] = 0;
+	smcfg->LockDevice = FALSE;
+	smcfg->StartInfo = FALSE;
+	GSM_SetConfigNum(sm, 1);
+
+	/* Try just once, we want to be fast */
+	error = GSM_InitConnection(sm, 1);
+
+	if (error == ERR_NONE) {
+		error = GSM_GetManufacturer(sm, device->Manufacturer);
+		if (error == ERR_NONE) {
+			error = GSM_GetModel(sm, device->Model);
+		}
+	}
+	if (error != ERR_DEVICEOPENERROR && error != ERR_DEVICENOTEXIST && error != ERR_DEVICENOPERMISSION) {
+		GSM_TerminateConnection(sm);
+	}
+	GSM_FreeStateMachine(sm);
+
+	return error;
+}
+
+/**
+ * Probes single device, runs in own thread.
+ */
+static THREAD_RETURN probe_thread(void *arg)
+{
+	ProbeDevice *device = arg;
+	GSM_Error error;
+	int i;
+
+	/* Suggested connection first */
+	error = probe_connection(device, device->Connection);
+	if (error == ERR_NONE) {
+		device->Found = TRUE;
+		return THREAD_RETURN_VAL;
+	}
+	if (!probe_is_serial(device->Connection)) {
+		return THREAD_RETURN_VAL;
+	}
+
+	for (i = 0; serial_connections[i] != NULL; i++) {
+		/* There is no point in trying when device can not be opened */
+		if (error == ERR_DEVICEOPENERROR || error == ERR_DEVICENOTEXIST || error == ERR_DEVICENOPERMISSION) {
+			break;
+		}
+		if (strcmp(serial_connections[i], device->Connection) == 0) {
+			continue;
+		}
+		error = probe_connection(device, serial_connections[i]);
+		if (error == ERR_NONE) {
+			free(device->Connection);
+			device->Connection = strdup(serial_connections[i]);
+			device->Found = (device->Connection != NULL);
+			break;
+		}
+	}
+	return THREAD_RETURN_VAL;
+}
+
+/**
+ * Fills in devices from cache.
+ */
+static void probe_cache_load(ProbeDevice *devices, int count, const char *cache_file)
+{
+	INI_Section *cfg = NULL;
+	const char *value;
+	int i;
+
+	if (INI_ReadFile(cache_file, FALSE, &cfg) != ERR_NONE) {
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (devices[i].Key == NULL) {
+			continue;
+		}
+		value = (const char *)INI_GetValue(cfg, devices[i].Key, "connection", FALSE);
+		if (value == NULL) {
+			continue;
+		}
+		free(devices[i].Connection);
+		devices[i].Connection = strdup(value);
+		if (devices[i].Connection == NULL) {
+			continue;
+		}
+		devices[i].Found = TRUE;
+		devices[i].Cached = TRUE;
+
+		value = (const char *)INI_GetValue(cfg, devices[i].Key, "manufacturer", FALSE);
+		if (value != NULL) {
+			strncpy(devices[i].Manufacturer, value, GSM_MAX_MANUFACTURER_LENGTH);
+		}
+		value = (const char *)INI_GetValue(cfg, devices[i].Key, "model", FALSE);
+		if (value != NULL) {
+			strncpy(devices[i].Model, value, GSM_MAX_MODEL_LENGTH);
+		}
+	}
+
+	INI_Free(cfg);
+}
+
+/**
+ * Stores working devices in cache, keeping results for devices which
+ * were not probed now.
+ */
+static void probe_cache_save(ProbeDevice *devices, int count, const char *cache_file)
+{
+	INI_Section *cfg = NULL, *h;
+	INI_Entry *e;
+	FILE *f;
+	int i;
+
+	if (INI_ReadFile(cache_file, FALSE, &cfg) != ERR_NONE) {
+		cfg = NULL;
+	}
+
+	f = fopen(cache_file, "w");
+	if (f == NULL) {
+		INI_Free(cfg);
+		return;
+	}
+
+	fprintf(f, "; Devices found by gammu-detect, remove to probe them again.\n\n");
+
+	for (h = cfg; h != NULL; h = h->Next) {
+		for (i = 0; i < count; i++) {
+			if (devices[i].Key != NULL && strcasecmp(devices[i].Key, h->SectionName) == 0) {
+				break;
+			}
+		}
+		if (i < count) {
+			continue;
+		}
+		fprintf(f, "[%s]\n", h->SectionName);
+		for (e = h->SubEntries; e != NULL; e = e->Next) {
+			fprintf(f, "%s = %s\n", e->EntryName, e->EntryValue);
+		}
+		fprintf(f, "\n");
+	}
+
+	for (i = 0; i < count; i++) {
+		if (devices[i].Key == NULL || !devices[i].Found) {
+			continue;
+		}
+		fprintf(f, "[%s]\n", devices[i].Key);
+		fprintf(f, "connection = %s\n", devices[i].Connection);
+		if (devices[i].Manufacturer[0] != 0) {
+			fprintf(f, "manufacturer = %s\n", devices[i].Manufacturer);
+		}
+		if (devices[i].Model[0] != 0) {
+			fprintf(f, "model = %s\n", devices[i].Model);
+		}
+		fprintf(f, "\n");
+	}
+
+	fclose(f);
+	INI_Free(cfg);
+}
+
+void probe_devices(ProbeDevice *devices, int count, const char *cache_file, gboolean refresh)
+{
+	int i;
+	gboolean *started;
+#ifdef HAVE_PTHREAD
+	pthread_t *threads;
+#elif defined(HAVE_WIN32_THREADS)
+	HANDLE *threads;
+#endif
+
+	if (cache_file != NULL && !refresh) {
+		probe_cache_load(devices, count, cache_file);
+	}
+
+	started = (gboolean *)calloc(count, sizeof(gboolean));
+#ifdef HAVE_PTHREAD
+	threads = (pthread_t *)calloc(count, sizeof(pthread_t));
+#elif defined(HAVE_WIN32_THREADS)
+	threads = (HANDLE *)calloc(count, sizeof(HANDLE));
+#endif
+
+	/* Probe all devices at once, waiting for timeouts is what takes time */
+	for (i = 0; i < count; i++) {
+		if (devices[i].Cached) {
+			continue;
+		}
+#ifdef HAVE_PTHREAD
+		if (started != NULL && threads != NULL &&
+				pthread_create(&threads[i], NULL, probe_thread, &devices[i]) == 0) {
+			started[i] = TRUE;
+			continue;
+		}
+#elif defined(HAVE_WIN32_THREADS)
+		if (started != NULL && threads != NULL) {
+			threads[i] = CreateThread((LPSECURITY_ATTRIBUTES) NULL, 0,
+				(LPTHREAD_START_ROUTINE) probe_thread,
+				&devices[i], 0, NULL);
+			if (threads[i] != NULL) {
+				started[i] = TRUE;
+				continue;
+			}
+		}
+#endif
+		/* Fallback to probing in this thread */
+		probe_thread(&devices[i]);
+	}
+
+	for (i = 0; started != NULL && i < count; i++) {
+		if (!started[i]) {
+			continue;
+		}
+#ifdef HAVE_PTHREAD
+		pthread_join(threads[i], NULL);
+#elif defined(HAVE_WIN32_THREADS)
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#endif
+	}
+#if defined(HAVE_PTHREAD) || defined(HAVE_WIN32_THREADS)
+	free(threads);
+#endif
+	free(started);
+
+	if (cache_file != NULL) {
+		probe_cache_save(devices, count, cache_file);
+	}
+}
+
+void probe_free(ProbeDevice *devices, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		free(devices[i].Device);
+		free(devices[i].Name);
+		free(devices[i].Connection);
+		free(devices[i].Key);
+	}
+	free(devices);
+}
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
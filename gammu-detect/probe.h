@@ -0,0 +1,61 @@
+#ifndef _probe_h_
+#define _probe_h_
+
+#include <gammu.h>
+
+/**
+ * Device which should be probed for phone.
+ */
+typedef struct {
+	/**
+	 * Device name.
+	 */
+	char *Device;
+	/**
+	 * Human readable name, can be NULL.
+	 */
+	char *Name;
+	/**
+	 * Suggested connection, replaced by working one.
+	 */
+	char *Connection;
+	/**
+	 * Identification of device used to store result in cache, eg.
+	 * udev serial or bus path.
+	 */
+	char *Key;
+	/**
+	 * Whether phone has answered.
+	 */
+	gboolean Found;
+	/**
+	 * Whether result was read from cache.
+	 */
+	gboolean Cached;
+	/**
+	 * Phone manufacturer.
+	 */
+	char Manufacturer[GSM_MAX_MANUFACTURER_LENGTH + 1];
+	/**
+	 * Phone model.
+	 */
+	char Model[GSM_MAX_MODEL_LENGTH + 1];
+} ProbeDevice;
+
+/**
+ * Probes all devices at once, on every device tries connections which
+ * are suitable for it.
+ *
+ * \param devices Devices to probe.
+ * \param count Number of devices.
+ * \param cache_file File where results are cached, can be NULL.
+ * \param refresh Whether to ignore cached results.
+ */
+void probe_devices(ProbeDevice *devices, int count, const char *cache_file, gboolean refresh);
+
+/**
+ * Frees data allocated in devices.
+ */
+void probe_free(ProbeDevice *devices, int count);
+
+#endif
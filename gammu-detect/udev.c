@@ -161,9 +161,30 @@ static gboolean device_is_valid(GUdevDevice * device)
 	return FALSE;
 }
 
+/**
+ * Returns key identifying device for caching of probe results, serial
+ * number of device is preferred, bus path is used otherwise.
+ */
+static gchar *device_key(GUdevDevice * device)
+{
+	const gchar *serial, *interface, *path;
+
+	serial = g_udev_device_get_property(device, "ID_SERIAL");
+	interface = g_udev_device_get_property(device, "ID_USB_INTERFACE_NUM");
+	path = g_udev_device_get_property(device, "ID_PATH");
+
+	if (serial != NULL) {
+		return g_strdup_printf("%s-%s", serial, interface != NULL ? interface : "");
+	}
+	if (path != NULL) {
+		return g_strdup(path);
+	}
+	return g_strdup(g_udev_device_get_sysfs_path(device));
+}
+
 static void device_dump_config(GUdevDevice * device)
 {
-	gchar *device_name, *name;
+	gchar *device_name, *name, *key;
 	device_name = g_strdup_printf("/dev/%s", g_udev_device_get_name(device));
 
 	if (device_is_serial(device)) {
@@ -175,9 +196,11 @@ static void device_dump_config(GUdevDevice * device)
 	} else {
 		name = NULL;
 	}
-	print_config(device_name, name, "at");
+	key = device_key(device);
+	add_device(device_name, name, "at", key);
 	g_free(device_name);
 	g_free(name);
+	g_free(key);
 }
 
 void udev_detect(void)
@@ -42,7 +42,7 @@ void win32_serial_detect(void)
         for (i = 0; buffer[i] != 0 && i < chars; i += strlen(buffer + i) + 1) {
             if (strncasecmp(buffer + i, "com", 3) == 0) {
                 name = g_strdup_printf(_("Phone on serial port %s"), buffer + i);
-                print_config(buffer + i, name, "at");
+                add_device(buffer + i, name, "at", NULL);
                 g_free(name);
             }
         }
@@ -23,6 +23,7 @@
 #include "files.h"
 #include "calendar.h"
 #include "misc.h"
+#include "multi.h"
 
 #include "../helper/locales.h"
 #include "../helper/printing.h"
@@ -790,6 +791,8 @@ void HelpGeneral(void)
 	printf("%s\n", _("Parameters before command configure gammu behaviour:"));
 	printf("%s\n", _("-c / --config <filename> ... name of configuration file"));
 	printf("%s\n", _("-s / --section <confign> ... section of config file to use, eg. 42"));
+	printf("%s\n", _("-m / --sections <list> ... run command on several sections concurrently, eg. 1,3-5 or all"));
+	printf("%s\n", _("-j / --jobs <number> ... maximal number of sections processed at once, default is 4"));
 	printf("%s\n", _("-d / --debug <level> ... debug level (nothing|text|textall|textalldate|binary|errors)"));
 	printf("%s\n\n", _("-f / --debug-file <filename> ... file for logging debug messages"));
 
@@ -1048,13 +1051,108 @@ int ProcessParameters(int start, int argc, char *argv[])
 	return 0;
 }
 
+/**
+ * Reads configuration for global state machine, either all sections or
+ * just the one given by user.
+ */
+static void ReadConfiguration(int only_config, gboolean debug_level_set, gboolean debug_file_set)
+{
+	int i;
+	char *rss;
+	GSM_Config *smcfg;
+	GSM_Config *smcfg0;
+	GSM_Debug_Info *di;
+	GSM_Error error;
+
+	di = GSM_GetGlobalDebug();
+
+	smcfg0 = GSM_GetConfig(gsm, 0);
+
+	for (i = 0; (smcfg = GSM_GetConfig(gsm, i)) != NULL; i++) {
+		/* Wanted user specific configuration? */
+		if (only_config != -1) {
+			smcfg = smcfg0;
+			error = GSM_ReadConfig(cfg, smcfg, only_config);
+			/* Here we get only in first for loop */
+			if (error != ERR_NONE) {
+				printf_err(_("Failed to read [gammu%d] section from configuration file (gammurc)!\n"),
+					   only_config);
+				printf_warn("%s\n", _("No configuration read, using builtin defaults!"));
+				GSM_ReadConfig(NULL, smcfg, 0);
+			}
+		} else {
+			error = GSM_ReadConfig(cfg, smcfg, i);
+			if (error != ERR_NONE) {
+				if (i != 0) {
+					/* We just end here, we already have some valid config */
+					break;
+				}
+				if (error == ERR_USING_DEFAULTS) {
+					printf_warn("%s\n", _("No configuration read, using builtin defaults!"));
+				}
+			}
+		}
+		GSM_SetConfigNum(gsm, GSM_GetConfigNum(gsm) + 1);
+
+		/* We want to use only one file descriptor for global and state machine debug output */
+		smcfg->UseGlobalDebugFile = TRUE;
+
+		/* It makes no sense to open several debug logs... */
+		if (i == 0) {
+			/* Just for first config */
+			/* When user gave debug level on command line */
+			if (!debug_level_set) {
+				/* Try to set debug level from config file */
+				GSM_SetDebugLevel(smcfg->DebugLevel, di);
+			}
+			/* If user gave debug file in gammurc, we will use it */
+			if (!debug_file_set) {
+				error = GSM_SetDebugFile(smcfg->DebugFile, di);
+				Print_Error(error);
+			}
+		}
+
+		if (i == 0) {
+			rss = INI_GetValue(cfg, "gammu", "rsslevel", FALSE);
+			if (rss) {
+				printf_warn("Configuration option rsslevel is ignored, use '%s' instead\n", "gammu checkversion");
+			}
+		}
+
+		/* We wanted to read just user specified configuration. */
+		if (only_config != -1) {
+			break;
+		}
+	}
+}
+
+/**
+ * Parameters needed to run command on several sections.
+ */
+static struct {
+	int start;
+	int argc;
+	char **argv;
+	gboolean debug_level_set;
+	gboolean debug_file_set;
+} MultiParams;
+
+/**
+ * Runs command using single configuration section, called in child
+ * process for every section.
+ */
+static int RunSection(int section)
+{
+	ReadConfiguration(section, MultiParams.debug_level_set, MultiParams.debug_file_set);
+
+	return ProcessParameters(MultiParams.start, MultiParams.argc, MultiParams.argv);
+}
+
 int main(int argc, char *argv[])
 {
 	int start = 0;
 	int i, ret;
-	char *cp, *locales_path, *rss;
-	GSM_Config *smcfg;
-	GSM_Config *smcfg0;
+	char *cp, *locales_path;
 	GSM_Debug_Info *di;
 	GSM_Error error;
 
@@ -1063,6 +1161,8 @@ int main(int argc, char *argv[])
 	gboolean debug_file_set = FALSE;
 	const char *config_file = NULL;
 	int only_config = -1;
+	const char *sections_list = NULL;
+	int *sections, sections_count, jobs = 4;
 
 	di = GSM_GetGlobalDebug();
 
@@ -1085,6 +1185,18 @@ int main(int argc, char *argv[])
 			i++;
 			only_config = GetInt(argv[i]);
 			start += 2;
+		} else if ((strcasecmp(argv[i], "--sections") == 0 ||
+		    strcasecmp(argv[i], "-m") == 0) &&
+		    i + 1 < argc) {
+			i++;
+			sections_list = argv[i];
+			start += 2;
+		} else if ((strcasecmp(argv[i], "--jobs") == 0 ||
+		    strcasecmp(argv[i], "-j") == 0) &&
+		    i + 1 < argc) {
+			i++;
+			jobs = GetInt(argv[i]);
+			start += 2;
 		} else if ((strcasecmp(argv[i], "--debug") == 0 ||
 		    strcasecmp(argv[i], "-d") == 0) &&
 		    i + 1 < argc) {
@@ -1178,65 +1290,6 @@ int main(int argc, char *argv[])
 		Terminate(2);
 	}
 
-	smcfg0 = GSM_GetConfig(gsm, 0);
-
-	for (i = 0; (smcfg = GSM_GetConfig(gsm, i)) != NULL; i++) {
-		/* Wanted user specific configuration? */
-		if (only_config != -1) {
-			smcfg = smcfg0;
-			error = GSM_ReadConfig(cfg, smcfg, only_config);
-			/* Here we get only in first for loop */
-			if (error != ERR_NONE) {
-				printf_err(_("Failed to read [gammu%d] section from configuration file (gammurc)!\n"),
-					   only_config);
-				printf_warn("%s\n", _("No configuration read, using builtin defaults!"));
-				GSM_ReadConfig(NULL, smcfg, 0);
-			}
-		} else {
-			error = GSM_ReadConfig(cfg, smcfg, i);
-			if (error != ERR_NONE) {
-				if (i != 0) {
-					/* We just end here, we already have some valid config */
-					break;
-				}
-				if (error == ERR_USING_DEFAULTS) {
-					printf_warn("%s\n", _("No configuration read, using builtin defaults!"));
-				}
-			}
-		}
-		GSM_SetConfigNum(gsm, GSM_GetConfigNum(gsm) + 1);
-
-		/* We want to use only one file descriptor for global and state machine debug output */
-		smcfg->UseGlobalDebugFile = TRUE;
-
-		/* It makes no sense to open several debug logs... */
-		if (i == 0) {
-			/* Just for first config */
-			/* When user gave debug level on command line */
-			if (!debug_level_set) {
-				/* Try to set debug level from config file */
-				GSM_SetDebugLevel(smcfg->DebugLevel, di);
-			}
-			/* If user gave debug file in gammurc, we will use it */
-			if (!debug_file_set) {
-				error = GSM_SetDebugFile(smcfg->DebugFile, di);
-				Print_Error(error);
-			}
-		}
-
-		if (i == 0) {
-			rss = INI_GetValue(cfg, "gammu", "rsslevel", FALSE);
-			if (rss) {
-				printf_warn("Configuration option rsslevel is ignored, use '%s' instead\n", "gammu checkversion");
-			}
-		}
-
-		/* We wanted to read just user specified configuration. */
-		if (only_config != -1) {
-			break;
-		}
-	}
-
 	/* Check used version vs. compiled */
 	if (!strcasecmp(GetGammuVersion(), GAMMU_VERSION) == 0) {
 		printf_err(_("Version of installed libGammu.so (%s) is different to version of Gammu (%s)\n"),
@@ -1244,6 +1297,24 @@ int main(int argc, char *argv[])
 		Terminate(98);
 	}
 
+	/* Command on several sections, every one runs in own process */
+	if (sections_list != NULL) {
+		sections = ParseSections(cfg, sections_list, &sections_count);
+		if (sections == NULL) {
+			Terminate(2);
+		}
+		MultiParams.start = start;
+		MultiParams.argc = argc;
+		MultiParams.argv = argv;
+		MultiParams.debug_level_set = debug_level_set;
+		MultiParams.debug_file_set = debug_file_set;
+		ret = RunSections(cfg, sections, sections_count, jobs, RunSection);
+		free(sections);
+		Terminate(ret);
+	}
+
+	ReadConfiguration(only_config, debug_level_set, debug_file_set);
+
 	ret = ProcessParameters(start, argc, argv);
 
 	Terminate(ret);
@@ -0,0 +1,393 @@
+#include "../helper/locales.h"
+
+#include <gammu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(HAVE_UNISTD_H) && !defined(WIN32)
+#  define HAVE_MULTI_SECTION
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <errno.h>
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#endif
+
+#include "multi.h"
+
+#include "../helper/printing.h"
+
+/**
+ * Formats configuration section name.
+ */
+static void SectionName(int num, char *buffer, size_t size)
+{
+	if (num == 0) {
+		snprintf(buffer, size, "gammu");
+	} else {
+		snprintf(buffer, size, "gammu%d", num);
+	}
+}
+
+/**
+ * Returns number of gammu configuration section or -1 for other ones.
+ */
+static int SectionNumber(const char *name)
+{
+	char *end;
+	long num;
+
+	if (strncasecmp(name, "gammu", 5) != 0) {
+		return -1;
+	}
+	if (name[5] == 0) {
+		return 0;
+	}
+	if (!isdigit((int)name[5])) {
+		return -1;
+	}
+	num = strtol(name + 5, &end, 10);
+	if (*end != 0 || num <= 0) {
+		return -1;
+	}
+	return num;
+}
+
+static int CompareSections(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * Returns highest number of gammu configuration section, -1 if there
+ * is none.
+ */
+static int LastSection(INI_Section *cfg)
+{
+	INI_Section *h;
+	int num, last = -1;
+
+	for (h = cfg; h != NULL; h = h->Next) {
+		num = SectionNumber(h->SectionName);
+		if (num > last) {
+			last = num;
+		}
+	}
+	return last;
+}
+
+/**
+ * Checks whether gammu configuration section exists.
+ */
+static gboolean SectionExists(INI_Section *cfg, int num)
+{
+	INI_Section *h;
+
+	for (h = cfg; h != NULL; h = h->Next) {
+		if (SectionNumber(h->SectionName) == num) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * Appends section to list, sections already listed are skipped.
+ */
+static gboolean AddSection(int **sections, int *count, int num)
+{
+	int *tmp;
+	int i;
+
+	for (i = 0; i < *count; i++) {
+		if ((*sections)[i] == num) {
+			return TRUE;
+		}
+	}
+
+	tmp = (int *)realloc(*sections, (*count + 1) * sizeof(int));
+	if (tmp == NULL) {
+		return FALSE;
+	}
+	*sections = tmp;
+	(*sections)[(*count)++] = num;
+	return TRUE;
+}
+
+int *ParseSections(INI_Section *cfg, const char *list, int *count)
+{
+	INI_Section *h;
+	int *sections = NULL;
+	int max, i;
+	long first, last;
+	gboolean range;
+	const char *pos = list;
+	char *end;
+
+	*count = 0;
+	max = LastSection(cfg);
+
+	/* All phone sections in configuration file */
+	if (strcasecmp(list, "all") == 0) {
+		for (h = cfg; h != NULL; h = h->Next) {
+			i = SectionNumber(h->SectionName);
+			if (i >= 0 && !AddSection(&sections, count, i)) {
+				goto fail;
+			}
+		}
+		if (*count == 0) {
+			printf_err("%s\n", _("No configuration sections found!"));
+			goto fail;
+		}
+		qsort(sections, *count, sizeof(int), CompareSections);
+		return sections;
+	}
+
+	while (*pos != 0) {
+		first = strtol(pos, &end, 10);
+		if (end == pos || first < 0) {
+			goto wrong;
+		}
+		last = first;
+		range = FALSE;
+		pos = end;
+		if (*pos == '-') {
+			range = TRUE;
+			pos++;
+			last = strtol(pos, &end, 10);
+			if (end == pos || last < first) {
+				goto wrong;
+			}
+			pos = end;
+		}
+		if (!range) {
+			/* Explicitly listed section has to exist */
+			if (first > max || !SectionExists(cfg, first)) {
+				printf_err(_("Configuration section %ld not found!\n"), first);
+				goto fail;
+			}
+			if (!AddSection(&sections, count, first)) {
+				goto fail;
+			}
+		} else {
+			/* Range includes only existing sections */
+			if (last > max) {
+				last = max;
+			}
+			for (i = first; i <= last; i++) {
+				if (SectionExists(cfg, i) && !AddSection(&sections, count, i)) {
+					goto fail;
+				}
+			}
+		}
+		if (*pos == ',') {
+			pos++;
+		} else if (*pos != 0) {
+			goto wrong;
+		}
+	}
+	if (*count > 0) {
+		return sections;
+	}
+wrong:
+	printf_err(_("Wrong list of sections: %s\n"), list);
+fail:
+	free(sections);
+	*count = 0;
+	return NULL;
+}
+
+#ifdef HAVE_MULTI_SECTION
+
+/**
+ * State of command running on single section.
+ */
+typedef struct {
+	/**
+	 * Configuration section.
+	 */
+	int Section;
+	/**
+	 * Process handling the section.
+	 */
+	pid_t Pid;
+	/**
+	 * Collected output of the process.
+	 */
+	FILE *Output;
+	/**
+	 * Exit code of the process.
+	 */
+	int ExitCode;
+	/**
+	 * Whether the process has finished.
+	 */
+	gboolean Finished;
+} MultiSectionJob;
+
+/**
+ * Prints collected output of finished job.
+ */
+static void PrintJob(INI_Section *cfg, MultiSectionJob *job)
+{
+	char section[50], buffer[4096];
+	const char *device;
+	size_t length;
+
+	SectionName(job->Section, section, sizeof(section));
+	device = INI_GetValue(cfg, section, "device", FALSE);
+	if (device == NULL) {
+		device = INI_GetValue(cfg, section, "port", FALSE);
+	}
+
+	printf("[%s] %s, ", section, device == NULL ? "" : device);
+	printf(_("exit code %d:\n"), job->ExitCode);
+
+	if (job->Output != NULL) {
+		rewind(job->Output);
+		while ((length = fread(buffer, 1, sizeof(buffer), job->Output)) > 0) {
+			fwrite(buffer, 1, length, stdout);
+		}
+		fclose(job->Output);
+		job->Output = NULL;
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+/**
+ * Starts processing of single section in child process.
+ */
+static void StartJob(MultiSectionJob *job, MultiSectionRun run)
+{
+	int fd;
+
+	job->Output = tmpfile();
+	if (job->Output == NULL) {
+		printf_err("%s\n", _("Failed to create temporary file!"));
+		job->Pid = -1;
+		return;
+	}
+
+	/* Avoid duplicating buffered output in child */
+	fflush(NULL);
+
+	job->Pid = fork();
+	if (job->Pid < 0) {
+		printf_err(_("Failed to start process: %s\n"), strerror(errno));
+		return;
+	}
+	if (job->Pid > 0) {
+		return;
+	}
+
+	/* Child process, input can not be shared among several processes */
+	fd = open("/dev/null", O_RDONLY);
+	if (fd >= 0) {
+		dup2(fd, 0);
+		close(fd);
+	}
+	dup2(fileno(job->Output), 1);
+	dup2(fileno(job->Output), 2);
+
+	exit(run(job->Section));
+}
+
+int RunSections(INI_Section *cfg, const int *sections, int count, int jobs, MultiSectionRun run)
+{
+	MultiSectionJob *job;
+	int i, running = 0, next = 0, finished = 0, failed = 0, ret = 0, status;
+	pid_t pid;
+
+	if (jobs < 1) {
+		jobs = 1;
+	}
+
+	job = (MultiSectionJob *)calloc(count, sizeof(MultiSectionJob));
+	if (job == NULL) {
+		printf_err("%s", _("Failed to allocate memory, aborting!\n"));
+		return 1;
+	}
+
+	while (finished < count) {
+		/* Start processes up to the limit */
+		while (running < jobs && next < count) {
+			job[next].Section = sections[next];
+			StartJob(&job[next], run);
+			if (job[next].Pid < 0) {
+				job[next].ExitCode = 1;
+				job[next].Finished = TRUE;
+				PrintJob(cfg, &job[next]);
+				finished++;
+			} else {
+				running++;
+			}
+			next++;
+		}
+		if (running == 0) {
+			continue;
+		}
+
+		/* Wait for any of them to finish */
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			printf_err(_("Failed to wait for process: %s\n"), strerror(errno));
+			break;
+		}
+		for (i = 0; i < next; i++) {
+			if (job[i].Pid == pid) {
+				break;
+			}
+		}
+		if (i == next) {
+			continue;
+		}
+		if (WIFEXITED(status)) {
+			job[i].ExitCode = WEXITSTATUS(status);
+		} else if (WIFSIGNALED(status)) {
+			job[i].ExitCode = 128 + WTERMSIG(status);
+		} else {
+			continue;
+		}
+		job[i].Finished = TRUE;
+		running--;
+		finished++;
+		PrintJob(cfg, &job[i]);
+	}
+
+	/* Jobs not started or not waited for are failed as well */
+	for (i = 0; i < count; i++) {
+		if (!job[i].Finished || job[i].ExitCode != 0) {
+			failed++;
+			if (ret == 0) {
+				ret = job[i].Finished ? job[i].ExitCode : 1;
+			}
+		}
+		if (job[i].Output != NULL) {
+			fclose(job[i].Output);
+		}
+	}
+	printf(_("Command finished on %d sections, %d failed.\n"), count, failed);
+
+	free(job);
+	return ret;
+}
+
+#else
+
+int RunSections(INI_Section *cfg UNUSED, const int *sections UNUSED, int count UNUSED, int jobs UNUSED, MultiSectionRun run UNUSED)
+{
+	printf_err("%s\n", _("Running command on several sections is not supported on this platform!"));
+	return 3;
+}
+
+#endif
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
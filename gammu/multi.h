@@ -0,0 +1,40 @@
+#ifndef _gammu_multi_h
+#define _gammu_multi_h
+
+#include <gammu.h>
+
+/**
+ * Callback which runs command using single configuration section. It
+ * is called in separate process and returns exit code.
+ */
+typedef int (*MultiSectionRun)(int section);
+
+/**
+ * Parses list of configuration sections, eg. "0,2-5" or "all" for all
+ * [gammu] and [gammuN] sections in configuration file. Explicitly
+ * listed sections have to exist, ranges include only existing ones.
+ *
+ * \param cfg Parsed configuration file.
+ * \param list List of sections.
+ * \param count Storage for number of parsed sections.
+ *
+ * \return Allocated array of sections, NULL on failure.
+ */
+int *ParseSections(INI_Section *cfg, const char *list, int *count);
+
+/**
+ * Runs command on several configuration sections concurrently. Every
+ * section is handled by separate process, output is collected and
+ * printed per section once it finishes.
+ *
+ * \param cfg Parsed configuration file.
+ * \param sections Sections to use.
+ * \param count Number of sections.
+ * \param jobs Maximal number of concurrently running processes.
+ * \param run Callback executing command.
+ *
+ * \return Exit code, first non zero exit code of command in any section.
+ */
+int RunSections(INI_Section *cfg, const int *sections, int count, int jobs, MultiSectionRun run);
+
+#endif
@@ -620,6 +620,22 @@ GSM_Error GSM_EncodeVCALENDAR(char *Buffer, const size_t buff_len,
  */
 GSM_Error GSM_DecodeVNOTE(char *Buffer, size_t * Pos, GSM_NoteEntry * Note);
 
+/**
+ * Decodes vNote from buffer of known length. This should be preferred
+ * over \ref GSM_DecodeVNOTE when reading many entries from one buffer.
+ *
+ * \param Buffer Buffer to decode.
+ * \param Length Length of data in buffer.
+ * \param Pos Current position in buffer (will be updated).
+ * \param Note Storage for note entry.
+ *
+ * \return Error code.
+ *
+ * \ingroup Note
+ */
+GSM_Error GSM_DecodeVNOTELength(char *Buffer, size_t Length, size_t * Pos,
+				GSM_NoteEntry * Note);
+
 /**
  * Encodes vNote to buffer.
  *
@@ -656,6 +672,31 @@ GSM_Error GSM_DecodeVCALENDAR_VTODO(GSM_Debug_Info * di, char *Buffer,
 				    GSM_VCalendarVersion CalVer,
 				    GSM_VToDoVersion ToDoVer);
 
+/**
+ * Decodes vCalendar and vTodo buffer of known length. This should be
+ * preferred over \ref GSM_DecodeVCALENDAR_VTODO when reading many
+ * entries from one buffer.
+ *
+ * \param di Pointer to debugging description.
+ * \param Buffer Buffer to decode.
+ * \param Length Length of data in buffer.
+ * \param Pos Current position in buffer (will be updated).
+ * \param Calendar Storage for calendar entry.
+ * \param ToDo Storage for todo entry.
+ * \param CalVer Format of vCalendar.
+ * \param ToDoVer Format of vTodo.
+ *
+ * \return Error code
+ *
+ * \ingroup Calendar
+ */
+GSM_Error GSM_DecodeVCALENDAR_VTODOLength(GSM_Debug_Info * di, char *Buffer,
+					  size_t Length, size_t * Pos,
+					  GSM_CalendarEntry * Calendar,
+					  GSM_ToDoEntry * ToDo,
+					  GSM_VCalendarVersion CalVer,
+					  GSM_VToDoVersion ToDoVer);
+
 /**
  * Detects whether calendar note is in past.
  *
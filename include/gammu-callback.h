@@ -15,6 +15,7 @@
 #include <gammu-types.h>
 #include <gammu-message.h>
 #include <gammu-call.h>
+#include <gammu-file.h>
 
 /**
  * Callback for incoming calls.
@@ -56,6 +57,14 @@ typedef void (*IncomingUSSDCallback) (GSM_StateMachine * s,
 typedef void (*SendSMSStatusCallback) (GSM_StateMachine * s, int status,
 				       int MessageReference, void *user_data);
 
+/**
+ * Callback for received file data.
+ * \ingroup Callback
+ */
+typedef void (*FilePartCallback) (GSM_StateMachine * s, GSM_File *File,
+				  const unsigned char *buffer, size_t length,
+				  void *user_data);
+
 /**
  * Sets callback for incoming calls.
  *
@@ -118,6 +127,22 @@ void GSM_SetIncomingUSSDCallback(GSM_StateMachine * s,
 void GSM_SetSendSMSStatusCallback(GSM_StateMachine * s,
 				  SendSMSStatusCallback callback,
 				  void *user_data);
+
+/**
+ * Sets callback for data received by \ref GSM_GetFilePart. While it is
+ * set, data are streamed to the callback as they arrive and drivers
+ * which support it do not keep them in File->Buffer, File->Used still
+ * counts received bytes. Drivers which can not stream store data in
+ * File->Buffer as usual and new data are passed to the callback after
+ * each part.
+ *
+ * \param s State machine.
+ * \param callback Pointer to callback function, NULL to disable.
+ * \param user_data Last parameter which will be passed to callback.
+ * \ingroup Callback
+ */
+void GSM_SetFilePartCallback(GSM_StateMachine * s,
+			     FilePartCallback callback, void *user_data);
 #endif
 
 /* Editor configuration
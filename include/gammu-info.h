@@ -12,6 +12,8 @@
  * Phone information.
  */
 
+#include <stdlib.h>		/* Needed for size_t declaration */
+
 #include <gammu-types.h>
 #include <gammu-error.h>
 #include <gammu-limits.h>
@@ -19,6 +21,8 @@
 /**
  * Find network name from given network code.
  *
+ * \return Name encoded in UCS-2, names are encoded only on first call.
+ *
  * \ingroup Info
  */
 const unsigned char *GSM_GetNetworkName(const char *NetworkCode);
@@ -26,10 +30,44 @@ const unsigned char *GSM_GetNetworkName(const char *NetworkCode);
 /**
  * Find country name from given country code.
  *
+ * \return Name encoded in UCS-2, names are encoded only on first call.
+ *
  * \ingroup Info
  */
 const unsigned char *GSM_GetCountryName(const char *CountryCode);
 
+/**
+ * Find network name from given network code without any conversion.
+ *
+ * \param NetworkCode Network code, either "MCC MNC" or "MCCMNC".
+ * \return Name from \ref GSM_Networks (UTF-8) or NULL if not found.
+ *
+ * \ingroup Info
+ */
+const char *GSM_LookupNetworkName(const char *NetworkCode);
+
+/**
+ * Find country name from given country code without any conversion.
+ *
+ * \param CountryCode Country code, only first three digits are used,
+ * so network code can be passed as well.
+ * \return Name from \ref GSM_Countries (UTF-8) or NULL if not found.
+ *
+ * \ingroup Info
+ */
+const char *GSM_LookupCountryName(const char *CountryCode);
+
+/**
+ * Find network names for several network codes at once.
+ *
+ * \param NetworkCodes Array of network codes.
+ * \param Names Array where names will be stored, NULL for unknown codes.
+ * \param Count Number of codes to resolve.
+ *
+ * \ingroup Info
+ */
+void GSM_LookupNetworkNames(const char * const *NetworkCodes, const char **Names, size_t Count);
+
 /**
  * Structure for defining code-name mappings.
  *
@@ -41,14 +79,16 @@ typedef struct {
 } GSM_CodeName;
 
 /**
- * List of network codes, terminated by empty name/code.
+ * List of network codes, terminated by empty name/code. The list is
+ * sorted by MCC and numeric value of MNC.
  *
  * \ingroup Info
  */
 extern const GSM_CodeName GSM_Networks[];
 
 /**
- * List of country codes, terminated by empty name/code.
+ * List of country codes, terminated by empty name/code. The list is
+ * sorted by code.
  *
  * \ingroup Info
  */
@@ -706,6 +746,28 @@ typedef enum {
 	 * Reading og SMSes in text mode.
 	 */
 	F_READ_SMSTEXTMODE,
+	/**
+	 * Phone can not read phonebook ranges using AT+CPBR=first,last.
+	 */
+	F_NO_CPBR_RANGE,
+	/**
+	 * Phone can not handle OBEX packets bigger than 1 KiB.
+	 */
+	F_OBEX_SMALL_FRAME,
+	/**
+	 * Do not ask phone for OBEX Single Response Mode.
+	 */
+	F_OBEX_NO_SRM,
+	/**
+	 * Phone needs fixed delays after data transfers and protocol
+	 * switches instead of checking whether it is ready.
+	 */
+	F_FIXED_DELAYS,
+	/**
+	 * Phone needs acknowledgement of every FBUS2 frame written right
+	 * away instead of together with other acknowledgements.
+	 */
+	F_FBUS2_IMMEDIATE_ACK,
 
 	/**
 	 * Just marker of highest feature code, should not be used.
@@ -659,6 +659,27 @@ GSM_Error GSM_DecodeVCARD(GSM_Debug_Info * di, char *Buffer, size_t * Pos,
 			  GSM_MemoryEntry * Pbk,
 			  const GSM_VCardVersion Version);
 
+/**
+ * Decodes memory entry from vCard buffer of known length. This should
+ * be preferred over \ref GSM_DecodeVCARD when reading many entries
+ * from one buffer.
+ *
+ * \param di Pointer to debugging description.
+ * \param[in] Buffer Buffer to readCard text.
+ * \param[in] Length Length of data in buffer.
+ * \param[in,out] Pos Position in output buffer.
+ * \param[out] Pbk Phonebook data read from vCard.
+ * \param[in] Version What vCard version to parse.
+ *
+ * \return Error code.
+ *
+ * \ingroup Memory
+ */
+GSM_Error GSM_DecodeVCARDLength(GSM_Debug_Info * di, char *Buffer,
+				size_t Length, size_t * Pos,
+				GSM_MemoryEntry * Pbk,
+				const GSM_VCardVersion Version);
+
 /**
  * Frees any dynamically allocated memory inside memory
  * entry structure.
@@ -1013,6 +1013,11 @@ typedef struct {
 	int Class;
 	unsigned char ReplaceMessage;
 	gboolean Unknown;
+	/**
+	 * Concatenation reference of linked message, -1 to make it
+	 * from current time.
+	 */
+	int Reference;
 	GSM_MultiPartSMSEntry Entries[GSM_MAX_MULTI_SMS];
 } GSM_MultiPartSMSInfo;
 
@@ -1062,9 +1067,57 @@ void GSM_ClearMultiPartSMSInfo(GSM_MultiPartSMSInfo * Info);
  */
 void GSM_FreeMultiPartSMSInfo(GSM_MultiPartSMSInfo * Info);
 
+/**
+ * Context for sending same message to several recipients, message is
+ * encoded only once and then only recipient specific fields are
+ * changed.
+ *
+ * \ingroup SMS
+ */
+typedef struct {
+	/**
+	 * Encoded message, recipient specific fields are not set. Fill
+	 * it by @ref GSM_EncodeMultiPartSMS or any other way of
+	 * creating message.
+	 */
+	GSM_MultiSMSMessage Template;
+	/**
+	 * Concatenation reference for next message, -1 to take it from
+	 * template. Set it to -1 whenever template is filled.
+	 */
+	int Reference;
+} GSM_MultiPartSMSContext;
+
+/**
+ * Creates message for single recipient from encoded context. Only
+ * used parts of the template are copied.
+ *
+ * \param di Debug information.
+ * \param Context Context with filled template.
+ * \param SMS Storage for created message.
+ * \param Number Recipient number (unicode), NULL to keep template one.
+ * \param Validity Message validity, NULL to keep template one.
+ * \param MessageReference TP-Message-Reference, -1 to keep template one.
+ * \param Reference Concatenation reference of linked message, -1 to
+ * use next one from context.
+ *
+ * \return Error code.
+ *
+ * \ingroup SMS
+ */
+GSM_Error GSM_StampMultiPartSMS(GSM_Debug_Info * di,
+				GSM_MultiPartSMSContext * Context,
+				GSM_MultiSMSMessage * SMS,
+				const unsigned char *Number,
+				const GSM_SMSValidity * Validity,
+				int MessageReference, int Reference);
+
 /**
  * Links SMS messages according to IDs.
  *
+ * Only used parts of input messages are read, output messages are
+ * always allocated in full size.
+ *
  * \return Error code.
  *
  * \ingroup SMS
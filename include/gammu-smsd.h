@@ -29,6 +29,128 @@ typedef struct _GSM_SMSDConfig GSM_SMSDConfig;
  */
 #define SMSD_TEXT_LENGTH 255
 
+/**
+ * Counters kept in SMSD metrics.
+ *
+ * \ingroup SMSD
+ */
+typedef enum {
+	/**
+	 * Number of connections to phone (including reconnects).
+	 */
+	SMSD_COUNTER_PHONE_CONNECTS = 0,
+	/**
+	 * Number of reconnects to database.
+	 */
+	SMSD_COUNTER_DB_RECONNECTS,
+	/**
+	 * Number of failed database queries.
+	 */
+	SMSD_COUNTER_DB_ERRORS,
+	/**
+	 * Number of successfully sent message parts.
+	 */
+	SMSD_COUNTER_PARTS_SENT,
+	/**
+	 * Number of message parts which failed to be sent.
+	 */
+	SMSD_COUNTER_PARTS_FAILED,
+	/**
+	 * Number of retried attempts to send message.
+	 */
+	SMSD_COUNTER_SEND_RETRIES,
+	/**
+	 * Number of received message parts.
+	 */
+	SMSD_COUNTER_PARTS_RECEIVED,
+	/**
+	 * Number of counters, not a valid counter.
+	 */
+	SMSD_COUNTER_LAST
+} GSM_SMSDCounter;
+
+/**
+ * Latency histograms kept in SMSD metrics.
+ *
+ * \ingroup SMSD
+ */
+typedef enum {
+	/**
+	 * Time to send message part by phone, including waiting for
+	 * network confirmation.
+	 */
+	SMSD_HISTOGRAM_PHONE_SEND = 0,
+	/**
+	 * Time to execute database query.
+	 */
+	SMSD_HISTOGRAM_DB_QUERY,
+	/**
+	 * Time between reading message from phone and storing it in
+	 * backend.
+	 */
+	SMSD_HISTOGRAM_RECEIVE_STORE,
+	/**
+	 * Number of histograms, not a valid histogram.
+	 */
+	SMSD_HISTOGRAM_LAST
+} GSM_SMSDHistogramType;
+
+/**
+ * Number of buckets in SMSD latency histograms.
+ */
+#define SMSD_HISTOGRAM_BUCKETS 12
+
+/**
+ * Latency histogram with fixed buckets.
+ *
+ * \ingroup SMSD
+ */
+typedef struct {
+	/**
+	 * Number of observations per bucket (not cumulative).
+	 */
+	unsigned long long Buckets[SMSD_HISTOGRAM_BUCKETS];
+	/**
+	 * Total number of observations.
+	 */
+	unsigned long long Count;
+	/**
+	 * Sum of all observations in milliseconds.
+	 */
+	unsigned long long Sum;
+} GSM_SMSDHistogram;
+
+/**
+ * Extended SMSD metrics. Updates are bracketed by increasing Sequence,
+ * so consistent copy can be made without locking while Sequence is
+ * even and unchanged.
+ *
+ * \ingroup SMSD
+ */
+typedef struct {
+	/**
+	 * Sequence counter, odd while update is in progress.
+	 */
+	volatile unsigned int Sequence;
+	/**
+	 * Upper bounds of histogram buckets in milliseconds, last
+	 * bucket is unbounded and has 0 here.
+	 */
+	unsigned int BucketLimits[SMSD_HISTOGRAM_BUCKETS];
+	/**
+	 * Monotonic counters, indexed by \ref GSM_SMSDCounter.
+	 */
+	unsigned long long Counters[SMSD_COUNTER_LAST];
+	/**
+	 * Latency histograms, indexed by \ref GSM_SMSDHistogramType.
+	 */
+	GSM_SMSDHistogram Histograms[SMSD_HISTOGRAM_LAST];
+	/**
+	 * Number of messages waiting in phone memory on last check.
+	 */
+	int InboxQueue;
+} GSM_SMSDMetrics;
+
 /**
  * Status structure, which can be found in shared memory (if supported
  * on platform).
@@ -37,7 +159,7 @@ typedef struct _GSM_SMSDConfig GSM_SMSDConfig;
  */
 typedef struct {
 	/**
-	 * Version of this structure (1 for now).
+	 * Version of this structure (2 for now).
 	 */
 	int Version;
 	/**
@@ -72,6 +194,10 @@ typedef struct {
 	 * Phone IMEI.
 	 */
 	char IMEI[GSM_MAX_IMEI_LENGTH + 1];
+	/**
+	 * Extended metrics.
+	 */
+	GSM_SMSDMetrics Metrics;
 } GSM_SMSDStatus;
 
 /**
@@ -89,7 +215,25 @@ typedef struct {
 GSM_Error SMSD_InjectSMS(GSM_SMSDConfig * Config, GSM_MultiSMSMessage * sms, char *NewID);
 
 /**
- * Gets SMSD status via shared memory.
+ * Enqueues several SMS messages in SMS daemon queue using single
+ * connection to the backend. SQL backends store all messages in single
+ * transaction, so either all of them or none is stored.
+ *
+ * \param Config SMSD configuration pointer.
+ * \param sms Array of messages to send.
+ * \param count Number of messages in the array.
+ * \param NewIDs Array of count pointers to strings where IDs of new
+ * messages will be written. Can be NULL and then it is ignored.
+ *
+ * \return Error code
+ *
+ * \ingroup SMSD
+ */
+GSM_Error SMSD_InjectSMSBatch(GSM_SMSDConfig * Config, GSM_MultiSMSMessage * sms, int count, char **NewIDs);
+
+/**
+ * Gets SMSD status via shared memory. The copy is consistent even
+ * while SMSD is updating metrics.
  *
  * \param Config SMSD configuration pointer.
  * \param status pointer where status will be copied
@@ -111,6 +255,20 @@ GSM_Error SMSD_GetStatus(GSM_SMSDConfig * Config, GSM_SMSDStatus * status);
  */
 GSM_Error SMSD_Shutdown(GSM_SMSDConfig * Config);
 
+/**
+ * Wakes up SMSD main loop, so that it checks outbox without waiting
+ * for CommTimeout. It can be called from any thread of the process,
+ * other processes should use \ref SMSD_InjectSMS which wakes up daemon
+ * on its own.
+ *
+ * \param Config Pointer to SMSD configuration data.
+ *
+ * \return Error code
+ *
+ * \ingroup SMSD
+ */
+GSM_Error SMSD_WakeUp(GSM_SMSDConfig * Config);
+
 /**
  * Reads SMSD configuration.
  *
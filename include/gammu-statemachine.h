@@ -101,6 +101,11 @@ typedef struct {
 	 * Phone features override.
 	 */
 	GSM_Feature PhoneFeatures[GSM_MAX_PHONE_FEATURES + 1];
+	/**
+	 * Directory where probed phone capabilities are cached, NULL
+	 * disables caching.
+	 */
+	char *CapabilityCache;
 } GSM_Config;
 
 /**
@@ -196,6 +201,24 @@ GSM_Error GSM_AbortOperation(GSM_StateMachine * s);
  */
 int GSM_ReadDevice(GSM_StateMachine * s, gboolean waitforreply);
 
+/**
+ * Returns file descriptor used for communication with phone. This can
+ * be used for integrating Gammu into event loop - once descriptor
+ * becomes readable, call \ref GSM_ReadDevice to process incoming data.
+ *
+ * \ingroup StateMachine
+ *
+ * USB connections are not supported: libusb may use several descriptors
+ * internally and data are read by asynchronous transfers, so there is
+ * no single descriptor whose readability means data from phone.
+ * Callers have to poll \ref GSM_ReadDevice for these.
+ *
+ * \param s State machine data
+ * \return File descriptor or -1 if not connected or connection type
+ * does not use one (USB or any connection on Windows).
+ */
+int GSM_GetDeviceFD(GSM_StateMachine * s);
+
 /**
  * Detects whether state machine is connected.
  *
@@ -1745,10 +1745,23 @@ GSM_Error GSM_SetFileAttributes(GSM_StateMachine *s, GSM_File *File)
 GSM_Error GSM_GetFilePart(GSM_StateMachine *s, GSM_File *File, int *Handle, int *Size)
 {
 	GSM_Error err;
+	size_t old;
 
 	CHECK_PHONE_CONNECTION();
 
+	old = File->Used;
+	s->Phone.Data.FilePartSink = (s->User.FilePart != NULL);
+	s->Phone.Data.FilePartStreamed = FALSE;
+
 	err = s->Phone.Functions->GetFilePart(s, File, Handle, Size);
+
+	/* Driver stored data in buffer, pass new ones to callback */
+	if (s->Phone.Data.FilePartSink && !s->Phone.Data.FilePartStreamed &&
+			(err == ERR_NONE || err == ERR_EMPTY || err == ERR_WRONGCRC) &&
+			File->Buffer != NULL && File->Used > old) {
+		s->User.FilePart(s, File, File->Buffer + old, File->Used - old, s->User.FilePartUserData);
+	}
+	s->Phone.Data.FilePartSink = FALSE;
 	PRINT_LOG_ERROR(err);
 	return err;
 }
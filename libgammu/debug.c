@@ -258,7 +258,7 @@ int smfprintf(GSM_Debug_Info *d, const char *format, ...)
 
 
 PRINTF_STYLE(2, 3)
-int smprintf(GSM_StateMachine *s, const char *format, ...)
+int (smprintf)(GSM_StateMachine *s, const char *format, ...)
 {
 	va_list		argp;
 	int 		result=0;
@@ -275,7 +275,7 @@ int smprintf(GSM_StateMachine *s, const char *format, ...)
 }
 
 PRINTF_STYLE(3, 4)
-int smprintf_level(GSM_StateMachine * s, GSM_DebugSeverity severity, const char *format, ...)
+int (smprintf_level)(GSM_StateMachine * s, GSM_DebugSeverity severity, const char *format, ...)
 {
 	va_list		argp;
 	int 		result=0;
@@ -104,4 +104,24 @@ typedef enum {
 PRINTF_STYLE(3, 4)
 int smprintf_level(GSM_StateMachine * s, GSM_DebugSeverity severity, const char *format, ...);
 
+/**
+ * Checks whether state machine has any debug output enabled.
+ *
+ * \param s State machine, where to print.
+ *
+ * \ingroup Debug
+ */
+#define GSM_DebugEnabled(s) (GSM_GetDI(s)->dl != DL_NONE)
+
+#ifdef __GNUC__
+/*
+ * Check debug level before calling the functions, so that arguments
+ * are not evaluated and nothing is formatted with disabled logging.
+ */
+#define smprintf(s, ...) \
+	(GSM_DebugEnabled(s) ? (smprintf)(s, __VA_ARGS__) : 0)
+#define smprintf_level(s, severity, ...) \
+	(GSM_DebugEnabled(s) ? (smprintf_level)(s, severity, __VA_ARGS__) : 0)
+#endif
+
 #endif
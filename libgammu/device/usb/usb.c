@@ -11,6 +11,7 @@
 #include <gammu-config.h>
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef LIBUSB_FOUND
@@ -422,6 +423,15 @@ GSM_Error GSM_USB_Init(GSM_StateMachine *s)
 	int rc;
 
 	d->handle = NULL;
+	d->async = FALSE;
+	d->async_stopping = FALSE;
+	d->async_error = 0;
+	d->read_pending = 0;
+	memset(d->read_transfers, 0, sizeof(d->read_transfers));
+	d->ring = NULL;
+	d->ring_size = 0;
+	d->ring_start = 0;
+	d->ring_used = 0;
 
 	rc = libusb_init(&d->context);
 	if (rc != 0) {
@@ -433,11 +443,238 @@ GSM_Error GSM_USB_Init(GSM_StateMachine *s)
 	return ERR_NONE;
 }
 
+/**
+ * Stores received data in ring buffer, growing it if needed.
+ */
+static gboolean GSM_USB_RingPut(GSM_Device_USBData *d, const unsigned char *data, size_t length)
+{
+	unsigned char *ring;
+	size_t size, end, part;
+
+	if (d->ring_used + length > d->ring_size) {
+		size = d->ring_size;
+		while (d->ring_used + length > size) {
+			size *= 2;
+		}
+		ring = (unsigned char *)malloc(size);
+		if (ring == NULL) {
+			return FALSE;
+		}
+		/* Unwrap current content to the beginning of new buffer */
+		part = MIN(d->ring_used, d->ring_size - d->ring_start);
+		memcpy(ring, d->ring + d->ring_start, part);
+		memcpy(ring + part, d->ring, d->ring_used - part);
+		free(d->ring);
+		d->ring = ring;
+		d->ring_size = size;
+		d->ring_start = 0;
+	}
+
+	end = (d->ring_start + d->ring_used) % d->ring_size;
+	part = MIN(length, d->ring_size - end);
+	memcpy(d->ring + end, data, part);
+	memcpy(d->ring, data + part, length - part);
+	d->ring_used += length;
+
+	return TRUE;
+}
+
+/**
+ * Reads data from ring buffer.
+ */
+static size_t GSM_USB_RingGet(GSM_Device_USBData *d, unsigned char *buf, size_t nbytes)
+{
+	size_t length, part;
+
+	length = MIN(nbytes, d->ring_used);
+	part = MIN(length, d->ring_size - d->ring_start);
+	memcpy(buf, d->ring + d->ring_start, part);
+	memcpy(buf + part, d->ring, length - part);
+	d->ring_start = (d->ring_start + length) % d->ring_size;
+	d->ring_used -= length;
+	if (d->ring_used == 0) {
+		d->ring_start = 0;
+	}
+
+	return length;
+}
+
+/**
+ * Completion callback for bulk-IN transfers, stores received data and
+ * queues transfer again.
+ */
+static void LIBUSB_CALL GSM_USB_ReadCallback(struct libusb_transfer *transfer)
+{
+	GSM_StateMachine *s = transfer->user_data;
+	GSM_Device_USBData *d = &s->Device.Data.USB;
+	int rc;
+
+	d->read_pending--;
+
+	switch (transfer->status) {
+		case LIBUSB_TRANSFER_COMPLETED:
+		case LIBUSB_TRANSFER_TIMED_OUT:
+			if (!GSM_USB_RingPut(d, transfer->buffer, transfer->actual_length)) {
+				d->async_error = LIBUSB_ERROR_NO_MEM;
+				return;
+			}
+			break;
+		case LIBUSB_TRANSFER_CANCELLED:
+			return;
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			d->async_error = LIBUSB_ERROR_NO_DEVICE;
+			return;
+		case LIBUSB_TRANSFER_STALL:
+			d->async_error = LIBUSB_ERROR_PIPE;
+			return;
+		case LIBUSB_TRANSFER_OVERFLOW:
+			d->async_error = LIBUSB_ERROR_OVERFLOW;
+			return;
+		case LIBUSB_TRANSFER_ERROR:
+		default:
+			d->async_error = LIBUSB_ERROR_IO;
+			return;
+	}
+
+	if (d->async_stopping) {
+		return;
+	}
+
+	rc = libusb_submit_transfer(transfer);
+	if (rc != 0) {
+		d->async_error = rc;
+		return;
+	}
+	d->read_pending++;
+}
+
+/**
+ * Cancels queued transfers and frees all resources used by
+ * asynchronous mode.
+ *
+ * Transfers can not be freed while they are in flight, so when they do
+ * not complete in GSM_USB_STOP_ROUNDS rounds of event handling, nothing
+ * is freed, asynchronous mode stays active and error is returned.
+ */
+static GSM_Error GSM_USB_StopAsync(GSM_StateMachine *s)
+{
+	GSM_Device_USBData *d = &s->Device.Data.USB;
+	struct timeval tv;
+	int i, rc, round;
+
+	d->async_stopping = TRUE;
+
+	for (i = 0; i < GSM_USB_READ_TRANSFERS; i++) {
+		if (d->read_transfers[i] != NULL) {
+			libusb_cancel_transfer(d->read_transfers[i]);
+		}
+	}
+
+	for (round = 0; d->read_pending > 0 && round < GSM_USB_STOP_ROUNDS; round++) {
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		rc = libusb_handle_events_timeout_completed(d->context, &tv, NULL);
+		if (rc != 0 && rc != LIBUSB_ERROR_INTERRUPTED) {
+			smprintf(s, "Failed to wait for cancelled transfers (%d)!\n", rc);
+			usleep(100000);
+		}
+	}
+
+	if (d->read_pending > 0) {
+		smprintf(s, "%d read transfers still pending, can not free them!\n", d->read_pending);
+		return ERR_DEVICEBUSY;
+	}
+
+	for (i = 0; i < GSM_USB_READ_TRANSFERS; i++) {
+		if (d->read_transfers[i] != NULL) {
+			free(d->read_transfers[i]->buffer);
+			libusb_free_transfer(d->read_transfers[i]);
+			d->read_transfers[i] = NULL;
+		}
+	}
+
+	free(d->ring);
+	d->ring = NULL;
+	d->ring_size = 0;
+	d->ring_start = 0;
+	d->ring_used = 0;
+	d->async = FALSE;
+	d->async_stopping = FALSE;
+
+	return ERR_NONE;
+}
+
+/**
+ * Queues bulk-IN transfers for asynchronous reading. When this fails,
+ * synchronous reading is used.
+ */
+GSM_Error GSM_USB_StartAsync(GSM_StateMachine *s)
+{
+	GSM_Device_USBData *d = &s->Device.Data.USB;
+	GSM_Error error;
+	unsigned char *buffer;
+	int i, rc;
+
+	d->async_error = 0;
+	d->async_stopping = FALSE;
+	d->read_pending = 0;
+
+	d->ring = (unsigned char *)malloc(GSM_USB_RING_SIZE);
+	if (d->ring == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	d->ring_size = GSM_USB_RING_SIZE;
+	d->ring_start = 0;
+	d->ring_used = 0;
+	d->async = TRUE;
+
+	for (i = 0; i < GSM_USB_READ_TRANSFERS; i++) {
+		d->read_transfers[i] = libusb_alloc_transfer(0);
+		buffer = (unsigned char *)malloc(GSM_USB_READ_SIZE);
+		if (d->read_transfers[i] == NULL || buffer == NULL) {
+			free(buffer);
+			error = GSM_USB_StopAsync(s);
+			return error != ERR_NONE ? error : ERR_MOREMEMORY;
+		}
+		libusb_fill_bulk_transfer(d->read_transfers[i], d->handle, d->ep_read,
+			buffer, GSM_USB_READ_SIZE, GSM_USB_ReadCallback, s, 0);
+		rc = libusb_submit_transfer(d->read_transfers[i]);
+		if (rc != 0) {
+			smprintf(s, "Failed to submit read transfer (%d)!\n", rc);
+			libusb_free_transfer(d->read_transfers[i]);
+			d->read_transfers[i] = NULL;
+			free(buffer);
+			error = GSM_USB_StopAsync(s);
+			return error != ERR_NONE ? error : GSM_USB_Error(s, rc);
+		}
+		d->read_pending++;
+	}
+
+	smprintf(s, "Queued %d read transfers\n", GSM_USB_READ_TRANSFERS);
+
+	return ERR_NONE;
+}
+
 GSM_Error GSM_USB_Terminate(GSM_StateMachine *s)
 {
 	GSM_Device_USBData *d = &s->Device.Data.USB;
+	GSM_Error error;
 	int rc;
 
+	if (d->async) {
+		error = GSM_USB_StopAsync(s);
+		if (error != ERR_NONE) {
+			/*
+			 * Transfers still in flight reference the handle and
+			 * context, so leak them instead of freeing under libusb.
+			 */
+			smprintf(s, "Leaving USB device open, transfers did not complete!\n");
+			d->handle = NULL;
+			d->context = NULL;
+			return error;
+		}
+	}
+
 	if (d->handle != NULL) {
 		rc = libusb_set_interface_alt_setting(d->handle, d->data_iface, d->data_idlesetting);
 		if (rc != 0) {
@@ -465,11 +702,49 @@ GSM_Error GSM_USB_Terminate(GSM_StateMachine *s)
 	return ERR_NONE;
 }
 
+/**
+ * Reads data from ring buffer filled by queued transfers. Waits only
+ * shortly for new data so that caller is not blocked when phone is
+ * silent.
+ */
+static int GSM_USB_ReadAsync(GSM_StateMachine *s, void *buf, size_t nbytes)
+{
+	GSM_Device_USBData *d = &s->Device.Data.USB;
+	struct timeval tv;
+	int rc;
+
+	if (d->ring_used == 0 && d->async_error == 0) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 5000;
+		rc = libusb_handle_events_timeout_completed(d->context, &tv, NULL);
+		if (rc != 0 && rc != LIBUSB_ERROR_INTERRUPTED) {
+			smprintf(s, "Failed to handle usb events (%d)!\n", rc);
+			GSM_USB_Error(s, rc);
+			return -1;
+		}
+	}
+
+	if (d->ring_used == 0) {
+		if (d->async_error != 0) {
+			smprintf(s, "Failed to read from usb (%d)!\n", d->async_error);
+			GSM_USB_Error(s, d->async_error);
+			return -1;
+		}
+		return 0;
+	}
+
+	return GSM_USB_RingGet(d, buf, nbytes);
+}
+
 int GSM_USB_Read(GSM_StateMachine *s, void *buf, size_t nbytes)
 {
 	GSM_Device_USBData *d = &s->Device.Data.USB;
 	int rc = LIBUSB_ERROR_TIMEOUT, ret = 0, repeat = 0;
 
+	if (d->async) {
+		return GSM_USB_ReadAsync(s, buf, nbytes);
+	}
+
 	while (repeat < 10 && (rc == LIBUSB_ERROR_TIMEOUT || rc == LIBUSB_ERROR_INTERRUPTED || rc == LIBUSB_ERROR_OTHER || rc == LIBUSB_ERROR_NO_MEM)) {
 		rc = libusb_bulk_transfer(d->handle, d->ep_read, buf, nbytes, &ret, 1000);
 		/* This seems to be some strange failure on partial data transfer */
@@ -670,6 +945,15 @@ GSM_Error FBUSUSB_Open(GSM_StateMachine *s)
 	error = GSM_USB_Probe(s, FBUSUSB_Match);
 	if (error != ERR_NONE) return error;
 
+	error = GSM_USB_StartAsync(s);
+	if (error != ERR_NONE) {
+		if (s->Device.Data.USB.async) {
+			/* Transfers could not be cancelled, can not continue */
+			return error;
+		}
+		smprintf(s, "Asynchronous reading not available, falling back to synchronous!\n");
+	}
+
 	return ERR_NONE;
 }
 
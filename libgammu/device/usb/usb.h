@@ -23,6 +23,28 @@
 #define struct_libusb_device_descriptor struct libusb_device_descriptor
 #endif
 
+/**
+ * Number of bulk-IN transfers kept queued in asynchronous mode.
+ */
+#define GSM_USB_READ_TRANSFERS 4
+
+/**
+ * Size of buffer for single bulk-IN transfer.
+ */
+#define GSM_USB_READ_SIZE 4096
+
+/**
+ * Initial size of ring buffer collecting received data, it grows
+ * when application does not read data fast enough.
+ */
+#define GSM_USB_RING_SIZE (4 * GSM_USB_READ_TRANSFERS * GSM_USB_READ_SIZE)
+
+/**
+ * How many times to wait (one second each) for cancelled transfers
+ * before giving up on freeing them.
+ */
+#define GSM_USB_STOP_ROUNDS 10
+
 typedef struct {
     libusb_context *context;
     libusb_device_handle *handle;
@@ -34,7 +56,53 @@ typedef struct {
     int data_idlesetting;
     unsigned char ep_read;
     unsigned char ep_write;
+    /**
+     * Whether reading is done using queued asynchronous transfers.
+     */
+    gboolean async;
+    /**
+     * Set when asynchronous transfers are being cancelled.
+     */
+    gboolean async_stopping;
+    /**
+     * Last libusb error reported by asynchronous transfer.
+     */
+    int async_error;
+    /**
+     * Queued bulk-IN transfers.
+     */
+    struct libusb_transfer *read_transfers[GSM_USB_READ_TRANSFERS];
+    /**
+     * Number of submitted transfers which have not yet completed.
+     */
+    int read_pending;
+    /**
+     * Ring buffer with received data.
+     */
+    unsigned char *ring;
+    /**
+     * Allocated size of ring buffer.
+     */
+    size_t ring_size;
+    /**
+     * Offset of first unread byte in ring buffer.
+     */
+    size_t ring_start;
+    /**
+     * Number of unread bytes in ring buffer.
+     */
+    size_t ring_used;
 } GSM_Device_USBData;
 
 typedef gboolean (*GSM_USB_Match_Function)(GSM_StateMachine *s, libusb_device *dev, struct_libusb_device_descriptor *desc);
+
+GSM_Error GSM_USB_Init(GSM_StateMachine *s);
+GSM_Error GSM_USB_Terminate(GSM_StateMachine *s);
+/**
+ * Queues bulk-IN transfers for asynchronous reading. When this fails
+ * and asynchronous mode is still active afterwards, transfers could
+ * not be cancelled and device can not be used.
+ */
+GSM_Error GSM_USB_StartAsync(GSM_StateMachine *s);
+int GSM_USB_Read(GSM_StateMachine *s, void *buf, size_t nbytes);
 #endif
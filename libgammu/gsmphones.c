@@ -126,6 +126,11 @@ GSM_FeatureName AllFeatureNames[] = {
 	{"SMS_UTF8_ENCODED", F_SMS_UTF8_ENCODED},
 	{"NO_STOP_CUSD", F_NO_STOP_CUSD},
 	{"READ_SMSTEXTMODE", F_READ_SMSTEXTMODE},
+	{"NO_CPBR_RANGE", F_NO_CPBR_RANGE},
+	{"OBEX_SMALL_FRAME", F_OBEX_SMALL_FRAME},
+	{"OBEX_NO_SRM", F_OBEX_NO_SRM},
+	{"FIXED_DELAYS", F_FIXED_DELAYS},
+	{"FBUS2_IMMEDIATE_ACK", F_FBUS2_IMMEDIATE_ACK},
 	{"", 0},
 };
 
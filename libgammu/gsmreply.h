@@ -34,6 +34,7 @@ typedef enum {
 	ID_GetAlarm,
 	ID_GetMemory,
 	ID_GetMemoryStatus,
+	ID_GetMemoryRange,
 	ID_GetSMSC,
 	ID_GetSMSMessage,
 	ID_EnableEcho,
@@ -154,6 +155,7 @@ typedef enum {
 	ID_DeleteFile,
 	ID_ModeSwitch,
 	ID_GetProtocol,
+	ID_ATBatch,
 	ID_Screenshot,
 	ID_GetScreenSize,
 
@@ -169,6 +169,7 @@ GSM_Protocol_Functions NoProtocol = {
 	NONEFUNCTION,
 	NONEFUNCTION,
 	NONEFUNCTION,
+	NONEFUNCTION,
 	NONEFUNCTION
 };
 
@@ -884,9 +885,36 @@ int GSM_ReadDevice (GSM_StateMachine *s, gboolean waitforreply)
 	for (count = 0; count < res; count++) {
 		s->Protocol.Functions->StateMachine(s,buff[count]);
 	}
+	if (res > 0) {
+		s->Protocol.Functions->Flush(s);
+	}
 	return res;
 }
 
+int GSM_GetDeviceFD(GSM_StateMachine *s)
+{
+	if (!GSM_IsConnected(s)) {
+		return -1;
+	}
+#if defined(GSM_ENABLE_SERIALDEVICE) && !defined(WIN32) && !defined(DJGPP)
+	if (s->Device.Functions == &SerialDevice) {
+		return s->Device.Data.Serial.hPhone;
+	}
+#endif
+#if defined(GSM_ENABLE_IRDADEVICE) && !defined(WIN32) && !defined(DJGPP)
+	if (s->Device.Functions == &IrdaDevice) {
+		return s->Device.Data.Irda.hPhone;
+	}
+#endif
+#if defined(GSM_ENABLE_BLUETOOTHDEVICE) && !defined(WIN32)
+	if (s->Device.Functions == &BlueToothDevice) {
+		return s->Device.Data.BlueTooth.hPhone;
+	}
+#endif
+	/* USB has no single descriptor to watch, see header */
+	return -1;
+}
+
 GSM_Error GSM_TerminateConnection(GSM_StateMachine *s)
 {
 	GSM_Error error;
@@ -1362,6 +1390,14 @@ GSM_Error GSM_ReadConfig(INI_Section *cfg_info, GSM_Config *cfg, int num)
 	/* Set file locking */
 	cfg->LockDevice  = INI_GetBool(cfg_info, section, "use_locking", DefaultLockDevice);
 
+	/* Set capability cache */
+	free(cfg->CapabilityCache);
+	cfg->CapabilityCache = INI_GetValue(cfg_info, section, "capabilitycache", FALSE);
+	if (cfg->CapabilityCache != NULL) {
+		cfg->CapabilityCache = strdup(cfg->CapabilityCache);
+		GSM_ExpandUserPath(&cfg->CapabilityCache);
+	}
+
 	/* Set model */
 	Temp		 = INI_GetValue(cfg_info, section, "model", 		FALSE);
 	if (Temp == NULL || strcmp(Temp, "auto") == 0) {
@@ -1469,6 +1505,8 @@ fail:
 		strcpy(cfg->TextBirthday,"Birthday");
 		strcpy(cfg->TextMemo,"Memo");
 		cfg->PhoneFeatures[0] = 0;
+		free(cfg->CapabilityCache);
+		cfg->CapabilityCache = NULL;
 		/* Indicate that we used defaults */
 		return ERR_USING_DEFAULTS;
 	}
@@ -1614,6 +1652,32 @@ void GSM_SetSendSMSStatusCallback(GSM_StateMachine *s, SendSMSStatusCallback cal
 	s->User.SendSMSStatusUserData = user_data;
 }
 
+void GSM_SetFilePartCallback(GSM_StateMachine *s, FilePartCallback callback, void *user_data)
+{
+	s->User.FilePart = callback;
+	s->User.FilePartUserData = user_data;
+}
+
+GSM_Error GSM_AppendFilePart(GSM_StateMachine *s, GSM_File *File, const unsigned char *data, size_t length)
+{
+	unsigned char *buffer;
+
+	if (s->Phone.Data.FilePartSink) {
+		s->User.FilePart(s, File, data, length, s->User.FilePartUserData);
+		s->Phone.Data.FilePartStreamed = TRUE;
+		File->Used += length;
+		return ERR_NONE;
+	}
+	buffer = (unsigned char *)realloc(File->Buffer, File->Used + length);
+	if (buffer == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	File->Buffer = buffer;
+	memcpy(File->Buffer + File->Used, data, length);
+	File->Used += length;
+	return ERR_NONE;
+}
+
 GSM_StateMachine *GSM_AllocStateMachine(void)
 {
 	GSM_StateMachine *ret;
@@ -1637,6 +1701,8 @@ void GSM_FreeStateMachine(GSM_StateMachine *s)
 		s->Config[i].Connection = NULL;
 		free(s->Config[i].DebugFile);
 		s->Config[i].DebugFile = NULL;
+		free(s->Config[i].CapabilityCache);
+		s->Config[i].CapabilityCache = NULL;
 	}
 	free(s);
 	s = NULL;
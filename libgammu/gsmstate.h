@@ -343,6 +343,11 @@ typedef struct {
 	 * Protocol termination.
 	 */
 	GSM_Error (*Terminate)    (GSM_StateMachine *s);
+	/**
+	 * Called once all data from single read were processed, protocol
+	 * can write data it postponed (eg. acknowledgements).
+	 */
+	GSM_Error (*Flush)        (GSM_StateMachine *s);
 } GSM_Protocol_Functions;
 
 #ifdef GSM_ENABLE_MBUS2
@@ -625,6 +630,15 @@ typedef struct {
 	 * Pointer to structure used internally by phone drivers.
 	 */
 	GSM_File		*File;
+	/**
+	 * Whether received file data go to FilePart callback instead of
+	 * File->Buffer, set by @ref GSM_GetFilePart.
+	 */
+	gboolean		FilePartSink;
+	/**
+	 * Set when driver passed received file data to FilePart callback.
+	 */
+	gboolean		FilePartStreamed;
 	/**
 	 * Pointer to structure used internally by phone drivers.
 	 */
@@ -1360,11 +1374,13 @@ struct _GSM_User {
 	IncomingCBCallback IncomingCB;
 	IncomingUSSDCallback IncomingUSSD;
 	SendSMSStatusCallback SendSMSStatus;
+	FilePartCallback FilePart;
 	void * IncomingCallUserData;
 	void * IncomingSMSUserData;
 	void * IncomingCBUserData;
 	void * IncomingUSSDUserData;
 	void * SendSMSStatusUserData;
+	void * FilePartUserData;
 };
 
 /* --------------------------- Statemachine layer -------------------------- */
@@ -1453,6 +1469,12 @@ GSM_Error GSM_WaitFor			(GSM_StateMachine *s, unsigned const char *buffer,
 
 GSM_Error GSM_DispatchMessage		(GSM_StateMachine *s);
 
+/**
+ * Appends received file data to File->Buffer or passes them to
+ * FilePart callback when it is active.
+ */
+GSM_Error GSM_AppendFilePart		(GSM_StateMachine *s, GSM_File *File, const unsigned char *data, size_t length);
+
 void 	  GSM_DumpMessageLevel2		(GSM_StateMachine *s, unsigned const char *message, int messagesize, int type);
 void 	  GSM_DumpMessageLevel2Recv	(GSM_StateMachine *s, unsigned const char *message, int messagesize, int type);
 void 	  GSM_DumpMessageLevel3		(GSM_StateMachine *s, unsigned const char *message, int messagesize, int type);
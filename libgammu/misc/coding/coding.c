@@ -1297,7 +1297,7 @@ GSM_Error MyGetLine(char *Buffer, size_t *Pos, char *OutBuffer, size_t MaxLen, s
 	gboolean quoted_printable = FALSE;
 	gboolean was_cr = FALSE, was_lf = FALSE;
 	size_t pos;
-	int tmp;
+	size_t tmp;
 
 	OutBuffer[0] = 0;
 	pos = 0;
@@ -1329,10 +1329,10 @@ GSM_Error MyGetLine(char *Buffer, size_t *Pos, char *OutBuffer, size_t MaxLen, s
 					}
 					/* (vCard continuation) Next line start with space? */
 					tmp = *Pos + 1;
-					if (Buffer[*Pos + 1] == 0x0a || Buffer[*Pos + 1] == 0x0d) {
+					if (tmp < MaxLen && (Buffer[tmp] == 0x0a || Buffer[tmp] == 0x0d)) {
 						tmp += 1;
 					}
-					if (Buffer[tmp] == ' ') {
+					if (tmp < MaxLen && Buffer[tmp] == ' ') {
 						*Pos = tmp;
 						break;
 					}
@@ -1367,17 +1367,21 @@ GSM_Error MyGetLine(char *Buffer, size_t *Pos, char *OutBuffer, size_t MaxLen, s
 	return ERR_NONE;
 }
 
-GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t MaxLen, gboolean MergeLines)
+GSM_Error GSM_ReadVCSLine(char **OutBuffer, size_t *OutSize, const char *Buffer, size_t *Pos, size_t MaxLen, gboolean MergeLines)
 {
 	gboolean skip = FALSE;
 	gboolean quoted_printable = FALSE;
 	gboolean was_cr = FALSE, was_lf = FALSE;
 	size_t pos=0;
-	int tmp=0;
-	size_t OutLen = 200;
-
-	*OutBuffer = (char *)malloc(OutLen);
-	if (*OutBuffer == NULL) return ERR_MOREMEMORY;
+	size_t tmp=0;
+	char *NewBuffer;
+
+	if (*OutBuffer == NULL || *OutSize < 200) {
+		NewBuffer = (char *)realloc(*OutBuffer, 200);
+		if (NewBuffer == NULL) return ERR_MOREMEMORY;
+		*OutBuffer = NewBuffer;
+		*OutSize = 200;
+	}
 	(*OutBuffer)[0] = 0;
 	pos = 0;
 	if (Buffer == NULL) return ERR_NONE;
@@ -1409,10 +1413,10 @@ GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t Max
 					}
 					/* (vCard continuation) Next line start with space? */
 					tmp = *Pos + 1;
-					if (Buffer[*Pos + 1] == 0x0a || Buffer[*Pos + 1] == 0x0d) {
+					if (tmp < MaxLen && (Buffer[tmp] == 0x0a || Buffer[tmp] == 0x0d)) {
 						tmp += 1;
 					}
-					if (Buffer[tmp] == ' ') {
+					if (tmp < MaxLen && Buffer[tmp] == ' ') {
 						*Pos = tmp;
 						break;
 					}
@@ -1422,7 +1426,7 @@ GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t Max
 			break;
 		default:
 			/* Detect quoted printable for possible escaping */
-			if (Buffer[*Pos] == ':' &&
+			if (Buffer[*Pos] == ':' && !quoted_printable &&
 					strstr(*OutBuffer, ";ENCODING=QUOTED-PRINTABLE") != NULL) {
 				quoted_printable = TRUE;
 			}
@@ -1430,10 +1434,11 @@ GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t Max
 			(*OutBuffer)[pos]     = Buffer[*Pos];
 			pos++;
 			(*OutBuffer)[pos] = 0;
-			if (pos + 2 >= OutLen) {
-				OutLen += 100;
-				*OutBuffer = (char *)realloc(*OutBuffer, OutLen);
-				if (*OutBuffer == NULL) return ERR_MOREMEMORY;
+			if (pos + 2 >= *OutSize) {
+				NewBuffer = (char *)realloc(*OutBuffer, *OutSize * 2);
+				if (NewBuffer == NULL) return ERR_MOREMEMORY;
+				*OutBuffer = NewBuffer;
+				*OutSize *= 2;
 			}
 		}
 		(*Pos)++;
@@ -1441,6 +1446,14 @@ GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t Max
 	return ERR_NONE;
 }
 
+GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t MaxLen, gboolean MergeLines)
+{
+	size_t OutSize = 0;
+
+	*OutBuffer = NULL;
+	return GSM_ReadVCSLine(OutBuffer, &OutSize, Buffer, Pos, MaxLen, MergeLines);
+}
+
 
 void StringToDouble(char *text, double *d)
 {
@@ -133,6 +133,22 @@ void StringToDouble	(char *text, double *d);
  */
 GSM_Error GSM_GetVCSLine(char **OutBuffer, char *Buffer, size_t *Pos, size_t MaxLen, gboolean MergeLines);
 
+/**
+ * Gets VCS line from buffer into reusable line buffer.
+ *
+ * @param MergeLines: Determine whether merge lines as vCard style
+ * continuation or quoted printable continutaion.
+ * @param Buffer: Data source to parse.
+ * @param Pos: Current position in data.
+ * @param OutBuffer: Pointer to buffer pointer, which will be allocated
+ * or grown as needed. Can be reused for reading following lines.
+ * @param OutSize: Pointer to allocated size of OutBuffer.
+ * @param MaxLen: Maximal length of data to process.
+ *
+ * \return ERR_NONE on success, ERR_MOREMEMORY if allocation fails.
+ */
+GSM_Error GSM_ReadVCSLine(char **OutBuffer, size_t *OutSize, const char *Buffer, size_t *Pos, size_t MaxLen, gboolean MergeLines);
+
 /**
  * Gets line from buffer.
  *
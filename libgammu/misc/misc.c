@@ -385,7 +385,10 @@ void InitLines(GSM_CutLines *lines)
 {
 	lines->numbers = NULL;
 	lines->allocated = 0;
+	lines->count = 0;
+	lines->used = 0;
 	lines->retval = NULL;
+	lines->retval_size = 0;
 }
 
 void FreeLines(GSM_CutLines *lines)
@@ -393,8 +396,11 @@ void FreeLines(GSM_CutLines *lines)
 	free(lines->numbers);
 	lines->numbers = NULL;
 	lines->allocated = 0;
+	lines->count = 0;
+	lines->used = 0;
 	free(lines->retval);
 	lines->retval = NULL;
+	lines->retval_size = 0;
 }
 
 void SplitLines(const char *message, const int messagesize, GSM_CutLines *lines,
@@ -402,26 +408,29 @@ void SplitLines(const char *message, const int messagesize, GSM_CutLines *lines,
 	const char *quotes, const int quoteslen,
 	const gboolean eot)
 {
-	int 	 i=0,number=0,j=0, lastquote = -1;
+	int 	 i=0,number=0,j=0, lastquote = -1, newsize;
 	gboolean whitespace = TRUE, nowwhite = FALSE, insidequotes = FALSE;
 
-	/* Clean current lines */
-	for (i = 0; i < lines->allocated; i++) {
-		lines->numbers[i] = 0;
-	}
+	lines->count = 0;
 
 	/* Go through message */
 	for (i = 0; i < messagesize; i++) {
-		/* Reallocate buffer if needed */
+		/*
+		 * Reallocate buffer if needed, it grows geometrically as
+		 * replies with thousands of lines are quite common.
+		 */
 		if (number + 1 >= lines->allocated - 1) {
-			lines->allocated += 20;
-			lines->numbers = (int *)realloc(lines->numbers, lines->allocated * sizeof(int));
+			newsize = lines->allocated < 32 ? 64 : lines->allocated * 2;
+			lines->numbers = (int *)realloc(lines->numbers, newsize * sizeof(int));
 			if (lines->numbers == NULL) {
+				lines->allocated = 0;
+				lines->used = 0;
 				return;
 			}
-			for (j = lines->allocated - 20; j < lines->allocated; j++) {
+			for (j = lines->allocated; j < newsize; j++) {
 				lines->numbers[j] = 0;
 			}
+			lines->allocated = newsize;
 		}
 
 		nowwhite = FALSE;
@@ -476,7 +485,23 @@ rollback_quote:
 	/* Store possible end if there was not just whitespace */
     	if (eot && !whitespace) {
 		lines->numbers[number] = messagesize;
+		number++;
+	}
+
+	/*
+	 * Clean cut points left from previous split, we do not touch
+	 * rest of the buffer as it was not used.
+	 */
+	for (j = number; j < lines->used; j++) {
+		lines->numbers[j] = 0;
 	}
+	lines->used = number;
+	lines->count = number / 2;
+}
+
+int GetLineCount(const GSM_CutLines *lines)
+{
+	return lines->count;
 }
 
 const char *GetLineStringPos(const char *message, const GSM_CutLines *lines, int start)
@@ -500,10 +525,15 @@ const char *GetLineString(const char *message, GSM_CutLines *lines, int start)
 
 	len = GetLineLength(message, lines, start);
 
-	lines->retval = (char *)realloc(lines->retval, len + 1);
-	if (lines->retval == NULL) {
-		dbgprintf(NULL, "Allocation failed!\n");
-		return NULL;
+	/* Buffer is reused for all lines, so grow it only when needed */
+	if (lines->retval == NULL || (size_t)len + 1 > lines->retval_size) {
+		lines->retval_size = (size_t)len + 1 < 2 * lines->retval_size ? 2 * lines->retval_size : (size_t)len + 1;
+		lines->retval = (char *)realloc(lines->retval, lines->retval_size);
+		if (lines->retval == NULL) {
+			lines->retval_size = 0;
+			dbgprintf(NULL, "Allocation failed!\n");
+			return NULL;
+		}
 	}
 
 	memcpy(lines->retval, pos, len);
@@ -518,6 +548,37 @@ int GetLineLength(const char *message UNUSED, const GSM_CutLines *lines, int sta
 	return lines->numbers[start*2-2+1] - lines->numbers[start*2-2];
 }
 
+gboolean LineEquals(const char *message, const GSM_CutLines *lines, int start, const char *text)
+{
+	size_t len = strlen(text);
+
+	return GetLineLength(message, lines, start) == (int)len &&
+		memcmp(GetLineStringPos(message, lines, start), text, len) == 0;
+}
+
+gboolean LineStartsWith(const char *message, const GSM_CutLines *lines, int start, const char *text)
+{
+	size_t len = strlen(text);
+
+	return GetLineLength(message, lines, start) >= (int)len &&
+		memcmp(GetLineStringPos(message, lines, start), text, len) == 0;
+}
+
+char *DupLineString(const char *message, const GSM_CutLines *lines, int start)
+{
+	int len;
+	char *result;
+
+	len = GetLineLength(message, lines, start);
+	result = (char *)malloc(len + 1);
+	if (result == NULL) {
+		return NULL;
+	}
+	memcpy(result, GetLineStringPos(message, lines, start), len);
+	result[len] = '\0';
+	return result;
+}
+
 void CopyLineString(char *dest, const char *src, const GSM_CutLines *lines, int start)
 {
 	int len;
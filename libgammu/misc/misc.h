@@ -40,10 +40,23 @@ typedef struct {
 	 * Number of currently allocated entries.
 	 */
 	int allocated;
+	/**
+	 * Number of lines found by last split.
+	 */
+	int count;
+	/**
+	 * Number of cut points written by last split, entries behind
+	 * this are zero.
+	 */
+	int used;
 	/**
 	 * Storage for return value.
 	 */
 	char *retval;
+	/**
+	 * Allocated size of return value storage.
+	 */
+	size_t retval_size;
 } GSM_CutLines;
 
 /**
@@ -51,6 +64,50 @@ typedef struct {
  */
 void SplitLines(const char *message, const int messagesize, GSM_CutLines *lines, const char *whitespaces, const int spaceslen, const char *quotes, const int quoteslen, const gboolean eot);
 
+/**
+ * Returns number of lines found by last SplitLines call.
+ */
+int GetLineCount(const GSM_CutLines *lines);
+
+/**
+ * Returns pointer to beginning of line inside of message, the line is
+ * not terminated, use GetLineLength to get its length.
+ *
+ * @param message Parsed message.
+ * @param lines Parsed lines information.
+ * @param start Which line we want.
+ */
+const char *GetLineStringPos(const char *message, const GSM_CutLines *lines, int start);
+
+/**
+ * Checks whether line equals to text without copying it.
+ *
+ * @param message Parsed message.
+ * @param lines Parsed lines information.
+ * @param start Which line we want.
+ * @param text Text to compare.
+ */
+gboolean LineEquals(const char *message, const GSM_CutLines *lines, int start, const char *text);
+
+/**
+ * Checks whether line starts with text without copying it.
+ *
+ * @param message Parsed message.
+ * @param lines Parsed lines information.
+ * @param start Which line we want.
+ * @param text Text to compare.
+ */
+gboolean LineStartsWith(const char *message, const GSM_CutLines *lines, int start, const char *text);
+
+/**
+ * Returns newly allocated copy of line, caller has to free it.
+ *
+ * @param message Parsed message.
+ * @param lines Parsed lines information.
+ * @param start Which line we want.
+ */
+char *DupLineString(const char *message, const GSM_CutLines *lines, int start);
+
 /**
  * Returns pointer to static buffer containing line.
  *
@@ -0,0 +1,311 @@
+/* (c) 2015 by Michal Cihar */
+
+/**
+ * @file at-cache.c
+ * @author Michal Čihař
+ */
+/**
+ * @ingroup Phone
+ * @{
+ */
+/**
+ * @addtogroup ATPhone
+ * @{
+ */
+
+#include <gammu-config.h>
+
+#ifdef GSM_ENABLE_ATGEN
+
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include <gammu-inifile.h>
+
+#include "../../gsmcomon.h"
+#include "../../gsmphones.h"
+#include "../pfunc.h"
+
+#include "atgen.h"
+#include "atfunc.h"
+
+/**
+ * Section name used in capability cache file.
+ */
+#define AT_CACHE_SECTION "capabilities"
+
+/**
+ * Version of capability cache format, bump when stored fields change.
+ */
+#define AT_CACHE_VERSION 1
+
+/**
+ * Builds name of capability cache file for current IMEI.
+ *
+ * Only alphanumeric characters from IMEI are used, so that whatever
+ * phone returns can not escape cache directory.
+ */
+static GSM_Error ATGEN_CapabilityCacheName(GSM_StateMachine *s, char *path, size_t size)
+{
+	const char *dir = s->CurrentConfig->CapabilityCache;
+	char imei[GSM_MAX_IMEI_LENGTH + 1];
+	size_t i, pos = 0;
+
+	if (dir == NULL || dir[0] == 0) {
+		return ERR_NOTSUPPORTED;
+	}
+
+	for (i = 0; s->Phone.Data.IMEI[i] != 0 && pos < sizeof(imei) - 1; i++) {
+		if (isalnum((int)(unsigned char)s->Phone.Data.IMEI[i])) {
+			imei[pos++] = s->Phone.Data.IMEI[i];
+		}
+	}
+	imei[pos] = 0;
+
+	if (pos == 0) {
+		return ERR_EMPTY;
+	}
+
+	if ((size_t)snprintf(path, size, "%s/%s.cache", dir, imei) >= size) {
+		return ERR_MOREMEMORY;
+	}
+	return ERR_NONE;
+}
+
+/**
+ * Restores capabilities from cache file, if it matches IMEI and
+ * firmware of connected phone.
+ */
+GSM_Error ATGEN_ReadCapabilityCache(GSM_StateMachine *s)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_Phone_Data		*Data = &s->Phone.Data;
+	GSM_Error		error;
+	INI_Section		*cache = NULL;
+	GSM_Feature		features[GSM_MAX_PHONE_FEATURES + 1];
+	char			path[1000];
+	const char		*value;
+	int			i;
+
+	error = ATGEN_CapabilityCacheName(s, path, sizeof(path));
+	if (error != ERR_NONE) {
+		return error;
+	}
+
+	error = INI_ReadFile(path, FALSE, &cache);
+	if (error != ERR_NONE) {
+		smprintf(s, "No capability cache in %s\n", path);
+		return error;
+	}
+
+	/* Validate cache against connected phone */
+	if (INI_GetInt(cache, AT_CACHE_SECTION, "version", 0) != AT_CACHE_VERSION) {
+		smprintf(s, "Capability cache has wrong version, ignoring\n");
+		error = ERR_INVALIDDATA;
+		goto done;
+	}
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "imei", FALSE);
+	if (value == NULL || strcmp(value, Data->IMEI) != 0) {
+		smprintf(s, "Capability cache is for different IMEI, ignoring\n");
+		error = ERR_INVALIDDATA;
+		goto done;
+	}
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "firmware", FALSE);
+	if (value == NULL || strcmp(value, Data->Version) != 0) {
+		smprintf(s, "Capability cache is for different firmware, ignoring\n");
+		error = ERR_INVALIDDATA;
+		goto done;
+	}
+
+	/* Phone identification */
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "manufacturer", FALSE);
+	if (value == NULL || strlen(value) > GSM_MAX_MANUFACTURER_LENGTH) {
+		error = ERR_INVALIDDATA;
+		goto done;
+	}
+	strcpy(Data->Manufacturer, value);
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "model", FALSE);
+	if (value == NULL || strlen(value) > GSM_MAX_MODEL_LENGTH) {
+		error = ERR_INVALIDDATA;
+		goto done;
+	}
+	strcpy(Data->Model, value);
+	Priv->Manufacturer = INI_GetInt(cache, AT_CACHE_SECTION, "manufacturerid", AT_Unknown);
+
+	Data->ModelInfo = GetModelData(s, NULL, Data->Model, NULL);
+	if (Data->ModelInfo->number[0] == 0)
+		Data->ModelInfo = GetModelData(s, NULL, NULL, Data->Model);
+	if (Data->ModelInfo->number[0] == 0)
+		Data->ModelInfo = GetModelData(s, Data->Model, NULL, NULL);
+
+	/* Features detected while probing */
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "features", FALSE);
+	if (value != NULL && value[0] != 0) {
+		error = GSM_SetFeatureString(features, value);
+		if (error != ERR_NONE) {
+			goto done;
+		}
+		for (i = 0; features[i] != 0; i++) {
+			GSM_AddPhoneFeature(Data->ModelInfo, features[i]);
+		}
+	}
+
+	/* Lazily probed capabilities */
+	Priv->Mode = INI_GetBool(cache, AT_CACHE_SECTION, "mode", FALSE);
+	Priv->Batching = INI_GetInt(cache, AT_CACHE_SECTION, "batching", 0);
+	Priv->UnicodeCharset = INI_GetInt(cache, AT_CACHE_SECTION, "unicodecharset", 0);
+	Priv->NormalCharset = INI_GetInt(cache, AT_CACHE_SECTION, "normalcharset", 0);
+	Priv->IRACharset = INI_GetInt(cache, AT_CACHE_SECTION, "iracharset", 0);
+	Priv->GSMCharset = INI_GetInt(cache, AT_CACHE_SECTION, "gsmcharset", 0);
+	value = INI_GetValue(cache, AT_CACHE_SECTION, "pbkmemories", FALSE);
+	if (value != NULL && strlen(value) <= AT_PBK_MAX_MEMORIES) {
+		strcpy(Priv->PBKMemories, value);
+	}
+	Priv->PBKSBNR = INI_GetInt(cache, AT_CACHE_SECTION, "pbksbnr", 0);
+	Priv->PBK_SPBR = INI_GetInt(cache, AT_CACHE_SECTION, "pbkspbr", 0);
+	Priv->PBK_MPBR = INI_GetInt(cache, AT_CACHE_SECTION, "pbkmpbr", 0);
+	Priv->SamsungCalendar = INI_GetInt(cache, AT_CACHE_SECTION, "samsungcalendar", 0);
+	Priv->PhoneSMSMemory = INI_GetInt(cache, AT_CACHE_SECTION, "phonesmsmemory", 0);
+	Priv->SIMSMSMemory = INI_GetInt(cache, AT_CACHE_SECTION, "simsmsmemory", 0);
+	Priv->PhoneSaveSMS = INI_GetInt(cache, AT_CACHE_SECTION, "phonesavesms", 0);
+	Priv->SIMSaveSMS = INI_GetInt(cache, AT_CACHE_SECTION, "simsavesms", 0);
+	Priv->MotorolaSMS = INI_GetBool(cache, AT_CACHE_SECTION, "motorolasms", FALSE);
+	Priv->CNMIMode = INI_GetInt(cache, AT_CACHE_SECTION, "cnmimode", -1);
+	Priv->CNMIProcedure = INI_GetInt(cache, AT_CACHE_SECTION, "cnmiprocedure", -1);
+	Priv->CNMIDeliverProcedure = INI_GetInt(cache, AT_CACHE_SECTION, "cnmideliverprocedure", -1);
+#ifdef GSM_ENABLE_CELLBROADCAST
+	Priv->CNMIBroadcastProcedure = INI_GetInt(cache, AT_CACHE_SECTION, "cnmibroadcastprocedure", -1);
+#endif
+
+	smprintf(s, "Capabilities loaded from %s\n", path);
+	smprintf(s, "[Model name: `%s']\n", Data->Model);
+	smprintf(s, "[Manufacturer: %s]\n", Data->Manufacturer);
+	error = ERR_NONE;
+
+done:
+	INI_Free(cache);
+	return error;
+}
+
+/**
+ * Identifies connected phone and restores its cached capabilities.
+ */
+GSM_Error ATGEN_LoadCapabilityCache(GSM_StateMachine *s)
+{
+	GSM_Phone_Data		*Data = &s->Phone.Data;
+	GSM_Error		error;
+
+	if (s->CurrentConfig->CapabilityCache == NULL) {
+		return ERR_NOTSUPPORTED;
+	}
+
+	/* Identify phone, IMEI might be left from previous connection */
+	Data->IMEI[0] = 0;
+	error = ATGEN_GetIMEI(s);
+	if (error != ERR_NONE) {
+		return error;
+	}
+	Data->Version[0] = 0;
+	ATGEN_WaitForAutoLen(s, "AT+CGMR\r", 0x00, 16, ID_GetFirmware);
+	if (error != ERR_NONE) {
+		Data->Version[0] = 0;
+		return error;
+	}
+
+	return ATGEN_ReadCapabilityCache(s);
+}
+
+/**
+ * Stores capabilities probed so far for use on next connection.
+ */
+GSM_Error ATGEN_SaveCapabilityCache(GSM_StateMachine *s)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_Phone_Data		*Data = &s->Phone.Data;
+	GSM_Error		error;
+	char			path[1000], tmppath[1010];
+	const char		*name;
+	FILE			*file;
+	int			i;
+
+	if (Data->Version[0] == 0 || Data->Model[0] == 0 || Data->Manufacturer[0] == 0) {
+		return ERR_EMPTY;
+	}
+
+	error = ATGEN_CapabilityCacheName(s, path, sizeof(path));
+	if (error != ERR_NONE) {
+		return error;
+	}
+
+	/* Write to temporary file and rename, so that readers see either old or new cache */
+	snprintf(tmppath, sizeof(tmppath), "%s.new", path);
+	file = fopen(tmppath, "w");
+	if (file == NULL) {
+		smprintf(s, "Can not write capability cache to %s\n", tmppath);
+		return ERR_CANTOPENFILE;
+	}
+
+	fprintf(file, "[%s]\n", AT_CACHE_SECTION);
+	fprintf(file, "version = %d\n", AT_CACHE_VERSION);
+	fprintf(file, "imei = %s\n", Data->IMEI);
+	fprintf(file, "firmware = %s\n", Data->Version);
+	fprintf(file, "manufacturer = %s\n", Data->Manufacturer);
+	fprintf(file, "manufacturerid = %d\n", Priv->Manufacturer);
+	fprintf(file, "model = %s\n", Data->Model);
+	fprintf(file, "features = ");
+	for (i = 0; Data->ModelInfo->features[i] != 0; i++) {
+		name = GSM_FeatureToString(Data->ModelInfo->features[i]);
+		if (name != NULL) {
+			fprintf(file, "%s%s", i == 0 ? "" : ",", name);
+		}
+	}
+	fprintf(file, "\n");
+	fprintf(file, "mode = %s\n", Priv->Mode ? "yes" : "no");
+	fprintf(file, "batching = %d\n", Priv->Batching);
+	fprintf(file, "unicodecharset = %d\n", Priv->UnicodeCharset);
+	fprintf(file, "normalcharset = %d\n", Priv->NormalCharset);
+	fprintf(file, "iracharset = %d\n", Priv->IRACharset);
+	fprintf(file, "gsmcharset = %d\n", Priv->GSMCharset);
+	if (Priv->PBKMemories[0] != 0) {
+		fprintf(file, "pbkmemories = %s\n", Priv->PBKMemories);
+	}
+	fprintf(file, "pbksbnr = %d\n", Priv->PBKSBNR);
+	fprintf(file, "pbkspbr = %d\n", Priv->PBK_SPBR);
+	fprintf(file, "pbkmpbr = %d\n", Priv->PBK_MPBR);
+	fprintf(file, "samsungcalendar = %d\n", Priv->SamsungCalendar);
+	fprintf(file, "phonesmsmemory = %d\n", Priv->PhoneSMSMemory);
+	fprintf(file, "simsmsmemory = %d\n", Priv->SIMSMSMemory);
+	fprintf(file, "phonesavesms = %d\n", Priv->PhoneSaveSMS);
+	fprintf(file, "simsavesms = %d\n", Priv->SIMSaveSMS);
+	fprintf(file, "motorolasms = %s\n", Priv->MotorolaSMS ? "yes" : "no");
+	fprintf(file, "cnmimode = %d\n", Priv->CNMIMode);
+	fprintf(file, "cnmiprocedure = %d\n", Priv->CNMIProcedure);
+	fprintf(file, "cnmideliverprocedure = %d\n", Priv->CNMIDeliverProcedure);
+#ifdef GSM_ENABLE_CELLBROADCAST
+	fprintf(file, "cnmibroadcastprocedure = %d\n", Priv->CNMIBroadcastProcedure);
+#endif
+
+	if (fclose(file) != 0) {
+		remove(tmppath);
+		return ERR_WRITING_FILE;
+	}
+#ifdef WIN32
+	/* Windows can not rename over existing file */
+	remove(path);
+#endif
+	if (rename(tmppath, path) != 0) {
+		remove(tmppath);
+		return ERR_WRITING_FILE;
+	}
+	smprintf(s, "Capabilities saved to %s\n", path);
+	return ERR_NONE;
+}
+
+#endif
+/*@}*/
+/*@}*/
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
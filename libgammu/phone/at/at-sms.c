@@ -1031,7 +1031,7 @@ GSM_Error ATGEN_ReplyGetMessageList(GSM_Protocol_Message *msg, GSM_StateMachine
 	GSM_Error error;
 	GSM_Phone_ATGENData *Priv = &s->Phone.Data.Priv.ATGEN;
 	GSM_SMSMessage sms;
-	int line = 1, cur = 0, allocsize = 0;
+	int line = 1, cur = 0, allocsize = 0, length;
 	char *tmp = NULL;
 	const char *str;
 
@@ -1057,7 +1057,9 @@ GSM_Error ATGEN_ReplyGetMessageList(GSM_Protocol_Message *msg, GSM_StateMachine
 
 	/* Walk through lines with +CMGL: */
 	/* First line is our command so we can skip it */
-	for (line = 2; strcmp("OK", str = GetLineString(msg->Buffer, &Priv->Lines, line)) != 0; line++) {
+	for (line = 2; !LineEquals(msg->Buffer, &Priv->Lines, line, "OK"); line++) {
+		str = GetLineString(msg->Buffer, &Priv->Lines, line);
+
 		/*
 		 * Find +CMGL, it should be on beginning, but it does not have to (see
 		 * corruption mentioned at the end of loop.
@@ -1087,7 +1089,7 @@ GSM_Error ATGEN_ReplyGetMessageList(GSM_Protocol_Message *msg, GSM_StateMachine
 
 		/* Reallocate buffer if needed */
 		if (allocsize <= Priv->SMSCount) {
-			allocsize += 20;
+			allocsize = (allocsize == 0) ? 32 : allocsize * 2;
 			Priv->SMSCache = (GSM_AT_SMS_Cache *)realloc(Priv->SMSCache, allocsize * sizeof(GSM_AT_SMS_Cache));
 
 			if (Priv->SMSCache == NULL) {
@@ -1117,14 +1119,16 @@ GSM_Error ATGEN_ReplyGetMessageList(GSM_Protocol_Message *msg, GSM_StateMachine
 				smprintf(s, "Failed to parse reply, not using cache!\n");
 				Priv->SMSCache[Priv->SMSCount - 1].State = -1;
 			}
-			/* Get next line (PDU data) */
-			str = GetLineString(msg->Buffer, &Priv->Lines, line);
+			/* Next line (PDU data) is copied directly to the cache */
+			length = GetLineLength(msg->Buffer, &Priv->Lines, line);
+			str = GetLineStringPos(msg->Buffer, &Priv->Lines, line);
 
-			if (strlen(str) >= GSM_AT_MAXPDULEN) {
-				smprintf(s, "PDU (%s) too long for cache, skipping!\n", str);
+			if (length >= GSM_AT_MAXPDULEN) {
+				smprintf(s, "PDU (%.*s) too long for cache, skipping!\n", length, str);
 				Priv->SMSCache[Priv->SMSCount - 1].State = -1;
 			} else {
-				strcpy(Priv->SMSCache[Priv->SMSCount - 1].PDU, str);
+				memcpy(Priv->SMSCache[Priv->SMSCount - 1].PDU, str, length);
+				Priv->SMSCache[Priv->SMSCount - 1].PDU[length] = 0;
 
 				/* Some phones corrupt output and do not put new line before +CMGL occassionally */
 				tmp = strstr(Priv->SMSCache[Priv->SMSCount - 1].PDU, "+CMGL:");
@@ -1470,6 +1474,13 @@ GSM_Error ATGEN_GetSMSStatus(GSM_StateMachine *s, GSM_SMSMemoryStatus *status)
 {
 	GSM_Error error;
 	GSM_Phone_ATGENData *Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_AT_BatchCommand batch[] = {
+		{NULL, "+CPMS:", ID_GetSMSStatus, ERR_NONE, FALSE},
+		{NULL, "+CPMS:", ID_GetSMSStatus, ERR_NONE, FALSE},
+	};
+	GSM_MemoryType memory[2];
+	gboolean write[2];
+	int count = 0, i;
 
 	/* No templates at all */
 	status->TemplatesUsed = 0;
@@ -1496,46 +1507,57 @@ GSM_Error ATGEN_GetSMSStatus(GSM_StateMachine *s, GSM_SMSMemoryStatus *status)
 			return error;
 		}
 	}
+	status->PhoneUsed = 0;
+	status->PhoneUnRead = 0;
+	status->PhoneSize = 0;
+
+	/* Both memories are queried in one batch */
 	if (Priv->SIMSMSMemory == AT_AVAILABLE) {
 		smprintf(s, "Getting SIM SMS status\n");
 
 		if (Priv->SIMSaveSMS == AT_AVAILABLE) {
-			ATGEN_WaitForAutoLen(s, "AT+CPMS=\"SM\",\"SM\"\r", 0x00, 20, ID_GetSMSStatus);
-			Priv->SMSMemoryWrite = TRUE;
+			batch[count].Command = "+CPMS=\"SM\",\"SM\"";
+			write[count] = TRUE;
 		} else {
-			ATGEN_WaitForAutoLen(s, "AT+CPMS=\"SM\"\r", 0x00, 20, ID_GetSMSStatus);
-			Priv->SMSMemoryWrite = FALSE;
-		}
-		if (error != ERR_NONE) {
-			return error;
+			batch[count].Command = "+CPMS=\"SM\"";
+			write[count] = FALSE;
 		}
-		Priv->SMSMemory = MEM_SM;
+		memory[count++] = MEM_SM;
 	}
-	status->PhoneUsed = 0;
-	status->PhoneUnRead = 0;
-	status->PhoneSize = 0;
-
 	if (Priv->PhoneSMSMemory == AT_AVAILABLE) {
 		smprintf(s, "Getting phone SMS status\n");
 
 		if (Priv->PhoneSaveSMS == AT_AVAILABLE) {
 			if (Priv->MotorolaSMS) {
-				ATGEN_WaitForAutoLen(s, "AT+CPMS=\"MT\"\r", 0x00, 20, ID_GetSMSStatus);
-				Priv->SMSMemoryWrite = FALSE;
+				batch[count].Command = "+CPMS=\"MT\"";
+				write[count] = FALSE;
 			} else {
-				ATGEN_WaitForAutoLen(s, "AT+CPMS=\"ME\",\"ME\"\r", 0x00, 20, ID_GetSMSStatus);
-				Priv->SMSMemoryWrite = TRUE;
+				batch[count].Command = "+CPMS=\"ME\",\"ME\"";
+				write[count] = TRUE;
 			}
 		} else {
-			ATGEN_WaitForAutoLen(s, "AT+CPMS=\"ME\"\r", 0x00, 20, ID_GetSMSStatus);
-			Priv->SMSMemoryWrite = FALSE;
+			batch[count].Command = "+CPMS=\"ME\"";
+			write[count] = FALSE;
 		}
-		if (error != ERR_NONE) {
-			return error;
+		memory[count++] = MEM_ME;
+	}
+	if (count == 0) {
+		return ERR_NONE;
+	}
+
+	error = ATGEN_WaitForBatch(s, batch, count, 20);
+	if (error != ERR_NONE) {
+		return error;
+	}
+	for (i = 0; i < count; i++) {
+		if (batch[i].Error == ERR_NONE) {
+			Priv->SMSMemoryWrite = write[i];
+			Priv->SMSMemory = memory[i];
+		} else if (error == ERR_NONE) {
+			error = batch[i].Error;
 		}
-		Priv->SMSMemory = MEM_ME;
 	}
-	return ERR_NONE;
+	return error;
 }
 
 GSM_Error ATGEN_ReplyAddSMSMessage(GSM_Protocol_Message *msg, GSM_StateMachine *s)
@@ -1557,11 +1579,7 @@ GSM_Error ATGEN_ReplyAddSMSMessage(GSM_Protocol_Message *msg, GSM_StateMachine *
 		smprintf(s, "SMS saved OK\n");
 
 		/* Number of lines */
-		i = 0;
-
-		while (Priv->Lines.numbers[i*2+1] != 0) {
-			i++;
-		}
+		i = GetLineCount(&Priv->Lines);
 		error = ATGEN_ParseReply(s,
 				GetLineString(msg->Buffer, &Priv->Lines, i - 1),
 				"+CMGW: @i",
@@ -1917,10 +1935,7 @@ GSM_Error ATGEN_ReplySendSMS(GSM_Protocol_Message *msg, GSM_StateMachine *s)
  		smprintf(s, "SMS sent OK\n");
 
 		/* Number of lines */
-		i = 0;
-		while (Priv->Lines.numbers[i*2+1] != 0) {
-			i++;
-		}
+		i = GetLineCount(&Priv->Lines);
 		error = ATGEN_ParseReply(s,
 				GetLineString(msg->Buffer, &Priv->Lines, i - 1),
 				"+CMGS: @i",
@@ -2070,8 +2085,11 @@ GSM_Error ATGEN_SendSavedSMS(GSM_StateMachine *s, int Folder, int Location)
 		return error;
 	}
 	len = sprintf(req, "AT+CMSS=%i\r",location);
+	/* Reply is handled asynchronously by ATGEN_ReplySendSMS */
 	error = s->Protocol.Functions->WriteMessage(s, req, len, 0x00);
-	usleep(strlen(req)*1000);
+	if (error == ERR_NONE && GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_FIXED_DELAYS)) {
+		usleep(len * 1000);
+	}
 	return error;
 }
 
@@ -2349,12 +2367,9 @@ GSM_Error ATGEN_IncomingSMSDeliver(GSM_Protocol_Message *msg, GSM_StateMachine *
 		/* T310 with larger SMS goes crazy and mix this incoming
                  * frame with normal answers. PDU is always last frame
 		 * We find its' number and parse it */
-		while (Data->Priv.ATGEN.Lines.numbers[i*2+1] != 0) {
-			/* FIXME: handle special chars correctly */
-			i++;
-		}
+		i = GetLineCount(&Data->Priv.ATGEN.Lines);
 		DecodeHexBin (buffer,
-			GetLineString(msg->Buffer,&Data->Priv.ATGEN.Lines,i),
+			GetLineStringPos(msg->Buffer,&Data->Priv.ATGEN.Lines,i),
 			GetLineLength(msg->Buffer,&Data->Priv.ATGEN.Lines,i));
 
 		/* We use locations from SMS layouts like in ../phone2.c(h) */
@@ -9,6 +9,9 @@ extern GSM_Reply_Function ATGENReplyFunctions[];
 
 extern GSM_Error ATGEN_Initialise		(GSM_StateMachine *s);
 extern GSM_Error ATGEN_Terminate		(GSM_StateMachine *s);
+extern GSM_Error ATGEN_LoadCapabilityCache	(GSM_StateMachine *s);
+extern GSM_Error ATGEN_ReadCapabilityCache	(GSM_StateMachine *s);
+extern GSM_Error ATGEN_SaveCapabilityCache	(GSM_StateMachine *s);
 extern GSM_Error ATGEN_GetIMEI 			(GSM_StateMachine *s);
 extern GSM_Error ATGEN_GetFirmware		(GSM_StateMachine *s);
 extern GSM_Error ATGEN_GetModel			(GSM_StateMachine *s);
@@ -1416,13 +1416,150 @@ int ATGEN_PrintReplyLines(GSM_StateMachine *s)
 	GSM_Phone_ATGENData 	*Priv 	= &s->Phone.Data.Priv.ATGEN;
 	GSM_Protocol_Message	*msg	= s->Phone.Data.RequestMsg;
 
-	/* Find number of lines */
-	while (Priv->Lines.numbers[i*2+1] != 0) {
+	for (i = 1; i <= GetLineCount(&Priv->Lines); i++) {
 		/* FIXME: handle special chars correctly */
-		smprintf(s, "%i \"%s\"\n",i+1,GetLineString(msg->Buffer,&Priv->Lines,i+1));
-		i++;
+		smprintf(s, "%i \"%.*s\"\n", i,
+			GetLineLength(msg->Buffer, &Priv->Lines, i),
+			GetLineStringPos(msg->Buffer, &Priv->Lines, i));
 	}
-	return i;
+	return GetLineCount(&Priv->Lines);
+}
+
+/**
+ * Checks whether information line belongs to batched command.
+ */
+static gboolean ATGEN_BatchLineMatches(const GSM_AT_BatchCommand *command, const char *line)
+{
+	return command->Prefix != NULL &&
+		strncmp(line, command->Prefix, strlen(command->Prefix)) == 0;
+}
+
+/**
+ * Splits reply to concatenated commands into replies to single
+ * commands and passes them to reply functions. When reply can not be
+ * split, no command is marked as done and caller sends them again one
+ * by one.
+ *
+ * \param s State machine structure.
+ * \param lines Number of lines in reply.
+ */
+static GSM_Error ATGEN_DispatchBatch(GSM_StateMachine *s, int lines)
+{
+	GSM_Phone_ATGENData 	*Priv 	= &s->Phone.Data.Priv.ATGEN;
+	GSM_Phone_Data		*Data	= &s->Phone.Data;
+	GSM_Protocol_Message	*msg	= Data->RequestMsg;
+	GSM_AT_BatchCommand	*batch	= Priv->Batch;
+	GSM_Protocol_Message	reply;
+	GSM_Error		error = ERR_NONE;
+	const char		*line;
+	char			**buffers = NULL;
+	int			*owner = NULL;
+	size_t			*lengths = NULL;
+	int			i, j, k, current = 0;
+
+	/* Whole batch is answered by this message */
+	Data->RequestID = ID_None;
+
+	if (lines < 2 || strncmp(GetLineString(msg->Buffer, &Priv->Lines, 1), "AT", 2) != 0) {
+		smprintf(s, "Batch reply does not start with echo\n");
+		return ERR_UNKNOWNRESPONSE;
+	}
+
+	switch (Priv->ReplyState) {
+		case AT_Reply_OK:
+			break;
+		case AT_Reply_Error:
+			/* Error right after echo means phone did not accept the line */
+			line = GetLineString(msg->Buffer, &Priv->Lines, lines);
+			if (lines == 2 && (strcmp(line, "ERROR") == 0 || strncmp(line, "COMMAND NOT SUPPORT", 19) == 0)) {
+				smprintf(s, "Batch rejected, commands will be sent separately\n");
+				return ERR_NOTSUPPORTED;
+			}
+			smprintf(s, "Batch failed, commands will be sent separately\n");
+			return ERR_UNKNOWN;
+		case AT_Reply_CMEError:
+			smprintf(s, "Batch failed, commands will be sent separately\n");
+			return ATGEN_HandleCMEError(s);
+		case AT_Reply_CMSError:
+			smprintf(s, "Batch failed, commands will be sent separately\n");
+			return ATGEN_HandleCMSError(s);
+		default:
+			smprintf(s, "Batch failed, commands will be sent separately\n");
+			return ERR_UNKNOWN;
+	}
+
+	owner = (int *)malloc(sizeof(int) * lines);
+	lengths = (size_t *)calloc(Priv->BatchCount, sizeof(size_t));
+	buffers = (char **)calloc(Priv->BatchCount, sizeof(char *));
+	if (owner == NULL || lengths == NULL || buffers == NULL) {
+		error = ERR_MOREMEMORY;
+		goto done;
+	}
+
+	/* Assign information lines to commands in order */
+	for (i = 2; i < lines; i++) {
+		line = GetLineString(msg->Buffer, &Priv->Lines, i);
+		for (k = current; k < Priv->BatchCount; k++) {
+			if (ATGEN_BatchLineMatches(&batch[k], line)) {
+				break;
+			}
+		}
+		if (k == Priv->BatchCount) {
+			smprintf(s, "Can not assign line \"%s\" to batched command\n", line);
+			error = ERR_UNKNOWNRESPONSE;
+			goto done;
+		}
+		owner[i] = k;
+		lengths[k] += strlen(line) + 2;
+		current = k;
+		/* Same command follows, so this one has just single line */
+		for (j = k + 1; j < Priv->BatchCount; j++) {
+			if (batch[j].Prefix != NULL && strcmp(batch[j].Prefix, batch[k].Prefix) == 0) {
+				current = k + 1;
+				break;
+			}
+		}
+	}
+
+	/* Compose replies as if commands were sent separately */
+	for (k = 0; k < Priv->BatchCount; k++) {
+		lengths[k] += strlen(batch[k].Command) + 9;
+		buffers[k] = (char *)malloc(lengths[k]);
+		if (buffers[k] == NULL) {
+			error = ERR_MOREMEMORY;
+			goto done;
+		}
+		sprintf(buffers[k], "AT%s\r\n", batch[k].Command);
+	}
+	for (i = 2; i < lines; i++) {
+		line = GetLineString(msg->Buffer, &Priv->Lines, i);
+		strcat(buffers[owner[i]], line);
+		strcat(buffers[owner[i]], "\r\n");
+	}
+
+	for (k = 0; k < Priv->BatchCount; k++) {
+		strcat(buffers[k], "OK\r\n");
+		reply.Buffer = buffers[k];
+		reply.Length = strlen(buffers[k]);
+		reply.Type = msg->Type;
+		Data->RequestMsg = &reply;
+		Data->RequestID = batch[k].RequestID;
+		batch[k].Error = ATGEN_DispatchMessage(s);
+		batch[k].Done = TRUE;
+	}
+	Data->RequestMsg = msg;
+	Data->RequestID = ID_None;
+
+done:
+	if (buffers != NULL) {
+		for (k = 0; k < Priv->BatchCount; k++) {
+			free(buffers[k]);
+		}
+	}
+	free(buffers);
+	free(lengths);
+	free(owner);
+	return error;
 }
 
 GSM_Error ATGEN_DispatchMessage(GSM_StateMachine *s)
@@ -1432,7 +1569,6 @@ GSM_Error ATGEN_DispatchMessage(GSM_StateMachine *s)
 	int 			i = 0,j = 0,k = 0;
 	const char		*err, *line;
 	ATErrorCode		*ErrorCodes = NULL;
-	char *line1, *line2;
 
 	SplitLines(msg->Buffer, msg->Length, &Priv->Lines, "\x0D\x0A", 2, "\"", 1, TRUE);
 
@@ -1440,29 +1576,21 @@ GSM_Error ATGEN_DispatchMessage(GSM_StateMachine *s)
 	i = ATGEN_PrintReplyLines(s);
 
 	/* Check for duplicated command in response (bug#1069) */
-	if (i >= 2) {
-		/* Get first two lines */
-		line1 = strdup(GetLineString(msg->Buffer, &Priv->Lines, 1));
-		line2 = strdup(GetLineString(msg->Buffer, &Priv->Lines, 2));
-		if (line1 == NULL || line2 == NULL) {
-			free(line1);
-			free(line2);
-			return ERR_MOREMEMORY;
-		}
-		/* Is it AT command? */
-		if (strncmp(line1, "AT", 2) == 0) {
-			/* Are two lines same */
-			if (strcmp(line1, line2) == 0) {
-				smprintf(s, "Removing first reply, because it is duplicated\n");
-				/* Remove first line */
-				memmove(Priv->Lines.numbers, Priv->Lines.numbers + 2, (Priv->Lines.allocated - 2) * sizeof(int));
-				i--;
-				ATGEN_PrintReplyLines(s);
-			}
-		}
-		/* Free allocated memory */
-		free(line1);
-		free(line2);
+	if (i >= 2 &&
+			LineStartsWith(msg->Buffer, &Priv->Lines, 1, "AT") &&
+			GetLineLength(msg->Buffer, &Priv->Lines, 1) == GetLineLength(msg->Buffer, &Priv->Lines, 2) &&
+			memcmp(GetLineStringPos(msg->Buffer, &Priv->Lines, 1),
+				GetLineStringPos(msg->Buffer, &Priv->Lines, 2),
+				GetLineLength(msg->Buffer, &Priv->Lines, 1)) == 0) {
+		smprintf(s, "Removing first reply, because it is duplicated\n");
+		/* Remove first line */
+		memmove(Priv->Lines.numbers, Priv->Lines.numbers + 2, (Priv->Lines.used - 2) * sizeof(int));
+		Priv->Lines.numbers[Priv->Lines.used - 2] = 0;
+		Priv->Lines.numbers[Priv->Lines.used - 1] = 0;
+		Priv->Lines.used -= 2;
+		Priv->Lines.count--;
+		i--;
+		ATGEN_PrintReplyLines(s);
 	}
 
 	Priv->ReplyState 	= AT_Reply_Unknown;
@@ -1512,7 +1640,7 @@ GSM_Error ATGEN_DispatchMessage(GSM_StateMachine *s)
 	}
 
 	/* FIXME: Samsung phones can answer +CME ERROR:-1 meaning empty location */
-	if (Priv->ReplyState == AT_Reply_CMEError && Priv->Manufacturer == AT_Samsung) {
+	if (Priv->ReplyState == AT_Reply_CMEError && Priv->Manufacturer == AT_Samsung && s->Phone.Data.RequestID != ID_ATBatch) {
 		err = line + 11;
 		Priv->ErrorCode = atoi(err);
 
@@ -1550,6 +1678,11 @@ GSM_Error ATGEN_DispatchMessage(GSM_StateMachine *s)
 		}
 	}
 	smprintf(s, "AT reply state: %d\n", Priv->ReplyState);
+
+	/* Reply to concatenated commands */
+	if (Priv->Batch != NULL && s->Phone.Data.RequestID == ID_ATBatch) {
+		return ATGEN_DispatchBatch(s, i);
+	}
 	return GSM_DispatchMessage(s);
 }
 
@@ -1576,6 +1709,173 @@ GSM_Error ATGEN_GenericReply(GSM_Protocol_Message *msg UNUSED, GSM_StateMachine
 	return ERR_UNKNOWNRESPONSE;
 }
 
+/**
+ * Sends commands concatenated on single line.
+ */
+static GSM_Error ATGEN_SendBatch(GSM_StateMachine *s, GSM_AT_BatchCommand *commands, int count, int timeout)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_Error		error;
+	char			buffer[ATGEN_BATCH_MAX_LENGTH + 2];
+	size_t			len = 2;
+	int			i;
+
+	strcpy(buffer, "AT");
+	for (i = 0; i < count; i++) {
+		if (len + strlen(commands[i].Command) + 1 > ATGEN_BATCH_MAX_LENGTH) {
+			smprintf(s, "Batch too long, sending commands separately\n");
+			return ERR_MOREMEMORY;
+		}
+		if (i > 0) {
+			buffer[len++] = ';';
+		}
+		strcpy(buffer + len, commands[i].Command);
+		len += strlen(commands[i].Command);
+	}
+	buffer[len++] = '\r';
+	buffer[len] = 0;
+
+	for (i = 0; i < Priv->FailedBatchCount; i++) {
+		if (strcmp(Priv->FailedBatches[i], buffer) == 0) {
+			smprintf(s, "Phone rejected this batch before, sending commands separately\n");
+			return ERR_NOTSUPPORTED;
+		}
+	}
+
+	Priv->Batch = commands;
+	Priv->BatchCount = count;
+	error = GSM_WaitFor(s, buffer, len, 0x00, timeout, ID_ATBatch);
+	Priv->Batch = NULL;
+	Priv->BatchCount = 0;
+
+	/*
+	 * Phone rejected the line (usually one of commands is not
+	 * supported), so do not waste round trip on it again. Other
+	 * failures might be temporary, so batch is tried next time.
+	 */
+	if (error == ERR_NOTSUPPORTED && Priv->FailedBatchCount < ATGEN_BATCH_FAILED_MAX) {
+		strcpy(Priv->FailedBatches[Priv->FailedBatchCount++], buffer);
+	}
+
+	return error;
+}
+
+/**
+ * Checks whether phone accepts concatenated commands. This is done
+ * only once for each phone, result is kept in capability cache.
+ */
+static gboolean ATGEN_CanBatch(GSM_StateMachine *s)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_SignalQuality	*saved = s->Phone.Data.SignalQuality;
+	GSM_SignalQuality	signal;
+	GSM_AT_BatchCommand	probe[] = {
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_NONE, FALSE},
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_NONE, FALSE},
+	};
+
+	/* Mode switching needs to check each command */
+	if (Priv->Mode) {
+		return FALSE;
+	}
+	if (Priv->Batching == 0) {
+		smprintf(s, "Checking whether phone accepts concatenated commands\n");
+		s->Phone.Data.SignalQuality = &signal;
+		ATGEN_SendBatch(s, probe, 2, 4);
+		s->Phone.Data.SignalQuality = saved;
+
+		if (probe[0].Done && probe[0].Error == ERR_NONE &&
+				probe[1].Done && probe[1].Error == ERR_NONE) {
+			smprintf(s, "Works, will use it\n");
+			Priv->Batching = AT_AVAILABLE;
+		} else {
+			smprintf(s, "Seems not to be supported\n");
+			Priv->Batching = AT_NOTAVAILABLE;
+		}
+	}
+	return Priv->Batching == AT_AVAILABLE;
+}
+
+GSM_Error ATGEN_WaitForBatch(GSM_StateMachine *s, GSM_AT_BatchCommand *commands, int count, int timeout)
+{
+	GSM_Error	error;
+	char		buffer[ATGEN_BATCH_MAX_LENGTH + 2];
+	int		len, i;
+
+	for (i = 0; i < count; i++) {
+		commands[i].Error = ERR_UNKNOWN;
+		commands[i].Done = FALSE;
+	}
+
+	if (count > 1 && ATGEN_CanBatch(s)) {
+		smprintf(s, "Sending %d commands in batch\n", count);
+		error = ATGEN_SendBatch(s, commands, count, timeout);
+		if (error == ERR_DEVICEWRITEERROR) {
+			return error;
+		}
+	}
+
+	/* Fallback to sending commands one by one */
+	for (i = 0; i < count; i++) {
+		if (commands[i].Done) {
+			continue;
+		}
+		len = sprintf(buffer, "AT%s\r", commands[i].Command);
+		ATGEN_WaitFor(s, buffer, len, 0x00, timeout, commands[i].RequestID);
+		commands[i].Error = error;
+		commands[i].Done = TRUE;
+	}
+	return ERR_NONE;
+}
+
+GSM_Error ATGEN_WaitForReady(GSM_StateMachine *s, int delay)
+{
+	GSM_Phone_Data	*Phone = &s->Phone.Data;
+	GSM_Error	error, dispatch;
+
+	if (GSM_IsPhoneFeatureAvailable(Phone->ModelInfo, F_FIXED_DELAYS)) {
+		usleep(delay * 1000);
+		return ERR_NONE;
+	}
+
+	/* Phone answers empty command once it is done with previous one */
+	dispatch = Phone->DispatchError;
+	smprintf(s, "Checking whether phone is ready\n");
+	error = GSM_WaitForAutoLen(s, "AT\r", 0x00, 4, ID_Initialise);
+	Phone->DispatchError = dispatch;
+	return error;
+}
+
+GSM_Error ATGEN_WaitForPrompt(GSM_StateMachine *s, const char *prompt, int timeout)
+{
+	char		buffer[100];
+	size_t		used = 0, keep = strlen(prompt);
+	int		n;
+	time_t		end = time(NULL) + timeout;
+
+	do {
+		n = s->Device.Functions->ReadDevice(s, buffer + used, sizeof(buffer) - 1 - used);
+		if (n <= 0) {
+			if (s->Abort) return ERR_ABORTED;
+			usleep(10000);
+			continue;
+		}
+		used += n;
+		buffer[used] = 0;
+		if (strstr(buffer, prompt) != NULL) {
+			return ERR_NONE;
+		}
+		/* Keep only what can be start of the prompt */
+		if (used > keep) {
+			memmove(buffer, buffer + used - keep, keep);
+			used = keep;
+		}
+	} while (time(NULL) <= end);
+
+	smprintf(s, "Prompt \"%s\" not received\n", prompt);
+	return ERR_TIMEOUT;
+}
+
 GSM_Error ATGEN_SQWEReply(GSM_Protocol_Message *msg UNUSED, GSM_StateMachine *s)
 {
 	GSM_Phone_ATGENData 	*Priv = &s->Phone.Data.Priv.ATGEN;
@@ -2035,6 +2335,7 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 	GSM_Phone_ATGENData     *Priv = &s->Phone.Data.Priv.ATGEN;
 	GSM_Error               error;
     	char                    buff[2]={0};
+	gboolean		cached;
 
 	InitLines(&Priv->Lines);
 
@@ -2069,6 +2370,10 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 	Priv->file.Used 		= 0;
 	Priv->file.Buffer 		= NULL;
 	Priv->Mode			= FALSE;
+	Priv->Batching			= 0;
+	Priv->Batch			= NULL;
+	Priv->BatchCount		= 0;
+	Priv->FailedBatchCount		= 0;
 	Priv->MemorySize		= 0;
 	Priv->MotorolaMemorySize	= 0;
 	Priv->MemoryUsed		= 0;
@@ -2086,6 +2391,12 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 
 	Priv->SMSCount			= 0;
 	Priv->SMSCache			= NULL;
+	Priv->PBKCacheCount		= 0;
+	Priv->PBKCacheSize		= 0;
+	Priv->PBKCacheRead		= 0;
+	Priv->PBKCacheMemory		= 0;
+	Priv->PBKCacheRange		= 0;
+	Priv->PBKCache			= NULL;
 	Priv->ReplyState		= 0;
 
 	if (s->ConnectionType != GCT_IRDAAT && s->ConnectionType != GCT_BLUEAT) {
@@ -2132,17 +2443,22 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 		return error;
 	}
 
+	/* Reuse capabilities from previous connection to same phone */
+	cached = (ATGEN_LoadCapabilityCache(s) == ERR_NONE);
+
 	/* Try whether phone supports mode switching as Motorola phones. */
-	smprintf(s, "Trying Motorola mode switch\n");
-	error = GSM_WaitForAutoLen(s, "AT+MODE=2\r", 0x00, 3, ID_ModeSwitch);
+	if (!cached || Priv->Mode) {
+		smprintf(s, "Trying Motorola mode switch\n");
+		error = GSM_WaitForAutoLen(s, "AT+MODE=2\r", 0x00, 3, ID_ModeSwitch);
 
-	if (error != ERR_NONE) {
-		smprintf(s, "Seems not to be supported\n");
-		Priv->Mode = FALSE;
-	} else {
-		smprintf(s, "Works, will use it\n");
-		Priv->Mode = TRUE;
-		Priv->CurrentMode = 2;
+		if (error != ERR_NONE) {
+			smprintf(s, "Seems not to be supported\n");
+			Priv->Mode = FALSE;
+		} else {
+			smprintf(s, "Works, will use it\n");
+			Priv->Mode = TRUE;
+			Priv->CurrentMode = 2;
+		}
 	}
 	smprintf(s, "Enabling CME errors\n");
 
@@ -2172,8 +2488,11 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 	/* Clear error flag */
 	error = ERR_NONE;
 
+	/* Features found by probes below are stored in cache */
+	if (cached) {
+		smprintf(s, "Skipping protocol probes, capabilities are cached\n");
 	/* Mode switching cabaple phones can switch using AT+MODE */
-	if (!Priv->Mode) {
+	} else if (!Priv->Mode) {
 		smprintf(s, "Checking for OBEX support\n");
 		/* We don't care about error here */
 		ATGEN_WaitForAutoLen(s, "AT+CPROT=?\r", 0x00, 20, ID_SetOBEX);
@@ -2203,7 +2522,7 @@ GSM_Error ATGEN_Initialise(GSM_StateMachine *s)
 #endif
 	}
 
-	if (!GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_MOBEX) && !GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_TSSPCSW) && !GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_NO_ATSYNCML)) {
+	if (!cached && !GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_MOBEX) && !GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_TSSPCSW) && !GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_NO_ATSYNCML)) {
 		smprintf(s, "Checking for SYNCML/OBEX support\n");
 		/* We don't care about error here */
 		ATGEN_WaitForAutoLen(s, "AT+SYNCML=?\r", 0x00, 20, ID_SetOBEX);
@@ -3104,6 +3423,12 @@ GSM_Error ATGEN_ReplyGetGPRSState(GSM_Protocol_Message *msg, GSM_StateMachine *s
 GSM_Error ATGEN_GetNetworkInfo(GSM_StateMachine *s, GSM_NetworkInfo *netinfo)
 {
 	GSM_Error error;
+	GSM_AT_BatchCommand names[] = {
+		{"+COPS=3,2", NULL, ID_GetNetworkInfo, ERR_NONE, FALSE},
+		{"+COPS?", "+COPS:", ID_GetNetworkCode, ERR_NONE, FALSE},
+		{"+COPS=3,0", NULL, ID_GetNetworkInfo, ERR_NONE, FALSE},
+		{"+COPS?", "+COPS:", ID_GetNetworkName, ERR_NONE, FALSE},
+	};
 
 	s->Phone.Data.NetworkInfo = netinfo;
 
@@ -3146,21 +3471,12 @@ GSM_Error ATGEN_GetNetworkInfo(GSM_StateMachine *s, GSM_NetworkInfo *netinfo)
 		return error;
 	}
 	if (netinfo->State == GSM_HomeNetwork || netinfo->State == GSM_RoamingNetwork) {
-		/* Set numeric format for AT+COPS? */
-		smprintf(s, "Setting short network name format\n");
-		ATGEN_WaitForAutoLen(s, "AT+COPS=3,2\r", 0x00, 4, ID_GetNetworkInfo);
-
-		/* Get operator code */
-		smprintf(s, "Getting network code\n");
-		ATGEN_WaitForAutoLen(s, "AT+COPS?\r", 0x00, 4, ID_GetNetworkCode);
-
-		/* Set string format for AT+COPS? */
-		smprintf(s, "Setting long string network name format\n");
-		ATGEN_WaitForAutoLen(s, "AT+COPS=3,0\r", 0x00, 4, ID_GetNetworkInfo);
-
-		/* Get operator code */
-		smprintf(s, "Getting network code\n");
-		ATGEN_WaitForAutoLen(s, "AT+COPS?\r", 0x00, 4, ID_GetNetworkName);
+		/*
+		 * Get operator code in numeric format and then name in
+		 * long string format, all in one batch.
+		 */
+		smprintf(s, "Getting network code and name\n");
+		ATGEN_WaitForBatch(s, names, 4, 4);
 
 		/* All information here is optional */
 		error = ERR_NONE;
@@ -3554,7 +3870,8 @@ GSM_Error ATGEN_ReplyGetCPBRMemoryStatus(GSM_Protocol_Message *msg, GSM_StateMac
 	case AT_Reply_OK:
 		smprintf(s, "Memory entries for status received\n");
 		/* Walk through lines with +CPBR: */
-		while (strcmp("OK", str = GetLineString(msg->Buffer, &Priv->Lines, line + 1)) != 0) {
+		while (!LineEquals(msg->Buffer, &Priv->Lines, line + 1, "OK")) {
+			str = GetLineString(msg->Buffer, &Priv->Lines, line + 1);
 
 			/* Parse reply */
 			error = ATGEN_ParseReply(s, str, "+CPBR: @i, @0", &cur);
@@ -3727,7 +4044,7 @@ GSM_Error ATGEN_GetMemoryStatus(GSM_StateMachine *s, GSM_MemoryStatus *Status)
 }
 
 /**
- * Parses reply on AT+CPBR=n.
+ * Parses single +CPBR: line into memory entry.
  *
  * \todo Handle special replies from some phones:
  * LG C1200:
@@ -3739,304 +4056,315 @@ GSM_Error ATGEN_GetMemoryStatus(GSM_StateMachine *s, GSM_MemoryStatus *Status)
  * Samsung SGH-P900 reply:
  * +CPBR: 81,"#121#",129,"My Tempo",0
  */
-GSM_Error ATGEN_ReplyGetMemory(GSM_Protocol_Message *msg, GSM_StateMachine *s)
+GSM_Error ATGEN_ParseMemoryEntry(GSM_StateMachine *s, GSM_MemoryEntry *Memory, const char *line)
 {
  	GSM_Phone_ATGENData 	*Priv = &s->Phone.Data.Priv.ATGEN;
- 	GSM_MemoryEntry		*Memory = s->Phone.Data.Memory;
 	GSM_Error		error;
 	unsigned char		buffer[500];
 	int offset, i;
 	int number_type, types[10];
 
-	switch (Priv->ReplyState) {
-	case AT_Reply_OK:
- 		smprintf(s, "Phonebook entry received\n");
-		/* Check for empty entries */
-		if (strcmp("OK", GetLineString(msg->Buffer, &Priv->Lines, 2)) == 0) {
-			Memory->EntriesNum = 0;
-			return ERR_EMPTY;
-		}
-
-		/* Set number type */
-		Memory->Entries[0].EntryType = PBK_Number_General;
-		Memory->Entries[0].Location = PBK_Location_Unknown;
-		Memory->Entries[0].VoiceTag = 0;
-		Memory->Entries[0].SMSList[0] = 0;
-
-		/* Set name type */
-		Memory->Entries[1].EntryType = PBK_Text_Name;
-		Memory->Entries[1].Location = PBK_Location_Unknown;
+	/* Set number type */
+	Memory->Entries[0].EntryType = PBK_Number_General;
+	Memory->Entries[0].Location = PBK_Location_Unknown;
+	Memory->Entries[0].VoiceTag = 0;
+	Memory->Entries[0].SMSList[0] = 0;
 
-		/* Try standard reply */
-		if (Priv->Manufacturer == AT_Motorola) {
-			/* Enable encoding guessing for Motorola */
-			error = ATGEN_ParseReply(s,
-						GetLineString(msg->Buffer, &Priv->Lines, 2),
-						"+CPBR: @i, @p, @I, @s",
-						&Memory->Location,
-						Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
-						&number_type,
-						Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
-		} else {
-			error = ATGEN_ParseReply(s,
-						GetLineString(msg->Buffer, &Priv->Lines, 2),
-						"+CPBR: @i, @p, @I, @e",
-						&Memory->Location,
-						Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
-						&number_type,
-						Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
-		}
-		if (error == ERR_NONE) {
-			smprintf(s, "Generic AT reply detected\n");
-			/* Adjust location */
-			Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-			/* Adjust number */
-			GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
-			/* Set number of entries */
-			Memory->EntriesNum = 2;
-			return ERR_NONE;
-		}
+	/* Set name type */
+	Memory->Entries[1].EntryType = PBK_Text_Name;
+	Memory->Entries[1].Location = PBK_Location_Unknown;
 
-		/* Try reply with extra unknown number (maybe group?), seen on Samsung SGH-P900 */
+	/* Try standard reply */
+	if (Priv->Manufacturer == AT_Motorola) {
+		/* Enable encoding guessing for Motorola */
 		error = ATGEN_ParseReply(s,
-					GetLineString(msg->Buffer, &Priv->Lines, 2),
-					"+CPBR: @i, @p, @I, @e, @i",
+					line,
+					"+CPBR: @i, @p, @I, @s",
 					&Memory->Location,
 					Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
 					&number_type,
-					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
-					&i /* Don't know what this means */
-					);
-		if (error == ERR_NONE) {
-			smprintf(s, "AT reply with extra number detected\n");
-			/* Adjust location */
-			Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-			/* Adjust number */
-			GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
-			/* Set number of entries */
-			Memory->EntriesNum = 2;
-			return ERR_NONE;
-		}
-
-		/* Try reply with call date */
+					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
+	} else {
 		error = ATGEN_ParseReply(s,
-					GetLineString(msg->Buffer, &Priv->Lines, 2),
-					"+CPBR: @i, @p, @I, @s, @d",
+					line,
+					"+CPBR: @i, @p, @I, @e",
 					&Memory->Location,
 					Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
 					&number_type,
-					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
-					&Memory->Entries[2].Date);
-		if (error == ERR_NONE) {
-			smprintf(s, "Reply with date detected\n");
-			/* Adjust location */
-			Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-			/* Adjust number */
-			GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
-			/* Set date type */
-			Memory->Entries[2].EntryType = PBK_Date;
-			Memory->Entries[2].Location = PBK_Location_Unknown;
-			/* Set number of entries */
-			Memory->EntriesNum = 3;
-			/* Check whether date is correct */
-			if (!CheckTime(&Memory->Entries[2].Date) || !CheckDate(&Memory->Entries[2].Date)) {
-				smprintf(s, "Date looks invalid, ignoring!\n");
-				Memory->EntriesNum = 2;
-			}
-			return ERR_NONE;
+					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
+	}
+	if (error == ERR_NONE) {
+		smprintf(s, "Generic AT reply detected\n");
+		/* Adjust location */
+		Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
+		/* Adjust number */
+		GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
+		/* Set number of entries */
+		Memory->EntriesNum = 2;
+		return ERR_NONE;
+	}
+
+	/* Try reply with extra unknown number (maybe group?), seen on Samsung SGH-P900 */
+	error = ATGEN_ParseReply(s,
+				line,
+				"+CPBR: @i, @p, @I, @e, @i",
+				&Memory->Location,
+				Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
+				&number_type,
+				Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
+				&i /* Don't know what this means */
+				);
+	if (error == ERR_NONE) {
+		smprintf(s, "AT reply with extra number detected\n");
+		/* Adjust location */
+		Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
+		/* Adjust number */
+		GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
+		/* Set number of entries */
+		Memory->EntriesNum = 2;
+		return ERR_NONE;
+	}
+
+	/* Try reply with call date */
+	error = ATGEN_ParseReply(s,
+				line,
+				"+CPBR: @i, @p, @I, @s, @d",
+				&Memory->Location,
+				Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
+				&number_type,
+				Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
+				&Memory->Entries[2].Date);
+	if (error == ERR_NONE) {
+		smprintf(s, "Reply with date detected\n");
+		/* Adjust location */
+		Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
+		/* Adjust number */
+		GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
+		/* Set date type */
+		Memory->Entries[2].EntryType = PBK_Date;
+		Memory->Entries[2].Location = PBK_Location_Unknown;
+		/* Set number of entries */
+		Memory->EntriesNum = 3;
+		/* Check whether date is correct */
+		if (!CheckTime(&Memory->Entries[2].Date) || !CheckDate(&Memory->Entries[2].Date)) {
+			smprintf(s, "Date looks invalid, ignoring!\n");
+			Memory->EntriesNum = 2;
 		}
+		return ERR_NONE;
+	}
 
-		/*
-		 * Try reply with call date and some additional string.
-		 * I have no idea what should be stored there.
-		 * We store it in Entry 3, but do not use it for now.
-		 * Seen on T630.
-		 */
+	/*
+	 * Try reply with call date and some additional string.
+	 * I have no idea what should be stored there.
+	 * We store it in Entry 3, but do not use it for now.
+	 * Seen on T630.
+	 */
+	error = ATGEN_ParseReply(s,
+				line,
+				"+CPBR: @i, @s, @p, @I, @s, @d",
+				&Memory->Location,
+				Memory->Entries[3].Text, sizeof(Memory->Entries[3].Text),
+				Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
+				&number_type,
+				Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
+				&Memory->Entries[2].Date);
+	if (error == ERR_NONE) {
+		smprintf(s, "Reply with date detected\n");
+		/* Adjust location */
+		Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
+		/* Adjust number */
+		GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
+		/* Set date type */
+		Memory->Entries[2].EntryType = PBK_Date;
+		/* Set number of entries */
+		Memory->EntriesNum = 3;
+		return ERR_NONE;
+	}
+
+	/**
+	 * Samsung format:
+	 * location,"number",type,"0x02surname0x03","0x02firstname0x03","number",
+	 * type,"number",type,"number",type,"number",type,"email","NA",
+	 * "0x02note0x03",category?,x,x,x,ringtone?,"NA","photo"
+	 *
+	 * NA fields were empty
+	 * x fields are some numbers, default is 1,65535,255,255,65535
+	 *
+	 * Samsung number types:
+	 * 2 - fax
+	 * 4 - cell
+	 * 5 - other
+	 * 6 - home
+	 * 7 - office
+	 */
+	if (Priv->Manufacturer == AT_Samsung) {
+		/* Parse reply */
 		error = ATGEN_ParseReply(s,
-					GetLineString(msg->Buffer, &Priv->Lines, 2),
-					"+CPBR: @i, @s, @p, @I, @s, @d",
-					&Memory->Location,
-					Memory->Entries[3].Text, sizeof(Memory->Entries[3].Text),
-					Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
-					&number_type,
-					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text),
-					&Memory->Entries[2].Date);
+				line,
+				"+CPBR: @i,@p,@i,@S,@S,@p,@i,@p,@i,@p,@i,@p,@i,@s,@s,@S,@i,@i,@i,@i,@i,@s,@s",
+				&Memory->Location,
+				Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
+				&types[0],
+				Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text), /* surname */
+				Memory->Entries[2].Text, sizeof(Memory->Entries[2].Text), /* first name */
+				Memory->Entries[3].Text, sizeof(Memory->Entries[3].Text),
+				&types[3],
+				Memory->Entries[4].Text, sizeof(Memory->Entries[4].Text),
+				&types[4],
+				Memory->Entries[5].Text, sizeof(Memory->Entries[5].Text),
+				&types[5],
+				Memory->Entries[6].Text, sizeof(Memory->Entries[6].Text),
+				&types[6],
+				Memory->Entries[7].Text, sizeof(Memory->Entries[7].Text), /* email */
+				buffer, sizeof(buffer), /* We don't know this */
+				Memory->Entries[8].Text, sizeof(Memory->Entries[8].Text), /* note */
+				&Memory->Entries[9].Number, /* category */
+				&number_type, /* We don't know this */
+				&number_type, /* We don't know this */
+				&number_type, /* We don't know this */
+				&Memory->Entries[10].Number, /* ringtone ID */
+				buffer, sizeof(buffer), /* We don't know this */
+				Memory->Entries[11].Text, sizeof(Memory->Entries[11].Text) /* photo ID */
+				);
+
 		if (error == ERR_NONE) {
-			smprintf(s, "Reply with date detected\n");
+			smprintf(s, "Samsung reply detected\n");
+			/* Set types */
+			Memory->Entries[1].EntryType = PBK_Text_LastName;
+			Memory->Entries[1].Location = PBK_Location_Unknown;
+			Memory->Entries[2].EntryType = PBK_Text_FirstName;
+			Memory->Entries[2].Location = PBK_Location_Unknown;
+			Memory->Entries[7].EntryType = PBK_Text_Email;
+			Memory->Entries[7].Location = PBK_Location_Unknown;
+			Memory->Entries[8].EntryType = PBK_Text_Note;
+			Memory->Entries[8].Location = PBK_Location_Unknown;
+			Memory->Entries[9].EntryType = PBK_Category;
+			Memory->Entries[9].Location = PBK_Location_Unknown;
+			Memory->Entries[10].EntryType = PBK_RingtoneID;
+			Memory->Entries[10].Location = PBK_Location_Unknown;
+			Memory->Entries[11].EntryType = PBK_Text_PictureName;
+			Memory->Entries[11].Location = PBK_Location_Unknown;
+
 			/* Adjust location */
 			Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-			/* Adjust number */
-			GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
-			/* Set date type */
-			Memory->Entries[2].EntryType = PBK_Date;
-			/* Set number of entries */
-			Memory->EntriesNum = 3;
-			return ERR_NONE;
-		}
-
-		/**
-		 * Samsung format:
-		 * location,"number",type,"0x02surname0x03","0x02firstname0x03","number",
-		 * type,"number",type,"number",type,"number",type,"email","NA",
-		 * "0x02note0x03",category?,x,x,x,ringtone?,"NA","photo"
-		 *
-		 * NA fields were empty
-		 * x fields are some numbers, default is 1,65535,255,255,65535
-		 *
-		 * Samsung number types:
-		 * 2 - fax
-		 * 4 - cell
-		 * 5 - other
-		 * 6 - home
-		 * 7 - office
-		 */
-		if (Priv->Manufacturer == AT_Samsung) {
-			/* Parse reply */
-			error = ATGEN_ParseReply(s,
-					GetLineString(msg->Buffer, &Priv->Lines, 2),
-					"+CPBR: @i,@p,@i,@S,@S,@p,@i,@p,@i,@p,@i,@p,@i,@s,@s,@S,@i,@i,@i,@i,@i,@s,@s",
-					&Memory->Location,
-					Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
-					&types[0],
-					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text), /* surname */
-					Memory->Entries[2].Text, sizeof(Memory->Entries[2].Text), /* first name */
-					Memory->Entries[3].Text, sizeof(Memory->Entries[3].Text),
-					&types[3],
-					Memory->Entries[4].Text, sizeof(Memory->Entries[4].Text),
-					&types[4],
-					Memory->Entries[5].Text, sizeof(Memory->Entries[5].Text),
-					&types[5],
-					Memory->Entries[6].Text, sizeof(Memory->Entries[6].Text),
-					&types[6],
-					Memory->Entries[7].Text, sizeof(Memory->Entries[7].Text), /* email */
-					buffer, sizeof(buffer), /* We don't know this */
-					Memory->Entries[8].Text, sizeof(Memory->Entries[8].Text), /* note */
-					&Memory->Entries[9].Number, /* category */
-					&number_type, /* We don't know this */
-					&number_type, /* We don't know this */
-					&number_type, /* We don't know this */
-					&Memory->Entries[10].Number, /* ringtone ID */
-					buffer, sizeof(buffer), /* We don't know this */
-					Memory->Entries[11].Text, sizeof(Memory->Entries[11].Text) /* photo ID */
-					);
 
-			if (error == ERR_NONE) {
-				smprintf(s, "Samsung reply detected\n");
-				/* Set types */
-				Memory->Entries[1].EntryType = PBK_Text_LastName;
-				Memory->Entries[1].Location = PBK_Location_Unknown;
-				Memory->Entries[2].EntryType = PBK_Text_FirstName;
-				Memory->Entries[2].Location = PBK_Location_Unknown;
-				Memory->Entries[7].EntryType = PBK_Text_Email;
-				Memory->Entries[7].Location = PBK_Location_Unknown;
-				Memory->Entries[8].EntryType = PBK_Text_Note;
-				Memory->Entries[8].Location = PBK_Location_Unknown;
-				Memory->Entries[9].EntryType = PBK_Category;
-				Memory->Entries[9].Location = PBK_Location_Unknown;
-				Memory->Entries[10].EntryType = PBK_RingtoneID;
-				Memory->Entries[10].Location = PBK_Location_Unknown;
-				Memory->Entries[11].EntryType = PBK_Text_PictureName;
-				Memory->Entries[11].Location = PBK_Location_Unknown;
-
-				/* Adjust location */
-				Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-
-				/* Shift entries when needed */
-				offset = 0;
+			/* Shift entries when needed */
+			offset = 0;
 
 #define SHIFT_ENTRIES(index) \
-	for (i = index - offset + 1; i < GSM_PHONEBOOK_ENTRIES; i++) { \
-		Memory->Entries[i - 1] = Memory->Entries[i]; \
-	} \
-	offset++;
+for (i = index - offset + 1; i < GSM_PHONEBOOK_ENTRIES; i++) { \
+	Memory->Entries[i - 1] = Memory->Entries[i]; \
+} \
+offset++;
 
 #define CHECK_TEXT(index) \
-				if (UnicodeLength(Memory->Entries[index - offset].Text) == 0) { \
-					smprintf(s, "Entry %d is empty\n", index); \
-					SHIFT_ENTRIES(index); \
-				}
+			if (UnicodeLength(Memory->Entries[index - offset].Text) == 0) { \
+				smprintf(s, "Entry %d is empty\n", index); \
+				SHIFT_ENTRIES(index); \
+			}
 #define CHECK_NUMBER(index) \
-				if (UnicodeLength(Memory->Entries[index - offset].Text) == 0) { \
-					smprintf(s, "Entry %d is empty\n", index); \
-					SHIFT_ENTRIES(index); \
-				} else { \
-					Memory->Entries[index - offset].VoiceTag   = 0; \
-					Memory->Entries[index - offset].SMSList[0] = 0; \
-					switch (types[index]) { \
-						case 2: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_Fax; \
-							Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
-							break; \
-						case 4: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_Mobile; \
-							Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
-							break; \
-						case 5: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_Other; \
-							Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
-							break; \
-						case 6: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_General; \
-							Memory->Entries[index - offset].Location = PBK_Location_Home; \
-							break; \
-						case 7: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_General; \
-							Memory->Entries[index - offset].Location = PBK_Location_Work; \
-							break; \
-						default: \
-							Memory->Entries[index - offset].EntryType  = PBK_Number_Other; \
-							Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
-							smprintf(s, "WARNING: Unknown memory entry type %d\n", types[index]); \
-							break; \
-					} \
-				}
-				CHECK_NUMBER(0);
-				CHECK_TEXT(1);
-				CHECK_TEXT(2);
-				CHECK_NUMBER(3);
-				CHECK_NUMBER(4);
-				CHECK_NUMBER(5);
-				CHECK_NUMBER(6);
-				CHECK_TEXT(7);
-				CHECK_TEXT(8);
-				if (Memory->Entries[10 - offset].Number == 65535) {
-					SHIFT_ENTRIES(10);
-				}
-				CHECK_TEXT(11);
+			if (UnicodeLength(Memory->Entries[index - offset].Text) == 0) { \
+				smprintf(s, "Entry %d is empty\n", index); \
+				SHIFT_ENTRIES(index); \
+			} else { \
+				Memory->Entries[index - offset].VoiceTag   = 0; \
+				Memory->Entries[index - offset].SMSList[0] = 0; \
+				switch (types[index]) { \
+					case 2: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_Fax; \
+						Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
+						break; \
+					case 4: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_Mobile; \
+						Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
+						break; \
+					case 5: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_Other; \
+						Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
+						break; \
+					case 6: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_General; \
+						Memory->Entries[index - offset].Location = PBK_Location_Home; \
+						break; \
+					case 7: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_General; \
+						Memory->Entries[index - offset].Location = PBK_Location_Work; \
+						break; \
+					default: \
+						Memory->Entries[index - offset].EntryType  = PBK_Number_Other; \
+						Memory->Entries[index - offset].Location = PBK_Location_Unknown; \
+						smprintf(s, "WARNING: Unknown memory entry type %d\n", types[index]); \
+						break; \
+				} \
+			}
+			CHECK_NUMBER(0);
+			CHECK_TEXT(1);
+			CHECK_TEXT(2);
+			CHECK_NUMBER(3);
+			CHECK_NUMBER(4);
+			CHECK_NUMBER(5);
+			CHECK_NUMBER(6);
+			CHECK_TEXT(7);
+			CHECK_TEXT(8);
+			if (Memory->Entries[10 - offset].Number == 65535) {
+				SHIFT_ENTRIES(10);
+			}
+			CHECK_TEXT(11);
 
 #undef CHECK_NUMBER
 #undef CHECK_TEXT
 #undef SHIFT_ENTRIES
-				/* Set number of entries */
-				Memory->EntriesNum = 12 - offset;
-				return ERR_NONE;
-			}
-
-		}
-
-		/*
-		 * Nokia 2730 adds some extra fields to the end, we ignore
-		 * them for now
-		 */
-		error = ATGEN_ParseReply(s,
-					GetLineString(msg->Buffer, &Priv->Lines, 2),
-					"+CPBR: @i, @p, @I, @e, @0",
-					&Memory->Location,
-					Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
-					&number_type,
-					Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
-		if (error == ERR_NONE) {
-			smprintf(s, "Extended AT reply detected\n");
-			/* Adjust location */
-			Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
-			/* Adjust number */
-			GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
 			/* Set number of entries */
-			Memory->EntriesNum = 2;
+			Memory->EntriesNum = 12 - offset;
 			return ERR_NONE;
 		}
 
-		return ERR_UNKNOWNRESPONSE;
+	}
+
+	/*
+	 * Nokia 2730 adds some extra fields to the end, we ignore
+	 * them for now
+	 */
+	error = ATGEN_ParseReply(s,
+				line,
+				"+CPBR: @i, @p, @I, @e, @0",
+				&Memory->Location,
+				Memory->Entries[0].Text, sizeof(Memory->Entries[0].Text),
+				&number_type,
+				Memory->Entries[1].Text, sizeof(Memory->Entries[1].Text));
+	if (error == ERR_NONE) {
+		smprintf(s, "Extended AT reply detected\n");
+		/* Adjust location */
+		Memory->Location = Memory->Location + 1 - Priv->FirstMemoryEntry;
+		/* Adjust number */
+		GSM_TweakInternationalNumber(Memory->Entries[0].Text, number_type);
+		/* Set number of entries */
+		Memory->EntriesNum = 2;
+		return ERR_NONE;
+	}
+
+	return ERR_UNKNOWNRESPONSE;
+}
+
+/**
+ * Parses reply on AT+CPBR=n.
+ */
+GSM_Error ATGEN_ReplyGetMemory(GSM_Protocol_Message *msg, GSM_StateMachine *s)
+{
+ 	GSM_Phone_ATGENData 	*Priv = &s->Phone.Data.Priv.ATGEN;
+ 	GSM_MemoryEntry		*Memory = s->Phone.Data.Memory;
+	GSM_Error		error;
+
+	switch (Priv->ReplyState) {
+	case AT_Reply_OK:
+ 		smprintf(s, "Phonebook entry received\n");
+		/* Check for empty entries */
+		if (strcmp("OK", GetLineString(msg->Buffer, &Priv->Lines, 2)) == 0) {
+			Memory->EntriesNum = 0;
+			return ERR_EMPTY;
+		}
+
+		return ATGEN_ParseMemoryEntry(s, Memory, GetLineString(msg->Buffer, &Priv->Lines, 2));
 	case AT_Reply_CMEError:
 		if (Priv->ErrorCode == 100)
 			return ERR_EMPTY;
@@ -4059,6 +4387,188 @@ GSM_Error ATGEN_ReplyGetMemory(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 	return ERR_UNKNOWNRESPONSE;
 }
 
+/**
+ * Parses reply on AT+CPBR=first,last and stores non empty entries in
+ * phonebook cache. Entries are decoded later by \ref ATGEN_ParseMemoryEntry
+ * when they are read. Lines wrapped by phone are joined back to their entry.
+ */
+GSM_Error ATGEN_ReplyGetMemoryRange(GSM_Protocol_Message *msg, GSM_StateMachine *s)
+{
+ 	GSM_Phone_ATGENData 	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_AT_PBK_Cache	*cache, *current = NULL;
+	GSM_Error		error;
+	char			*str;
+	int			line, location;
+	size_t			len, extra;
+
+	switch (Priv->ReplyState) {
+	case AT_Reply_OK:
+		break;
+	case AT_Reply_CMEError:
+		if (Priv->ErrorCode == 100 || Priv->ErrorCode == 22)
+			return ERR_EMPTY;
+		if (Priv->ErrorCode == 3 || Priv->ErrorCode == 4)
+			return ERR_NOTSUPPORTED;
+		error = ATGEN_HandleCMEError(s);
+		if (error == ERR_MEMORY) {
+			smprintf(s, "Assuming that memory error means empty range\n");
+			return ERR_EMPTY;
+		}
+		return error;
+	case AT_Reply_Error:
+		return ERR_NOTSUPPORTED;
+	case AT_Reply_CMSError:
+ 	        return ATGEN_HandleCMSError(s);
+	default:
+		return ERR_UNKNOWNRESPONSE;
+	}
+
+	smprintf(s, "Phonebook range received\n");
+
+	/* First line is our command so we can skip it */
+	for (line = 2; !LineEquals(msg->Buffer, &Priv->Lines, line, "OK"); line++) {
+		/* Continuation of wrapped entry is joined to it */
+		if (!LineStartsWith(msg->Buffer, &Priv->Lines, line, "+CPBR:")) {
+			if (current == NULL) {
+				continue;
+			}
+			len = strlen(current->Line);
+			extra = GetLineLength(msg->Buffer, &Priv->Lines, line);
+			str = (char *)realloc(current->Line, len + extra + 2);
+
+			if (str == NULL) {
+				return ERR_MOREMEMORY;
+			}
+			str[len] = ' ';
+			CopyLineString(str + len + 1, msg->Buffer, &Priv->Lines, line);
+			current->Line = str;
+			continue;
+		}
+		/* Line is copied just once, directly to the cache */
+		str = DupLineString(msg->Buffer, &Priv->Lines, line);
+
+		if (str == NULL) {
+			return ERR_MOREMEMORY;
+		}
+		error = ATGEN_ParseReply(s, str, "+CPBR: @i, @0", &location);
+
+		if (error != ERR_NONE) {
+			free(str);
+			return error;
+		}
+
+		/* Reallocate buffer if needed */
+		if (Priv->PBKCacheSize <= Priv->PBKCacheCount) {
+			Priv->PBKCacheSize = (Priv->PBKCacheSize == 0) ? 32 : Priv->PBKCacheSize * 2;
+			cache = (GSM_AT_PBK_Cache *)realloc(Priv->PBKCache, Priv->PBKCacheSize * sizeof(GSM_AT_PBK_Cache));
+
+			if (cache == NULL) {
+				free(str);
+				return ERR_MOREMEMORY;
+			}
+			Priv->PBKCache = cache;
+		}
+		cache = &Priv->PBKCache[Priv->PBKCacheCount];
+		cache->Location = location + 1 - Priv->FirstMemoryEntry;
+		cache->Line = str;
+		current = cache;
+		Priv->PBKCacheCount++;
+	}
+	return ERR_NONE;
+}
+
+void ATGEN_FreePBKCache(GSM_StateMachine *s)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	int			i;
+
+	for (i = 0; i < Priv->PBKCacheCount; i++) {
+		free(Priv->PBKCache[i].Line);
+	}
+	free(Priv->PBKCache);
+	Priv->PBKCache = NULL;
+	Priv->PBKCacheCount = 0;
+	Priv->PBKCacheSize = 0;
+	Priv->PBKCacheRead = 0;
+	Priv->PBKCacheMemory = 0;
+}
+
+/**
+ * Reads whole phonebook memory using AT+CPBR=first,last in chunks of
+ * \ref AT_PBK_CACHE_CHUNK locations.
+ */
+GSM_Error ATGEN_FillPBKCache(GSM_StateMachine *s, GSM_MemoryType type)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_Error		error;
+	char			req[40];
+	int			start, end, last;
+	size_t			len;
+
+	ATGEN_FreePBKCache(s);
+
+	if (Priv->FirstMemoryEntry == -1) {
+		error = ATGEN_GetMemoryInfo(s, NULL, AT_First);
+		if (error != ERR_NONE) return error;
+	}
+
+	last = Priv->FirstMemoryEntry + Priv->MemorySize - 1;
+
+	smprintf(s, "Filling phonebook cache\n");
+	for (start = Priv->FirstMemoryEntry; start <= last; start += AT_PBK_CACHE_CHUNK) {
+		end = MIN(start + AT_PBK_CACHE_CHUNK - 1, last);
+		len = sprintf(req, "AT+CPBR=%i,%i\r", start, end);
+		ATGEN_WaitFor(s, req, len, 0x00, 30, ID_GetMemoryRange);
+
+		if (error == ERR_EMPTY) {
+			continue;
+		}
+		if (error != ERR_NONE) {
+			ATGEN_FreePBKCache(s);
+			return error;
+		}
+	}
+	smprintf(s, "Read %d phonebook entries\n", Priv->PBKCacheCount);
+
+	Priv->PBKCacheMemory = type;
+	Priv->PBKCacheCharset = Priv->Charset;
+	return ERR_NONE;
+}
+
+/**
+ * Returns next entry from phonebook cache, filling it when needed.
+ */
+GSM_Error ATGEN_GetNextMemoryCache(GSM_StateMachine *s, GSM_MemoryEntry *entry, gboolean start)
+{
+	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
+	GSM_Error		error;
+
+	/* For reading we prefer unicode */
+	error = ATGEN_SetCharset(s, AT_PREF_CHARSET_UNICODE);
+	if (error != ERR_NONE) return error;
+
+	/* Cached lines are decoded in charset they were read in */
+	if (start || Priv->PBKCacheMemory != entry->MemoryType || Priv->PBKCacheCharset != Priv->Charset) {
+		error = ATGEN_FillPBKCache(s, entry->MemoryType);
+		if (error != ERR_NONE) return error;
+	}
+
+	/* Rewind if caller went back */
+	if (Priv->PBKCacheRead > 0 && Priv->PBKCache[Priv->PBKCacheRead - 1].Location >= entry->Location) {
+		Priv->PBKCacheRead = 0;
+	}
+	while (Priv->PBKCacheRead < Priv->PBKCacheCount && Priv->PBKCache[Priv->PBKCacheRead].Location < entry->Location) {
+		Priv->PBKCacheRead++;
+	}
+	if (Priv->PBKCacheRead >= Priv->PBKCacheCount) {
+		return ERR_EMPTY;
+	}
+
+	error = ATGEN_ParseMemoryEntry(s, entry, Priv->PBKCache[Priv->PBKCacheRead].Line);
+	Priv->PBKCacheRead++;
+	return error;
+}
+
 GSM_Error ATGEN_PrivGetMemory (GSM_StateMachine *s, GSM_MemoryEntry *entry, int endlocation)
 {
 	GSM_Error 		error;
@@ -4170,6 +4680,26 @@ GSM_Error ATGEN_GetNextMemory (GSM_StateMachine *s, GSM_MemoryEntry *entry, gboo
 	} else {
 		entry->Location++;
 	}
+
+	/* Read whole memory at once if phone supports generic ranges */
+	if ((entry->MemoryType != MEM_ME ||
+				(Priv->PBKSBNR != AT_AVAILABLE &&
+				Priv->PBK_MPBR != AT_AVAILABLE &&
+				Priv->PBK_SPBR != AT_AVAILABLE)) &&
+			Priv->PBKCacheRange != AT_NOTAVAILABLE &&
+			!GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_NO_CPBR_RANGE)) {
+		error = ATGEN_GetNextMemoryCache(s, entry, start);
+
+		if (error != ERR_NOTSUPPORTED && error != ERR_UNKNOWNRESPONSE) {
+			if (error == ERR_NONE) {
+				Priv->PBKCacheRange = AT_AVAILABLE;
+			}
+			return error;
+		}
+		smprintf(s, "Phonebook range reading failed, reading entries one by one\n");
+		Priv->PBKCacheRange = AT_NOTAVAILABLE;
+	}
+
 	while ((error = ATGEN_PrivGetMemory(s, entry, step == 0 ? 0 : MIN(Priv->MemorySize, entry->Location + step))) == ERR_EMPTY) {
 		entry->Location += step + 1;
 		if (Priv->PBK_MPBR == AT_AVAILABLE && entry->MemoryType == MEM_ME) {
@@ -4196,6 +4726,8 @@ GSM_Error ATGEN_DeleteAllMemory(GSM_StateMachine *s, GSM_MemoryType type)
 	GSM_Phone_ATGENData	*Priv = &s->Phone.Data.Priv.ATGEN;
 	size_t len;
 
+	ATGEN_FreePBKCache(s);
+
 	error = ATGEN_SetPBKMemory(s, type);
 	if (error != ERR_NONE) return error;
 
@@ -4870,6 +5402,8 @@ GSM_Error ATGEN_DeleteMemory(GSM_StateMachine *s, GSM_MemoryEntry *entry)
 	if (entry->Location < 1) {
 		return ERR_INVALIDLOCATION;
 	}
+	ATGEN_FreePBKCache(s);
+
 	error = ATGEN_SetPBKMemory(s, entry->MemoryType);
 
 	if (error != ERR_NONE) {
@@ -4913,6 +5447,8 @@ GSM_Error ATGEN_PrivSetMemory(GSM_StateMachine *s, GSM_MemoryEntry *entry)
 	if (entry->Location == 0) {
 		return ERR_INVALIDLOCATION;
 	}
+	ATGEN_FreePBKCache(s);
+
 	if (entry->MemoryType == MEM_ME) {
 		if (Priv->PBK_SPBR == 0) {
 			ATGEN_CheckSPBR(s);
@@ -5506,11 +6042,17 @@ GSM_Error ATGEN_Terminate(GSM_StateMachine *s)
 {
 	GSM_Phone_ATGENData *Priv = &s->Phone.Data.Priv.ATGEN;
 
+	/* Remember what we have probed for next connection */
+	if (s->CurrentConfig->CapabilityCache != NULL) {
+		ATGEN_SaveCapabilityCache(s);
+	}
+
 	FreeLines(&Priv->Lines);
 	free(Priv->file.Buffer);
 	Priv->file.Buffer = NULL;
 	free(Priv->SMSCache);
 	Priv->SMSCache = NULL;
+	ATGEN_FreePBKCache(s);
 	return ERR_NONE;
 }
 
@@ -5894,6 +6436,7 @@ GSM_Error ATGEN_ReplyCheckProt(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 }
 
 GSM_Reply_Function ATGENReplyFunctions[] = {
+{ATGEN_GenericReply,		"AT\r"			,0x00,0x00,ID_Initialise	 },
 {ATGEN_GenericReply,		"AT\r"			,0x00,0x00,ID_IncomingFrame	 },
 {ATGEN_GenericReply,		"ATE1" 	 		,0x00,0x00,ID_EnableEcho	 },
 {ATGEN_GenericReply,		"ERROR" 	 	,0x00,0x00,ID_EnableEcho	 },
@@ -5977,6 +6520,7 @@ GSM_Reply_Function ATGENReplyFunctions[] = {
 {ATGEN_ReplyGetCharset,		"AT+CSCS?"		,0x00,0x00,ID_GetMemoryCharset	 },
 {ATGEN_GenericReply,		"AT+CSCS="		,0x00,0x00,ID_SetMemoryCharset	 },
 {ATGEN_ReplyGetMemory,		"AT+CPBR="		,0x00,0x00,ID_GetMemory		 },
+{ATGEN_ReplyGetMemoryRange,	"AT+CPBR="		,0x00,0x00,ID_GetMemoryRange	 },
 {SIEMENS_ReplyGetMemoryInfo,	"AT^SBNR=?"		,0x00,0x00,ID_GetMemory		 },
 {SAMSUNG_ReplyGetMemoryInfo,	"AT+SPBR=?"		,0x00,0x00,ID_GetMemory		 },
 {MOTOROLA_ReplyGetMemoryInfo,	"AT+MPBR=?"		,0x00,0x00,ID_GetMemory		 },
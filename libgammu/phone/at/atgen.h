@@ -28,6 +28,7 @@
 #include <gammu-statemachine.h>
 
 #include "../../misc/misc.h" /* For GSM_CutLines */
+#include "../../gsmreply.h" /* For GSM_Phone_RequestID */
 
 #include "motorola.h"
 
@@ -185,6 +186,44 @@ typedef enum {
 	AT_NOTAVAILABLE
 } GSM_AT_Feature;
 
+/**
+ * Maximal length of line with concatenated commands.
+ */
+#define ATGEN_BATCH_MAX_LENGTH 128
+
+/**
+ * Maximal number of remembered batches which phone did not accept.
+ */
+#define ATGEN_BATCH_FAILED_MAX 8
+
+/**
+ * Single command in batch sent by \ref ATGEN_WaitForBatch.
+ */
+typedef struct {
+	/**
+	 * Command without AT prefix and line end, for example "+CSQ".
+	 * Only extended syntax commands can be batched.
+	 */
+	const char		*Command;
+	/**
+	 * Prefix of information lines this command replies with, for
+	 * example "+CSQ:", NULL if command has no information reply.
+	 */
+	const char		*Prefix;
+	/**
+	 * Request ID used for dispatching reply of this command.
+	 */
+	GSM_Phone_RequestID	RequestID;
+	/**
+	 * Result of reply function for this command.
+	 */
+	GSM_Error		Error;
+	/**
+	 * Whether reply for this command was already dispatched.
+	 */
+	gboolean		Done;
+} GSM_AT_BatchCommand;
+
 typedef enum {
 	SAMSUNG_NONE = 1,
 	SAMSUNG_ORG,
@@ -224,6 +263,26 @@ typedef struct {
 	char PDU[GSM_AT_MAXPDULEN];
 } GSM_AT_SMS_Cache;
 
+/**
+ * Structure for phonebook cache.
+ */
+typedef struct {
+	/**
+	 * Location of entry (translated).
+	 */
+	int Location;
+	/**
+	 * Raw +CPBR: reply line, decoded on read.
+	 */
+	char *Line;
+} GSM_AT_PBK_Cache;
+
+/**
+ * Number of locations read by one AT+CPBR=first,last when filling
+ * phonebook cache, some phones can not reply with more at once.
+ */
+#define AT_PBK_CACHE_CHUNK	100
+
 /**
  * Maximal length of phonebook memories list.
  */
@@ -376,6 +435,28 @@ typedef struct {
 	 * Current Motorola mode.
 	 */
 	int			CurrentMode;
+	/**
+	 * Whether phone accepts several commands concatenated on one
+	 * line, zero if not yet probed.
+	 */
+	GSM_AT_Feature		Batching;
+	/**
+	 * Commands of batch currently being processed.
+	 */
+	GSM_AT_BatchCommand	*Batch;
+	/**
+	 * Number of commands in Batch.
+	 */
+	int			BatchCount;
+	/**
+	 * Command lines of batches phone did not accept, commands from
+	 * these are sent separately without trying batch again.
+	 */
+	char			FailedBatches[ATGEN_BATCH_FAILED_MAX][ATGEN_BATCH_MAX_LENGTH + 2];
+	/**
+	 * Number of entries in FailedBatches.
+	 */
+	int			FailedBatchCount;
 	GSM_File		file;
 	/**
 	 * Number of entries in SMSCache.
@@ -385,6 +466,34 @@ typedef struct {
 	 * Locations of non empty SMSes.
 	 */
 	GSM_AT_SMS_Cache	*SMSCache;
+	/**
+	 * Number of entries in PBKCache.
+	 */
+	int			PBKCacheCount;
+	/**
+	 * Allocated size of PBKCache.
+	 */
+	int			PBKCacheSize;
+	/**
+	 * Next PBKCache entry to be read.
+	 */
+	int			PBKCacheRead;
+	/**
+	 * Memory type PBKCache holds, zero if cache is not valid.
+	 */
+	GSM_MemoryType		PBKCacheMemory;
+	/**
+	 * Charset in which PBKCache entries were read.
+	 */
+	GSM_AT_Charset		PBKCacheCharset;
+	/**
+	 * Whether phone supports reading phonebook ranges by AT+CPBR.
+	 */
+	GSM_AT_Feature		PBKCacheRange;
+	/**
+	 * Non empty phonebook entries read by AT+CPBR=first,last.
+	 */
+	GSM_AT_PBK_Cache	*PBKCache;
 	/**
 	 * Which folder do we read SMS from.
 	 */
@@ -436,6 +545,46 @@ GSM_Error ATGEN_DispatchMessage	(GSM_StateMachine *s);
 #define ATGEN_WaitForAutoLen(s, cmd, type, time, request) \
 	ATGEN_WaitFor(s, cmd, strlen(cmd), type, time, request)
 
+/**
+ * Sends several commands to phone and dispatches their replies to
+ * reply functions as if they were sent separately. Phones which
+ * support it get all commands concatenated on single line, others
+ * get them one by one. Result for each command is stored in its
+ * Error field.
+ *
+ * \param s State machine structure.
+ * \param commands Commands to send.
+ * \param count Number of commands.
+ * \param timeout Timeout for whole batch.
+ *
+ * \return Error code, ERR_NONE does not mean all commands succeeded.
+ */
+GSM_Error ATGEN_WaitForBatch(GSM_StateMachine *s, GSM_AT_BatchCommand *commands, int count, int timeout);
+
+/**
+ * Waits until phone is done with previous request and can accept new
+ * one. Phone is probed with empty AT command, phones with
+ * F_FIXED_DELAYS just get fixed delay instead.
+ *
+ * \param s State machine structure.
+ * \param delay Delay in milliseconds for phones with F_FIXED_DELAYS.
+ *
+ * \return Error code, DispatchError of previous request is kept.
+ */
+GSM_Error ATGEN_WaitForReady(GSM_StateMachine *s, int delay);
+
+/**
+ * Reads raw data from device until prompt is received. The data are
+ * not passed to protocol.
+ *
+ * \param s State machine structure.
+ * \param prompt Prompt to wait for.
+ * \param timeout Timeout in seconds.
+ *
+ * \return Error code.
+ */
+GSM_Error ATGEN_WaitForPrompt(GSM_StateMachine *s, const char *prompt, int timeout);
+
 /**
  * Parses AT formatted reply. This is a bit like sprintf parser, but
  * specially focused on AT replies and can automatically convert text
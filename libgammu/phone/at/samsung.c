@@ -122,28 +122,6 @@ static unsigned int GetCRC(char *data, int size)
  * Frame transfer
  */
 
-static GSM_Error WaitFor(GSM_StateMachine *s, const char *t, int ttl)
-{
-	char 		readbuf[100]={0};
-	int 		n=0,sec=0;
-        GSM_DateTime    Date;
-
-        GSM_GetCurrentDateTime (&Date);
-        sec = Date.Second;
-
-	n = s->Device.Functions->ReadDevice(s, readbuf, sizeof(readbuf) - 1);
-	readbuf[n] = '\0';
-
-	while (strstr(readbuf, t) == NULL && (sec + ttl) >= Date.Second) {
-		usleep(500000);
-		n = s->Device.Functions->ReadDevice(s, readbuf, sizeof(readbuf) - 1);
-		readbuf[n] = '\0';
-        	GSM_GetCurrentDateTime (&Date);
-	}
-
-	return (sec + ttl) >= Date.Second ? ERR_NONE : ERR_TIMEOUT;
-}
-
 static GSM_Error SetSamsungFrame(GSM_StateMachine *s, unsigned char *buff, int size, GSM_Phone_RequestID id)
 {
 	GSM_Phone_Data		*Phone = &s->Phone.Data;
@@ -153,7 +131,7 @@ static GSM_Error SetSamsungFrame(GSM_StateMachine *s, unsigned char *buff, int s
 	count = size / BLKSZ;
 
 	for (i = 0; i < count; i++) {
-		error = WaitFor(s, ">", 4);
+		error = ATGEN_WaitForPrompt(s, ">", 4);
  		if (error!=ERR_NONE) return error;
 
  		error = s->Protocol.Functions->WriteMessage(s,
@@ -161,7 +139,7 @@ static GSM_Error SetSamsungFrame(GSM_StateMachine *s, unsigned char *buff, int s
  		if (error!=ERR_NONE) return error;
 	}
 
-	error = WaitFor(s, ">", 4);
+	error = ATGEN_WaitForPrompt(s, ">", 4);
  	if (error!=ERR_NONE) return error;
 	error = s->Protocol.Functions->WriteMessage(s,
 		buff + i * BLKSZ, size%BLKSZ, 0x00);
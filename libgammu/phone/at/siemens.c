@@ -109,9 +109,11 @@ static GSM_Error SetSiemensFrame (GSM_StateMachine *s, unsigned char *buff, cons
 			return error;
 		}
 	}
-	/* Give phone some time to process the request */
-	/* @todo: This is probably way too big */
-	usleep(500000);
+	/* Wait until phone processes the request */
+	error = ATGEN_WaitForReady(s, 500);
+	if (error != ERR_NONE) {
+		return error;
+	}
 	return Phone->DispatchError;
 }
 
@@ -242,7 +244,7 @@ GSM_Error SIEMENS_ReplyGetNextCalendar(GSM_Protocol_Message *msg, GSM_StateMachi
  		smprintf(s, "Calendar entry received\n");
 		error = GetSiemensFrame(msg, s, "vcs", buffer, &len);
 		if (error != ERR_NONE) return error;
-		return GSM_DecodeVCALENDAR_VTODO(&(s->di), buffer,&pos,Calendar,&ToDo,Siemens_VCalendar,0);
+		return GSM_DecodeVCALENDAR_VTODOLength(&(s->di), buffer, len, &pos, Calendar, &ToDo, Siemens_VCalendar, 0);
 	case AT_Reply_Error:
 		smprintf(s, "Error - too high location ?\n");
 		return ERR_INVALIDLOCATION;
@@ -407,6 +409,7 @@ GSM_Error SIEMENS_ReplyGetMemory(GSM_Protocol_Message *msg, GSM_StateMachine *s)
  	GSM_MemoryEntry		*Memory = s->Phone.Data.Memory;
 	char			buffer[4096];
 	size_t			length = 0;
+	size_t			pos = 0;
 	GSM_Error		error;
 
 	switch (Priv->ReplyState) {
@@ -415,8 +418,7 @@ GSM_Error SIEMENS_ReplyGetMemory(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 		error = GetSiemensFrame(msg,s,"vcf", buffer, &length);
 		if (error != ERR_NONE) return error;
  		Memory->EntriesNum = 0;
-		length = 0;
- 		return GSM_DecodeVCARD(&(s->di), buffer, &length, Memory, SonyEricsson_VCard21_Phone);
+ 		return GSM_DecodeVCARDLength(&(s->di), buffer, length, &pos, Memory, SonyEricsson_VCard21_Phone);
 	case AT_Reply_Error:
                 smprintf(s, "Error - too high location ?\n");
                 return ERR_INVALIDLOCATION;
@@ -64,22 +64,23 @@ GSM_Error ATOBEX_SetATMode(GSM_StateMachine *s)
 	s->Phone.Functions->ReplyFunctions	= ATGENReplyFunctions;
 	Priv->Mode				= ATOBEX_ModeAT;
 
-	/* Terminate SQWE Obex mode */
+	/* Terminate SQWE Obex mode, escape sequence needs guard time */
 	if (Priv->HasOBEX == ATOBEX_OBEX_SQWE) {
 		sleep(1);
 		error = GSM_WaitFor (s, "+++", 3, 0x00, 100, ID_IncomingFrame);
 		if (error != ERR_NONE) return error;
 	}
 
-	/* Give Samsung phones some time to recover from protocol switch */
-	if (Priv->HasOBEX == ATOBEX_OBEX_MOBEX || Priv->HasOBEX == ATOBEX_OBEX_TSSPCSW) {
-		sleep(2);
-	}
-
 	/* Initialise AT protocol */
 	error = s->Protocol.Functions->Initialise(s);
 	if (error != ERR_NONE) return error;
 
+	/* Samsung phones need some time to recover from protocol switch */
+	if (Priv->HasOBEX == ATOBEX_OBEX_MOBEX || Priv->HasOBEX == ATOBEX_OBEX_TSSPCSW) {
+		error = ATGEN_WaitForReady(s, 2000);
+		if (error != ERR_NONE) return error;
+	}
+
 	return ERR_NONE;
 }
 
@@ -156,8 +157,13 @@ GSM_Error ATOBEX_SetOBEXMode(GSM_StateMachine *s, OBEX_Service service)
 	error = s->Protocol.Functions->Terminate(s);
 	if (error != ERR_NONE) return error;
 
-	/* Need some sleep before starting talk in OBEX */
-	sleep(1);
+	/*
+	 * Some phones need time before starting talk in OBEX, others
+	 * get OBEX connection request retried if it is not answered.
+	 */
+	if (GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_FIXED_DELAYS)) {
+		sleep(1);
+	}
 
 	/* Switch to OBEX protocol and initialise it */
 	s->Protocol.Functions = &OBEXProtocol;
@@ -1256,23 +1256,9 @@ read_next_entry:
 	File->System = FALSE;
 	File->ReadOnly = FALSE; /* @todo TODO get this from permissions? */
 
-	/* Open nested directory for next loop if needed */
+	/* Listing does not descend to nested directories */
 	if (S_ISDIR(sb.st_mode)) {
 		File->Folder = TRUE;
-		if (Priv->fs_depth == DUMMY_MAX_FS_DEPTH - 1) {
-			smprintf(s, "We hit DUMMY_MAX_FS_DEPTH limit!\n");
-			free(path);
-			path=NULL;
-			return ERR_MOREMEMORY;
-		}
-		Priv->fs_depth++;
-		Priv->dir[Priv->fs_depth] = opendir(path);
-		if (Priv->dir[Priv->fs_depth] == NULL) {
-			free(path);
-			path=NULL;
-			return DUMMY_Error(s, "nested opendir failed");
-		}
-		strcpy(Priv->dirnames[Priv->fs_depth], path);
 	}
 	free(path);
 	path=NULL;
@@ -21,97 +21,316 @@
 /* shared */
 
 /**
- * Shifts data in file cache by defined count.
+ * Returns entry of file cache, entry 0 is the first one to be processed.
  *
- * \param move How to move entries. +10 means that i entry will become
- * i + 10, while -10 means that entries will be moved backwards. Of
- * course starting at the beginning of the list. So 10 entry will become 0.
+ * Cache is stack kept at the end of allocated array, so entries are
+ * added and removed at the beginning without moving the others. Returned
+ * pointer is valid only until next insertion.
  */
-static GSM_Error N6510_ShiftFileCache(GSM_StateMachine *s, int move)
+static N6510_FileEntry *N6510_FileCacheEntry(GSM_Phone_N6510Data *Priv, int i)
+{
+	return &Priv->FilesCache[Priv->FilesLocationsAvail - Priv->FilesLocationsUsed + i];
+}
+
+/**
+ * Inserts empty entries to file cache, array grows geometrically.
+ *
+ * \param pos Position where new entries should be inserted, entries
+ * before it are moved in front of them.
+ * \param count Number of entries to insert.
+ */
+static GSM_Error N6510_InsertFileCache(GSM_StateMachine *s, int pos, int count)
 {
 	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
-	int i;
+	N6510_FileEntry *cache;
+	int newsize, start;
 
-	if (move < 0) {
-		for (i = 0; i < Priv->FilesLocationsUsed + move; i++) {
-			memcpy(&Priv->FilesCache[i], &Priv->FilesCache[i - move], sizeof(GSM_File));
-			smprintf(s, "Copying %i to %i\n", i - move, i);
-		}
-	} else {
-		for (i = Priv->FilesLocationsUsed - 1; i >= 0; i--) {
-			memcpy(&Priv->FilesCache[i + move], &Priv->FilesCache[i], sizeof(GSM_File));
-			smprintf(s, "Copying %i to %i\n", i, i + move);
-		}
+	if (Priv->FilesLocationsUsed + count > Priv->FilesLocationsAvail) {
+		newsize = 2 * Priv->FilesLocationsAvail;
+		if (newsize < Priv->FilesLocationsUsed + count) newsize = Priv->FilesLocationsUsed + count;
+		if (newsize < 16) newsize = 16;
+
+		cache = (N6510_FileEntry *)realloc(Priv->FilesCache, newsize * sizeof(N6510_FileEntry));
+		if (cache == NULL) return ERR_MOREMEMORY;
+
+		/* Entries stay at the end, new space is at the beginning */
+		memmove(cache + newsize - Priv->FilesLocationsUsed,
+			cache + Priv->FilesLocationsAvail - Priv->FilesLocationsUsed,
+			Priv->FilesLocationsUsed * sizeof(N6510_FileEntry));
+
+		Priv->FilesCache = cache;
+		Priv->FilesLocationsAvail = newsize;
 	}
+	cache = Priv->FilesCache;
+	start = Priv->FilesLocationsAvail - Priv->FilesLocationsUsed - count;
 
-	Priv->FilesLocationsUsed += move;
+	/* Move entries before pos in front of new ones */
+	memmove(cache + start, cache + start + count, pos * sizeof(N6510_FileEntry));
+	memset(cache + start + pos, 0, count * sizeof(N6510_FileEntry));
+
+	Priv->FilesLocationsUsed += count;
 
 	return ERR_NONE;
 }
+
 /**
- * Allocates enough entries in file cache.
+ * Removes first entries from file cache.
  *
- * \param requested Number of files which are requested.
+ * \param used Number of entries which should stay in cache.
  */
-static GSM_Error N6510_AllocFileCache(GSM_StateMachine *s, int requested)
+static void N6510_TruncateFileCache(GSM_StateMachine *s, int used)
 {
 	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
-	int newsize;
 
-	/* Maybe there is already enough allocated */
-	if (Priv->FilesLocationsAvail >= requested) return ERR_NONE;
+	while (Priv->FilesLocationsUsed > used) {
+		free(N6510_FileCacheEntry(Priv, 0)->ID);
+		Priv->FilesLocationsUsed--;
+	}
+}
+
+/**
+ * Sets ID of file cache entry.
+ *
+ * \param Parent ID of parent folder, name is appended to it, can be NULL.
+ * \param Name Name or whole ID of entry.
+ */
+static GSM_Error N6510_SetFileCacheID(N6510_FileEntry *Entry, const unsigned char *Parent, const unsigned char *Name)
+{
+	size_t parent = 0, length;
+
+	if (Parent != NULL) {
+		if (UnicodeLength(Name) > GSM_MAX_FILENAME_LENGTH) return ERR_INVALIDDATA;
+		parent = UnicodeLength(Parent) + 1;
+	}
+	length = parent + UnicodeLength(Name);
+	if (length > GSM_MAX_FILENAME_ID_LENGTH) return ERR_INVALIDDATA;
+
+	free(Entry->ID);
+	Entry->ID = (unsigned char *)malloc(2 * (length + 1));
+	if (Entry->ID == NULL) return ERR_MOREMEMORY;
 
-	/* Do not allocate one by one */
-	newsize = requested + 10;
+	if (Parent != NULL) {
+		CopyUnicodeString(Entry->ID, Parent);
+		EncodeUnicode(Entry->ID + 2 * (parent - 1), "/", 1);
+	}
+	CopyUnicodeString(Entry->ID + 2 * parent, Name);
+	return ERR_NONE;
+}
 
-	/* Reallocate memory */
-	Priv->FilesCache = (GSM_File *)realloc(Priv->FilesCache, newsize * sizeof(GSM_File));
-	if (Priv->FilesCache == NULL) return ERR_MOREMEMORY;
+/**
+ * Fills file structure from file cache entry, name is taken from last
+ * part of ID.
+ */
+static void N6510_FileFromCache(N6510_FileEntry *Entry, GSM_File *File)
+{
+	size_t i, name = 0;
 
-	/* Store new cache size */
-	Priv->FilesLocationsAvail = newsize;
+	memset(File, 0, sizeof(GSM_File));
+	if (Entry->ID != NULL) {
+		CopyUnicodeString(File->ID_FullName, Entry->ID);
+		for (i = 0; i < UnicodeLength(Entry->ID); i++) {
+			if (Entry->ID[2 * i] == 0 && Entry->ID[2 * i + 1] == '/') name = i + 1;
+		}
+		if (name != 0) CopyUnicodeString(File->Name, Entry->ID + 2 * name);
+	}
+	File->Level		= Entry->Level;
+	File->Folder		= Entry->Folder;
+	File->ReadOnly		= Entry->ReadOnly;
+	File->Hidden		= Entry->Hidden;
+	File->System		= Entry->System;
+	File->Protected		= Entry->Protected;
+	File->ModifiedEmpty	= Entry->ModifiedEmpty;
+	File->Modified		= Entry->Modified;
+	File->Used		= Entry->Used;
+}
+
+/**
+ * Removes first entry from file cache.
+ *
+ * \param File Where to store removed entry, can be NULL.
+ */
+static GSM_Error N6510_PopFileCache(GSM_StateMachine *s, GSM_File *File)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	if (Priv->FilesLocationsUsed == 0) return ERR_EMPTY;
+
+	if (File != NULL) {
+		N6510_FileFromCache(N6510_FileCacheEntry(Priv, 0), File);
+	}
+	N6510_TruncateFileCache(s, Priv->FilesLocationsUsed - 1);
 
 	return ERR_NONE;
 }
 
-static int N6510_FindFileCheckSum12(GSM_StateMachine *s, unsigned char *ptr, int len)
+void N6510_FreeFileCache(GSM_StateMachine *s)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	N6510_TruncateFileCache(s, 0);
+	free(Priv->FilesCache);
+	Priv->FilesCache = NULL;
+	Priv->FilesLocationsAvail = 0;
+}
+
+/**
+ * CRC-16 table for polynomial 0x1021.
+ */
+static const unsigned short N6510_FileCRCTable[256] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static void N6510_StartFileCheckSum12(GSM_StateMachine *s)
+{
+	s->Phone.Data.Priv.N6510.FileCRC = 0xffff;
+	s->Phone.Data.Priv.N6510.FileCRCHistory = 0;
+}
+
+/**
+ * Updates checksum of transferred file with next part of data.
+ *
+ * Phone uses CRC-16 with polynomial 0x1021, where each byte is
+ * additionally mixed with high byte of the register from two bytes
+ * before (accx keeps these history bytes).
+ */
+static void N6510_UpdateFileCheckSum12(GSM_StateMachine *s, const unsigned char *ptr, size_t len)
 {
-	int acc, i, accx;
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+	int acc, accx, high;
 
-	accx = 0;
-	acc  = 0xffff;
+	acc  = Priv->FileCRC;
+	accx = Priv->FileCRCHistory;
 	while (len--) {
-		accx = (accx & 0xffff00ff) | (acc & 0xff00);
-		acc  = (acc  & 0xffff00ff) | (*ptr++ << 8);
-		for (i = 0; i < 8; i++) {
-			acc <<= 1;
-			if (acc & 0x10000)     acc ^= 0x1021;
-			if (accx & 0x80000000) acc ^= 0x1021;
-			accx <<= 1;
+		high = acc >> 8;
+		acc  = ((acc << 8) & 0xff00) ^ N6510_FileCRCTable[*ptr++ ^ (accx >> 8)];
+		accx = ((accx << 8) | high) & 0xffff;
+	}
+	Priv->FileCRC = acc;
+	Priv->FileCRCHistory = accx;
+}
+
+/**
+ * Compares checksum from phone with checksum of transferred data.
+ *
+ * \return ERR_EMPTY on match (end of transfer), ERR_WRONGCRC otherwise.
+ */
+static GSM_Error N6510_CheckFileCheckSum12(GSM_StateMachine *s)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	smprintf(s, "Checksum from Gammu is %04X\n", Priv->FileCRC);
+	if (Priv->FileCRC != Priv->FileCheckSum) {
+		smprintf(s,"File2 checksum is %i, File checksum is %i\n", Priv->FileCRC, Priv->FileCheckSum);
+		return ERR_WRONGCRC;
+	}
+	return ERR_EMPTY;
+}
+
+/**
+ * Starts transfer of new file, part size is negotiated again for every
+ * file.
+ */
+static void N6510_StartFileParts(GSM_StateMachine *s)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	Priv->FilePartSize = N6510_FILE_PART_MIN;
+	Priv->FilePartMax = N6510_FILE_PART_MAX;
+	N6510_StartFileCheckSum12(s);
+}
+
+/**
+ * Handles file part request which phone did not accept.
+ *
+ * \return TRUE if part should be requested again with smaller size.
+ */
+static gboolean N6510_RejectedFilePartSize(GSM_StateMachine *s, int requested)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	if (requested <= N6510_FILE_PART_MIN) {
+		return FALSE;
+	}
+	smprintf(s, "Phone did not accept file part of %d bytes, using default size\n", requested);
+	Priv->FilePartSize = N6510_FILE_PART_MIN;
+	Priv->FilePartMax = requested / 2;
+	return TRUE;
+}
+
+/**
+ * Updates size of next requested file part based on reply to last
+ * request.
+ *
+ * \return TRUE if transfer continues.
+ */
+static gboolean N6510_NextFilePartSize(GSM_StateMachine *s, GSM_File *File, int requested, int received)
+{
+	GSM_Phone_N6510Data *Priv = &s->Phone.Data.Priv.N6510;
+
+	if (received == requested) {
+		/* Phone sent everything, ask for more next time */
+		if (requested * 2 <= Priv->FilePartMax) {
+			Priv->FilePartSize = requested * 2;
 		}
+		return TRUE;
+	}
+	if (received > 0 && (int)File->Used < Priv->FileSize) {
+		/* Phone sends less than asked, do not ask for more */
+		smprintf(s, "Phone sent %d bytes of %d requested in file part\n", received, requested);
+		return TRUE;
 	}
-	smprintf(s, "Checksum from Gammu is %04X\n",(acc & 0xffff));
-	return (acc & 0xffff);
+	return FALSE;
 }
 
 GSM_Error N6510_ReplyGetFilePart12(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 {
-	int old;
+	size_t length;
 
 	smprintf(s,"File part received\n");
-	old = s->Phone.Data.File->Used;
-	s->Phone.Data.File->Used += msg->Buffer[6]*256*256*256+
-				    msg->Buffer[7]*256*256+
-				    msg->Buffer[8]*256+
-				    msg->Buffer[9];
-	smprintf(s,"Length of file part: %i\n",
-			msg->Buffer[6]*256*256*256+
-			msg->Buffer[7]*256*256+
-			msg->Buffer[8]*256+
-			msg->Buffer[9]);
-	s->Phone.Data.File->Buffer = (unsigned char *)realloc(s->Phone.Data.File->Buffer,s->Phone.Data.File->Used);
-	memcpy(s->Phone.Data.File->Buffer+old,msg->Buffer+10,s->Phone.Data.File->Used-old);
-	return ERR_NONE;
+	if (msg->Length < 10) {
+		return ERR_UNKNOWNRESPONSE;
+	}
+	length = msg->Buffer[6]*256*256*256+
+		 msg->Buffer[7]*256*256+
+		 msg->Buffer[8]*256+
+		 msg->Buffer[9];
+	smprintf(s,"Length of file part: %ld\n", (long)length);
+	if (length > msg->Length - 10) {
+		return ERR_UNKNOWNRESPONSE;
+	}
+	N6510_UpdateFileCheckSum12(s, msg->Buffer + 10, length);
+	return GSM_AppendFilePart(s, s->Phone.Data.File, msg->Buffer + 10, length);
 }
 
 GSM_Error N6510_ReplyGetFileCRC12(GSM_Protocol_Message *msg, GSM_StateMachine *s)
@@ -140,9 +359,10 @@ static GSM_Error N6510_GetFileCRC1(GSM_StateMachine *s, unsigned char *id)
 GSM_Error N6510_ReplyGetFileFolderInfo1(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 {
 	GSM_File		*File = s->Phone.Data.FileInfo;
+	N6510_FileEntry		*Entry;
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 	int		     	i, newsize;
-	unsigned		char buffer[500];
+	unsigned		char buffer[500], id[20];
 	GSM_Error		error;
 
 	switch (msg->Buffer[3]) {
@@ -226,17 +446,17 @@ GSM_Error N6510_ReplyGetFileFolderInfo1(GSM_Protocol_Message *msg, GSM_StateMach
 
 			newsize = msg->Buffer[8] * 256 + msg->Buffer[9];
 
-			error = N6510_AllocFileCache(s, Priv->FilesLocationsUsed + newsize);
-			if (error != ERR_NONE) return error;
-
-			error = N6510_ShiftFileCache(s, newsize);
+			error = N6510_InsertFileCache(s, 0, newsize);
 			if (error != ERR_NONE) return error;
 
 			for (i = 0; i < newsize; i++) {
+				Entry = N6510_FileCacheEntry(Priv, i);
 				sprintf(buffer,"%i",msg->Buffer[13+i*4-1]*256 + msg->Buffer[13+i*4]);
-				EncodeUnicode(Priv->FilesCache[i].ID_FullName,buffer,strlen(buffer));
-				Priv->FilesCache[i].Level = File->Level+1;
-				smprintf(s, "%s ",DecodeUnicodeString(Priv->FilesCache[i].ID_FullName));
+				EncodeUnicode(id,buffer,strlen(buffer));
+				error = N6510_SetFileCacheID(Entry, NULL, id);
+				if (error != ERR_NONE) return error;
+				Entry->Level = File->Level+1;
+				smprintf(s, "%s ",buffer);
 			}
 			smprintf(s, "\n");
 		}
@@ -291,26 +511,28 @@ static GSM_Error N6510_GetNextFileFolder1(GSM_StateMachine *s, GSM_File *File, g
 {
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 	GSM_Error	       	error;
-	unsigned char		buffer[5];
+	unsigned char		buffer[5], id[20];
 
 	if (start) {
-		error = N6510_AllocFileCache(s, 1);
-		if (error != ERR_NONE) return error;
+		N6510_TruncateFileCache(s, 0);
 
-		Priv->FilesLocationsUsed = 1;
+		error = N6510_InsertFileCache(s, 0, 1);
+		if (error != ERR_NONE) return error;
 
 		sprintf(buffer,"%i",0x01);
-		EncodeUnicode(Priv->FilesCache[0].ID_FullName,buffer,strlen(buffer));
-		Priv->FilesCache[0].Level = 1;
+		EncodeUnicode(id,buffer,strlen(buffer));
+		error = N6510_SetFileCacheID(N6510_FileCacheEntry(Priv, 0), NULL, id);
+		if (error != ERR_NONE) return error;
+		N6510_FileCacheEntry(Priv, 0)->Level = 1;
 	}
 
 	while (1) {
 		if (Priv->FilesLocationsUsed == 0) return ERR_EMPTY;
 
-		CopyUnicodeString(File->ID_FullName,Priv->FilesCache[0].ID_FullName);
-		File->Level = Priv->FilesCache[0].Level;
+		CopyUnicodeString(File->ID_FullName,N6510_FileCacheEntry(Priv, 0)->ID);
+		File->Level = N6510_FileCacheEntry(Priv, 0)->Level;
 
-		error = N6510_ShiftFileCache(s, -1);
+		error = N6510_PopFileCache(s, NULL);
 		if (error != ERR_NONE) return error;
 
 		error = N6510_GetFileFolderInfo1(s, File, TRUE);
@@ -382,7 +604,7 @@ static GSM_Error N6510_GetFileSystemStatus1(GSM_StateMachine *s, GSM_FileSystemS
 static GSM_Error N6510_GetFilePart1(GSM_StateMachine *s, GSM_File *File, int *Handle UNUSED, int *Size)
 {
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
-	int		     	old;
+	int		     	old, length;
 	GSM_Error	       	error;
 	unsigned char	   	req[] = {
 		N7110_FRAME_HEADER, 0x0E, 0x00, 0x00, 0x00, 0x01,
@@ -398,9 +620,12 @@ static GSM_Error N6510_GetFilePart1(GSM_StateMachine *s, GSM_File *File, int *Ha
 		if (File->Folder) return ERR_SHOULDBEFILE;
 
 		(*Size) 	= File->Used;
+		Priv->FileSize	= File->Used;
 		File->Used 	= 0;
+		N6510_StartFileParts(s);
 	}
 
+	length		 = Priv->FilePartSize;
 	old		 = File->Used;
 	req[8]		 = atoi(DecodeUnicodeString(File->ID_FullName)) / 256;
 	req[9]		 = atoi(DecodeUnicodeString(File->ID_FullName)) % 256;
@@ -408,20 +633,21 @@ static GSM_Error N6510_GetFilePart1(GSM_StateMachine *s, GSM_File *File, int *Ha
 	req[11]		 = old / (256*256);
 	req[12]		 = old / 256;
 	req[13]		 = old % 256;
+	req[16]		 = length / 256;
+	req[17]		 = length % 256;
 
 	s->Phone.Data.File = File;
 	smprintf(s, "Getting file part from filesystem\n");
 	error=GSM_WaitFor (s, req, 18, 0x6D, 4, ID_GetFile);
+	if (error != ERR_NONE && N6510_RejectedFilePartSize(s, length)) {
+		return N6510_GetFilePart1(s, File, Handle, Size);
+	}
 	if (error != ERR_NONE) return error;
-	if (File->Used - old != (0x03 * 256 + 0xE8)) {
+	if (!N6510_NextFilePartSize(s, File, length, File->Used - old)) {
 		error = N6510_GetFileCRC1(s, File->ID_FullName);
 		if (error != ERR_NONE) return error;
 
-		if (N6510_FindFileCheckSum12(s, File->Buffer, File->Used) != Priv->FileCheckSum) {
-			smprintf(s,"File2 checksum is %i, File checksum is %i\n",N6510_FindFileCheckSum12(s, File->Buffer, File->Used),Priv->FileCheckSum);
-			return ERR_WRONGCRC;
-		}
-		return ERR_EMPTY;
+		return N6510_CheckFileCheckSum12(s);
 	}
 	return ERR_NONE;
 }
@@ -470,74 +696,44 @@ static GSM_Error N6510_SetFileAttributes1(GSM_StateMachine *s, GSM_File *File)
 static GSM_Error N6510_SearchForFileName1(GSM_StateMachine *s, GSM_File *File)
 {
 	GSM_Error	       	error;
-	GSM_File		*BackupCache, *NewFiles;
-	int		     	FilesLocationsUsed,FilesLocationsUsed2,i;
+	GSM_File		Entry;
+	int		     	FilesLocationsUsed,NewFiles,i;
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 
 	File->Folder = FALSE;
 
-	/* making backup */
-	BackupCache = (GSM_File *)malloc(sizeof(GSM_File) * Priv->FilesLocationsUsed);
-	if (BackupCache == NULL) return ERR_MOREMEMORY;
-	memcpy(BackupCache, Priv->FilesCache, sizeof(GSM_File) * Priv->FilesLocationsUsed);
+	/* Folder content is put on top of pending entries */
 	FilesLocationsUsed = Priv->FilesLocationsUsed;
 
-	/* Allocate new cache */
-	error = N6510_AllocFileCache(s, 1);
-	if (error != ERR_NONE) return error;
-
-	/* putting own data */
-	Priv->FilesCache[0].Level    	= 1;
-	Priv->FilesLocationsUsed 	= 1;
-	CopyUnicodeString(Priv->FilesCache[0].ID_FullName,File->ID_FullName);
-
 	/* checking */
-	error = N6510_GetFileFolderInfo1(s, &Priv->FilesCache[0], TRUE);
-
-	/* backuping new data */
-	NewFiles = (GSM_File *)malloc(sizeof(GSM_File) * Priv->FilesLocationsUsed);
-	if (NewFiles == NULL) {
-		free(BackupCache);
-		BackupCache=NULL;
-		return ERR_MOREMEMORY;
-	}
-	memcpy(NewFiles, Priv->FilesCache, sizeof(GSM_File) * Priv->FilesLocationsUsed);
-	FilesLocationsUsed2 = Priv->FilesLocationsUsed;
-
-	/* restoring */
-	memcpy(Priv->FilesCache, BackupCache, sizeof(GSM_File) * FilesLocationsUsed);
-	free(BackupCache);
-	BackupCache=NULL;
-	Priv->FilesLocationsUsed = FilesLocationsUsed;
-
-	if (error != ERR_NONE) {
-		free(NewFiles);
-		NewFiles=NULL;
-		return error;
-	}
-
-	for (i = 0; i < FilesLocationsUsed2; i++) {
-		smprintf(s, "ID is %s\n",DecodeUnicodeString(NewFiles[i].ID_FullName));
-		error = N6510_GetFileFolderInfo1(s, &NewFiles[i], FALSE);
-		if (error == ERR_EMPTY) continue;
-		if (error != ERR_NONE) {
-			free(NewFiles);
-			NewFiles=NULL;
-			return error;
+	memset(&Entry, 0, sizeof(Entry));
+	Entry.Level = 1;
+	CopyUnicodeString(Entry.ID_FullName,File->ID_FullName);
+	error = N6510_GetFileFolderInfo1(s, &Entry, TRUE);
+	NewFiles = Priv->FilesLocationsUsed - FilesLocationsUsed;
+
+	for (i = 0; error == ERR_NONE && i < NewFiles; i++) {
+		N6510_FileFromCache(N6510_FileCacheEntry(Priv, i), &Entry);
+		smprintf(s, "ID is %s\n",DecodeUnicodeString(Entry.ID_FullName));
+		error = N6510_GetFileFolderInfo1(s, &Entry, FALSE);
+		if (error == ERR_EMPTY) {
+			error = ERR_NONE;
+			continue;
 		}
+		if (error != ERR_NONE) break;
 		smprintf(s, "%s",DecodeUnicodeString(File->Name));
-		smprintf(s, "%s \n",DecodeUnicodeString(NewFiles[i].Name));
-		if (mywstrncasecmp(NewFiles[i].Name,File->Name,0)) {
+		smprintf(s, "%s \n",DecodeUnicodeString(Entry.Name));
+		if (mywstrncasecmp(Entry.Name,File->Name,0)) {
 			smprintf(s, "the same\n");
-			File->Folder = NewFiles[i].Folder;
-			free(NewFiles);
-			NewFiles=NULL;
-			return ERR_NONE;
+			File->Folder = Entry.Folder;
+			break;
 		}
 	}
-	free(NewFiles);
-	NewFiles=NULL;
-	return ERR_EMPTY;
+	if (error == ERR_NONE && i == NewFiles) error = ERR_EMPTY;
+
+	/* restoring */
+	N6510_TruncateFileCache(s, FilesLocationsUsed);
+	return error;
 }
 
 GSM_Error N6510_ReplyAddFileHeader1(GSM_Protocol_Message *msg, GSM_StateMachine *s)
@@ -630,6 +826,8 @@ static GSM_Error N6510_AddFilePart1(GSM_StateMachine *s, GSM_File *File, int *Po
 		smprintf(s, "Adding file header\n");
 		error=GSM_WaitFor (s, Header, 246, 0x6D, 4, ID_AddFile);
 		if (error != ERR_NONE) return error;
+
+		N6510_StartFileCheckSum12(s);
 	}
 
 	j = 1000;
@@ -642,6 +840,7 @@ static GSM_Error N6510_AddFilePart1(GSM_StateMachine *s, GSM_File *File, int *Po
 	smprintf(s, "Adding file part %i %i\n",*Pos,j);
 	error=GSM_WaitFor (s, Add, 14+j, 0x6D, 4, ID_AddFile);
 	if (error != ERR_NONE) return error;
+	N6510_UpdateFileCheckSum12(s, File->Buffer + (*Pos), j);
 	*Pos = *Pos + j;
 
 	if (j < 1000) {
@@ -715,12 +914,7 @@ static GSM_Error N6510_AddFilePart1(GSM_StateMachine *s, GSM_File *File, int *Po
 		error = N6510_GetFileCRC1(s, File->ID_FullName);
 		if (error != ERR_NONE) return error;
 
-		if (N6510_FindFileCheckSum12(s, File->Buffer, File->Used) != Priv->FileCheckSum) {
-			smprintf(s,"File2 checksum is %i, File checksum is %i\n",N6510_FindFileCheckSum12(s, File->Buffer, File->Used),Priv->FileCheckSum);
-			return ERR_WRONGCRC;
-		}
-
-		return ERR_EMPTY;
+		return N6510_CheckFileCheckSum12(s);
 	}
 
 	return ERR_NONE;
@@ -747,7 +941,7 @@ static GSM_Error N6510_PrivDeleteFileFolder1(GSM_StateMachine *s, unsigned char
 
 	memset(&File, 0, sizeof(File));
 
-	Priv->FilesLocationsUsed = 0;
+	N6510_TruncateFileCache(s, 0);
 	CopyUnicodeString(File.ID_FullName,ID);
 	error = N6510_GetFileFolderInfo1(s, &File, TRUE);
 	if (error != ERR_NONE) return error;
@@ -835,7 +1029,7 @@ static GSM_Error N6510_GetFolderListing1(GSM_StateMachine *s, GSM_File *File, gb
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 
 	if (start) {
-		Priv->FilesLocationsUsed = 0;
+		N6510_TruncateFileCache(s, 0);
 
 		error = N6510_GetFileFolderInfo1(s, File, TRUE);
 		if (error != ERR_NONE) return error;
@@ -846,11 +1040,11 @@ static GSM_Error N6510_GetFolderListing1(GSM_StateMachine *s, GSM_File *File, gb
 	while (TRUE) {
 		if (Priv->FilesLocationsUsed == 0) return ERR_EMPTY;
 
-		memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
+		N6510_FileFromCache(N6510_FileCacheEntry(Priv, 0), File);
 		error = N6510_GetFileFolderInfo1(s, File, FALSE);
 		if (error != ERR_NONE) return error;
 
-		error = N6510_ShiftFileCache(s, -1);
+		error = N6510_PopFileCache(s, NULL);
 		if (error != ERR_NONE) return error;
 
 		/* 3510 for example */
@@ -940,11 +1134,56 @@ static GSM_Error N6510_GetFileCRC2(GSM_StateMachine *s, int *Handle)
 	return GSM_WaitFor (s, req2, 10, 0x6D, 8, ID_GetCRC);
 }
 
+/**
+ * Decodes details of file or folder from filesystem 2 reply.
+ */
+static void N6510_DecodeFileFolderInfo2(GSM_Protocol_Message *msg, GSM_StateMachine *s, N6510_FileEntry *Entry)
+{
+	smprintf(s, "File type: 0x%02X\n", msg->Buffer[29]);
+	if ((msg->Buffer[29] & 0x10) == 0x10) {
+		Entry->Folder = TRUE;
+		smprintf(s,"Folder\n");
+	} else {
+		Entry->Folder = FALSE;
+		smprintf(s,"File\n");
+		Entry->Used = msg->Buffer[10]*256*256*256+
+			    msg->Buffer[11]*256*256+
+			    msg->Buffer[12]*256+
+			    msg->Buffer[13];
+		smprintf(s,"Size %ld bytes\n", (long)Entry->Used);
+	}
+	Entry->ReadOnly = FALSE;
+	if ((msg->Buffer[29] & 1) == 1) {
+		Entry->ReadOnly = TRUE;
+		smprintf(s,"Readonly\n");
+	}
+	Entry->Hidden = FALSE;
+	if ((msg->Buffer[29] & 2) == 2) {
+		Entry->Hidden = TRUE;
+		smprintf(s,"Hidden\n");
+	}
+	Entry->System = FALSE;
+	if ((msg->Buffer[29] & 4) == 4) {
+		Entry->System = TRUE;
+		smprintf(s,"System\n");
+	}
+	Entry->Protected = FALSE;
+	if ((msg->Buffer[29] & 0x40) == 0x40) {
+		Entry->Protected = TRUE;
+		smprintf(s,"Protected\n");
+	}
+
+	Entry->ModifiedEmpty = FALSE;
+	NOKIA_DecodeDateTime(s, msg->Buffer+14, &Entry->Modified, TRUE, FALSE);
+	if (Entry->Modified.Year == 0x00) Entry->ModifiedEmpty = TRUE;
+	if (Entry->Modified.Year == 0xffff) Entry->ModifiedEmpty = TRUE;
+}
+
 GSM_Error N6510_ReplyGetFileFolderInfo2(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 {
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 	GSM_File		*FileInfo = s->Phone.Data.FileInfo;
-	GSM_File		*File;
+	N6510_FileEntry		Entry;
 	GSM_Error error;
 
 	switch (msg->Buffer[3]) {
@@ -973,75 +1212,45 @@ GSM_Error N6510_ReplyGetFileFolderInfo2(GSM_Protocol_Message *msg, GSM_StateMach
 			}
 			smprintf(s,"File or folder details received\n");
 
-			if (msg->Buffer[3] == 0x69) {
-				/* File/Folder without can not be handled */
-				if (UnicodeLength(msg->Buffer+32) == 0) {
-					smprintf(s, "Ignoring file without name!\n");
-					return ERR_NONE;
-				}
-				error = N6510_AllocFileCache(s, Priv->FilesLocationsUsed + 1);
-				if (error != ERR_NONE) {
-					return error;
-				}
-
-				error = N6510_ShiftFileCache(s, 1);
-				if (error != ERR_NONE) return error;
-
-				File = &Priv->FilesCache[1];
-
-				File->Level = Priv->FilesCache[0].Level + 1;
-
-				CopyUnicodeString(File->Name,msg->Buffer+32);
-				smprintf(s,"\"%s\"\n",DecodeUnicodeString(File->Name));
+			memset(&Entry, 0, sizeof(Entry));
+			N6510_DecodeFileFolderInfo2(msg, s, &Entry);
+
+			if (msg->Buffer[3] == 0x6D) {
+				FileInfo->Folder	= Entry.Folder;
+				if (!Entry.Folder) FileInfo->Used = Entry.Used;
+				FileInfo->ReadOnly	= Entry.ReadOnly;
+				FileInfo->Hidden	= Entry.Hidden;
+				FileInfo->System	= Entry.System;
+				FileInfo->Protected	= Entry.Protected;
+				FileInfo->ModifiedEmpty	= Entry.ModifiedEmpty;
+				FileInfo->Modified	= Entry.Modified;
+				return ERR_NONE;
+			}
 
-				CopyUnicodeString(File->ID_FullName,FileInfo->ID_FullName);
-				EncodeUnicode(File->ID_FullName+UnicodeLength(File->ID_FullName)*2,"/",1);
-				CopyUnicodeString(File->ID_FullName+UnicodeLength(File->ID_FullName)*2,msg->Buffer+32);
-				smprintf(s,"\"%s\"\n",DecodeUnicodeString(File->ID_FullName));
-			} else {
-				File = FileInfo;
+			/* File/Folder without can not be handled */
+			if (UnicodeLength(msg->Buffer+32) == 0) {
+				smprintf(s, "Ignoring file without name!\n");
+				return ERR_NONE;
 			}
+			smprintf(s,"\"%s\"\n",DecodeUnicodeString(msg->Buffer+32));
 
-			smprintf(s, "File type: 0x%02X\n", msg->Buffer[29]);
-			if ((msg->Buffer[29] & 0x10) == 0x10) {
-				File->Folder = TRUE;
-				smprintf(s,"Folder\n");
+			Entry.Level = N6510_FileCacheEntry(Priv, 0)->Level + 1;
+			error = N6510_SetFileCacheID(&Entry, FileInfo->ID_FullName, msg->Buffer+32);
+			if (error == ERR_INVALIDDATA) {
+				smprintf(s, "Ignoring file with too long name!\n");
+			} else if (error != ERR_NONE) {
+				return error;
 			} else {
-				File->Folder = FALSE;
-				smprintf(s,"File\n");
-				File->Used = msg->Buffer[10]*256*256*256+
-					    msg->Buffer[11]*256*256+
-					    msg->Buffer[12]*256+
-					    msg->Buffer[13];
-				smprintf(s,"Size %ld bytes\n", (long)File->Used);
-			}
-			File->ReadOnly = FALSE;
-			if ((msg->Buffer[29] & 1) == 1) {
-				File->ReadOnly = TRUE;
-				smprintf(s,"Readonly\n");
-			}
-			File->Hidden = FALSE;
-			if ((msg->Buffer[29] & 2) == 2) {
-				File->Hidden = TRUE;
-				smprintf(s,"Hidden\n");
-			}
-			File->System = FALSE;
-			if ((msg->Buffer[29] & 4) == 4) {
-				File->System = TRUE;
-				smprintf(s,"System\n");
-			}
-			File->Protected = FALSE;
-			if ((msg->Buffer[29] & 0x40) == 0x40) {
-				File->Protected = TRUE;
-				smprintf(s,"Protected\n");
+				smprintf(s,"\"%s\"\n",DecodeUnicodeString(Entry.ID));
+				error = N6510_InsertFileCache(s, 1, 1);
+				if (error != ERR_NONE) {
+					free(Entry.ID);
+					return error;
+				}
+				*N6510_FileCacheEntry(Priv, 1) = Entry;
 			}
 
-			File->ModifiedEmpty = FALSE;
-			NOKIA_DecodeDateTime(s, msg->Buffer+14, &File->Modified, TRUE, FALSE);
-			if (File->Modified.Year == 0x00) File->ModifiedEmpty = TRUE;
-			if (File->Modified.Year == 0xffff) File->ModifiedEmpty = TRUE;
-
-			if (msg->Buffer[3] == 0x69 && msg->Buffer[4] == 0) Priv->FilesEnd = TRUE;
+			if (msg->Buffer[4] == 0) Priv->FilesEnd = TRUE;
 
 			return ERR_NONE;
 		case 0x06:
@@ -1127,57 +1336,64 @@ static GSM_Error N6510_PrivGetFolderListing2(GSM_StateMachine *s, GSM_File *File
 	return ERR_NONE;
 }
 
+/**
+ * Sets names of filesystem 2 roots, other entries have name in ID.
+ */
+static void N6510_SetRootName2(GSM_File *File)
+{
+	if (strcmp(DecodeUnicodeString(File->ID_FullName), "d:") == 0) {
+		EncodeUnicode(File->Name,"D (Permanent_memory 2)",22);
+	} else if (strcmp(DecodeUnicodeString(File->ID_FullName), "a:") == 0) {
+		EncodeUnicode(File->Name,"A (Memory card)",15);
+	}
+}
+
 static GSM_Error N6510_GetNextFileFolder2(GSM_StateMachine *s, GSM_File *File, gboolean start)
 {
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
+	N6510_FileEntry		*Entry;
+	unsigned char		id[10];
 	GSM_Error	       	error;
 
 	if (start) {
-		error = N6510_AllocFileCache(s, 2);
+		N6510_TruncateFileCache(s, 0);
+
+		error = N6510_InsertFileCache(s, 0, 2);
+		if (error != ERR_NONE) return error;
+
+		Entry = N6510_FileCacheEntry(Priv, 0);
+		Entry->Level	= 1;
+		Entry->Folder	= TRUE;
+		EncodeUnicode(id,"d:",2);
+		error = N6510_SetFileCacheID(Entry, NULL, id);
 		if (error != ERR_NONE) return error;
 
-		Priv->FilesLocationsUsed = 2;
-
-		Priv->FilesCache[0].Level	= 1;
-		Priv->FilesCache[0].Folder	= TRUE;
-		Priv->FilesCache[0].Level	= 1;
-		Priv->FilesCache[0].ReadOnly = FALSE;
-		Priv->FilesCache[0].System = FALSE;
-		Priv->FilesCache[0].Hidden = FALSE;
-		Priv->FilesCache[0].Protected = FALSE;
-		EncodeUnicode(Priv->FilesCache[0].ID_FullName,"d:",2);
-		EncodeUnicode(Priv->FilesCache[0].Name,"D (Permanent_memory 2)",22);
-
-		Priv->FilesCache[1].Level	= 1;
-		Priv->FilesCache[1].Folder	= TRUE;
-		Priv->FilesCache[1].Level	= 1;
-		Priv->FilesCache[1].ReadOnly = FALSE;
-		Priv->FilesCache[1].System = FALSE;
-		Priv->FilesCache[1].Hidden = FALSE;
-		Priv->FilesCache[1].Protected = FALSE;
-		EncodeUnicode(Priv->FilesCache[1].ID_FullName,"a:",2);
-		EncodeUnicode(Priv->FilesCache[1].Name,"A (Memory card)",15);
+		Entry = N6510_FileCacheEntry(Priv, 1);
+		Entry->Level	= 1;
+		Entry->Folder	= TRUE;
+		EncodeUnicode(id,"a:",2);
+		error = N6510_SetFileCacheID(Entry, NULL, id);
+		if (error != ERR_NONE) return error;
 	}
 
 	smprintf(s, "Currently %i locations\n",Priv->FilesLocationsUsed);
 	if (Priv->FilesLocationsUsed == 0) return ERR_EMPTY;
 
 
-	if (!Priv->FilesCache[0].Folder) {
-		memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
-		error = N6510_ShiftFileCache(s, -1);
+	if (!N6510_FileCacheEntry(Priv, 0)->Folder) {
+		error = N6510_PopFileCache(s, File);
 		if (error != ERR_NONE) return error;
 		smprintf(s, "Returning file %s, level %d\n", DecodeUnicodeString(File->ID_FullName), File->Level);
 		return ERR_NONE;
 	}
 
-	memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
+	N6510_FileFromCache(N6510_FileCacheEntry(Priv, 0), File);
 	error = N6510_PrivGetFolderListing2(s, File);
 	if (error != ERR_NONE) return error;
 
-	memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
-	error = N6510_ShiftFileCache(s, -1);
+	error = N6510_PopFileCache(s, File);
 	if (error != ERR_NONE) return error;
+	N6510_SetRootName2(File);
 
 	smprintf(s, "Returning folder %s, level %d\n", DecodeUnicodeString(File->ID_FullName), File->Level);
 
@@ -1188,7 +1404,7 @@ static GSM_Error N6510_GetNextFileFolder2(GSM_StateMachine *s, GSM_File *File, g
 
 static GSM_Error N6510_GetFilePart2(GSM_StateMachine *s, GSM_File *File, int *Handle, int *Size)
 {
-	int		    	old,j;
+	int		    	old,j,length;
 	GSM_Error	       	error;
 	GSM_Phone_N6510Data     *Priv = &s->Phone.Data.Priv.N6510;
 	unsigned char	   	req[] = {
@@ -1217,7 +1433,9 @@ static GSM_Error N6510_GetFilePart2(GSM_StateMachine *s, GSM_File *File, int *Ha
 		}
 
 		(*Size) 	= File->Used;
+		Priv->FileSize	= File->Used;
 		File->Used 	= 0;
+		N6510_StartFileParts(s);
 	}
 
 	req[6]		 = (*Handle) / (256*256*256);
@@ -1231,24 +1449,29 @@ static GSM_Error N6510_GetFilePart2(GSM_StateMachine *s, GSM_File *File, int *Ha
 	req[12]		 = old / 256;
 	req[13]		 = old % 256;
 
+	length		 = Priv->FilePartSize;
+	req[14]		 = length / (256*256*256);
+	req[15]		 = length / (256*256);
+	req[16]		 = length / 256;
+	req[17]		 = length % 256;
+	memcpy(req + 18, req + 14, 4);
+
 	s->Phone.Data.File      = File;
 	smprintf(s, "Getting file part from filesystem\n");
 	error=GSM_WaitFor (s, req, 22, 0x6D, 4, ID_GetFile);
+	if (error != ERR_NONE && N6510_RejectedFilePartSize(s, length)) {
+		return N6510_GetFilePart2(s, File, Handle, Size);
+	}
 	if (error != ERR_NONE) return error;
 
-	if (File->Used - old != (0x03 * 256 + 0xE8)) {
+	if (!N6510_NextFilePartSize(s, File, length, File->Used - old)) {
 		error = N6510_GetFileCRC2(s, Handle);
 		if (error != ERR_NONE) return error;
 
 		error = N6510_CloseFile2(s, Handle);
 		if (error != ERR_NONE) return error;
 
-		if (N6510_FindFileCheckSum12(s, File->Buffer, File->Used) != Priv->FileCheckSum) {
-			smprintf(s,"File2 checksum is %i, File checksum is %i\n",N6510_FindFileCheckSum12(s, File->Buffer, File->Used),Priv->FileCheckSum);
-			return ERR_WRONGCRC;
-		}
-
-		return ERR_EMPTY;
+		return N6510_CheckFileCheckSum12(s);
 	}
 	return ERR_NONE;
 }
@@ -1408,10 +1631,7 @@ static GSM_Error N6510_AddFilePart2(GSM_StateMachine *s, GSM_File *File, int *Po
 /* 		if (error != ERR_NONE) return error; */
 /* 		error = N6510_CloseFile2(s, Handle); */
 /* 		if (error != ERR_NONE) return error; */
-/* 		if (N6510_FindFileCheckSum12(s, File->Buffer, File->Used) != Priv->FileCheckSum) { */
-/* 			smprintf(s,"File2 checksum is %i, File checksum is %i\n",N6510_FindFileCheckSum12(s, File->Buffer, File->Used),Priv->FileCheckSum); */
-/* 			return ERR_WRONGCRC; */
-/* 		} */
+/* 		return N6510_CheckFileCheckSum12(s); */
 
 		return ERR_EMPTY;
 	}
@@ -1436,25 +1656,19 @@ static GSM_Error N6510_GetFolderListing2(GSM_StateMachine *s, GSM_File *File, gb
 			if (!File->Folder) return ERR_SHOULDBEFOLDER;
 		}
 
-		error = N6510_AllocFileCache(s, 1);
-		if (error != ERR_NONE) return error;
+		N6510_TruncateFileCache(s, 0);
 
-		Priv->FilesLocationsUsed = 1;
+		error = N6510_InsertFileCache(s, 0, 1);
+		if (error != ERR_NONE) return error;
 
 		error = N6510_PrivGetFolderListing2(s, File);
 		if (error != ERR_NONE) return error;
 
-		memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
-
-		error = N6510_ShiftFileCache(s, -1);
+		error = N6510_PopFileCache(s, NULL);
 		if (error != ERR_NONE) return error;
 	}
 
-	if (Priv->FilesLocationsUsed == 0) return ERR_EMPTY;
-
-	memcpy(File,&Priv->FilesCache[0],sizeof(GSM_File));
-
-	error = N6510_ShiftFileCache(s, -1);
+	error = N6510_PopFileCache(s, File);
 	if (error != ERR_NONE) return error;
 
 	if (start) {
@@ -13,6 +13,7 @@ GSM_Error N6510_GetMMSFolders			(GSM_StateMachine *s, GSM_MMSFolders *folders);
 GSM_Error N6510_GetNextMMSFileInfo		(GSM_StateMachine *s, unsigned char *FileID, int *MMSFolder, gboolean start);
 GSM_Error N6510_GetFilesystemSMSFolders		(GSM_StateMachine *s, GSM_SMSFolders *folders);
 GSM_Error N6510_GetNextFilesystemSMS		(GSM_StateMachine *s, GSM_MultiSMSMessage *sms, gboolean start);
+void N6510_FreeFileCache			(GSM_StateMachine *s);
 
 GSM_Error N6510_ReplyGetFileCRC12		(GSM_Protocol_Message *msg, GSM_StateMachine *s);
 GSM_Error N6510_ReplySetAttrib2			(GSM_Protocol_Message *msg, GSM_StateMachine *s);
@@ -48,6 +48,8 @@ static GSM_Error N6510_Initialise (GSM_StateMachine *s)
 	s->Phone.Data.Priv.N6510.FilesLocationsAvail = 0;
 	s->Phone.Data.Priv.N6510.FilesLocationsUsed = 0;
 	s->Phone.Data.Priv.N6510.FilesCache = NULL;
+	s->Phone.Data.Priv.N6510.FilePartSize = N6510_FILE_PART_MIN;
+	s->Phone.Data.Priv.N6510.FilePartMax = N6510_FILE_PART_MAX;
 	s->Phone.Data.Priv.N6510.ScreenWidth = 0;
 	s->Phone.Data.Priv.N6510.ScreenHeight = 0;
 
@@ -66,8 +68,7 @@ static GSM_Error N6510_Initialise (GSM_StateMachine *s)
 
 static GSM_Error N6510_Terminate (GSM_StateMachine *s)
 {
-	free(s->Phone.Data.Priv.N6510.FilesCache);
-	s->Phone.Data.Priv.N6510.FilesCache = NULL;
+	N6510_FreeFileCache(s);
 	return ERR_NONE;
 }
 
@@ -824,7 +825,7 @@ GSM_Error N6510_ReplyGetSMSMessage(GSM_Protocol_Message *msg, GSM_StateMachine *
  				i = i + output[i-1];
  			}
 #endif
-			GSM_MakeMultiPartSMS(&(s->di), Data->GetSMSMessage,output,i,UDH_NokiaProfileLong,SMS_Coding_8bit,1,0);
+			GSM_MakeMultiPartSMS(&(s->di), Data->GetSMSMessage,output,i,UDH_NokiaProfileLong,SMS_Coding_8bit,1,0,-1);
 			for (i=0;i<3;i++) {
                 		Data->GetSMSMessage->SMS[i].Number[0]=0;
                 		Data->GetSMSMessage->SMS[i].Number[1]=0;
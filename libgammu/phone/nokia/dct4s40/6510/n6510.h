@@ -5,6 +5,15 @@
 
 #include "../../ncommon.h"
 
+/**
+ * Size of file part which all phones accept.
+ */
+#define N6510_FILE_PART_MIN	1000
+/**
+ * Upper limit for file part size, phone can limit it further.
+ */
+#define N6510_FILE_PART_MAX	16384
+
 typedef enum {
 	N6510_MMS_SETTINGS = 0x01,
 	N6510_CHAT_SETTINGS,
@@ -19,6 +28,26 @@ typedef enum {
 	N6510_LIGHT_TORCH   = 0x10
 } N6510_PHONE_LIGHTS;
 
+/**
+ * Entry of filesystem traversal stack, only what is needed to continue
+ * the walk and to return entry from folder listing.
+ */
+typedef struct {
+	/**
+	 * Unicode ID of file or folder, allocated for each entry.
+	 */
+	unsigned char			*ID;
+	int				Level;
+	gboolean			Folder;
+	gboolean			ReadOnly;
+	gboolean			Hidden;
+	gboolean			System;
+	gboolean			Protected;
+	gboolean			ModifiedEmpty;
+	GSM_DateTime			Modified;
+	size_t				Used;
+} N6510_FileEntry;
+
 typedef struct {
 	int				LastCalendarYear;
 	int				LastCalendarPos;
@@ -40,12 +69,29 @@ typedef struct {
 
 	unsigned char			RingtoneID;	/* When set with preview */
 
-	GSM_File			*FilesCache; //[GSM_PHONE_MAXSMSINFOLDER];
+	/**
+	 * Filesystem traversal stack, used entries are at the end of
+	 * the array.
+	 */
+	N6510_FileEntry			*FilesCache;
 	int				FilesLocationsUsed;
 	int				FilesLocationsAvail;
 	int				FileToken;
 	int				ParentID;
 	int				FileCheckSum;
+	/**
+	 * Checksum of transferred file data, updated with every part.
+	 */
+	int				FileCRC;
+	int				FileCRCHistory;
+	/**
+	 * Size of file parts requested from phone, it starts again for
+	 * every file and grows while phone sends all requested data. Limit
+	 * is lowered only when phone rejects request.
+	 */
+	int				FilePartSize;
+	int				FilePartMax;
+	int				FileSize;
 	gboolean				FilesEnd;
 	gboolean				UseFs1;
 	GSM_Error			filesystem2error;
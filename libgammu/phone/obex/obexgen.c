@@ -46,6 +46,22 @@ GSM_Error OBEXGEN_GetModel(GSM_StateMachine *s);
  */
 #define OBEX_TIMEOUT 10
 
+/**
+ * Maximal packet size we advertise in connect, largest allowed by OBEX.
+ */
+#define OBEX_MAX_FRAME 0xFFFF
+
+/**
+ * Packet size used for phones which can not handle bigger packets and
+ * until connection has been negotiated.
+ */
+#define OBEX_SMALL_FRAME 0x0400
+
+/**
+ * Space reserved in request buffers for headers sent along with body.
+ */
+#define OBEX_HEADERS_SIZE 1000
+
 /**
  * Handles various error codes in OBEX protocol.
  */
@@ -127,6 +143,11 @@ static GSM_Error OBEXGEN_ReplyConnect(GSM_Protocol_Message *msg, GSM_StateMachin
 		/* Bytes 2,3 - maximal size of packet */
 		if (msg->Length >= 4) {
 			s->Phone.Data.Priv.OBEXGEN.FrameSize = msg->Buffer[2]*256 + msg->Buffer[3];
+			/* We never send more than we have advertised */
+			if (GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_OBEX_SMALL_FRAME) &&
+					s->Phone.Data.Priv.OBEXGEN.FrameSize > OBEX_SMALL_FRAME) {
+				s->Phone.Data.Priv.OBEXGEN.FrameSize = OBEX_SMALL_FRAME;
+			}
 			smprintf(s,"Maximal size of frame is %i 0x%x\n",s->Phone.Data.Priv.OBEXGEN.FrameSize,s->Phone.Data.Priv.OBEXGEN.FrameSize);
 		}
 		/* Remaining bytes - optional headers */
@@ -187,7 +208,13 @@ GSM_Error OBEXGEN_Connect(GSM_StateMachine *s, OBEX_Service service)
 	unsigned char 	req[200] = {
 		0x10,			/* Version 1.0 			*/
 		0x00,			/* no flags 			*/
-		0x04,0x00};		/* max size of packet (changed bellow for m-obex) */
+		(OBEX_MAX_FRAME >> 8) & 0xff,	/* max size of packet (changed bellow for m-obex) */
+		OBEX_MAX_FRAME & 0xff};
+
+	if (GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_OBEX_SMALL_FRAME)) {
+		req[2] = (OBEX_SMALL_FRAME >> 8) & 0xff;
+		req[3] = OBEX_SMALL_FRAME & 0xff;
+	}
 
 	/* Are we requsted for initial service? */
 	if (service == 0) {
@@ -235,8 +262,9 @@ GSM_Error OBEXGEN_Connect(GSM_StateMachine *s, OBEX_Service service)
 		OBEXAddBlock(req, &Current, 0x46, req2, 16);
 		break;
 	case OBEX_m_OBEX:
-		/* Bigger frame size for m-OBEX */
+		/* Fixed frame size for m-OBEX */
 		req[2] = 0x20;
+		req[3] = 0x00;
 		/* IrMC Service UUID */
 		req2[0] = 'M'; req2[1] = 'O'; req2[2] = 'B';
 		req2[3] = 'E'; req2[4] = 'X';
@@ -274,17 +302,23 @@ GSM_Error OBEXGEN_InitialiseVars(GSM_StateMachine *s)
 
 	Priv->Service = 0;
 	Priv->InitialService = 0;
+	Priv->FrameSize = OBEX_SMALL_FRAME;
+	Priv->FileBufferSize = 0;
+	Priv->SRM = FALSE;
+	Priv->SRMWait = FALSE;
 	Priv->PbLUID = NULL;
 	Priv->PbLUIDCount = 0;
 	Priv->PbIndex = NULL;
 	Priv->PbIndexCount = 0;
 	Priv->PbData = NULL;
+	Priv->PbDataLength = 0;
 	Priv->PbCount = -1;
 	Priv->CalLUID = NULL;
 	Priv->CalLUIDCount = 0;
 	Priv->CalIndex = NULL;
 	Priv->CalIndexCount = 0;
 	Priv->CalData = NULL;
+	Priv->CalDataLength = 0;
 	Priv->TodoLUID = NULL;
 	Priv->TodoLUIDCount = 0;
 	Priv->TodoIndex = NULL;
@@ -304,6 +338,7 @@ GSM_Error OBEXGEN_InitialiseVars(GSM_StateMachine *s)
 	Priv->NoteIndex = NULL;
 	Priv->NoteIndexCount = 0;
 	Priv->NoteData = NULL;
+	Priv->NoteDataLength = 0;
 	Priv->NoteCount = -1;
 	Priv->NoteOffsets = NULL;
 	Priv->m_obex_appdata = NULL;
@@ -641,6 +676,34 @@ static GSM_Error OBEXGEN_ReplyAddFilePart(GSM_Protocol_Message *msg, GSM_StateMa
 	switch (msg->Type) {
 	case 0x90:
 		smprintf(s,"Last part of file added OK\n");
+		Priv->SRMWait = FALSE;
+		while (Pos + 1 < msg->Length) {
+			switch (msg->Buffer[Pos]) {
+			case 0x97:
+				/* Single Response Mode */
+				Priv->SRM = (msg->Buffer[Pos+1] == 0x01);
+				smprintf(s, "Single Response Mode: %s\n", Priv->SRM ? "enabled" : "disabled");
+				Pos += 2;
+				break;
+			case 0x98:
+				/* Single Response Mode Parameters, 0x01 means wait */
+				Priv->SRMWait = (msg->Buffer[Pos+1] == 0x01);
+				Pos += 2;
+				break;
+			default:
+				/* Size of other headers is given by their type */
+				if ((msg->Buffer[Pos] & 0xc0) == 0x80) {
+					Pos += 2;
+				} else if ((msg->Buffer[Pos] & 0xc0) == 0xc0) {
+					Pos += 5;
+				} else if (Pos + 2 < msg->Length && msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2] >= 3) {
+					Pos += msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2];
+				} else {
+					Pos = msg->Length;
+				}
+				break;
+			}
+		}
 		return ERR_NONE;
 	case 0xA0:
 		smprintf(s,"Part of file added OK\n");
@@ -752,25 +815,33 @@ GSM_Error OBEXGEN_PrivAddFilePart(GSM_StateMachine *s, GSM_File *File, int *Pos,
 	GSM_Error		error;
 	size_t			j;
 	int		Current = 0;
-	unsigned char 		req[2000];
+	unsigned char 		*req;
 	unsigned char		hard_delete_header[2] = {'\x12', '\x0'};
 	GSM_Phone_OBEXGENData	*Priv = &s->Phone.Data.Priv.OBEXGEN;
 
 	s->Phone.Data.File = File;
 
+	/* Body is limited by frame size, headers by OBEX_HEADERS_SIZE */
+	req = (unsigned char *)malloc(Priv->FrameSize + OBEX_HEADERS_SIZE);
+	if (req == NULL) {
+		return ERR_MOREMEMORY;
+	}
+
 	if (Priv->Service == OBEX_BrowsingFolders || Priv->Service == OBEX_m_OBEX) {
 		OBEXGEN_AddConnectionID(s, req, &Current);
 	}
 
 	/* Are we sending first request or continuation? */
 	if (*Pos == 0) {
+		Priv->SRM = FALSE;
+		Priv->SRMWait = FALSE;
 		if (!strcmp(DecodeUnicodeString(File->ID_FullName),"")) {
 			error = OBEXGEN_Connect(s,OBEX_None);
-			if (error != ERR_NONE) return error;
+			if (error != ERR_NONE) goto fail;
 		} else {
 			if (Priv->Service == OBEX_BrowsingFolders) {
 				error = OBEXGEN_ChangeToFilePath(s, File->ID_FullName, FALSE, NULL);
-				if (error != ERR_NONE) return error;
+				if (error != ERR_NONE) goto fail;
 			}
 		}
 
@@ -790,9 +861,9 @@ GSM_Error OBEXGEN_PrivAddFilePart(GSM_StateMachine *s, GSM_File *File, int *Pos,
 		if (Priv->Service == OBEX_m_OBEX && File->Buffer == NULL) {
 			error = GSM_WaitFor (s, req, Current, 0x82, OBEX_TIMEOUT * 10, ID_AddFile);
 			if (error == ERR_NONE) {
-				return ERR_EMPTY;
+				error = ERR_EMPTY;
 			}
-			return error;
+			goto fail;
 		}
 
 		/* File size block */
@@ -806,10 +877,24 @@ GSM_Error OBEXGEN_PrivAddFilePart(GSM_StateMachine *s, GSM_File *File, int *Pos,
 		if (HardDelete) {
 			OBEXAddBlock(req, &Current, 0x4c, hard_delete_header, 2);
 		}
+
+		/*
+		 * Ask for Single Response Mode, phone will then not answer
+		 * following parts until the last one.
+		 */
+		if (Priv->Service == OBEX_BrowsingFolders &&
+				!GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_OBEX_NO_SRM)) {
+			req[Current++] = 0x97;
+			req[Current++] = 0x01;
+		}
 	}
 
-	j = Priv->FrameSize - Current - 20;
-	if (j > 1000) j = 1000;
+	/* Fill whole packet, leaving space for packet and block headers */
+	if (Priv->FrameSize > Current + 20 + 0x100) {
+		j = Priv->FrameSize - Current - 20;
+	} else {
+		j = 0x100;
+	}
 
 	if (File->Used - *Pos < j) {
 		j = File->Used - *Pos;
@@ -818,15 +903,31 @@ GSM_Error OBEXGEN_PrivAddFilePart(GSM_StateMachine *s, GSM_File *File, int *Pos,
 		smprintf(s, "Adding last file part %i %ld\n", *Pos, (long)j);
 		*Pos = *Pos + j;
 		error = GSM_WaitFor (s, req, Current, 0x82, OBEX_TIMEOUT * 10, ID_AddFile);
-		if (error != ERR_NONE) return error;
-		return ERR_EMPTY;
+		if (error == ERR_NONE) {
+			error = ERR_EMPTY;
+		}
 	} else {
 		/* File body block */
 		OBEXAddBlock(req, &Current, 0x48, File->Buffer+(*Pos), j);
 		smprintf(s, "Adding file part %i %ld\n", *Pos, (long)j);
 		*Pos = *Pos + j;
-		error=GSM_WaitFor (s, req, Current, 0x02, OBEX_TIMEOUT * 10, ID_AddFile);
+		if (Priv->SRM && !Priv->SRMWait) {
+			/* Phone does not answer parts in Single Response Mode */
+			error = GSM_WaitFor (s, req, Current, 0x02, OBEX_TIMEOUT * 10, ID_None);
+			if (error != ERR_NONE) goto fail;
+
+			/* Pick up error or wait request sent by phone meanwhile */
+			s->Phone.Data.RequestID = ID_AddFile;
+			s->Phone.Data.DispatchError = ERR_NONE;
+			GSM_ReadDevice(s, FALSE);
+			error = s->Phone.Data.DispatchError;
+			s->Phone.Data.RequestID = ID_None;
+		} else {
+			error=GSM_WaitFor (s, req, Current, 0x02, OBEX_TIMEOUT * 10, ID_AddFile);
+		}
 	}
+fail:
+	free(req);
 	return error;
 }
 
@@ -875,7 +976,10 @@ GSM_Error OBEXGEN_SendFilePart(GSM_StateMachine *s, GSM_File *File, int *Pos, in
  */
 static GSM_Error OBEXGEN_ReplyGetFilePart(GSM_Protocol_Message *msg, GSM_StateMachine *s)
 {
-	size_t old,Pos=0,len2,pos2;
+	size_t old,Pos=0,len2,pos2,size;
+	gboolean		body = FALSE;
+	unsigned char		*buffer;
+	GSM_File		*File = s->Phone.Data.File;
 	GSM_Phone_OBEXGENData	*Priv = &s->Phone.Data.Priv.OBEXGEN;
 
 	/* Non standard Sharp GX reply */
@@ -901,13 +1005,39 @@ static GSM_Error OBEXGEN_ReplyGetFilePart(GSM_Protocol_Message *msg, GSM_StateMa
 			case 0x48:
 			case 0x49:
 				smprintf(s,"File part received\n");
-				old = s->Phone.Data.File->Used;
-				s->Phone.Data.File->Used += msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2]-3;
+				old = File->Used;
+				File->Used += msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2]-3;
 				smprintf(s,"Length of file part: %i\n",
 						msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2]-3);
-				s->Phone.Data.File->Buffer = (unsigned char *)realloc(s->Phone.Data.File->Buffer,s->Phone.Data.File->Used);
-				memcpy(s->Phone.Data.File->Buffer+old,msg->Buffer+Pos+3,s->Phone.Data.File->Used-old);
-				return ERR_NONE;
+				/* Grow buffer geometrically to avoid realloc on every part */
+				if (File->Used > Priv->FileBufferSize) {
+					size = Priv->FileBufferSize * 2;
+					if (size < File->Used) {
+						size = File->Used;
+					}
+					buffer = (unsigned char *)realloc(File->Buffer, size);
+					if (buffer == NULL) {
+						File->Used = old;
+						return ERR_MOREMEMORY;
+					}
+					File->Buffer = buffer;
+					Priv->FileBufferSize = size;
+				}
+				memcpy(File->Buffer+old,msg->Buffer+Pos+3,File->Used-old);
+				/* Continue parsing, SRM header might follow body */
+				Pos += File->Used - old + 3;
+				body = TRUE;
+				break;
+			case 0x97:
+				/* Single Response Mode */
+				Priv->SRM = (msg->Buffer[Pos+1] == 0x01);
+				smprintf(s, "Single Response Mode: %s\n", Priv->SRM ? "enabled" : "disabled");
+				Pos += 2;
+				break;
+			case 0x98:
+				/* Single Response Mode Parameters, we don't use them */
+				Pos += 2;
+				break;
 			case 0xc3:
 				/* Length */
 				/**
@@ -942,10 +1072,23 @@ static GSM_Error OBEXGEN_ReplyGetFilePart(GSM_Protocol_Message *msg, GSM_StateMa
 				Pos += len2;
 				break;
 			default:
-				Pos+=msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2];
+				len2 = msg->Buffer[Pos+1]*256+msg->Buffer[Pos+2];
+				if (len2 < 3) {
+					smprintf(s, "Broken OBEX header: 0x%02X, skipping rest\n", msg->Buffer[Pos]);
+					Pos = msg->Length;
+					break;
+				}
+				Pos += len2;
 				break;
 			}
 		}
+		/* Phone sends following parts on its own, keep waiting for them */
+		if (msg->Type == 0x90 && Priv->SRM) {
+			return ERR_NEEDANOTHERANSWER;
+		}
+		if (body) {
+			return ERR_NONE;
+		}
 		return ERR_UNKNOWNRESPONSE;
 	}
 	return ERR_UNKNOWNRESPONSE;
@@ -956,6 +1099,7 @@ static GSM_Error OBEXGEN_PrivGetFilePart(GSM_StateMachine *s, GSM_File *File, gb
 	int 		Current = 0;
 	GSM_Error		error;
 	unsigned char 		req[2000], req2[200];
+	unsigned char		*buffer;
 	int			retries;
 	GSM_Phone_OBEXGENData	*Priv = &s->Phone.Data.Priv.OBEXGEN;
 
@@ -1022,12 +1166,25 @@ static GSM_Error OBEXGEN_PrivGetFilePart(GSM_StateMachine *s, GSM_File *File, gb
 	}
 
 	Priv->FileLastPart = FALSE;
+	Priv->FileBufferSize = File->Used;
+	Priv->SRM = FALSE;
 
 	/* Include m-obex application data */
 	if (Priv->Service == OBEX_m_OBEX && Priv->m_obex_appdata != NULL && Priv->m_obex_appdata_len != 0) {
 		OBEXAddBlock(req, &Current, 0x4C, Priv->m_obex_appdata, Priv->m_obex_appdata_len);
 	}
 
+	/*
+	 * Ask for Single Response Mode, phone will then send all parts
+	 * without waiting for our requests. Phones not knowing it just
+	 * ignore the header.
+	 */
+	if (Priv->Service == OBEX_BrowsingFolders &&
+			!GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_OBEX_NO_SRM)) {
+		req[Current++] = 0x97;
+		req[Current++] = 0x01;
+	}
+
 	smprintf(s, "Getting first file part\n");
 	retries = 0;
 	while (retries < 5) {
@@ -1041,6 +1198,7 @@ static GSM_Error OBEXGEN_PrivGetFilePart(GSM_StateMachine *s, GSM_File *File, gb
 	}
 	if (error != ERR_NONE) return error;
 
+	/* In Single Response Mode whole file was received by now */
 	while (!Priv->FileLastPart) {
 		Current = 0;
 		if (Priv->Service == OBEX_BrowsingFolders || Priv->Service == OBEX_m_OBEX) {
@@ -1064,6 +1222,15 @@ static GSM_Error OBEXGEN_PrivGetFilePart(GSM_StateMachine *s, GSM_File *File, gb
 		}
 		if (error != ERR_NONE) return error;
 	}
+
+	/* Drop unused space from geometric growth */
+	if (File->Used > 0 && File->Used < Priv->FileBufferSize) {
+		buffer = (unsigned char *)realloc(File->Buffer, File->Used);
+		if (buffer != NULL) {
+			File->Buffer = buffer;
+			Priv->FileBufferSize = File->Used;
+		}
+	}
 	return ERR_EMPTY;
 }
 
@@ -1636,7 +1803,7 @@ int OBEXGEN_GetFirstFreeLocation(int **IndexStorage, int *IndexCount) {
 GSM_Error OBEXGEN_InitLUID(GSM_StateMachine *s, const char *Name,
 		const gboolean Recalculate,
 		const char *Header,
-		char **Data, int **Offsets, int *Count,
+		char **Data, size_t *DataLength, int **Offsets, int *Count,
 		char ***LUIDStorage, int *LUIDCount,
 		int **IndexStorage, int *IndexCount)
 {
@@ -1680,6 +1847,7 @@ GSM_Error OBEXGEN_InitLUID(GSM_StateMachine *s, const char *Name,
 	*IndexCount = 0;
 	*IndexStorage = NULL;
 	len = strlen(*Data);
+	*DataLength = len;
 	hlen = strlen(Header);
 
 	while (1) {
@@ -1807,7 +1975,7 @@ GSM_Error OBEXGEN_InitPbLUID(GSM_StateMachine *s)
 	if (Priv->PbData != NULL) return ERR_NONE;
 
 	return OBEXGEN_InitLUID(s, "telecom/pb.vcf", FALSE, "BEGIN:VCARD",
-			&(Priv->PbData), &(Priv->PbOffsets), &(Priv->PbCount),
+			&(Priv->PbData), &(Priv->PbDataLength), &(Priv->PbOffsets), &(Priv->PbCount),
 			&(Priv->PbLUID), &(Priv->PbLUIDCount),
 			&(Priv->PbIndex), &(Priv->PbIndexCount));
 }
@@ -1909,7 +2077,9 @@ GSM_Error OBEXGEN_GetMemoryFull(GSM_StateMachine *s, GSM_MemoryEntry *Entry)
 	if (Entry->Location > Priv->PbCount) return ERR_EMPTY; /* Maybe invalid location? */
 
 	/* Decode vCard */
-	error = GSM_DecodeVCARD(&(s->di), Priv->PbData + Priv->PbOffsets[Entry->Location], &pos, Entry, SonyEricsson_VCard21_Phone);
+	error = GSM_DecodeVCARDLength(&(s->di), Priv->PbData + Priv->PbOffsets[Entry->Location],
+			Priv->PbDataLength - Priv->PbOffsets[Entry->Location],
+			&pos, Entry, SonyEricsson_VCard21_Phone);
 	if (error != ERR_NONE) return error;
 
 	return ERR_NONE;
@@ -2251,12 +2421,12 @@ GSM_Error OBEXGEN_InitCalLUID(GSM_StateMachine *s)
 	if (Priv->CalData != NULL) return ERR_NONE;
 
 	error = OBEXGEN_InitLUID(s, "telecom/cal.vcs", FALSE, "BEGIN:VEVENT",
-			&(Priv->CalData), &(Priv->CalOffsets), &(Priv->CalCount),
+			&(Priv->CalData), &(Priv->CalDataLength), &(Priv->CalOffsets), &(Priv->CalCount),
 			&(Priv->CalLUID), &(Priv->CalLUIDCount),
 			&(Priv->CalIndex), &(Priv->CalIndexCount));
 	if (error != ERR_NONE) return error;
 	return OBEXGEN_InitLUID(s, "telecom/cal.vcs", TRUE, "BEGIN:VTODO",
-			&(Priv->CalData), &(Priv->TodoOffsets), &(Priv->TodoCount),
+			&(Priv->CalData), &(Priv->CalDataLength), &(Priv->TodoOffsets), &(Priv->TodoCount),
 			&(Priv->TodoLUID), &(Priv->TodoLUIDCount),
 			&(Priv->TodoIndex), &(Priv->TodoIndexCount));
 }
@@ -2388,7 +2558,9 @@ GSM_Error OBEXGEN_GetCalendarFull(GSM_StateMachine *s, GSM_CalendarEntry *Entry)
 	if (Entry->Location > Priv->CalCount) return ERR_EMPTY; /* Maybe invalid location? */
 
 	/* Decode vCalendar */
-	error = GSM_DecodeVCALENDAR_VTODO(&(s->di), Priv->CalData + Priv->CalOffsets[Entry->Location], &pos, Entry, &ToDo, SonyEricsson_VCalendar, SonyEricsson_VToDo);
+	error = GSM_DecodeVCALENDAR_VTODOLength(&(s->di), Priv->CalData + Priv->CalOffsets[Entry->Location],
+			Priv->CalDataLength - Priv->CalOffsets[Entry->Location],
+			&pos, Entry, &ToDo, SonyEricsson_VCalendar, SonyEricsson_VToDo);
 	if (error != ERR_NONE) return error;
 
 	return ERR_NONE;
@@ -2807,7 +2979,9 @@ GSM_Error OBEXGEN_GetTodoFull(GSM_StateMachine *s, GSM_ToDoEntry *Entry)
 	if (Entry->Location > Priv->TodoCount) return ERR_EMPTY; /* Maybe invalid location? */
 
 	/* Decode vTodo */
-	error = GSM_DecodeVCALENDAR_VTODO(&(s->di), Priv->CalData + Priv->TodoOffsets[Entry->Location], &pos, &Cal, Entry, SonyEricsson_VCalendar, SonyEricsson_VToDo);
+	error = GSM_DecodeVCALENDAR_VTODOLength(&(s->di), Priv->CalData + Priv->TodoOffsets[Entry->Location],
+			Priv->CalDataLength - Priv->TodoOffsets[Entry->Location],
+			&pos, &Cal, Entry, SonyEricsson_VCalendar, SonyEricsson_VToDo);
 	if (error != ERR_NONE) return error;
 
 	return ERR_NONE;
@@ -3145,7 +3319,7 @@ GSM_Error OBEXGEN_InitNoteLUID(GSM_StateMachine *s)
 	if (Priv->NoteData != NULL) return ERR_NONE;
 
 	return OBEXGEN_InitLUID(s, "telecom/nt.vcf", FALSE, "BEGIN:VNOTE",
-			&(Priv->NoteData), &(Priv->NoteOffsets), &(Priv->NoteCount),
+			&(Priv->NoteData), &(Priv->NoteDataLength), &(Priv->NoteOffsets), &(Priv->NoteCount),
 			&(Priv->NoteLUID), &(Priv->NoteLUIDCount),
 			&(Priv->NoteIndex), &(Priv->NoteIndexCount));
 }
@@ -3245,7 +3419,9 @@ GSM_Error OBEXGEN_GetNoteFull(GSM_StateMachine *s, GSM_NoteEntry *Entry)
 	if (Entry->Location > Priv->NoteCount) return ERR_EMPTY; /* Maybe invalid location? */
 
 	/* Decode vNote */
-	error = GSM_DecodeVNOTE(Priv->NoteData + Priv->NoteOffsets[Entry->Location], &pos, Entry);
+	error = GSM_DecodeVNOTELength(Priv->NoteData + Priv->NoteOffsets[Entry->Location],
+			Priv->NoteDataLength - Priv->NoteOffsets[Entry->Location],
+			&pos, Entry);
 	if (error != ERR_NONE) return error;
 
 	return ERR_NONE;
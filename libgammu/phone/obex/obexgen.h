@@ -66,7 +66,25 @@ typedef struct {
 	GSM_File			Files[500];
 	gboolean				FileLastPart;
 
+	/**
+	 * Maximal packet size the phone is able to receive, as negotiated
+	 * in connect.
+	 */
 	int				FrameSize;
+	/**
+	 * Number of bytes allocated for currently received file buffer.
+	 */
+	size_t				FileBufferSize;
+	/**
+	 * Whether phone has enabled Single Response Mode for current GET
+	 * or PUT operation.
+	 */
+	gboolean			SRM;
+	/**
+	 * Whether phone has asked us to wait for its response before
+	 * sending next PUT packet in Single Response Mode.
+	 */
+	gboolean			SRMWait;
 	OBEX_Service			Service;
 	/**
 	 * Initial service used in configuration (this will be used for filesystem browsing)
@@ -109,6 +127,10 @@ typedef struct {
 	 * Complete phonebook data.
 	 */
 	char				*PbData;
+	/**
+	 * Length of complete phonebook data.
+	 */
+	size_t				PbDataLength;
 	/**
 	 * Number of read phonebook entries.
 	 */
@@ -181,6 +203,10 @@ typedef struct {
 	 * Complete calendar data.
 	 */
 	char				*CalData;
+	/**
+	 * Length of complete calendar data.
+	 */
+	size_t				CalDataLength;
 	/**
 	 * Number of read calendar entries.
 	 */
@@ -221,6 +247,10 @@ typedef struct {
 	 * Complete note data.
 	 */
 	char				*NoteData;
+	/**
+	 * Length of complete note data.
+	 */
+	size_t				NoteDataLength;
 	/**
 	 * Capability data.
 	 */
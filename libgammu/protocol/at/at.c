@@ -319,7 +319,8 @@ GSM_Protocol_Functions ATProtocol = {
 	AT_WriteMessage,
 	AT_StateMachine,
 	AT_Initialise,
-	AT_Terminate
+	AT_Terminate,
+	NONEFUNCTION
 };
 
 #endif
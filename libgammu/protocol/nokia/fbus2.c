@@ -27,14 +27,53 @@
 
 static GSM_Error FBUS2_Initialise(GSM_StateMachine *s);
 
-static GSM_Error FBUS2_WriteFrame(GSM_StateMachine 	*s,
-				  unsigned const char 	*MsgBuffer,
-				  int 			MsgLength,
-				  unsigned char 	MsgType)
+/**
+ * Calculates XOR checksums of even and odd bytes of the frame.
+ *
+ * Data are processed word by word, word has even size, so every byte
+ * keeps its parity within the word and the halves can be folded at the
+ * end.
+ */
+static void FBUS2_Checksum(const unsigned char *buffer, size_t length,
+			   unsigned char *even, unsigned char *odd)
+{
+	unsigned long		word = 0, sum = 0;
+	unsigned char		bytes[sizeof(unsigned long)];
+	size_t			i = 0, j = 0;
+
+	for (i = 0; i + sizeof(word) <= length; i += sizeof(word)) {
+		memcpy(&word, buffer + i, sizeof(word));
+		sum ^= word;
+	}
+	memcpy(bytes, &sum, sizeof(sum));
+
+	*even = 0;
+	*odd = 0;
+	for (j = 0; j < sizeof(sum); j += 2) {
+		*even ^= bytes[j];
+		*odd ^= bytes[j + 1];
+	}
+	for (; i < length; i++) {
+		if (i % 2) {
+			*odd ^= buffer[i];
+		} else {
+			*even ^= buffer[i];
+		}
+	}
+}
+
+/**
+ * Completes frame, which has MsgLength bytes of data already stored at
+ * buffer + 6. Header, padding and checksums are added in place.
+ *
+ * \return Length of the frame.
+ */
+static int FBUS2_FinishFrame(GSM_StateMachine 	*s,
+			     unsigned char 	*buffer,
+			     int 		MsgLength,
+			     unsigned char 	MsgType)
 {
-	unsigned char 		  buffer[FBUS2_MAX_TRANSMIT_LENGTH + 10]={0};
-	unsigned char 		  checksum=0;
-	int 			  i=0, length=0, sent=0;
+	int 			  length=0;
 
 	buffer[0] 	= FBUS2_FRAME_ID;
 
@@ -46,30 +85,41 @@ static GSM_Error FBUS2_WriteFrame(GSM_StateMachine 	*s,
 	buffer[3]	= MsgType;
 	buffer[4]	= MsgLength / 256;
 	buffer[5]	= MsgLength % 256;
-	memcpy(buffer + 6, MsgBuffer, MsgLength);
 	length = MsgLength + 6;
 
 	/* Odd messages require additional 0x00 byte */
 	if (MsgLength % 2) {
 		buffer[length++] = 0x00;
 	}
-	checksum = 0;
+	FBUS2_Checksum(buffer, length, &buffer[length], &buffer[length + 1]);
 
-	for (i = 0; i < length; i+=2) {
-		checksum ^= buffer[i];
-	}
-	buffer[length++] = checksum;
-	checksum = 0;
+	return length + 2;
+}
+
+/**
+ * Writes acknowledgements, which are waiting in the buffer.
+ *
+ * Acknowledgements are written while reading, so failure is also
+ * reported to the request being waited for.
+ */
+static GSM_Error FBUS2_Flush(GSM_StateMachine *s)
+{
+	GSM_Protocol_FBUS2Data	*d = &s->Protocol.Data.FBUS2;
+	int 			length=0, sent=0;
 
-	for (i = 1; i < length; i+=2) {
-		checksum ^= buffer[i];
+	if (d->AckLength == 0) {
+		return ERR_NONE;
 	}
-	buffer[length++] = checksum;
+	length = d->AckLength;
+	d->AckLength = 0;
 
 	/* Sending to phone */
-	sent = s->Device.Functions->WriteDevice(s, buffer, length);
+	sent = s->Device.Functions->WriteDevice(s, d->AckBuffer, length);
 
 	if (sent != length) {
+		smprintf_level(s, D_ERROR, "[ERROR: writing acknowledgements failed]\n");
+		s->Phone.Data.DispatchError	= ERR_DEVICEWRITEERROR;
+		s->Phone.Data.RequestID		= ID_None;
 		return ERR_DEVICEWRITEERROR;
 	}
 	return ERR_NONE;
@@ -81,15 +131,24 @@ static GSM_Error FBUS2_WriteMessage (GSM_StateMachine 	*s,
 				     int 	MsgType)
 {
 	int 			i=0, nom=0, togo=0, thislength=0; /* number of messages, ... */
-	unsigned char 		buffer[FBUS2_MAX_TRANSMIT_LENGTH + 2]={0}, seqnum=0;
+	int			length=0, sent=0;
+	unsigned char 		*buffer=NULL, *frame=NULL, seqnum=0;
 	GSM_Protocol_FBUS2Data	*d = &s->Protocol.Data.FBUS2;
-	GSM_Error 		error;
 
 	GSM_DumpMessageLevel3(s, MsgBuffer, MsgLength, MsgType);
 
 	nom  = (MsgLength + FBUS2_MAX_TRANSMIT_LENGTH - 1) / FBUS2_MAX_TRANSMIT_LENGTH;
 	togo = MsgLength;
 
+	/* All frames are written at once together with pending acks */
+	buffer = (unsigned char *)malloc(d->AckLength + nom * FBUS2_MAX_FRAME_LENGTH + 1);
+	if (buffer == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	memcpy(buffer, d->AckBuffer, d->AckLength);
+	length = d->AckLength;
+	d->AckLength = 0;
+
 	for (i = 0; i < nom; i++) {
 		seqnum = d->MsgSequenceNumber;
 
@@ -103,37 +162,66 @@ static GSM_Error FBUS2_WriteMessage (GSM_StateMachine 	*s,
 		if (togo > FBUS2_MAX_TRANSMIT_LENGTH) {
 			thislength = FBUS2_MAX_TRANSMIT_LENGTH;
 		}
-		memcpy(buffer, MsgBuffer + (MsgLength - togo), thislength);
-		buffer[thislength] = nom - i;
-		buffer[thislength + 1]	= seqnum;
+		frame = buffer + length;
+		memcpy(frame + 6, MsgBuffer + (MsgLength - togo), thislength);
+		frame[6 + thislength] = nom - i;
+		frame[7 + thislength] = seqnum;
 		togo = togo - thislength;
 
-		GSM_DumpMessageLevel2(s, buffer, thislength, MsgType);
+		GSM_DumpMessageLevel2(s, frame + 6, thislength, MsgType);
 
-		error = FBUS2_WriteFrame(s, buffer, thislength + 2, MsgType);
+		length += FBUS2_FinishFrame(s, frame, thislength + 2, MsgType);
+	}
 
-		if (error != ERR_NONE) {
-			return error;
-		}
+	if (length == 0) {
+		free(buffer);
+		return ERR_NONE;
+	}
+
+	/* Sending to phone */
+	sent = s->Device.Functions->WriteDevice(s, buffer, length);
+	free(buffer);
+
+	if (sent != length) {
+		return ERR_DEVICEWRITEERROR;
 	}
 	return ERR_NONE;
 }
 
+/**
+ * Queues acknowledgement of received frame, it is written by
+ * FBUS2_Flush or together with next message. Phones with
+ * F_FBUS2_IMMEDIATE_ACK get it written right away.
+ */
 static GSM_Error FBUS2_SendAck(GSM_StateMachine 	*s,
 			       unsigned char 		MsgType,
 			       unsigned char 		MsgSequence)
 {
-	unsigned char buffer[2]={0};
+	GSM_Protocol_FBUS2Data	*d = &s->Protocol.Data.FBUS2;
+	unsigned char		*buffer;
+	GSM_Error		error;
 
-	buffer[0] = MsgType;
-	buffer[1] = MsgSequence;
+	if (d->AckLength + FBUS2_ACK_LENGTH > (int)sizeof(d->AckBuffer)) {
+		error = FBUS2_Flush(s);
+		if (error != ERR_NONE) {
+			return error;
+		}
+	}
+	buffer = d->AckBuffer + d->AckLength;
+
+	buffer[6] = MsgType;
+	buffer[7] = MsgSequence;
 
 	smprintf_level(s, D_TEXT, "[Sending Ack of type %02x, seq %x]\n",
-			buffer[0],
-			buffer[1]);
+			buffer[6],
+			buffer[7]);
 
-	/* Sending to phone */
-	return FBUS2_WriteFrame(s, buffer, 2, FBUS2_ACK_BYTE);
+	d->AckLength += FBUS2_FinishFrame(s, buffer, 2, FBUS2_ACK_BYTE);
+
+	if (GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_FBUS2_IMMEDIATE_ACK)) {
+		return FBUS2_Flush(s);
+	}
+	return ERR_NONE;
 }
 
 static GSM_Error FBUS2_StateMachine(GSM_StateMachine *s, unsigned char rx_char)
@@ -141,6 +229,7 @@ static GSM_Error FBUS2_StateMachine(GSM_StateMachine *s, unsigned char rx_char)
 	GSM_Protocol_FBUS2Data 	*d = &s->Protocol.Data.FBUS2;
 	unsigned char 		frm_num, seq_num;
 	gboolean			correct = FALSE;
+	GSM_Error		error;
 
 	/* XOR the byte with the earlier checksum */
 	d->Msg.CheckSum[d->Msg.Count & 1] ^= rx_char;
@@ -217,15 +306,23 @@ static GSM_Error FBUS2_StateMachine(GSM_StateMachine *s, unsigned char rx_char)
 		/* do not ack debug trace, as this could generate a
 		 * (feedback loop) flood of which even Noah would be scared.
 		 */
+		d->MsgRXState = RX_Sync;
 		if (d->Msg.Type != 0) {
-			FBUS2_SendAck(s,d->Msg.Type,((unsigned char)(seq_num & 0x0f)));
+			error = FBUS2_SendAck(s,d->Msg.Type,((unsigned char)(seq_num & 0x0f)));
+			if (error != ERR_NONE) {
+				return error;
+			}
 		}
 
 		if (d->FramesToGo == 0) {
+			/* Phone should get acks before we reply */
+			error = FBUS2_Flush(s);
+			if (error != ERR_NONE) {
+				return error;
+			}
 			s->Phone.Data.RequestMsg	= &d->MultiMsg;
 			s->Phone.Data.DispatchError	= s->Phone.Functions->DispatchMessage(s);
 		}
-		d->MsgRXState = RX_Sync;
 		return ERR_NONE;
 	}
 	if (d->MsgRXState == RX_GetLength2) {
@@ -407,6 +504,7 @@ static GSM_Error FBUS2_Initialise(GSM_StateMachine *s)
 
 	d->MsgSequenceNumber	= 0;
 	d->FramesToGo		= 0;
+	d->AckLength		= 0;
 	d->MsgRXState		= RX_Sync;
 
 	error = Device->DeviceSetParity(s, FALSE);
@@ -505,7 +603,8 @@ GSM_Protocol_Functions FBUS2Protocol = {
 	FBUS2_WriteMessage,
 	FBUS2_StateMachine,
 	FBUS2_Initialise,
-	FBUS2_Terminate
+	FBUS2_Terminate,
+	FBUS2_Flush
 };
 
 #endif
@@ -26,6 +26,11 @@
 #define FBUS2_ACK_BYTE	     	0x7f /* Acknowledge of the received frame */
 
 #define FBUS2_MAX_TRANSMIT_LENGTH 120
+/* Header (6), data, frame number and sequence (2), padding (1), checksums (2) */
+#define FBUS2_MAX_FRAME_LENGTH	(FBUS2_MAX_TRANSMIT_LENGTH + 11)
+#define FBUS2_ACK_LENGTH	10
+/* How many acknowledgements can wait to be written together */
+#define FBUS2_ACK_WINDOW	8
 
 typedef struct {
 	int			MsgSequenceNumber;
@@ -33,6 +38,11 @@ typedef struct {
 	int			FramesToGo;
 	GSM_Protocol_Message	MultiMsg;
 	GSM_Protocol_Message	Msg;
+	/**
+	 * Acknowledgements of received frames, which were not yet written.
+	 */
+	unsigned char		AckBuffer[FBUS2_ACK_WINDOW * FBUS2_ACK_LENGTH];
+	int			AckLength;
 } GSM_Protocol_FBUS2Data;
 
 #ifndef GSM_USED_SERIALDEVICE
@@ -237,7 +237,8 @@ GSM_Protocol_Functions MBUS2Protocol = {
 	MBUS2_WriteMessage,
 	MBUS2_StateMachine,
 	MBUS2_Initialise,
-	MBUS2_Terminate
+	MBUS2_Terminate,
+	NONEFUNCTION
 };
 
 #endif
@@ -105,7 +105,8 @@ GSM_Protocol_Functions OBEXProtocol = {
 	OBEX_WriteMessage,
 	OBEX_StateMachine,
 	OBEX_Initialise,
-	OBEX_Terminate
+	OBEX_Terminate,
+	NONEFUNCTION
 };
 
 void OBEXAddBlock(char *Buffer, int *Pos, unsigned char ID, const char *AddData, int AddLength)
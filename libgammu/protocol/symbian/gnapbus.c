@@ -150,7 +150,8 @@ GSM_Protocol_Functions GNAPBUSProtocol = {
 	GNAPBUS_WriteMessage,
 	GNAPBUS_StateMachine,
 	GNAPBUS_Initialise,
-	GNAPBUS_Terminate
+	GNAPBUS_Terminate,
+	NONEFUNCTION
 };
 
 #endif
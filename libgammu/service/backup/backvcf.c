@@ -78,7 +78,7 @@ GSM_Error LoadVCard(const char *FileName, GSM_Backup *backup)
 	if (error != ERR_NONE) return error;
 
 	while (1) {
-		error = GSM_DecodeVCARD(NULL, File.Buffer, &Pos, &Pbk, Nokia_VCard21);
+		error = GSM_DecodeVCARDLength(NULL, File.Buffer, File.Used, &Pos, &Pbk, Nokia_VCard21);
 		if (error == ERR_EMPTY) {
 			error = ERR_NONE;
 			break;
@@ -85,7 +85,7 @@ GSM_Error LoadVCalendarPrivate(const char *FileName, GSM_Backup *backup, GSM_VCa
 	if (error != ERR_NONE) return error;
 
 	while (1) {
-		error = GSM_DecodeVCALENDAR_VTODO(NULL, File.Buffer, &Pos, &Calendar, &ToDo, CalVer, ToDoVer);
+		error = GSM_DecodeVCALENDAR_VTODOLength(NULL, File.Buffer, File.Used, &Pos, &Calendar, &ToDo, CalVer, ToDoVer);
 		if (error == ERR_EMPTY) {
 			error = ERR_NONE;
 			break;
@@ -69,7 +69,7 @@ GSM_Error LoadVNT(const char *FileName, GSM_Backup *backup)
 	if (error != ERR_NONE) return error;
 
 	while (1) {
-		error = GSM_DecodeVNOTE(File.Buffer, &Pos, &Note);
+		error = GSM_DecodeVNOTELength(File.Buffer, File.Used, &Pos, &Note);
 		if (error == ERR_EMPTY) {
 			error = ERR_NONE;
 			break;
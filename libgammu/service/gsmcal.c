@@ -1670,7 +1670,7 @@ GSM_Error GSM_DecodeVCAL_RRULE(GSM_Debug_Info *di, const char *Buffer, GSM_Calen
 	return ERR_NONE;
 }
 
-GSM_Error GSM_DecodeVCALENDAR_VTODO(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_CalendarEntry *Calendar,
+GSM_Error GSM_DecodeVCALENDAR_VTODOLength(GSM_Debug_Info *di, char *Buffer, size_t Length, size_t *Pos, GSM_CalendarEntry *Calendar,
 					GSM_ToDoEntry *ToDo, GSM_VCalendarVersion CalVer, GSM_VToDoVersion ToDoVer)
 {
 	unsigned char 	Line[2000],Buff[2000];
@@ -1691,7 +1691,7 @@ GSM_Error GSM_DecodeVCALENDAR_VTODO(GSM_Debug_Info *di, char *Buffer, size_t *Po
 
 	Calendar->EntriesNum 	= 0;
 	ToDo->EntriesNum 	= 0;
-	lBuffer = strlen(Buffer);
+	lBuffer = Length;
 	trigger.Timezone = -999 * 3600;
 
 	if (CalVer == Mozilla_iCalendar && *Pos ==0) {
@@ -2019,7 +2019,15 @@ GSM_Error GSM_DecodeVCALENDAR_VTODO(GSM_Debug_Info *di, char *Buffer, size_t *Po
 	return ERR_NONE;
 }
 
-GSM_Error GSM_DecodeVNOTE(char *Buffer, size_t *Pos, GSM_NoteEntry *Note)
+GSM_Error GSM_DecodeVCALENDAR_VTODO(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_CalendarEntry *Calendar,
+					GSM_ToDoEntry *ToDo, GSM_VCalendarVersion CalVer, GSM_VToDoVersion ToDoVer)
+{
+	if (!Buffer) return ERR_EMPTY;
+
+	return GSM_DecodeVCALENDAR_VTODOLength(di, Buffer, strlen(Buffer), Pos, Calendar, ToDo, CalVer, ToDoVer);
+}
+
+GSM_Error GSM_DecodeVNOTELength(char *Buffer, size_t Length, size_t *Pos, GSM_NoteEntry *Note)
 {
 	unsigned char   Line[2000],Buff[2000];
 	int	     Level = 0;
@@ -2030,7 +2038,7 @@ GSM_Error GSM_DecodeVNOTE(char *Buffer, size_t *Pos, GSM_NoteEntry *Note)
 	Note->Text[1] = 0;
 
 	while (1) {
-		error = MyGetLine(Buffer, Pos, Line, strlen(Buffer), sizeof(Line), TRUE);
+		error = MyGetLine(Buffer, Pos, Line, Length, sizeof(Line), TRUE);
 		if (error != ERR_NONE) return error;
 		if (strlen(Line) == 0) break;
 		switch (Level) {
@@ -2055,6 +2063,11 @@ GSM_Error GSM_DecodeVNOTE(char *Buffer, size_t *Pos, GSM_NoteEntry *Note)
 	return ERR_NONE;
 }
 
+GSM_Error GSM_DecodeVNOTE(char *Buffer, size_t *Pos, GSM_NoteEntry *Note)
+{
+	return GSM_DecodeVNOTELength(Buffer, strlen(Buffer), Pos, Note);
+}
+
 GSM_Error GSM_EncodeVNTFile(char *Buffer, const size_t buff_len, size_t *Length, GSM_NoteEntry *Note)
 {
 	GSM_Error error;
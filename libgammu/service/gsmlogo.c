@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <stdint.h>
 
 #include <gammu-debug.h>
 
@@ -74,73 +75,140 @@ size_t PHONE_GetBitmapSize(GSM_Phone_Bitmap_Types Type, size_t Width, size_t Hei
 	return 0;
 }
 
-static gboolean PHONE_IsPointBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, int x, int y, int width, int height)
+/**
+ * Spreads bits of byte into least significant bits of bytes of result,
+ * most significant bit goes to the first (lowest) byte.
+ */
+static uint64_t PHONE_SpreadBits(unsigned char value)
 {
-	int i=0, pixel;
+	return ((value * 0x8040201008040201ULL) & 0x8080808080808080ULL) >> 7;
+}
 
-	if (x > width || y > height) return FALSE;
+/**
+ * Gathers given bit from all bytes of value, bit from the first
+ * (lowest) byte goes to most significant bit of result.
+ */
+static unsigned char PHONE_GatherBits(uint64_t value, int bit)
+{
+	return (((value >> bit) & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56;
+}
 
-	switch (Type) {
-	case GSM_NokiaStartupLogo:
-	case GSM_Nokia6210StartupLogo:
-	case GSM_Nokia7110StartupLogo:
-	case GSM_Nokia6510OperatorLogo:
-		i=(buffer[(y / 8 * width) + x] & (1 << (y % 8)));
-		break;
-	case GSM_NokiaOperatorLogo:
-	case GSM_Nokia7110OperatorLogo:
-	case GSM_NokiaCallerLogo:
-	case GSM_EMSVariablePicture:
-	case GSM_EMSSmallPicture:
-	case GSM_EMSMediumPicture:
-	case GSM_EMSBigPicture:
-		pixel=width*y + x;
-		i=(buffer[pixel / 8] & (1 << (7 - (pixel % 8))));
-		break;
-	case GSM_NokiaPictureImage:
-		i=(buffer[(9 * y) + (x / 8)] & (1 << (7 - (x % 8))));
-		break;
-	case GSM_AlcatelBMMIPicture:
-		break;
+/**
+ * Returns mask of first count pixels in byte.
+ */
+static unsigned char GSM_BitmapMask(size_t count)
+{
+	if (count >= 8) return 0xff;
+	return (0xff << (8 - count)) & 0xff;
+}
+
+/**
+ * Reads 8 pixels of bitmap starting at given one, first pixel is in
+ * the most significant bit.
+ */
+static unsigned char GSM_GetBitmapByte(const unsigned char *points, size_t bit)
+{
+	size_t pos = bit / 8, shift = bit % 8;
+
+	if (shift == 0) return points[pos];
+	if (pos + 1 >= (GSM_BITMAP_SIZE)) return (points[pos] << shift) & 0xff;
+	return ((points[pos] << shift) | (points[pos + 1] >> (8 - shift))) & 0xff;
+}
+
+/**
+ * Sets 8 pixels of bitmap starting at given one, pixels are only added.
+ */
+static void GSM_OrBitmapByte(unsigned char *points, size_t bit, unsigned char value)
+{
+	size_t pos = bit / 8, shift = bit % 8;
+
+	if (value == 0) return;
+	points[pos] |= value >> shift;
+	if (shift != 0 && pos + 1 < (GSM_BITMAP_SIZE)) {
+		points[pos + 1] |= (value << (8 - shift)) & 0xff;
 	}
-	if (i) return TRUE; else return FALSE;
 }
 
-static void PHONE_SetPointBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, int x, int y, int width, int height)
+/**
+ * Copies pixels between byte aligned row major bitmaps, pixels in
+ * destination are only added.
+ */
+static void PHONE_CopyRowMajor(unsigned char *dest, const unsigned char *src, size_t count)
 {
-	int pixel;
+	size_t i;
 
-	switch (Type) {
-	case GSM_NokiaStartupLogo:
-	case GSM_Nokia6210StartupLogo:
-	case GSM_Nokia7110StartupLogo:
-	case GSM_Nokia6510OperatorLogo:
-		buffer[(y / 8 * width)+x] |= 1 << (y % 8);
-		break;
-	case GSM_NokiaOperatorLogo:
-	case GSM_Nokia7110OperatorLogo:
-	case GSM_NokiaCallerLogo:
-	case GSM_EMSSmallPicture:
-	case GSM_EMSMediumPicture:
-	case GSM_EMSBigPicture:
-	case GSM_EMSVariablePicture:
-		pixel = width*y + x;
-		buffer[pixel / 8] |= 1 << (7 - (pixel % 8));
-		break;
-	case GSM_NokiaPictureImage:
-		buffer[(9 * y) + (x / 8)] |= 1 << (7 - (x % 8));
-		break;
-	case GSM_AlcatelBMMIPicture:
-		pixel = height / 8;
-		if ((height % 8) != 0) pixel++;
-		buffer[(pixel * x) + (y / 8)] |= 1 << (7 - (y % 8));
-		break;
+	for (i = 0; i < count / 8; i++) {
+		dest[i] |= src[i];
+	}
+	if (count % 8 != 0 && (src[i] & GSM_BitmapMask(count % 8)) != 0) {
+		dest[i] |= src[i] & GSM_BitmapMask(count % 8);
+	}
+}
+
+/**
+ * Decodes bitmap stored in columns of 8 pixels high bands, top pixel
+ * is in the least significant bit.
+ */
+static void PHONE_DecodeColumnMajor(const unsigned char *buffer, GSM_Bitmap *Bitmap)
+{
+	size_t width = Bitmap->BitmapWidth, height = Bitmap->BitmapHeight;
+	size_t band, x, k, n;
+	uint64_t columns;
+	int j;
+
+	for (band = 0; band * 8 < height; band++) {
+		for (x = 0; x < width; x += 8) {
+			n = (width - x < 8) ? width - x : 8;
+			columns = 0;
+			for (k = 0; k < n; k++) {
+				columns |= (uint64_t)buffer[band * width + x + k] << (8 * k);
+			}
+			if (columns == 0) continue;
+			for (j = 0; j < 8 && band * 8 + j < height; j++) {
+				GSM_OrBitmapByte(Bitmap->BitmapPoints, (band * 8 + j) * width + x,
+					PHONE_GatherBits(columns, j) & GSM_BitmapMask(n));
+			}
+		}
+	}
+}
+
+/**
+ * Encodes bitmap into columns of 8 pixels high bands.
+ *
+ * \param topmsb Whether top pixel is in the most significant bit.
+ * \param column_stride Distance of columns in buffer.
+ * \param band_stride Distance of bands in buffer.
+ */
+static void PHONE_EncodeColumnMajor(unsigned char *buffer, GSM_Bitmap *Bitmap, gboolean topmsb, size_t column_stride, size_t band_stride)
+{
+	size_t width = Bitmap->BitmapWidth, height = Bitmap->BitmapHeight;
+	size_t band, x, k, n;
+	uint64_t columns;
+	unsigned char value;
+	int j;
+
+	for (band = 0; band * 8 < height; band++) {
+		for (x = 0; x < width; x += 8) {
+			n = (width - x < 8) ? width - x : 8;
+			columns = 0;
+			for (j = 0; j < 8 && band * 8 + j < height; j++) {
+				value = GSM_GetBitmapByte(Bitmap->BitmapPoints, (band * 8 + j) * width + x) & GSM_BitmapMask(n);
+				columns |= PHONE_SpreadBits(value) << (topmsb ? 7 - j : j);
+			}
+			if (columns == 0) continue;
+			for (k = 0; k < n; k++) {
+				value = (columns >> (8 * k)) & 0xff;
+				if (value != 0) {
+					buffer[(x + k) * column_stride + band * band_stride] |= value;
+				}
+			}
+		}
 	}
 }
 
 void PHONE_DecodeBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, GSM_Bitmap *Bitmap)
 {
-	size_t width, height, x,y;
+	size_t width, height;
 
 	PHONE_GetBitmapWidthHeight(Type, &width, &height);
 	if (Type != GSM_Nokia6510OperatorLogo && Type != GSM_Nokia7110OperatorLogo && Type != GSM_EMSVariablePicture) {
@@ -179,12 +247,27 @@ void PHONE_DecodeBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, GSM_Bitmap *B
 	Bitmap->Name[1]			= 0;
 
 	GSM_ClearBitmap(Bitmap);
-	for (x=0;x<Bitmap->BitmapWidth;x++) {
-		for (y=0;y<Bitmap->BitmapHeight;y++) {
-			if (PHONE_IsPointBitmap(Type, buffer, x, y, Bitmap->BitmapWidth, Bitmap->BitmapHeight)) {
-				GSM_SetPointBitmap(Bitmap,x,y);
-			}
-		}
+	switch (Type) {
+	case GSM_NokiaStartupLogo:
+	case GSM_Nokia6210StartupLogo:
+	case GSM_Nokia7110StartupLogo:
+	case GSM_Nokia6510OperatorLogo:
+		PHONE_DecodeColumnMajor((unsigned char *)buffer, Bitmap);
+		break;
+	case GSM_NokiaOperatorLogo:
+	case GSM_Nokia7110OperatorLogo:
+	case GSM_NokiaCallerLogo:
+	case GSM_EMSVariablePicture:
+	case GSM_EMSSmallPicture:
+	case GSM_EMSMediumPicture:
+	case GSM_EMSBigPicture:
+	/* Rows of 9 bytes, same as packed rows for 72 pixels width */
+	case GSM_NokiaPictureImage:
+		PHONE_CopyRowMajor(Bitmap->BitmapPoints, (unsigned char *)buffer,
+			Bitmap->BitmapWidth * Bitmap->BitmapHeight);
+		break;
+	case GSM_AlcatelBMMIPicture:
+		break;
 	}
 }
 
@@ -195,7 +278,7 @@ void PHONE_ClearBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, size_t width,
 
 void PHONE_EncodeBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, GSM_Bitmap *Bitmap)
 {
-	size_t		width, height, x, y;
+	size_t		width, height;
 	GSM_Bitmap	dest;
 
 	PHONE_GetBitmapWidthHeight(Type, &width, &height);
@@ -206,10 +289,27 @@ void PHONE_EncodeBitmap(GSM_Phone_Bitmap_Types Type, char *buffer, GSM_Bitmap *B
 	GSM_ResizeBitmap(&dest, Bitmap, width, height);
 	PHONE_ClearBitmap(Type, buffer, width, height);
 
-	for (x=0;x<width;x++) {
-		for (y=0;y<height;y++) {
-			if (GSM_IsPointBitmap(&dest,x,y)) PHONE_SetPointBitmap(Type, buffer, x, y, width, height);
-		}
+	switch (Type) {
+	case GSM_NokiaStartupLogo:
+	case GSM_Nokia6210StartupLogo:
+	case GSM_Nokia7110StartupLogo:
+	case GSM_Nokia6510OperatorLogo:
+		PHONE_EncodeColumnMajor((unsigned char *)buffer, &dest, FALSE, 1, width);
+		break;
+	case GSM_NokiaOperatorLogo:
+	case GSM_Nokia7110OperatorLogo:
+	case GSM_NokiaCallerLogo:
+	case GSM_EMSSmallPicture:
+	case GSM_EMSMediumPicture:
+	case GSM_EMSBigPicture:
+	case GSM_EMSVariablePicture:
+	/* Rows of 9 bytes, same as packed rows for 72 pixels width */
+	case GSM_NokiaPictureImage:
+		PHONE_CopyRowMajor((unsigned char *)buffer, dest.BitmapPoints, width * height);
+		break;
+	case GSM_AlcatelBMMIPicture:
+		PHONE_EncodeColumnMajor((unsigned char *)buffer, &dest, TRUE, (height + 7) / 8, 1);
+		break;
 	}
 }
 
@@ -271,16 +371,13 @@ void GSM_PrintBitmap(FILE *file, GSM_Bitmap *bitmap)
 
 void GSM_ReverseBitmap(GSM_Bitmap *Bitmap)
 {
-	size_t x, y;
+	size_t i, count = Bitmap->BitmapWidth * Bitmap->BitmapHeight;
 
-	for (x=0;x<Bitmap->BitmapWidth;x++) {
-		for (y=0;y<Bitmap->BitmapHeight;y++) {
-			if (GSM_IsPointBitmap(Bitmap,x,y)) {
-				GSM_ClearPointBitmap(Bitmap, x, y);
-			} else {
-				GSM_SetPointBitmap(Bitmap, x, y);
-			}
-		}
+	for (i = 0; i < count / 8; i++) {
+		Bitmap->BitmapPoints[i] ^= 0xff;
+	}
+	if (count % 8 != 0) {
+		Bitmap->BitmapPoints[i] ^= GSM_BitmapMask(count % 8);
 	}
 }
 
@@ -309,10 +406,11 @@ void GSM_ResizeBitmap(GSM_Bitmap *dest, GSM_Bitmap *src, size_t width, size_t he
 	dest->BitmapHeight	= height;
 	dest->BitmapWidth	= width;
 	GSM_ClearBitmap(dest);
-	for (x=startx;x<endx;x++) {
-		for (y=starty;y<endy;y++) {
-			if (GSM_IsPointBitmap(src,x,y))
-				GSM_SetPointBitmap(dest,setx+x-startx,sety+y-starty);
+	/* Copy row by row, 8 pixels at once */
+	for (y=starty;y<endy;y++) {
+		for (x=startx;x<endx;x+=8) {
+			GSM_OrBitmapByte(dest->BitmapPoints, (sety+y-starty)*width + setx+x-startx,
+				GSM_GetBitmapByte(src->BitmapPoints, y*src->BitmapWidth + x) & GSM_BitmapMask(endx - x));
 		}
 	}
 }
@@ -704,8 +802,8 @@ GSM_Error GSM_SaveBitmapFile(char *FileName, GSM_MultiBitmap *bitmap)
 GSM_Error BMP2Bitmap(unsigned char *buffer, FILE *file,GSM_Bitmap *bitmap)
 {
 	gboolean		first_white,isfile=FALSE;
-	unsigned char 	buff[60];
-	size_t		w,h,x,i,buffpos=0;
+	unsigned char 	buff[60], *row;
+	size_t		w,h,x,buffpos=0,rowbytes;
 	ssize_t		y, pos;
 	size_t		readbytes;
 #ifdef DEBUG
@@ -791,58 +889,38 @@ GSM_Error BMP2Bitmap(unsigned char *buffer, FILE *file,GSM_Bitmap *bitmap)
 		);
 #endif
 
-	pos=7;
+	/* each line is written in multiply of 4 bytes */
+	rowbytes = ((w + 31) / 32) * 4;
+	row = (unsigned char *)malloc(rowbytes + 1);
+	if (row == NULL) return ERR_MOREMEMORY;
+
 	/* lines are written from the last to the first */
 	for (y=h-1;y>=0;y--) {
-		i=1;
-		for (x=0;x<w;x++) {
-			/* new byte ! */
-			if (pos==7) {
-				if (isfile) {
-					readbytes = fread(buff, 1, 1, file);
-					if (readbytes != 1) return ERR_FILENOTSUPPORTED;
-				} else {
-					memcpy (buff,buffer+buffpos,1);
-					buffpos++;
-				}
-#ifdef DEBUG
-				sizeimage++;
-#endif
-				i++;
-				/* each line is written in multiply of 4 bytes */
-				if(i==5) i=1;
-			}
-			/* we have top left corner ! */
-			if (x<=bitmap->BitmapWidth && (size_t)y<=bitmap->BitmapHeight) {
-				if (first_white) {
-					if ((buff[0]&(1<<pos))<=0) GSM_SetPointBitmap(bitmap,x,y);
-				} else {
-					if ((buff[0]&(1<<pos))>0) GSM_SetPointBitmap(bitmap,x,y);
-				}
+		/* read whole line at once */
+		if (isfile) {
+			readbytes = fread(row, 1, rowbytes, file);
+			if (readbytes != rowbytes) {
+				free(row);
+				return ERR_FILENOTSUPPORTED;
 			}
-			pos--;
-			/* going to new byte */
-			if (pos<0) pos=7;
+		} else {
+			memcpy(row, buffer + buffpos, rowbytes);
+			buffpos += rowbytes;
 		}
-		/* going to new byte */
-		pos=7;
-		if (i!=1) {
-			/* each line is written in multiply of 4 bytes */
-			while (i!=5) {
-				if (isfile) {
-					readbytes = fread(buff, 1, 1, file);
-					if (readbytes != 1) return ERR_FILENOTSUPPORTED;
-				} else {
-					memcpy (buff,buffer+buffpos,1);
-					buffpos++;
-				}
 #ifdef DEBUG
-				sizeimage++;
+		sizeimage += rowbytes;
 #endif
-				i++;
+		/* we have top left corner ! */
+		if ((size_t)y > bitmap->BitmapHeight) continue;
+		for (x=0;x<w && x<=bitmap->BitmapWidth;x++) {
+			if (first_white) {
+				if ((row[x / 8] & (1 << (7 - x % 8))) == 0) GSM_SetPointBitmap(bitmap,x,y);
+			} else {
+				if ((row[x / 8] & (1 << (7 - x % 8))) != 0) GSM_SetPointBitmap(bitmap,x,y);
 			}
 		}
 	}
+	free(row);
 #ifdef DEBUG
 	dbgprintf(NULL, "Data size in BMP file: %i\n",sizeimage);
 #endif
@@ -1,6 +1,7 @@
 /* (c) 2001-2003 by Marcin Wiacek */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include <gammu-info.h>
 
@@ -580,8 +581,8 @@ const GSM_CodeName GSM_Networks[] = {
 	{"262 60", ""},
 	{"262 76", ""},
 	{"262 77", "E-Plus"},
-	{"262 901", "Debitel"},
 	{"262 92", "Nash Technologies"},
+	{"262 901", "Debitel"},
 	{"266 01", "GibTel"},
 	{"266 06", "CTS Mobile"},
 	{"268 01", "Vodafone"},
@@ -705,6 +706,7 @@ const GSM_CodeName GSM_Networks[] = {
 	{"310 034", "Airpeak"},
 	{"310 040", "Concho"},
 	{"310 046", "SIMMETRY"},
+	{"310 59", "Cellular One"},
 	{"310 060", ""},
 	{"310 070", ""},
 	{"310 080", "Corr"},
@@ -757,7 +759,6 @@ const GSM_CodeName GSM_Networks[] = {
 	{"310 570", "Cellular One"},
 	{"310 580", "T-Mobile"},
 	{"310 590", "Alltel"},
-	{"310 59", "Cellular One"},
 	{"310 610", "Epic Touch"},
 	{"310 620", "Coleman County Telecom"},
 	{"310 630", "AmeriLink PCS"},
@@ -829,13 +830,13 @@ const GSM_CodeName GSM_Networks[] = {
 	{"334 03", "movistar"},
 	{"334 04", "Iusacell / Unefon"},
 	{"334 050", "Iusacell"},
+	{"338 05", "Digicel"},
 	{"338 020", "LIME"},
 	{"338 050", "Digicel"},
 	{"338 050", "Digicel"},
 	{"338 050", "Digicel"},
 	{"338 050", "Digicel"},
 	{"338 050", "Digicel Bermuda"},
-	{"338 05", "Digicel"},
 	{"338 070", "Claro"},
 	{"338 180", "LIME"},
 	{"340 01", "Orange"},
@@ -970,6 +971,11 @@ const GSM_CodeName GSM_Networks[] = {
 	{"404 93", "AirTel"},
 	{"404 96", "AirTel"},
 	{"405 01", "Reliance"},
+	{"405 03", "Reliance"},
+	{"405 04", "Reliance"},
+	{"405 05", "Reliance"},
+	{"405 10", "Reliance"},
+	{"405 13", "Reliance"},
 	{"405 025", "TATA DOCOMO"},
 	{"405 026", "TATA DOCOMO"},
 	{"405 027", "TATA DOCOMO"},
@@ -984,7 +990,6 @@ const GSM_CodeName GSM_Networks[] = {
 	{"405 037", "TATA DOCOMO"},
 	{"405 038", "TATA DOCOMO"},
 	{"405 039", "TATA DOCOMO"},
-	{"405 03", "Reliance"},
 	{"405 041", "TATA DOCOMO"},
 	{"405 042", "TATA DOCOMO"},
 	{"405 043", "TATA DOCOMO"},
@@ -992,10 +997,6 @@ const GSM_CodeName GSM_Networks[] = {
 	{"405 045", "TATA DOCOMO"},
 	{"405 046", "TATA DOCOMO"},
 	{"405 047", "TATA DOCOMO"},
-	{"405 04", "Reliance"},
-	{"405 05", "Reliance"},
-	{"405 10", "Reliance"},
-	{"405 13", "Reliance"},
 	{"405 51", "AirTel"},
 	{"405 52", "AirTel"},
 	{"405 54", "AirTel"},
@@ -1094,8 +1095,8 @@ const GSM_CodeName GSM_Networks[] = {
 	{"425 01", "Orange"},
 	{"425 02", "Cellcom"},
 	{"425 03", "Pelephone"},
-	{"425 059", "Jawwal"},
 	{"425 06", "Wataniya"},
+	{"425 059", "Jawwal"},
 	{"425 77", "Mirs"},
 	{"426 01", "Batelco"},
 	{"426 02", "zain BH"},
@@ -1625,14 +1626,14 @@ const GSM_CodeName GSM_Networks[] = {
 	{"716 17", "NEXTEL"},
 	{"722 010", "Movistar"},
 	{"722 020", "Nextel"},
+	{"722 34", "Personal"},
+	{"722 36", "Personal"},
 	{"722 070", "Movistar"},
 	{"722 310", "Claro"},
 	{"722 320", "Claro"},
 	{"722 330", "Claro"},
 	{"722 341", "Personal"},
-	{"722 34", "Personal"},
 	{"722 350", ""},
-	{"722 36", "Personal"},
 	{"724 00", "Nextel"},
 	{"724 02", "TIM"},
 	{"724 03", "TIM"},
@@ -1720,51 +1721,253 @@ const GSM_CodeName GSM_Networks[] = {
 	{"", ""},
 };
 
-const unsigned char *GSM_GetNetworkName(const char *NetworkCode)
+/**
+ * Converts network code to number used for ordering GSM_Networks.
+ *
+ * Both "MCC MNC" and "MCCMNC" formats are accepted, MNCs with same value
+ * but different number of digits are kept distinct.
+ *
+ * \return Key or -1 if code is not valid.
+ */
+static long GSM_NetworkCodeKey(const char *NetworkCode)
+{
+	long mcc = 0, mnc = 0;
+	size_t i, digits = 0;
+
+	for (i = 0; i < 3; i++) {
+		if (NetworkCode[i] < '0' || NetworkCode[i] > '9') {
+			return -1;
+		}
+		mcc = mcc * 10 + NetworkCode[i] - '0';
+	}
+	if (NetworkCode[i] == ' ') {
+		i++;
+	}
+	for (; NetworkCode[i] != 0; i++) {
+		if (NetworkCode[i] < '0' || NetworkCode[i] > '9' || digits >= 3) {
+			return -1;
+		}
+		mnc = mnc * 10 + NetworkCode[i] - '0';
+		digits++;
+	}
+	if (digits == 0) {
+		return -1;
+	}
+	return mcc * 100000 + mnc * 10 + digits;
+}
+
+/**
+ * Converts country code to number used for ordering GSM_Countries.
+ *
+ * \return Key or -1 if code is not valid.
+ */
+static long GSM_CountryCodeKey(const char *CountryCode)
 {
-	int i = 0;
-	static char retval[200];
-	char NetworkCodeFull[8];
-	const char *pos;
+	long mcc = 0;
+	size_t i;
 
-	EncodeUnicode(retval, "unknown", 7);
+	for (i = 0; i < 3; i++) {
+		if (CountryCode[i] < '0' || CountryCode[i] > '9') {
+			return -1;
+		}
+		mcc = mcc * 10 + CountryCode[i] - '0';
+	}
+	return mcc;
+}
 
-	/* Too long string */
-	if (strlen(NetworkCode) > 7 || strlen(NetworkCode) < 5) {
-		return retval;
+/**
+ * Binary search in code table sorted by key, returns first matching
+ * entry to match behaviour of linear search on duplicate codes.
+ */
+static const GSM_CodeName *GSM_FindCode(const GSM_CodeName *table, size_t count, long key, long (*getkey)(const char *))
+{
+	size_t low = 0, high = count, mid;
+
+	if (key < 0) {
+		return NULL;
+	}
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (getkey(table[mid].Code) < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
 	}
-	pos = strchr(NetworkCode, ' ');
-	if (pos == NULL) {
-		pos = NetworkCode + 3;
-	} else {
-		pos += 1;
+	if (low < count && getkey(table[low].Code) == key) {
+		return &table[low];
 	}
+	return NULL;
+}
 
-	sprintf(NetworkCodeFull, "%c%c%c %s", NetworkCode[0], NetworkCode[1], NetworkCode[2], pos);
+/**
+ * Number of entries in GSM_Networks, excluding terminator.
+ */
+static size_t GSM_NetworksCount(void)
+{
+	static size_t count = 0;
 
-	for (i = 0; GSM_Networks[i].Code[0] != 0; i++) {
-		if (strcmp(GSM_Networks[i].Code, NetworkCodeFull) == 0) {
-			EncodeUnicode(retval, GSM_Networks[i].Name, strlen(GSM_Networks[i].Name));
-			break;
+	if (count == 0) {
+		while (GSM_Networks[count].Code[0] != 0) {
+			count++;
 		}
 	}
+	return count;
+}
+
+/**
+ * Number of entries in GSM_Countries, excluding terminator.
+ */
+static size_t GSM_CountriesCount(void)
+{
+	static size_t count = 0;
 
-	return retval;
+	if (count == 0) {
+		while (GSM_Countries[count].Code[0] != 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * Finds entry for network code in GSM_Networks.
+ */
+static const GSM_CodeName *GSM_FindNetwork(const char *NetworkCode)
+{
+	if (strlen(NetworkCode) > 7 || strlen(NetworkCode) < 5) {
+		return NULL;
+	}
+
+	return GSM_FindCode(GSM_Networks, GSM_NetworksCount(),
+			GSM_NetworkCodeKey(NetworkCode), GSM_NetworkCodeKey);
+}
+
+/**
+ * Finds entry for country code in GSM_Countries.
+ */
+static const GSM_CodeName *GSM_FindCountry(const char *CountryCode)
+{
+	if (strlen(CountryCode) < 3) {
+		return NULL;
+	}
+
+	return GSM_FindCode(GSM_Countries, GSM_CountriesCount(),
+			GSM_CountryCodeKey(CountryCode), GSM_CountryCodeKey);
+}
+
+/**
+ * Encodes all names from table to UCS-2.
+ *
+ * Pointers to names are stored in table order and followed by encoded
+ * names in the same allocated block.
+ *
+ * \return Array of encoded names or NULL if allocation failed.
+ */
+static unsigned char **GSM_EncodeNames(const GSM_CodeName *table, size_t count)
+{
+	unsigned char **result, *pos;
+	size_t i, size = 0;
+
+	for (i = 0; i < count; i++) {
+		size += 2 * strlen(table[i].Name) + 2;
+	}
+
+	result = (unsigned char **)malloc(count * sizeof(unsigned char *) + size);
+	if (result == NULL) {
+		return NULL;
+	}
+
+	pos = (unsigned char *)(result + count);
+	for (i = 0; i < count; i++) {
+		result[i] = pos;
+		EncodeUnicode(pos, table[i].Name, strlen(table[i].Name));
+		pos += 2 * strlen(table[i].Name) + 2;
+	}
+	return result;
+}
+
+/**
+ * Encoded name returned for unknown codes.
+ */
+static const unsigned char GSM_UnknownName[] = {
+	0, 'u', 0, 'n', 0, 'k', 0, 'n', 0, 'o', 0, 'w', 0, 'n', 0, 0
+};
+
+const char *GSM_LookupNetworkName(const char *NetworkCode)
+{
+	const GSM_CodeName *entry;
+
+	entry = GSM_FindNetwork(NetworkCode);
+	if (entry == NULL) {
+		return NULL;
+	}
+	return entry->Name;
+}
+
+const char *GSM_LookupCountryName(const char *CountryCode)
+{
+	const GSM_CodeName *entry;
+
+	entry = GSM_FindCountry(CountryCode);
+	if (entry == NULL) {
+		return NULL;
+	}
+	return entry->Name;
+}
+
+void GSM_LookupNetworkNames(const char * const *NetworkCodes, const char **Names, size_t Count)
+{
+	size_t i;
+
+	for (i = 0; i < Count; i++) {
+		Names[i] = GSM_LookupNetworkName(NetworkCodes[i]);
+	}
+}
+
+const unsigned char *GSM_GetNetworkName(const char *NetworkCode)
+{
+	static unsigned char **names = NULL;
+	static unsigned char retval[200];
+	const GSM_CodeName *entry;
+
+	entry = GSM_FindNetwork(NetworkCode);
+	if (entry == NULL) {
+		return GSM_UnknownName;
+	}
+
+	/* Names are encoded only once, on first use */
+	if (names == NULL) {
+		names = GSM_EncodeNames(GSM_Networks, GSM_NetworksCount());
+	}
+	if (names == NULL) {
+		EncodeUnicode(retval, entry->Name, strlen(entry->Name));
+		return retval;
+	}
+	return names[entry - GSM_Networks];
 }
 
 const unsigned char *GSM_GetCountryName(const char *CountryCode)
 {
-	int		i = 0;
-	static char	retval[200];
+	static unsigned char **names = NULL;
+	static unsigned char retval[200];
+	const GSM_CodeName *entry;
 
-	EncodeUnicode(retval,"unknown",7);
-	for (i = 0; GSM_Countries[i].Code[0] != 0; i++) {
-		if (!strncmp(GSM_Countries[i].Code, CountryCode, 3)) {
-			EncodeUnicode(retval, GSM_Countries[i].Name, strlen(GSM_Countries[i].Name));
-			break;
-		}
+	entry = GSM_FindCountry(CountryCode);
+	if (entry == NULL) {
+		return GSM_UnknownName;
+	}
+
+	/* Names are encoded only once, on first use */
+	if (names == NULL) {
+		names = GSM_EncodeNames(GSM_Countries, GSM_CountriesCount());
+	}
+	if (names == NULL) {
+		EncodeUnicode(retval, entry->Name, strlen(entry->Name));
+		return retval;
 	}
-	return retval;
+	return names[entry - GSM_Countries];
 }
 
 void NOKIA_EncodeNetworkCode(unsigned char* buffer, const char* input)
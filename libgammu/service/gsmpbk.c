@@ -674,7 +674,7 @@ void GSM_TweakInternationalNumber(unsigned char *Number, const GSM_NumberType nu
 /**
  * \bug We should avoid using static buffers here.
  */
-GSM_Error GSM_DecodeVCARD(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_MemoryEntry *Pbk, GSM_VCardVersion Version)
+GSM_Error GSM_DecodeVCARDLength(GSM_Debug_Info *di, char *Buffer, size_t Length, size_t *Pos, GSM_MemoryEntry *Pbk, GSM_VCardVersion Version)
 {
 	char   Buff[20000];
 	int	     Level = 0;
@@ -683,6 +683,7 @@ GSM_Error GSM_DecodeVCARD(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_Mem
 	int		version = 1;
 	GSM_Error	error;
 	char	*Line = NULL;
+	size_t	LineSize = 0;
 	GSM_EntryLocation location;
 
 	Buff[0]	 = 0;
@@ -693,9 +694,7 @@ GSM_Error GSM_DecodeVCARD(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_Mem
 	}
 
 	while (1) {
-		free(Line);
-		Line = NULL;
-		error = GSM_GetVCSLine(&Line, Buffer, Pos, strlen(Buffer), TRUE);
+		error = GSM_ReadVCSLine(&Line, &LineSize, Buffer, Pos, Length, TRUE);
 		if (error != ERR_NONE) goto vcard_done;
 		if (strlen(Line) == 0) break;
 		switch (Level) {
@@ -1086,6 +1085,11 @@ vcard_done:
 	return error;
 }
 
+GSM_Error GSM_DecodeVCARD(GSM_Debug_Info *di, char *Buffer, size_t *Pos, GSM_MemoryEntry *Pbk, GSM_VCardVersion Version)
+{
+	return GSM_DecodeVCARDLength(di, Buffer, Buffer == NULL ? 0 : strlen(Buffer), Pos, Pbk, Version);
+}
+
 void GSM_FreeMemoryEntry(GSM_MemoryEntry *Entry)
 {
 	int i;
@@ -511,7 +511,7 @@ GSM_Error GSM_EncodeEMSMultiPartSMS(GSM_Debug_Info *di,
 	SMS->Number++;
 
 	if (UDHType == UDH_ConcatenatedMessages) {
-		UDHID = GSM_MakeSMSIDFromTime();
+		UDHID = (Info->Reference == -1) ? GSM_MakeSMSIDFromTime() : Info->Reference % 256;
 		for (i=0;i<SMS->Number;i++) {
 			SMS->SMS[i].UDH.Text[2+1] = UDHID;
 			SMS->SMS[i].UDH.Text[3+1] = SMS->Number;
@@ -521,6 +521,10 @@ GSM_Error GSM_EncodeEMSMultiPartSMS(GSM_Debug_Info *di,
 	if (UDHType == UDH_ConcatenatedMessages16bit) {
 		UDHID = GSM_MakeSMSIDFromTime();
 		GSM_GetCurrentDateTime (&Date);
+		if (Info->Reference != -1) {
+			Date.Hour = (Info->Reference / 256) % 256;
+			UDHID = Info->Reference % 256;
+		}
 		for (i=0;i<SMS->Number;i++) {
 			SMS->SMS[i].UDH.Text[2+1] = Date.Hour;
 			SMS->SMS[i].UDH.Text[3+1] = UDHID;
@@ -1,6 +1,8 @@
 /* (c) 2002-2006 by Marcin Wiacek */
 
 #include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -154,7 +156,8 @@ void GSM_MakeMultiPartSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage	*SMS,
 			  GSM_UDH		UDHType,
 			  GSM_Coding_Type	Coding,
 			  int			Class,
-			  unsigned char		ReplaceMessage)
+			  unsigned char		ReplaceMessage,
+			  int			Reference)
 {
 	size_t 		Len,UsedText = 0,CopiedText = 0,CopiedSMSText = 0;
 	int		j;
@@ -188,8 +191,13 @@ void GSM_MakeMultiPartSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage	*SMS,
 	GSM_GetCurrentDateTime (&Date);
 	for (j=0;j<SMS->Number;j++) {
 		SMS->SMS[j].UDH.Type 		= UDHType;
-		SMS->SMS[j].UDH.ID8bit 		= UDHID;
-		SMS->SMS[j].UDH.ID16bit		= UDHID + 256 * Date.Hour;
+		if (Reference == -1) {
+			SMS->SMS[j].UDH.ID8bit 	= UDHID;
+			SMS->SMS[j].UDH.ID16bit	= UDHID + 256 * Date.Hour;
+		} else {
+			SMS->SMS[j].UDH.ID8bit 	= Reference % 256;
+			SMS->SMS[j].UDH.ID16bit	= Reference % 65536;
+		}
 		SMS->SMS[j].UDH.PartNumber 	= j+1;
 		SMS->SMS[j].UDH.AllParts 	= SMS->Number;
 		GSM_EncodeUDHHeader(di, &SMS->SMS[j].UDH);
@@ -209,7 +217,7 @@ void GSM_SMSCounter(GSM_Debug_Info *di,
 	GSM_MultiSMSMessage 	MultiSMS;
 
 	MultiSMS.Number = 0;
-	GSM_MakeMultiPartSMS(di, &MultiSMS,MessageBuffer,UnicodeLength(MessageBuffer),UDHType,Coding,-1,FALSE);
+	GSM_MakeMultiPartSMS(di, &MultiSMS,MessageBuffer,UnicodeLength(MessageBuffer),UDHType,Coding,-1,FALSE,-1);
 	GSM_Find_Free_Used_SMS2(di, Coding,MultiSMS.SMS[MultiSMS.Number-1], &UsedText, CharsLeft, &FreeBytes);
 	*SMSNum = MultiSMS.Number;
 }
@@ -282,7 +290,8 @@ GSM_Error GSM_EncodeAlcatelMultiPartSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage
 					unsigned char 		*Data,
 					size_t			Len,
 					unsigned char		*Name,
-					size_t			Type)
+					size_t			Type,
+					int			Reference)
 {
 	unsigned char 	buff[100],UDHID;
 	size_t		i, p;
@@ -328,7 +337,7 @@ GSM_Error GSM_EncodeAlcatelMultiPartSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage
 
 	/* Linked sms UDH */
 	if (SMS->Number != 1) {
-		UDHID = GSM_MakeSMSIDFromTime();
+		UDHID = (Reference == -1) ? GSM_MakeSMSIDFromTime() : Reference % 256;
 		for (i = 0; i < (size_t)SMS->Number; i++) {
 			SMS->SMS[i].UDH.Text[SMS->SMS[i].UDH.Length-3] = UDHID;
 			SMS->SMS[i].UDH.Text[SMS->SMS[i].UDH.Length-2] = SMS->Number;
@@ -404,7 +413,7 @@ GSM_Error GSM_EncodeMultiPartSMS(GSM_Debug_Info *di,
 		}
 		}
 		Buffer[0] = Buffer[0] * 2;
-		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Buffer,ALCATELTDD_SMSTEMPLATE);
+		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Buffer,ALCATELTDD_SMSTEMPLATE,Info->Reference);
 	}
 
 	for (i=0;i<Info->EntriesNum;i++) {
@@ -472,7 +481,7 @@ GSM_Error GSM_EncodeMultiPartSMS(GSM_Debug_Info *di,
 		Buffer[1] = Info->Entries[0].Bitmap->Bitmap[0].BitmapHeight;
 		PHONE_EncodeBitmap(GSM_AlcatelBMMIPicture, Buffer+2, &Info->Entries[0].Bitmap->Bitmap[0]);
 		Length = PHONE_GetBitmapSize(GSM_AlcatelBMMIPicture,Info->Entries[0].Bitmap->Bitmap[0].BitmapWidth,Info->Entries[0].Bitmap->Bitmap[0].BitmapHeight)+2;
-		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Bitmap->Bitmap[0].Text,ALCATELTDD_PICTURE);
+		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Bitmap->Bitmap[0].Text,ALCATELTDD_PICTURE,Info->Reference);
 	case SMS_AlcatelMonoAnimationLong:
 		/* Number of sequence words */
 		Buffer[0] = (Info->Entries[0].Bitmap->Number+1) % 256;
@@ -498,7 +507,7 @@ GSM_Error GSM_EncodeMultiPartSMS(GSM_Debug_Info *di,
 			PHONE_EncodeBitmap(GSM_AlcatelBMMIPicture, Buffer+Length, &Info->Entries[0].Bitmap->Bitmap[i]);
 			Length += PHONE_GetBitmapSize(GSM_AlcatelBMMIPicture,Info->Entries[0].Bitmap->Bitmap[i].BitmapWidth,Info->Entries[0].Bitmap->Bitmap[i].BitmapHeight);
 		}
-		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Bitmap->Bitmap[0].Text,ALCATELTDD_ANIMATION);
+		return GSM_EncodeAlcatelMultiPartSMS(di, SMS,Buffer,Length,Info->Entries[0].Bitmap->Bitmap[0].Text,ALCATELTDD_ANIMATION,Info->Reference);
 	case SMS_MMSIndicatorLong:
 		Class	= 1;
 		UDH	= UDH_MMSIndicatorLong;
@@ -735,7 +744,7 @@ GSM_Error GSM_EncodeMultiPartSMS(GSM_Debug_Info *di,
 	default:
 		break;
 	}
-	GSM_MakeMultiPartSMS(di, SMS,Buffer,Length,UDH,Coding,Class,Info->ReplaceMessage);
+	GSM_MakeMultiPartSMS(di, SMS,Buffer,Length,UDH,Coding,Class,Info->ReplaceMessage,Info->Reference);
 	return ERR_NONE;
 }
 
@@ -770,6 +779,7 @@ void GSM_ClearMultiPartSMSInfo(GSM_MultiPartSMSInfo *Info)
 		Info->Entries[i].RingtoneNotes	= 0;
 	}
 	Info->Unknown		= FALSE;
+	Info->Reference		= -1;
 	Info->EntriesNum	= 0;
 	Info->Class		= -1;
 	Info->ReplaceMessage	= 0;
@@ -1205,6 +1215,111 @@ gboolean GSM_DecodeMultiPartSMS(GSM_Debug_Info *di,
 	return FALSE;
 }
 
+/**
+ * Returns size of message storage holding given number of parts.
+ */
+static size_t GSM_MultiSMSSize(int parts)
+{
+	if (parts < 1) parts = 1;
+	if (parts > GSM_MAX_MULTI_SMS) parts = GSM_MAX_MULTI_SMS;
+	return offsetof(GSM_MultiSMSMessage, SMS) + parts * sizeof(GSM_SMSMessage);
+}
+
+/**
+ * Returns concatenation reference stored in UDH, -1 if there is none.
+ */
+static int GSM_GetUDHReference(const GSM_UDHHeader *UDH)
+{
+	int pos = 1, len;
+
+	while (pos + 1 < UDH->Length) {
+		len = UDH->Text[pos + 1];
+		if (pos + 2 + len > UDH->Length) break;
+		if (UDH->Text[pos] == 0x00 && len == 3) {
+			return UDH->Text[pos + 2];
+		}
+		if (UDH->Text[pos] == 0x08 && len == 4) {
+			return UDH->Text[pos + 2] * 256 + UDH->Text[pos + 3];
+		}
+		pos += 2 + len;
+	}
+	return -1;
+}
+
+/**
+ * Replaces concatenation reference in all linking elements of UDH.
+ */
+static void GSM_SetUDHReference(GSM_UDHHeader *UDH, int Reference)
+{
+	int pos = 1, len;
+
+	while (pos + 1 < UDH->Length) {
+		len = UDH->Text[pos + 1];
+		if (pos + 2 + len > UDH->Length) break;
+		if (UDH->Text[pos] == 0x00 && len == 3) {
+			UDH->Text[pos + 2] = Reference % 256;
+			/* Parsed IDs are kept only for known headers */
+			if (UDH->Type != UDH_UserUDH && UDH->ID8bit != -1) {
+				UDH->ID8bit = Reference % 256;
+			}
+		}
+		if (UDH->Text[pos] == 0x08 && len == 4) {
+			UDH->Text[pos + 2] = (Reference / 256) % 256;
+			UDH->Text[pos + 3] = Reference % 256;
+			if (UDH->Type != UDH_UserUDH && UDH->ID16bit != -1) {
+				UDH->ID16bit = Reference % 65536;
+			}
+		}
+		pos += 2 + len;
+	}
+}
+
+GSM_Error GSM_StampMultiPartSMS(GSM_Debug_Info *di,
+				GSM_MultiPartSMSContext *Context,
+				GSM_MultiSMSMessage *SMS,
+				const unsigned char *Number,
+				const GSM_SMSValidity *Validity,
+				int MessageReference, int Reference)
+{
+	int i;
+
+	if (Context->Template.Number < 1) return ERR_EMPTY;
+	if (Context->Template.Number > GSM_MAX_MULTI_SMS) return ERR_MOREMEMORY;
+	if (Number != NULL && UnicodeLength(Number) > GSM_MAX_NUMBER_LENGTH) {
+		smfprintf(di, "Too long recipient number: %ld\n", (long)UnicodeLength(Number));
+		return ERR_MOREMEMORY;
+	}
+
+	/* Every recipient gets own reference, starting with template one */
+	if (Reference == -1) {
+		if (Context->Reference == -1) {
+			Context->Reference = GSM_GetUDHReference(&Context->Template.SMS[0].UDH);
+			if (Context->Reference == -1) {
+				Context->Reference = GSM_MakeSMSIDFromTime();
+			}
+		}
+		Reference = Context->Reference;
+		Context->Reference = (Context->Reference + 1) % 65536;
+	}
+
+	memcpy(SMS, &Context->Template, GSM_MultiSMSSize(Context->Template.Number));
+	for (i = 0; i < SMS->Number; i++) {
+		if (Number != NULL) {
+			CopyUnicodeString(SMS->SMS[i].Number, Number);
+		}
+		if (Validity != NULL) {
+			SMS->SMS[i].SMSC.Validity = *Validity;
+		}
+		if (MessageReference != -1) {
+			SMS->SMS[i].MessageReference = MessageReference;
+		}
+		GSM_SetUDHReference(&SMS->SMS[i].UDH, Reference);
+	}
+	smfprintf(di, "Stamped %d parts with reference %d\n", SMS->Number, Reference);
+
+	return ERR_NONE;
+}
+
 GSM_Error GSM_LinkSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage **InputMessages, GSM_MultiSMSMessage **OutputMessages, gboolean ems)
 {
 	gboolean			*InputMessagesSorted, copyit,OtherNumbers[GSM_SMS_OTHER_NUMBERS+1],wrong=FALSE;
@@ -1409,7 +1524,7 @@ GSM_Error GSM_LinkSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage **InputMessages, G
 				}
 				OutputMessages[OutputMessagesNum+1] = NULL;
 
-				memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],sizeof(GSM_MultiSMSMessage));
+				memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],GSM_MultiSMSSize(InputMessages[i]->Number));
 				InputMessagesSorted[i]=TRUE;
 				OutputMessagesNum++;
 				i = 0;
@@ -1441,7 +1556,7 @@ GSM_Error GSM_LinkSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage **InputMessages, G
 			}
 			OutputMessages[OutputMessagesNum+1] = NULL;
 
-			memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],sizeof(GSM_MultiSMSMessage));
+			memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],GSM_MultiSMSSize(InputMessages[i]->Number));
 			InputMessagesSorted[i]=TRUE;
 			OutputMessagesNum++;
 			i = 0;
@@ -1605,7 +1720,7 @@ GSM_Error GSM_LinkSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage **InputMessages, G
 				}
 				OutputMessages[OutputMessagesNum+1] = NULL;
 
-				memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],sizeof(GSM_MultiSMSMessage));
+				memcpy(OutputMessages[OutputMessagesNum],InputMessages[i],GSM_MultiSMSSize(InputMessages[i]->Number));
 				InputMessagesSorted[i]=TRUE;
 				OutputMessagesNum++;
 				i = 0;
@@ -41,7 +41,8 @@ void GSM_MakeMultiPartSMS(GSM_Debug_Info *di, GSM_MultiSMSMessage   *SMS,
 			  GSM_UDH	       	UDHType,
 			  GSM_Coding_Type       Coding,
 			  int		   	Class,
-			  unsigned char	 	RejectDuplicates);
+			  unsigned char	 	RejectDuplicates,
+			  int			Reference);
 
 void GSM_Find_Free_Used_SMS2(GSM_Debug_Info *di, GSM_Coding_Type Coding,GSM_SMSMessage SMS, size_t *UsedText, size_t *FreeText, size_t *FreeBytes);
 
@@ -0,0 +1,162 @@
+#!/usr/bin/env python
+# -*- coding: UTF-8 -*-
+# vim: expandtab sw=4 ts=4 sts=4:
+'''
+python-gammu - Phone communication libary
+
+Test for event loop integration, drives GammuAsyncWorker against dummy
+phone and compares results with synchronous state machine.
+'''
+__author__ = 'Michal Čihař'
+__email__ = 'michal@cihar.com'
+__license__ = '''
+Copyright © 2003 - 2015 Michal Čihař
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as published by
+the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+'''
+
+import sys
+import threading
+import gammu
+import gammu.asyncworker
+
+asyncio = gammu.asyncworker.asyncio
+
+COMMANDS = [
+    ('GetManufacturer', None),
+    ('GetModel', None),
+    ('GetIMEI', None),
+    ('GetMemory', ('ME', 1)),
+    ('GetMemory', {'Type': 'SM', 'Location': 1}),
+]
+
+
+def read_config():
+    '''
+    Reads gammu configuration.
+    '''
+    sm = gammu.StateMachine()
+    sm.ReadConfig(Filename = sys.argv[1])
+    return sm.GetConfig()
+
+
+def expected_results(config):
+    '''
+    Runs commands on synchronous state machine.
+    '''
+    sm = gammu.StateMachine()
+    sm.SetConfig(0, config)
+    sm.Init()
+    result = []
+    for command, params in COMMANDS:
+        func = getattr(sm, command)
+        if params is None:
+            result.append(func())
+        elif type(params) is dict:
+            result.append(func(**params))
+        else:
+            result.append(func(*params))
+    sm.Terminate()
+    return result
+
+
+def check(condition, message):
+    '''
+    Fails test when condition does not hold.
+    '''
+    if not condition:
+        raise AssertionError(message)
+
+
+def main():
+    '''
+    Runs commands through worker and checks their results.
+    '''
+    config = read_config()
+    expected = expected_results(config)
+
+    loop = asyncio.new_event_loop()
+    asyncio.set_event_loop(loop)
+    loop_thread = threading.current_thread()
+    worker = gammu.asyncworker.GammuAsyncWorker(
+        config, loop, poll_interval = 0.01
+    )
+
+    events = []
+    finished = []
+
+    def incoming(callback_worker, event, data):
+        check(callback_worker is worker, 'Wrong worker in callback')
+        check(threading.current_thread() is loop_thread,
+              'Callback not invoked from event loop')
+        events.append((event, data))
+
+    worker.set_incoming_callback(incoming)
+
+    def done(name, future):
+        finished.append(name)
+
+    futures = []
+    for name, future in [
+            ('Init', worker.initiate()),
+            ('SetIncomingUSSD', worker.enqueue('SetIncomingUSSD')),
+            ('DialService', worker.enqueue('DialService', ('*100#',)))]:
+        future.add_done_callback(lambda future, name=name: done(name, future))
+        futures.append((name, future))
+    for command, params in COMMANDS:
+        future = worker.enqueue(command, params)
+        future.add_done_callback(
+            lambda future, name=command: done(name, future)
+        )
+        futures.append((command, future))
+    missing = worker.enqueue('GetMemory', ('SM', 99999))
+    missing.add_done_callback(lambda future: done('Missing', future))
+
+    try:
+        loop.run_until_complete(missing)
+    except gammu.GSMError:
+        pass
+
+    # Commands are completed in order they were queued
+    check(finished == [name for name, future in futures] + ['Missing'],
+          'Wrong order of commands: %s' % finished)
+
+    # Results match synchronous calls
+    results = [future.result() for name, future in futures[3:]]
+    check(results == expected, 'Results differ: %s != %s' % (results, expected))
+
+    # Errors are propagated to future
+    check(isinstance(missing.exception(), gammu.GSMError),
+          'Missing error: %s' % missing.exception())
+
+    # Incoming event is delivered once to event loop
+    check(len(events) == 1, 'Wrong events: %s' % events)
+    check(events[0][0] == 'USSD', 'Wrong event: %s' % events[0][0])
+    check(events[0][1]['Text'] == 'Reply for *100#',
+          'Wrong USSD: %s' % events[0][1])
+
+    # Idle phone is polled and terminating waits for the poll
+    loop.run_until_complete(asyncio.sleep(0.1))
+    terminated = worker.terminate()
+    loop.run_until_complete(terminated)
+    check(terminated.exception() is None, 'Terminate failed')
+    check(worker.get_statemachine().GetDeviceFD() == -1,
+          'Descriptor after terminate')
+
+    loop.close()
+    print('Worker passed %d commands' % len(finished))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+# -*- coding: UTF-8 -*-
+# vim: expandtab sw=4 ts=4 sts=4:
+'''
+python-gammu - Phone communication libary
+
+Gammu event loop integration example. Commands return futures and
+incoming events are delivered to the event loop.
+'''
+__author__ = 'Michal Čihař'
+__email__ = 'michal@cihar.com'
+__license__ = '''
+Copyright © 2003 - 2015 Michal Čihař
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as published by
+the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+'''
+
+import sys
+import gammu
+
+try:
+    import gammu.asyncworker
+except ImportError:
+    print 'Neither asyncio nor trollius is available!'
+    sys.exit(1)
+
+COMMANDS = [
+    ('GetManufacturer', None),
+    ('GetModel', None),
+    ('GetIMEI', None),
+    ('GetBatteryCharge', None),
+    ('GetMemory', ('SM', 1)),
+]
+
+
+def read_config():
+    '''
+    Reads gammu configuration.
+    '''
+    sm = gammu.StateMachine()
+    if len(sys.argv) == 2:
+        sm.ReadConfig(Filename = sys.argv[1])
+    else:
+        sm.ReadConfig()
+    return sm.GetConfig()
+
+
+def incoming(worker, event, data):
+    '''
+    Callback for incoming events, called from event loop.
+    '''
+    print '-> incoming %s:' % event
+    print data
+
+
+def main():
+    '''
+    Main code to talk with worker.
+    '''
+    loop = gammu.asyncworker.asyncio.get_event_loop()
+    worker = gammu.asyncworker.GammuAsyncWorker(read_config(), loop)
+    worker.set_incoming_callback(incoming)
+
+    def done(name, future):
+        try:
+            print '-> %s completed, return value:' % name
+            print future.result()
+        except gammu.GSMError, val:
+            print '-> %s failed: %s' % (name, val[0]['Text'])
+
+    worker.initiate().add_done_callback(
+        lambda future: done('Init', future)
+    )
+    for command, params in COMMANDS:
+        worker.enqueue(command, params).add_done_callback(
+            lambda future, name=command: done(name, future)
+        )
+    finished = worker.terminate()
+    finished.add_done_callback(lambda future: done('Terminate', future))
+    loop.run_until_complete(finished)
+
+
+if __name__ == '__main__':
+    main()
@@ -181,6 +181,86 @@ def DateTime():
     sm.SetDateTime(dt)
     return dt
 
+def BulkRead():
+    '''
+    Checks that bulk methods read same entries as iterating over them.
+    '''
+    for memory in ('ME', 'SM', 'MC', 'RC', 'DC'):
+        status = sm.GetMemoryStatus(Type = memory)
+        entries = sm.GetAllMemory(Type = memory)
+        print '%-15s: %d' % ('Memory ' + memory, len(entries))
+        if len(entries) != status['Used']:
+            raise Exception('Bulk memory read mismatch!')
+
+    status = sm.GetCalendarStatus()
+    entries = sm.GetAllCalendar()
+    print '%-15s: %d' % ('Calendar', len(entries))
+    if len(entries) != status['Used']:
+        raise Exception('Bulk calendar read mismatch!')
+
+    status = sm.GetToDoStatus()
+    entries = sm.GetAllToDo()
+    print '%-15s: %d' % ('ToDo', len(entries))
+    if len(entries) != status['Used']:
+        raise Exception('Bulk todo read mismatch!')
+
+    status = sm.GetSMSStatus()
+    sms = sm.GetAllSMS()
+    parts = sum([len(x) for x in sms])
+    print '%-15s: %d' % ('SMS', parts)
+    if parts != status['SIMUsed'] + status['PhoneUsed'] + status['TemplatesUsed']:
+        raise Exception('Bulk SMS read mismatch!')
+
+    # Returning False from callback stops reading
+    progress = []
+    def Progress(count):
+        progress.append(count)
+        return False
+    sms = sm.GetAllSMS(Callback = Progress)
+    if len(sms) > 0 and progress != [len(sms)]:
+        raise Exception('Bulk SMS read was not stopped!')
+
+    # Folder with more entries than are read from phone at once
+    folder = sm.AddFolder(u'', u'bulk')
+    created = [folder]
+    try:
+        for i in range(20):
+            created.append(sm.AddFolder(folder, u'sub%02d' % i))
+
+        files = sm.GetAllFileFolders()
+        print '%-15s: %d' % ('Files', len(files))
+        if files != IterateFiles(sm.GetNextFileFolder):
+            raise Exception('Bulk file system listing mismatch!')
+
+        files = sm.GetAllFolderListing(folder)
+        print '%-15s: %d' % ('Folder', len(files))
+        if len(files) != 20:
+            raise Exception('Bulk folder listing is incomplete!')
+        if files != IterateFiles(
+                lambda Start: sm.GetFolderListing(folder, Start)):
+            raise Exception('Bulk folder listing mismatch!')
+
+        progress = []
+        files = sm.GetAllFolderListing(folder, Callback = Progress)
+        if progress != [len(files)] or len(files) >= 20:
+            raise Exception('Bulk folder listing was not stopped!')
+    finally:
+        for name in reversed(created):
+            sm.DeleteFolder(name)
+
+def IterateFiles(function):
+    '''
+    Lists files by calling function until there are no more entries.
+    '''
+    result = []
+    try:
+        result.append(function(Start = True))
+        while True:
+            result.append(function(Start = False))
+    except gammu.ERR_EMPTY:
+        pass
+    return result
+
 smsfolders = GetSMSFolders()
 GetAllMemory('ME')
 GetAllMemory('SM')
@@ -193,4 +273,5 @@ GetAllTodo()
 smslist = GetAllSMS()
 PrintAllSMS(smslist, smsfolders)
 LinkAllSMS(smslist, smsfolders)
+BulkRead()
 DateTime()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python
+# -*- coding: UTF-8 -*-
+# vim: expandtab sw=4 ts=4 sts=4:
+'''
+python-gammu - Test script for injecting several messages to SMSD at once
+using files backend
+'''
+__author__ = 'Michal Čihař'
+__email__ = 'michal@cihar.com'
+__license__ = '''
+Copyright © 2003 - 2015 Michal Čihař
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as published by
+the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+'''
+
+DATA_DIR = '@CMAKE_CURRENT_BINARY_DIR@'
+
+if DATA_DIR == '' or DATA_DIR[0] == '@':
+    raise Exception('Please configure this script!')
+
+import gammu
+import gammu.smsd
+import os
+import shutil
+import tempfile
+
+LONG_TEXT = 'python-gammu batch testing message, long enough to be split ' * 5
+
+
+def GenerateSMSDRC(path, gammurc, outbox):
+    gammu_config = file(gammurc).read()
+    out = file(path, 'w')
+    out.write('''
+[smsd]
+commtimeout = 1
+debuglevel = 255
+logfile = stderr
+service = files
+outboxformat = detail
+inboxpath = %s/
+outboxpath = %s/
+sentsmspath = %s/
+errorsmspath = %s/
+
+%s
+    ''' % (outbox, outbox, outbox, outbox, gammu_config))
+
+
+def PrepareMessages():
+    '''
+    Prepares short and multipart messages for different recipients.
+    '''
+    result = []
+    for number, text in (
+            ('+420800123451', 'python-gammu first batch message'),
+            ('+420800123452', LONG_TEXT),
+            ('+420800123453', 'python-gammu third batch message')):
+        message = gammu.EncodeSMS({
+            'Class': -1,
+            'Unicode': False,
+            'Entries': [{'ID': 'ConcatenatedTextLong', 'Buffer': text}],
+        })
+        for part in message:
+            part['SMSC'] = {'Location': 1}
+            part['Number'] = number
+        result.append(message)
+    return result
+
+
+def Summary(message):
+    return [(part['Number'], part['Text']) for part in message]
+
+
+def check(condition, message):
+    '''
+    Fails test when condition does not hold.
+    '''
+    if not condition:
+        raise AssertionError(message)
+
+
+if __name__ == '__main__':
+    outbox = tempfile.mkdtemp()
+    try:
+        smsdrc = os.path.join(outbox, '.smsdrc')
+        GenerateSMSDRC(smsdrc, os.path.join(DATA_DIR, '.gammurc'), outbox)
+        smsd = gammu.smsd.SMSD(smsdrc)
+
+        # Empty batch does not store anything
+        check(smsd.InjectSMSBatch([]) == [], 'Empty batch returned IDs')
+
+        # Every message gets own ID in same order
+        messages = PrepareMessages()
+        check(len(messages[1]) > 1, 'Long message was not split')
+        ids = smsd.InjectSMSBatch(messages)
+        check(len(ids) == len(messages), 'Wrong number of IDs: %s' % ids)
+        check(len(set(ids)) == len(ids), 'IDs are not unique: %s' % ids)
+
+        # IDs point to stored messages which match injected ones
+        for message_id, message in zip(ids, messages):
+            check(os.path.exists(message_id), 'Missing %s' % message_id)
+            stored = gammu.ReadSMSBackup(message_id)
+            check(Summary(stored) == Summary(message),
+                  'Stored message differs: %s != %s' % (
+                      Summary(stored), Summary(message)))
+        outbox_files = sorted(
+            name for name in os.listdir(outbox) if name.startswith('OUT')
+        )
+        check(outbox_files == sorted(os.path.basename(x) for x in ids),
+              'Unexpected outbox content: %s' % outbox_files)
+
+        # Too long batch is rejected before storing anything
+        try:
+            smsd.InjectSMSBatch([messages[0]] * 101)
+            check(False, 'Too long batch was accepted')
+        except ValueError:
+            pass
+        check(len([name for name in os.listdir(outbox) if name.startswith('OUT')]) == len(ids),
+              'Rejected batch was stored')
+
+        print 'Injected %d messages' % len(ids)
+    finally:
+        shutil.rmtree(outbox)
@@ -0,0 +1,232 @@
+# -*- coding: UTF-8 -*-
+# vim: expandtab sw=4 ts=4 sts=4:
+'''
+Event loop based communication to phone.
+
+This module integrates Gammu into asyncio (or trollius on older Python)
+event loop. Commands are executed one by one in executor, so many phones
+can share single thread pool, and incoming events are processed in the
+event loop as soon as phone sends some data.
+'''
+__author__ = 'Michal Čihař'
+__email__ = 'michal@cihar.com'
+__license__ = '''
+Copyright © 2003 - 2015 Michal Čihař
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as published by
+the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+'''
+
+import collections
+import functools
+import gammu
+from gammu.worker import check_worker_command
+
+try:
+    import asyncio
+except ImportError:
+    import trollius as asyncio
+
+
+class GammuAsyncWorker(object):
+    '''
+    Event loop based wrapper for communication with Gammu. Each command
+    returns future which is completed once phone replies. Commands for
+    one phone are serialized, but they do not block event loop and do not
+    need dedicated thread.
+    '''
+
+    def __init__(self, config, loop=None, executor=None, poll_interval=1):
+        '''
+        Initializes worker class.
+
+        @param config: Gammu configuration, same as
+        L{StateMachine.SetConfig} accepts.
+        @type config: hash
+        @param loop: Event loop to use, default one is used if not set.
+        @param executor: Executor used for phone commands, default
+        executor of event loop is used if not set.
+        @param poll_interval: Interval in seconds for polling device
+        which does not provide file descriptor (eg. USB or on Windows).
+        @type poll_interval: float
+        '''
+        if loop is None:
+            loop = asyncio.get_event_loop()
+        self._loop = loop
+        self._executor = executor
+        self._poll_interval = poll_interval
+        self._sm = gammu.StateMachine()
+        self._sm.SetConfig(0, config)
+        self._queue = collections.deque()
+        self._busy = False
+        self._connected = False
+        self._fd = -1
+        self._watching = False
+        self._poll_handle = None
+
+    def get_statemachine(self):
+        '''
+        Returns underlaying L{StateMachine}. It should be used only for
+        methods which do not communicate with phone.
+        '''
+        return self._sm
+
+    def set_incoming_callback(self, callback):
+        '''
+        Sets callback for incoming events. The callback is always invoked
+        from event loop, regardless of thread which received the event.
+
+        @param callback: Function to call or None for disabling.
+        @type callback: function, it will get three params: worker
+        object, event type and it's data in dictionary
+        '''
+        if callback is None:
+            self._sm.SetIncomingCallback(None)
+            return
+
+        def dispatch(statemachine, event, data):
+            self._loop.call_soon_threadsafe(callback, self, event, data)
+
+        self._sm.SetIncomingCallback(dispatch)
+
+    def enqueue(self, command, params=None):
+        '''
+        Enqueues command.
+
+        @param command: Name of L{StateMachine} method to invoke.
+        @type command: string
+        @param params: Parameters to command.
+        @type params: tuple or dict
+        @return: Future which gets result of the command.
+        '''
+        check_worker_command(command)
+        future = asyncio.Future(loop=self._loop)
+        self._queue.append((command, params, future))
+        self._schedule()
+        return future
+
+    def initiate(self):
+        '''
+        Connects to phone.
+
+        @return: Future which is completed once phone is connected.
+        '''
+        return self.enqueue('Init')
+
+    def terminate(self):
+        '''
+        Terminates phone connection once all queued commands are done.
+
+        @return: Future which is completed once phone is disconnected.
+        '''
+        return self.enqueue('Terminate')
+
+    def _do_command(self, command, params):
+        '''
+        Executes single command on phone, called from executor.
+        '''
+        func = getattr(self._sm, command)
+        if params is None:
+            return func()
+        elif type(params) is dict:
+            return func(**params)
+        return func(*params)
+
+    def _schedule(self):
+        '''
+        Starts next queued command or watches device for incoming data.
+        '''
+        if self._busy:
+            return
+        while len(self._queue) > 0:
+            command, params, future = self._queue.popleft()
+            if future.cancelled():
+                continue
+            self._unwatch()
+            self._busy = True
+            pending = self._loop.run_in_executor(
+                self._executor, self._do_command, command, params
+            )
+            pending.add_done_callback(
+                functools.partial(self._command_done, command, future)
+            )
+            return
+        self._watch()
+
+    def _command_done(self, command, future, pending):
+        '''
+        Propagates command result and schedules next command.
+        '''
+        self._busy = False
+        error = pending.exception()
+        if command == 'Init' and error is None:
+            self._connected = True
+        elif command == 'Terminate':
+            self._connected = False
+        self._fd = self._sm.GetDeviceFD()
+        if future is not None and not future.cancelled():
+            if error is not None:
+                future.set_exception(error)
+            else:
+                future.set_result(pending.result())
+        self._schedule()
+
+    def _watch(self):
+        '''
+        Starts processing of incoming data while no command is running.
+        '''
+        if not self._connected or self._watching:
+            return
+        self._watching = True
+        if self._fd >= 0:
+            self._loop.add_reader(self._fd, self._read)
+        else:
+            self._poll_handle = self._loop.call_later(
+                self._poll_interval, self._poll
+            )
+
+    def _unwatch(self):
+        '''
+        Stops processing of incoming data, command will handle it.
+        '''
+        if not self._watching:
+            return
+        self._watching = False
+        if self._poll_handle is not None:
+            self._poll_handle.cancel()
+            self._poll_handle = None
+        else:
+            self._loop.remove_reader(self._fd)
+
+    def _read(self):
+        '''
+        Feeds readable data to Gammu, this does not block.
+        '''
+        try:
+            self._sm.ReadDevice()
+        except gammu.GSMError:
+            pass
+
+    def _poll(self):
+        '''
+        Polls device without file descriptor in executor.
+        '''
+        self._poll_handle = None
+        self._watching = False
+        self._busy = True
+        pending = self._loop.run_in_executor(
+            self._executor, self._read
+        )
+        pending.add_done_callback(
+            functools.partial(self._command_done, None, None)
+        )
@@ -144,7 +144,8 @@ PyObject *FileToPython(GSM_File * file)
 		return NULL;
 	}
 
-	buffer = PyString_FromStringAndSize((char *)file->Buffer, file->Used);
+	/* Listings fill in only size, there is no content */
+	buffer = PyString_FromStringAndSize((char *)file->Buffer, file->Buffer == NULL ? 0 : file->Used);
 	if (buffer == NULL) {
 		Py_DECREF(name);
 		free(type);
@@ -50,6 +50,9 @@
 /* Length of buffers used in most of code */
 #define BUFFER_LENGTH 255
 
+/* Number of entries bulk methods read from phone without holding GIL */
+#define BULK_CHUNK 16
+
 #ifdef WITH_THREAD
 
 /* Use python locking */
@@ -353,6 +356,46 @@ static void CheckIncomingEvents(StateMachineObject *sm) {
     }
 }
 
+/**
+ * Checks progress callback passed to bulk methods, None is turned
+ * into NULL.
+ */
+static int BulkCheckCallback(PyObject **callback) {
+    if (*callback == Py_None) {
+        *callback = NULL;
+    }
+    if (*callback != NULL && !PyCallable_Check(*callback)) {
+        PyErr_SetString(PyExc_TypeError, "Callback must be callable");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Calls progress callback of bulk methods with number of entries read
+ * so far.
+ *
+ * @return 1 to continue, 0 to stop reading, -1 on exception.
+ */
+static int BulkProgress(PyObject *callback, Py_ssize_t count) {
+    PyObject            *ret;
+    int                 result;
+
+    if (callback == NULL) return 1;
+
+    ret = PyObject_CallFunction(callback, "n", count);
+    if (ret == NULL) return -1;
+
+    /* Returning nothing means continue */
+    if (ret == Py_None) {
+        result = 1;
+    } else {
+        result = PyObject_IsTrue(ret);
+    }
+    Py_DECREF(ret);
+    return result;
+}
+
 /* ---------------------------------------------------------------- */
 
 static char StateMachine_GetConfig__doc__[] =
@@ -739,6 +782,29 @@ StateMachine_ReadDevice(StateMachineObject *self, PyObject *args, PyObject *kwds
     return PyInt_FromLong(result);
 }
 
+/***************/
+/* GetDeviceFD */
+/***************/
+
+static char StateMachine_GetDeviceFD__doc__[] =
+"GetDeviceFD()\n\n"
+"Returns file descriptor used for communication with phone. Once it\n"
+"becomes readable, L{ReadDevice} should be called to process incoming\n"
+"data. This allows to integrate Gammu into event loops. USB\n"
+"connections have no such descriptor and need to be polled.\n\n"
+"@return: File descriptor or -1 if connection does not use one\n"
+"@rtype: int\n"
+;
+
+static PyObject *
+StateMachine_GetDeviceFD(StateMachineObject *self, PyObject *args, PyObject *kwds)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+
+    return PyInt_FromLong(GSM_GetDeviceFD(self->s));
+}
+
 
 /*******************/
 /* GetManufacturer */
@@ -2003,6 +2069,99 @@ StateMachine_GetNextMemory(StateMachineObject *self, PyObject *args, PyObject *k
     return result;
 }
 
+/****************/
+/* GetAllMemory */
+/****************/
+
+static char StateMachine_GetAllMemory__doc__[] =
+"GetAllMemory(Type, Callback)\n\n"
+"Reads all entries from memory (phonebooks or calls), this is same as calling L{GetNextMemory} until there are no more entries, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Type: Memory type, one of 'ME', 'SM', 'ON', 'DC', 'RC', 'MC', 'MT', 'FD', 'VM'\n"
+"@type Type: string\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of entries, each of them in same format as L{GetNextMemory} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllMemory(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    GSM_Error           error = ERR_NONE;
+    GSM_MemoryEntry     *entries;
+    static char         *kwlist[] = {"Type", "Callback", NULL};
+    PyObject            *callback = NULL;
+    PyObject            *result, *item;
+    char                *s = NULL;
+    GSM_MemoryType      type;
+    int                 start = TRUE, location = 0;
+    int                 count, i, cont = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|O", kwlist,
+                &s, &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    type = StringToMemoryType(s);
+    if (type == 0) return NULL;
+
+    entries = (GSM_MemoryEntry *)malloc(BULK_CHUNK * sizeof(GSM_MemoryEntry));
+    if (entries == NULL) return PyErr_NoMemory();
+
+    result = PyList_New(0);
+    if (result == NULL) {
+        free(entries);
+        return NULL;
+    }
+
+    while (cont) {
+        count = 0;
+
+        BEGIN_PHONE_COMM
+        while (count < BULK_CHUNK) {
+            entries[count].MemoryType = type;
+            entries[count].Location = location;
+            error = GSM_GetNextMemory(self->s, &entries[count], start);
+            if (error != ERR_NONE) break;
+            start = FALSE;
+            location = entries[count].Location;
+            count++;
+        }
+        END_PHONE_COMM
+
+        for (i = 0; i < count; i++) {
+            if (result != NULL) {
+                item = MemoryEntryToPython(&entries[i]);
+                if (item == NULL || PyList_Append(result, item) != 0) {
+                    Py_CLEAR(result);
+                }
+                Py_XDECREF(item);
+            }
+            GSM_FreeMemoryEntry(&entries[i]);
+        }
+        if (result == NULL) break;
+
+        if (count > 0) {
+            cont = BulkProgress(callback, PyList_GET_SIZE(result));
+            if (cont < 0) {
+                Py_CLEAR(result);
+                break;
+            }
+        }
+        if (error != ERR_NONE) break;
+    }
+
+    free(entries);
+
+    if (result != NULL && error != ERR_EMPTY && error != ERR_NONE) {
+        if (!checkError(self->s, error, "GetAllMemory")) {
+            Py_CLEAR(result);
+        }
+    }
+
+    return result;
+}
+
 /*************/
 /* SetMemory */
 /*************/
@@ -2468,6 +2627,121 @@ StateMachine_GetNextSMS(StateMachineObject *self, PyObject *args, PyObject *kwds
     return MultiSMSToPython(&sms);
 }
 
+/*************/
+/* GetAllSMS */
+/*************/
+
+static char StateMachine_GetAllSMS__doc__[] =
+"GetAllSMS(Folder, Callback)\n\n"
+"Reads all SMS messages, this is same as calling L{GetNextSMS} until there are no more messages, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Folder: Folder where to read entries (0 is emulated flat memory). Defaults to 0.\n"
+"@type Folder: int\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of messages, each of them in same format as L{GetNextSMS} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllSMS(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    GSM_Error           error = ERR_NONE;
+    GSM_MultiSMSMessage *sms;
+    GSM_SMSMessage      *parts = NULL, *newparts;
+    int                 numbers[BULK_CHUNK];
+    static char         *kwlist[] = {"Folder", "Callback", NULL};
+    PyObject            *callback = NULL;
+    PyObject            *result, *item;
+    int                 folder = 0, location, start = TRUE;
+    int                 count, used, allocated = 0, i, pos, cont = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iO", kwlist,
+                &folder, &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    /* Single work structure, parts of messages are stored separately */
+    sms = (GSM_MultiSMSMessage *)malloc(sizeof(GSM_MultiSMSMessage));
+    if (sms == NULL) return PyErr_NoMemory();
+
+    result = PyList_New(0);
+    if (result == NULL) goto fail;
+
+    for (i = 0; i < GSM_MAX_MULTI_SMS; i++) {
+        GSM_SetDefaultSMSData(&sms->SMS[i]);
+    }
+    sms->SMS[0].Folder = folder;
+    sms->SMS[0].Location = 0;
+    sms->Number = 0;
+
+    while (cont) {
+        count = 0;
+        used = 0;
+
+        BEGIN_PHONE_COMM
+        while (count < BULK_CHUNK) {
+            error = GSM_GetNextSMS(self->s, sms, start);
+            if (error != ERR_NONE) break;
+            start = FALSE;
+
+            if (used + sms->Number > allocated) {
+                newparts = (GSM_SMSMessage *)realloc(parts, (used + sms->Number + BULK_CHUNK) * sizeof(GSM_SMSMessage));
+                if (newparts == NULL) {
+                    error = ERR_MOREMEMORY;
+                    break;
+                }
+                parts = newparts;
+                allocated = used + sms->Number + BULK_CHUNK;
+            }
+            memcpy(parts + used, sms->SMS, sms->Number * sizeof(GSM_SMSMessage));
+            used += sms->Number;
+            numbers[count++] = sms->Number;
+        }
+        END_PHONE_COMM
+
+        /* Work structure is reused for conversion, remember position */
+        folder = sms->SMS[0].Folder;
+        location = sms->SMS[0].Location;
+
+        for (i = 0, pos = 0; i < count; i++) {
+            sms->Number = numbers[i];
+            memcpy(sms->SMS, parts + pos, numbers[i] * sizeof(GSM_SMSMessage));
+            pos += numbers[i];
+
+            item = MultiSMSToPython(sms);
+            if (item == NULL) goto fail;
+            if (PyList_Append(result, item) != 0) {
+                Py_DECREF(item);
+                goto fail;
+            }
+            Py_DECREF(item);
+        }
+
+        sms->SMS[0].Folder = folder;
+        sms->SMS[0].Location = location;
+
+        if (count > 0) {
+            cont = BulkProgress(callback, PyList_GET_SIZE(result));
+            if (cont < 0) goto fail;
+        }
+        if (error != ERR_NONE) break;
+    }
+
+    if (error != ERR_EMPTY && error != ERR_NONE) {
+        if (!checkError(self->s, error, "GetAllSMS")) goto fail;
+    }
+
+    free(parts);
+    free(sms);
+    return result;
+
+fail:
+    free(parts);
+    free(sms);
+    Py_XDECREF(result);
+    return NULL;
+}
+
 /**********/
 /* SetSMS */
 /**********/
@@ -3811,6 +4085,90 @@ StateMachine_GetNextToDo(StateMachineObject *self, PyObject *args, PyObject *kwd
     return TodoToPython(&todo);
 }
 
+/**************/
+/* GetAllToDo */
+/**************/
+
+static char StateMachine_GetAllToDo__doc__[] =
+"GetAllToDo(Callback)\n\n"
+"Reads all ToDo entries, this is same as calling L{GetNextToDo} until there are no more entries, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of entries, each of them in same format as L{GetNextToDo} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllToDo(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    GSM_Error           error = ERR_NONE;
+    GSM_ToDoEntry     *entries;
+    static char         *kwlist[] = {"Callback", NULL};
+    PyObject            *callback = NULL;
+    PyObject            *result, *item;
+    int                 start = TRUE, location = 0;
+    int                 count, i, cont = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist,
+                &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    entries = (GSM_ToDoEntry *)malloc(BULK_CHUNK * sizeof(GSM_ToDoEntry));
+    if (entries == NULL) return PyErr_NoMemory();
+
+    result = PyList_New(0);
+    if (result == NULL) {
+        free(entries);
+        return NULL;
+    }
+
+    while (cont) {
+        count = 0;
+
+        BEGIN_PHONE_COMM
+        while (count < BULK_CHUNK) {
+            entries[count].Location = location;
+            error = GSM_GetNextToDo(self->s, &entries[count], start);
+            if (error != ERR_NONE) break;
+            start = FALSE;
+            location = entries[count].Location;
+            count++;
+        }
+        END_PHONE_COMM
+
+        for (i = 0; i < count; i++) {
+            if (result != NULL) {
+                item = TodoToPython(&entries[i]);
+                if (item == NULL || PyList_Append(result, item) != 0) {
+                    Py_CLEAR(result);
+                }
+                Py_XDECREF(item);
+            }
+        }
+        if (result == NULL) break;
+
+        if (count > 0) {
+            cont = BulkProgress(callback, PyList_GET_SIZE(result));
+            if (cont < 0) {
+                Py_CLEAR(result);
+                break;
+            }
+        }
+        if (error != ERR_NONE) break;
+    }
+
+    free(entries);
+
+    if (result != NULL && error != ERR_EMPTY && error != ERR_NONE) {
+        if (!checkError(self->s, error, "GetAllToDo")) {
+            Py_CLEAR(result);
+        }
+    }
+
+    return result;
+}
+
 /***********/
 /* SetToDo */
 /***********/
@@ -4070,6 +4428,90 @@ StateMachine_GetNextCalendar(StateMachineObject *self, PyObject *args, PyObject
     return CalendarToPython(&entry);
 }
 
+/******************/
+/* GetAllCalendar */
+/******************/
+
+static char StateMachine_GetAllCalendar__doc__[] =
+"GetAllCalendar(Callback)\n\n"
+"Reads all calendar entries, this is same as calling L{GetNextCalendar} until there are no more entries, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of entries, each of them in same format as L{GetNextCalendar} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllCalendar(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    GSM_Error           error = ERR_NONE;
+    GSM_CalendarEntry     *entries;
+    static char         *kwlist[] = {"Callback", NULL};
+    PyObject            *callback = NULL;
+    PyObject            *result, *item;
+    int                 start = TRUE, location = 0;
+    int                 count, i, cont = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist,
+                &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    entries = (GSM_CalendarEntry *)malloc(BULK_CHUNK * sizeof(GSM_CalendarEntry));
+    if (entries == NULL) return PyErr_NoMemory();
+
+    result = PyList_New(0);
+    if (result == NULL) {
+        free(entries);
+        return NULL;
+    }
+
+    while (cont) {
+        count = 0;
+
+        BEGIN_PHONE_COMM
+        while (count < BULK_CHUNK) {
+            entries[count].Location = location;
+            error = GSM_GetNextCalendar(self->s, &entries[count], start);
+            if (error != ERR_NONE) break;
+            start = FALSE;
+            location = entries[count].Location;
+            count++;
+        }
+        END_PHONE_COMM
+
+        for (i = 0; i < count; i++) {
+            if (result != NULL) {
+                item = CalendarToPython(&entries[i]);
+                if (item == NULL || PyList_Append(result, item) != 0) {
+                    Py_CLEAR(result);
+                }
+                Py_XDECREF(item);
+            }
+        }
+        if (result == NULL) break;
+
+        if (count > 0) {
+            cont = BulkProgress(callback, PyList_GET_SIZE(result));
+            if (cont < 0) {
+                Py_CLEAR(result);
+                break;
+            }
+        }
+        if (error != ERR_NONE) break;
+    }
+
+    free(entries);
+
+    if (result != NULL && error != ERR_EMPTY && error != ERR_NONE) {
+        if (!checkError(self->s, error, "GetAllCalendar")) {
+            Py_CLEAR(result);
+        }
+    }
+
+    return result;
+}
+
 /***************/
 /* SetCalendar */
 /***************/
@@ -4479,6 +4921,161 @@ StateMachine_GetFolderListing(StateMachineObject *self, PyObject *args, PyObject
     return FileToPython(&File);
 }
 
+/*********************/
+/* GetAllFileFolders */
+/*********************/
+
+/**
+ * Reads all entries of file system listing, used by GetAllFileFolders
+ * and GetAllFolderListing.
+ *
+ * @param first Template for first entry.
+ * @param folder Whether to list single folder instead of whole file system.
+ */
+static PyObject *
+BulkFileListing(StateMachineObject *self, const GSM_File *first, gboolean folder, PyObject *callback, const char *where) {
+    GSM_Error           error = ERR_NONE;
+    GSM_File            *entries;
+    PyObject            *result, *item;
+    int                 start = TRUE;
+    int                 count, i, cont = 1;
+
+    entries = (GSM_File *)malloc((BULK_CHUNK + 1) * sizeof(GSM_File));
+    if (entries == NULL) return PyErr_NoMemory();
+
+    result = PyList_New(0);
+    if (result == NULL) {
+        free(entries);
+        return NULL;
+    }
+
+    /* Last slot holds entry from which listing continues */
+    entries[BULK_CHUNK] = *first;
+
+    while (cont) {
+        count = 0;
+
+        BEGIN_PHONE_COMM
+        while (count < BULK_CHUNK) {
+            entries[count] = (count == 0) ? entries[BULK_CHUNK] : entries[count - 1];
+            entries[count].Buffer = NULL;
+            entries[count].Used = 0;
+            if (folder) {
+                error = GSM_GetFolderListing(self->s, &entries[count], start);
+            } else {
+                error = GSM_GetNextFileFolder(self->s, &entries[count], start);
+            }
+            if (error != ERR_NONE) break;
+            start = FALSE;
+            count++;
+        }
+        END_PHONE_COMM
+
+        if (count > 0) {
+            entries[BULK_CHUNK] = entries[count - 1];
+            entries[BULK_CHUNK].Buffer = NULL;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (result != NULL) {
+                item = FileToPython(&entries[i]);
+                if (item == NULL || PyList_Append(result, item) != 0) {
+                    Py_CLEAR(result);
+                }
+                Py_XDECREF(item);
+            }
+            free(entries[i].Buffer);
+        }
+        if (result == NULL) break;
+
+        if (count > 0) {
+            cont = BulkProgress(callback, PyList_GET_SIZE(result));
+            if (cont < 0) {
+                Py_CLEAR(result);
+                break;
+            }
+        }
+        if (error != ERR_NONE) break;
+    }
+
+    free(entries);
+
+    if (result != NULL && error != ERR_EMPTY && error != ERR_NONE) {
+        if (!checkError(self->s, error, where)) {
+            Py_CLEAR(result);
+        }
+    }
+
+    return result;
+}
+
+static char StateMachine_GetAllFileFolders__doc__[] =
+"GetAllFileFolders(Callback)\n\n"
+"Lists whole filesystem, this is same as calling L{GetNextFileFolder} until there are no more entries, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of entries, each of them in same format as L{GetNextFileFolder} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllFileFolders(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    static char         *kwlist[] = {"Callback", NULL};
+    PyObject            *callback = NULL;
+    GSM_File            File;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist,
+                &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    memset(&File, 0, sizeof(File));
+
+    return BulkFileListing(self, &File, FALSE, callback, "GetAllFileFolders");
+}
+
+/***********************/
+/* GetAllFolderListing */
+/***********************/
+
+static char StateMachine_GetAllFolderListing__doc__[] =
+"GetAllFolderListing(Folder, Callback)\n\n"
+"Lists filesystem folder, this is same as calling L{GetFolderListing} until there are no more entries, but entries are read from phone in chunks without holding Python lock.\n\n"
+"@param Folder: Folder to list\n"
+"@type Folder: string\n"
+"@param Callback: Optional function called after each chunk of entries is read with number of entries read so far. Reading is stopped when it returns False.\n"
+"@type Callback: callable\n"
+"@return: List of entries, each of them in same format as L{GetFolderListing} returns\n"
+"@rtype: list\n"
+;
+
+static PyObject *
+StateMachine_GetAllFolderListing(StateMachineObject *self, PyObject *args, PyObject *kwds) {
+    static char         *kwlist[] = {"Folder", "Callback", NULL};
+    PyObject            *callback = NULL;
+    PyObject            *folder_p;
+    unsigned char       *folder_g;
+    GSM_File            File;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "U|O", kwlist,
+                &folder_p, &callback))
+        return NULL;
+
+    if (!BulkCheckCallback(&callback)) return NULL;
+
+    memset(&File, 0, sizeof(File));
+
+    folder_g = StringPythonToGammu(folder_p);
+    if (folder_g == NULL) return NULL;
+    CopyUnicodeString(File.ID_FullName, folder_g);
+    free(folder_g);
+
+    File.Folder = TRUE;
+
+    return BulkFileListing(self, &File, TRUE, callback, "GetAllFolderListing");
+}
+
 /*********************/
 /* GetNextRootFolder */
 /*********************/
@@ -5140,6 +5737,7 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"Terminate",	(PyCFunction)StateMachine_Terminate,	METH_VARARGS|METH_KEYWORDS,	StateMachine_Terminate__doc__},
     {"Abort",	(PyCFunction)StateMachine_Abort,	METH_VARARGS|METH_KEYWORDS,	StateMachine_Abort__doc__},
     {"ReadDevice",	(PyCFunction)StateMachine_ReadDevice,	METH_VARARGS|METH_KEYWORDS,	StateMachine_ReadDevice__doc__},
+    {"GetDeviceFD",	(PyCFunction)StateMachine_GetDeviceFD,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetDeviceFD__doc__},
     {"GetManufacturer",	(PyCFunction)StateMachine_GetManufacturer,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetManufacturer__doc__},
     {"GetModel",	(PyCFunction)StateMachine_GetModel,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetModel__doc__},
     {"GetFirmware",	(PyCFunction)StateMachine_GetFirmware,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetFirmware__doc__},
@@ -5172,6 +5770,7 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"GetMemoryStatus",	(PyCFunction)StateMachine_GetMemoryStatus,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetMemoryStatus__doc__},
     {"GetMemory",	(PyCFunction)StateMachine_GetMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetMemory__doc__},
     {"GetNextMemory",	(PyCFunction)StateMachine_GetNextMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextMemory__doc__},
+    {"GetAllMemory",	(PyCFunction)StateMachine_GetAllMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllMemory__doc__},
     {"SetMemory",	(PyCFunction)StateMachine_SetMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_SetMemory__doc__},
     {"AddMemory",	(PyCFunction)StateMachine_AddMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_AddMemory__doc__},
     {"DeleteMemory",	(PyCFunction)StateMachine_DeleteMemory,	METH_VARARGS|METH_KEYWORDS,	StateMachine_DeleteMemory__doc__},
@@ -5183,6 +5782,7 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"GetSMSStatus",	(PyCFunction)StateMachine_GetSMSStatus,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetSMSStatus__doc__},
     {"GetSMS",	(PyCFunction)StateMachine_GetSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetSMS__doc__},
     {"GetNextSMS",	(PyCFunction)StateMachine_GetNextSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextSMS__doc__},
+    {"GetAllSMS",	(PyCFunction)StateMachine_GetAllSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllSMS__doc__},
     {"SetSMS",	(PyCFunction)StateMachine_SetSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_SetSMS__doc__},
     {"AddSMS",	(PyCFunction)StateMachine_AddSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_AddSMS__doc__},
     {"DeleteSMS",	(PyCFunction)StateMachine_DeleteSMS,	METH_VARARGS|METH_KEYWORDS,	StateMachine_DeleteSMS__doc__},
@@ -5228,6 +5828,7 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"GetToDoStatus",	(PyCFunction)StateMachine_GetToDoStatus,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetToDoStatus__doc__},
     {"GetToDo",	(PyCFunction)StateMachine_GetToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetToDo__doc__},
     {"GetNextToDo",	(PyCFunction)StateMachine_GetNextToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextToDo__doc__},
+    {"GetAllToDo",	(PyCFunction)StateMachine_GetAllToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllToDo__doc__},
     {"SetToDo",	(PyCFunction)StateMachine_SetToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_SetToDo__doc__},
     {"AddToDo",	(PyCFunction)StateMachine_AddToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_AddToDo__doc__},
     {"DeleteToDo",	(PyCFunction)StateMachine_DeleteToDo,	METH_VARARGS|METH_KEYWORDS,	StateMachine_DeleteToDo__doc__},
@@ -5235,6 +5836,7 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"GetCalendarStatus",	(PyCFunction)StateMachine_GetCalendarStatus,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetCalendarStatus__doc__},
     {"GetCalendar",	(PyCFunction)StateMachine_GetCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetCalendar__doc__},
     {"GetNextCalendar",	(PyCFunction)StateMachine_GetNextCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextCalendar__doc__},
+    {"GetAllCalendar",	(PyCFunction)StateMachine_GetAllCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllCalendar__doc__},
     {"SetCalendar",	(PyCFunction)StateMachine_SetCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_SetCalendar__doc__},
     {"AddCalendar",	(PyCFunction)StateMachine_AddCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_AddCalendar__doc__},
     {"DeleteCalendar",	(PyCFunction)StateMachine_DeleteCalendar,	METH_VARARGS|METH_KEYWORDS,	StateMachine_DeleteCalendar__doc__},
@@ -5250,7 +5852,9 @@ static struct PyMethodDef StateMachine_methods[] = {
     {"ClearFMStations",	(PyCFunction)StateMachine_ClearFMStations,	METH_VARARGS|METH_KEYWORDS,	StateMachine_ClearFMStations__doc__},
 #endif
     {"GetNextFileFolder",	(PyCFunction)StateMachine_GetNextFileFolder,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextFileFolder__doc__},
+    {"GetAllFileFolders",	(PyCFunction)StateMachine_GetAllFileFolders,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllFileFolders__doc__},
     {"GetFolderListing",	(PyCFunction)StateMachine_GetFolderListing,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetFolderListing__doc__},
+    {"GetAllFolderListing",	(PyCFunction)StateMachine_GetAllFolderListing,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetAllFolderListing__doc__},
     {"GetNextRootFolder",	(PyCFunction)StateMachine_GetNextRootFolder,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetNextRootFolder__doc__},
     {"SetFileAttributes",	(PyCFunction)StateMachine_SetFileAttributes,	METH_VARARGS|METH_KEYWORDS,	StateMachine_SetFileAttributes__doc__},
     {"GetFilePart",	(PyCFunction)StateMachine_GetFilePart,	METH_VARARGS|METH_KEYWORDS,	StateMachine_GetFilePart__doc__},
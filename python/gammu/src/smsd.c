@@ -37,6 +37,10 @@
 /* Convertors between Gammu and Python types */
 #include "convertors.h"
 
+/* Maximal number of messages in one batch, each is converted to
+ * GSM_MultiSMSMessage which takes about 260 kB */
+#define INJECT_BATCH_MAX 100
+
 /* Error objects */
 #include "errors.h"
 
@@ -144,11 +148,90 @@ static PyObject *Py_SMSD_InjectSMS(SMSDObject * self, PyObject * args, PyObject
 	return Py_BuildValue("s", newid);
 }
 
+static char SMSD_InjectSMSBatch__doc__[] = "Injects several messages (at most 100) to the SMSD queue at once";
+
+static PyObject *Py_SMSD_InjectSMSBatch(SMSDObject * self, PyObject * args, PyObject * kwds)
+{
+	GSM_MultiSMSMessage *smsin;
+	static char *kwlist[] = { "Messages", NULL };
+	PyObject *value, *item, *result = NULL;
+	GSM_Error error;
+	char **newids = NULL;
+	Py_ssize_t count, i;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PyList_Type, &(value)))
+		return NULL;
+
+	count = PyList_Size(value);
+	if (count > INJECT_BATCH_MAX) {
+		PyErr_Format(PyExc_ValueError, "Too many messages, at most %d can be injected at once", INJECT_BATCH_MAX);
+		return NULL;
+	}
+
+	smsin = (GSM_MultiSMSMessage *) malloc((count == 0 ? 1 : count) * sizeof(GSM_MultiSMSMessage));
+	if (smsin == NULL) {
+		return PyErr_NoMemory();
+	}
+	newids = (char **) calloc(count == 0 ? 1 : count, sizeof(char *));
+	if (newids == NULL) {
+		PyErr_NoMemory();
+		goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		item = PyList_GetItem(value, i);
+		if (!PyList_Check(item)) {
+			PyErr_Format(PyExc_ValueError, "Message %" PY_FORMAT_SIZE_T "d is not a list", i);
+			goto done;
+		}
+		if (!MultiSMSFromPython(item, &smsin[i]))
+			goto done;
+		newids[i] = (char *) malloc(200);
+		if (newids[i] == NULL) {
+			PyErr_NoMemory();
+			goto done;
+		}
+		newids[i][0] = 0;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	error = SMSD_InjectSMSBatch(self->config, smsin, count, newids);
+	Py_END_ALLOW_THREADS
+
+	if (!checkError(NULL, error, "SMSD_InjectSMSBatch"))
+		goto done;
+
+	result = PyList_New(count);
+	if (result == NULL)
+		goto done;
+
+	for (i = 0; i < count; i++) {
+		item = Py_BuildValue("s", newids[i]);
+		if (item == NULL) {
+			Py_DECREF(result);
+			result = NULL;
+			goto done;
+		}
+		PyList_SET_ITEM(result, i, item);
+	}
+
+done:
+	if (newids != NULL) {
+		for (i = 0; i < count; i++) {
+			free(newids[i]);
+		}
+		free(newids);
+	}
+	free(smsin);
+	return result;
+}
+
 static struct PyMethodDef SMSD_methods[] = {
 	{"MainLoop", (PyCFunction) Py_SMSD_MainLoop, METH_VARARGS | METH_KEYWORDS, SMSD_MainLoop__doc__},
 	{"Shutdown", (PyCFunction) Py_SMSD_Shutdown, METH_VARARGS | METH_KEYWORDS, SMSD_Shutdown__doc__},
 	{"GetStatus", (PyCFunction) Py_SMSD_GetStatus, METH_VARARGS | METH_KEYWORDS, SMSD_GetStatus__doc__},
 	{"InjectSMS", (PyCFunction) Py_SMSD_InjectSMS, METH_VARARGS | METH_KEYWORDS, SMSD_InjectSMS__doc__},
+	{"InjectSMSBatch", (PyCFunction) Py_SMSD_InjectSMSBatch, METH_VARARGS | METH_KEYWORDS, SMSD_InjectSMSBatch__doc__},
 
 	{NULL, NULL, 0, NULL}	/* sentinel */
 };
@@ -2,12 +2,15 @@
 /* Copyright (c) 2009 - 2012 Michal Cihar <michal@cihar.com> */
 
 #include <string.h>
+#include <stddef.h>
 #include <signal.h>
 #include <time.h>
 #include <assert.h>
 #ifndef WIN32
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <fcntl.h>
 #endif
 #include <gammu-config.h>
 #ifdef HAVE_SYSLOG
@@ -30,6 +33,7 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/sem.h>
 #include <sys/stat.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -100,9 +104,222 @@ GSM_Error SMSD_Shutdown(GSM_SMSDConfig *Config)
 		return ERR_NOTRUNNING;
 	}
 	Config->shutdown = TRUE;
+	SMSD_WakeUp(Config);
 	return ERR_NONE;
 }
 
+GSM_Error SMSD_WakeUp(GSM_SMSDConfig *Config)
+{
+	Config->wakeup = TRUE;
+#ifdef WIN32
+	if (Config->wakeup_event != NULL) {
+		SetEvent(Config->wakeup_event);
+	}
+#else
+	if (Config->wakeup_pipe[1] != -1) {
+		/* Pipe full means there is already pending wakeup */
+		if (write(Config->wakeup_pipe[1], "W", 1) != 1) {
+			return ERR_NONE;
+		}
+	}
+#endif
+	return ERR_NONE;
+}
+
+#ifdef SMSD_WAKEUP_SEMAPHORE
+/**
+ * Waits for other processes posting wakeup semaphore and wakes up main
+ * loop. Terminates once the semaphore is removed.
+ */
+static void *SMSD_WakeUpThread(void *data)
+{
+	GSM_SMSDConfig *Config = (GSM_SMSDConfig *)data;
+	struct sembuf wait_op = {0, -1, 0}, drain_op = {0, -1, IPC_NOWAIT};
+
+	while (TRUE) {
+		if (semop(Config->wakeup_sem, &wait_op, 1) != 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		/* Several posts need just one wakeup */
+		while (semop(Config->wakeup_sem, &drain_op, 1) == 0);
+		SMSD_WakeUp(Config);
+	}
+	return NULL;
+}
+
+/**
+ * Creates semaphore for other processes, failure only disables waking
+ * up from them.
+ */
+static void SMSD_InitWakeUpSemaphore(GSM_SMSDConfig *Config)
+{
+	sigset_t all, old;
+	int ret;
+
+	Config->wakeup_sem = semget(Config->shm_key, 1, IPC_CREAT | S_IRUSR | S_IWUSR);
+	if (Config->wakeup_sem == -1) {
+		SMSD_LogErrno(Config, "Can not create wakeup semaphore, injected messages will wait for next outbox check");
+		return;
+	}
+	/* Signals should be handled by main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	ret = pthread_create(&Config->wakeup_thread, NULL, SMSD_WakeUpThread, Config);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		SMSD_Log(DEBUG_ERROR, Config, "Can not start wakeup thread, injected messages will wait for next outbox check");
+		semctl(Config->wakeup_sem, 0, IPC_RMID);
+		Config->wakeup_sem = -1;
+	}
+}
+
+/**
+ * Removes semaphore, this terminates the thread, which might still
+ * write to wakeup pipe.
+ */
+static void SMSD_FreeWakeUpSemaphore(GSM_SMSDConfig *Config)
+{
+	if (Config->wakeup_sem == -1) {
+		return;
+	}
+	semctl(Config->wakeup_sem, 0, IPC_RMID);
+	pthread_join(Config->wakeup_thread, NULL);
+	Config->wakeup_sem = -1;
+}
+#endif
+
+/**
+ * Prepares main loop wakeup, which can be triggered by other process
+ * as well.
+ */
+static GSM_Error SMSD_InitWakeUp(GSM_SMSDConfig *Config)
+{
+#ifdef WIN32
+	char name[MAX_PATH + 30];
+
+	sprintf(name, "%s-wakeup", Config->map_key);
+	Config->wakeup_event = CreateEvent(NULL, FALSE, FALSE, name);
+	if (Config->wakeup_event == NULL) {
+		SMSD_LogErrno(Config, "Can not create wakeup event");
+		return ERR_UNKNOWN;
+	}
+#else
+	int i;
+
+	if (pipe(Config->wakeup_pipe) != 0) {
+		SMSD_LogErrno(Config, "Can not create wakeup pipe");
+		Config->wakeup_pipe[0] = -1;
+		Config->wakeup_pipe[1] = -1;
+		return ERR_UNKNOWN;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(Config->wakeup_pipe[i], F_SETFL, fcntl(Config->wakeup_pipe[i], F_GETFL) | O_NONBLOCK);
+	}
+#endif
+#ifdef SMSD_WAKEUP_SEMAPHORE
+	SMSD_InitWakeUpSemaphore(Config);
+#endif
+	return ERR_NONE;
+}
+
+static void SMSD_FreeWakeUpPipe(GSM_SMSDConfig *Config)
+{
+#ifdef WIN32
+	HANDLE event = Config->wakeup_event;
+
+	Config->wakeup_event = NULL;
+	if (event != NULL) {
+		CloseHandle(event);
+	}
+#else
+	int fds[2] = {Config->wakeup_pipe[0], Config->wakeup_pipe[1]};
+
+	/* Disable first, signal handler might be using it */
+	Config->wakeup_pipe[0] = -1;
+	Config->wakeup_pipe[1] = -1;
+	if (fds[0] != -1) {
+		close(fds[0]);
+		close(fds[1]);
+	}
+#endif
+}
+
+static void SMSD_FreeWakeUp(GSM_SMSDConfig *Config)
+{
+#ifdef SMSD_WAKEUP_SEMAPHORE
+	SMSD_FreeWakeUpSemaphore(Config);
+#endif
+	SMSD_FreeWakeUpPipe(Config);
+}
+
+/**
+ * Waits given number of miliseconds or until SMSD_WakeUp is called.
+ */
+static void SMSD_Wait(GSM_SMSDConfig *Config, unsigned long long msec)
+{
+#ifdef WIN32
+	if (Config->wakeup_event == NULL) {
+		Sleep(msec);
+		return;
+	}
+	WaitForSingleObject(Config->wakeup_event, msec);
+#else
+	fd_set readfds;
+	struct timeval timeout;
+	char buffer[32];
+	int fd = Config->wakeup_pipe[0];
+
+	if (fd == -1) {
+		sleep(msec / 1000);
+		usleep((msec % 1000) * 1000);
+		return;
+	}
+	FD_ZERO(&readfds);
+	FD_SET(fd, &readfds);
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = (msec % 1000) * 1000;
+	if (select(fd + 1, &readfds, NULL, NULL, &timeout) > 0) {
+		/* Drain all pending wakeups */
+		while (read(fd, buffer, sizeof(buffer)) > 0);
+	}
+#endif
+}
+
+/**
+ * Wakes up SMSD running in other process using same configuration.
+ */
+static void SMSD_WakeUpDaemon(GSM_SMSDConfig *Config)
+{
+#ifdef WIN32
+	char name[MAX_PATH + 30];
+	HANDLE event;
+
+	sprintf(name, "%s-wakeup", Config->map_key);
+	event = OpenEvent(EVENT_MODIFY_STATE, FALSE, name);
+	if (event != NULL) {
+		SetEvent(event);
+		CloseHandle(event);
+	}
+#elif defined(HAVE_SHM)
+	int handle;
+	struct sembuf post_op = {0, 1, IPC_NOWAIT};
+
+	/* Semaphore exists only while SMSD is running */
+	handle = semget(Config->shm_key, 1, 0);
+	if (handle == -1) {
+		return;
+	}
+	if (semop(handle, &post_op, 1) != 0) {
+		SMSD_LogErrno(Config, "Can not wake up SMSD");
+		return;
+	}
+	SMSD_Log(DEBUG_NOTICE, Config, "Woke up SMSD");
+#endif
+}
+
 /**
  * Callback from libGammu on sending message.
  */
@@ -244,23 +461,41 @@ GSM_Error SMSD_Init(GSM_SMSDConfig *Config) {
 }
 
 PRINTF_STYLE(3, 4)
-void SMSD_Log(SMSD_DebugLevel level, GSM_SMSDConfig *Config, const char *format, ...)
+void (SMSD_Log)(SMSD_DebugLevel level, GSM_SMSDConfig *Config, const char *format, ...)
 {
 	GSM_DateTime 	date_time;
-	char 		Buffer[65535];
+	char 		StaticBuffer[2048];
+	char		*Buffer = StaticBuffer;
 	va_list		argp;
+	int		length;
 #ifdef HAVE_SYSLOG
 	int priority;
 #endif
 
+	/* Filter before doing any formatting */
+	if (!SMSD_LogEnabled(level, Config)) {
+		return;
+	}
+	if (Config->log_type == SMSD_LOG_NONE &&
+			!(Config->use_stderr && level == DEBUG_ERROR)) {
+		return;
+	}
+
 	va_start(argp, format);
-	vsprintf(Buffer,format, argp);
+	length = vsnprintf(StaticBuffer, sizeof(StaticBuffer), format, argp);
 	va_end(argp);
+	StaticBuffer[sizeof(StaticBuffer) - 1] = 0;
 
-	if (level != DEBUG_ERROR &&
-			level != DEBUG_INFO &&
-			(level & Config->debug_level) == 0) {
-		return;
+	/* Allocate bigger buffer for long messages (eg. SQL queries) */
+	if (length >= (int)sizeof(StaticBuffer)) {
+		Buffer = (char *)malloc(length + 1);
+		if (Buffer == NULL) {
+			Buffer = StaticBuffer;
+		} else {
+			va_start(argp, format);
+			vsnprintf(Buffer, length + 1, format, argp);
+			va_end(argp);
+		}
 	}
 
 
@@ -318,6 +553,10 @@ void SMSD_Log(SMSD_DebugLevel level, GSM_SMSDConfig *Config, const char *format,
 #endif
 		fprintf(stderr, "%s\n", Buffer);
 	}
+
+	if (Buffer != StaticBuffer) {
+		free(Buffer);
+	}
 }
 
 /**
@@ -329,6 +568,11 @@ void SMSD_Log_Function(const char *text, void *data)
 	size_t pos;
 	size_t newsize;
 
+	/* Do not collect messages which would be thrown away */
+	if (!SMSD_LogEnabled(DEBUG_GAMMU, Config)) {
+		return;
+	}
+
 	/* Dump the buffer if we got \n */
 	if (strcmp("\n", text) == 0) {
 		SMSD_Log(DEBUG_GAMMU, Config, "gammu: %s", Config->gammu_log_buffer);
@@ -384,6 +628,18 @@ GSM_SMSDConfig *SMSD_NewConfig(const char *name)
 	Config->debug_level = 0;
 	Config->ServiceName = NULL;
 	Config->Service = NULL;
+	Config->writer = NULL;
+	Config->backend_journal = NULL;
+	Config->wakeup = FALSE;
+#ifdef WIN32
+	Config->wakeup_event = NULL;
+#else
+	Config->wakeup_pipe[0] = -1;
+	Config->wakeup_pipe[1] = -1;
+#endif
+#ifdef SMSD_WAKEUP_SEMAPHORE
+	Config->wakeup_sem = -1;
+#endif
 
 #if defined(HAVE_MYSQL_MYSQL_H)
 	Config->conn.my = NULL;
@@ -394,12 +650,18 @@ GSM_SMSDConfig *SMSD_NewConfig(const char *name)
 #if defined(HAVE_POSTGRESQL_LIBPQ_FE_H)
 	Config->conn.pg = NULL;
 #endif
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	Config->transaction = FALSE;
+#endif
 
 	/* Prepare lists */
 	GSM_StringArray_New(&(Config->IncludeNumbersList));
 	GSM_StringArray_New(&(Config->ExcludeNumbersList));
 	GSM_StringArray_New(&(Config->IncludeSMSCList));
 	GSM_StringArray_New(&(Config->ExcludeSMSCList));
+	GSM_StringArray_New(&(Config->inboxpending));
+	Config->inboxlastname[0] = 0;
+	Config->inboxlastserial = 0;
 
 	if (name == NULL) {
 		Config->program_name = smsd_name;
@@ -485,6 +747,7 @@ void SMSD_FreeConfig(GSM_SMSDConfig *Config)
 	GSM_StringArray_Free(&(Config->ExcludeNumbersList));
 	GSM_StringArray_Free(&(Config->IncludeSMSCList));
 	GSM_StringArray_Free(&(Config->ExcludeSMSCList));
+	GSM_StringArray_Free(&(Config->inboxpending));
 
 	free(Config->gammu_log_buffer);
 
@@ -642,6 +905,36 @@ GSM_Error SMSD_ConfigureLogging(GSM_SMSDConfig *Config, gboolean uselog)
 	return ERR_NONE;
 }
 
+/**
+ * Reads interval in seconds from configuration, fractions of second
+ * are allowed.
+ *
+ * \return Interval in miliseconds.
+ */
+static unsigned int SMSD_GetInterval(GSM_SMSDConfig *Config, const char *key, unsigned int fallback)
+{
+	const char *str;
+	char *end;
+	double value;
+
+	str = INI_GetValue(Config->smsdcfgfile, "smsd", key, FALSE);
+	if (str == NULL) {
+		return fallback * 1000;
+	}
+	value = strtod(str, &end);
+	/* Written this way to reject NaN as well */
+	if (end == str || !(value >= 0)) {
+		SMSD_Log(DEBUG_ERROR, Config, "Invalid value for %s: %s, using %u", key, str, fallback);
+		return fallback * 1000;
+	}
+	/* Bigger values would not fit in miliseconds */
+	if (value > UINT_MAX / 1000) {
+		SMSD_Log(DEBUG_ERROR, Config, "Too big value for %s: %s, using %u", key, str, UINT_MAX / 1000);
+		value = UINT_MAX / 1000;
+	}
+	return (unsigned int)(value * 1000 + 0.5);
+}
+
 /**
  * Reads configuration file and feeds it's content into SMSD configuration structure.
  */
@@ -757,6 +1050,9 @@ GSM_Error SMSD_ReadConfig(const char *filename, GSM_SMSDConfig *Config, gboolean
 	if ((DEBUG_GAMMU & Config->debug_level) != 0) {
 		strcpy(gammucfg->DebugLevel, "textall");
 		GSM_SetDebugLevel("textall", GSM_GetGlobalDebug());
+	} else {
+		/* Gammu log would be discarded anyway, so do not create it */
+		strcpy(gammucfg->DebugLevel, "nothing");
 	}
 
 	Config->PINCode=INI_GetValue(Config->smsdcfgfile, "smsd", "PIN", FALSE);
@@ -776,20 +1072,20 @@ GSM_Error SMSD_ReadConfig(const char *filename, GSM_SMSDConfig *Config, gboolean
 		SMSD_Log(DEBUG_NOTICE, Config, "Phone code is \"%s\"",Config->PhoneCode);
 	}
 
-	Config->commtimeout = INI_GetInt(Config->smsdcfgfile, "smsd", "commtimeout", 30);
+	Config->commtimeout = SMSD_GetInterval(Config, "commtimeout", 30);
 	Config->deliveryreportdelay = INI_GetInt(Config->smsdcfgfile, "smsd", "deliveryreportdelay", 600);
-	Config->sendtimeout = INI_GetInt(Config->smsdcfgfile, "smsd", "sendtimeout", 30);
-	Config->receivefrequency = INI_GetInt(Config->smsdcfgfile, "smsd", "receivefrequency", 0);
-	Config->statusfrequency = INI_GetInt(Config->smsdcfgfile, "smsd", "statusfrequency", 15);
-	Config->loopsleep = INI_GetInt(Config->smsdcfgfile, "smsd", "loopsleep", 1);
+	Config->sendtimeout = SMSD_GetInterval(Config, "sendtimeout", 30);
+	Config->receivefrequency = SMSD_GetInterval(Config, "receivefrequency", 0);
+	Config->statusfrequency = SMSD_GetInterval(Config, "statusfrequency", 15);
+	Config->loopsleep = SMSD_GetInterval(Config, "loopsleep", 1);
 	Config->checksecurity = INI_GetBool(Config->smsdcfgfile, "smsd", "checksecurity", TRUE);
 	Config->hangupcalls = INI_GetBool(Config->smsdcfgfile, "smsd", "hangupcalls", FALSE);
 	Config->checksignal = INI_GetBool(Config->smsdcfgfile, "smsd", "checksignal", TRUE);
 	Config->checkbattery = INI_GetBool(Config->smsdcfgfile, "smsd", "checkbattery", TRUE);
 	Config->enable_send = INI_GetBool(Config->smsdcfgfile, "smsd", "send", TRUE);
 	Config->enable_receive = INI_GetBool(Config->smsdcfgfile, "smsd", "receive", TRUE);
-	Config->resetfrequency = INI_GetInt(Config->smsdcfgfile, "smsd", "resetfrequency", 0);
-	Config->hardresetfrequency = INI_GetInt(Config->smsdcfgfile, "smsd", "hardresetfrequency", 0);
+	Config->resetfrequency = SMSD_GetInterval(Config, "resetfrequency", 0);
+	Config->hardresetfrequency = SMSD_GetInterval(Config, "hardresetfrequency", 0);
 	Config->multiparttimeout = INI_GetInt(Config->smsdcfgfile, "smsd", "multiparttimeout", 600);
 	Config->maxretries = INI_GetInt(Config->smsdcfgfile, "smsd", "maxretries", 1);
 	Config->backend_retries = INI_GetInt(Config->smsdcfgfile, "smsd", "backendretries", 10);
@@ -797,9 +1093,12 @@ GSM_Error SMSD_ReadConfig(const char *filename, GSM_SMSDConfig *Config, gboolean
 		SMSD_Log(DEBUG_NOTICE, Config, "BackendRetries too low, forcing to 1");
 		Config->backend_retries = 1;
 	}
+	Config->backend_journal = INI_GetValue(Config->smsdcfgfile, "smsd", "backendjournal", FALSE);
+	Config->backend_queue_size = INI_GetInt(Config->smsdcfgfile, "smsd", "backendqueuesize", 64);
 
-	SMSD_Log(DEBUG_NOTICE, Config, "CommTimeout=%i, SendTimeout=%i, ReceiveFrequency=%i, ResetFrequency=%i, HardResetFrequency=%i",
-			Config->commtimeout, Config->sendtimeout, Config->receivefrequency, Config->resetfrequency, Config->hardresetfrequency);
+	SMSD_Log(DEBUG_NOTICE, Config, "CommTimeout=%.3f, SendTimeout=%.3f, ReceiveFrequency=%.3f, ResetFrequency=%.3f, HardResetFrequency=%.3f",
+			Config->commtimeout / 1000.0, Config->sendtimeout / 1000.0, Config->receivefrequency / 1000.0,
+			Config->resetfrequency / 1000.0, Config->hardresetfrequency / 1000.0);
 	SMSD_Log(DEBUG_NOTICE, Config, "checks: CheckSecurity=%d, CheckBattery=%d, CheckSignal=%d",
 			Config->checksecurity, Config->checkbattery, Config->checksignal);
 	SMSD_Log(DEBUG_NOTICE, Config, "mode: Send=%d, Receive=%d",
@@ -1275,11 +1574,11 @@ GSM_Error SMSD_ProcessSMS(GSM_SMSDConfig *Config, GSM_MultiSMSMessage *sms)
 	char *locations = NULL;
 
 	/* Increase message counter */
-	Config->Status->Received += sms->Number;
+	SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PARTS_RECEIVED, sms->Number);
 	/* Send message to the backend */
 	error = Config->Service->SaveInboxSMS(sms, Config, &locations);
-	/* RunOnReceive handling */
-	if (Config->RunOnReceive != NULL && error == ERR_NONE) {
+	/* RunOnReceive handling, asynchronous writer runs it once message is stored */
+	if (Config->RunOnReceive != NULL && error == ERR_NONE && Config->writer == NULL) {
 		SMSD_RunOn(Config->RunOnReceive, sms, Config, locations);
 	}
 	/* Free memory allocated by SaveInboxSMS */
@@ -1358,6 +1657,40 @@ success:
 	return TRUE;
 }
 
+/**
+ * Allocates copy of message which holds only its used parts.
+ *
+ * Parts after SMS->Number are not allocated, so the copy is used only
+ * as input for GSM_LinkSMS and for deleting messages from phone, which
+ * read just the used parts.
+ */
+static GSM_MultiSMSMessage *SMSD_CompactMultiSMS(const GSM_MultiSMSMessage *SMS)
+{
+	GSM_MultiSMSMessage *result;
+	size_t size = offsetof(GSM_MultiSMSMessage, SMS) + SMS->Number * sizeof(GSM_SMSMessage);
+
+	result = (GSM_MultiSMSMessage *)malloc(size);
+	if (result == NULL) return NULL;
+	memcpy(result, SMS, size);
+	return result;
+}
+
+/**
+ * Frees NULL terminated list of messages and the list itself.
+ */
+static void SMSD_FreeMultiSMSList(GSM_MultiSMSMessage **list)
+{
+	int i;
+
+	if (list == NULL) {
+		return;
+	}
+	for (i = 0; list[i] != NULL; i++) {
+		free(list[i]);
+	}
+	free(list);
+}
+
 /**
  * Reads message from phone, processes it and delete it from phone afterwards.
  *
@@ -1367,13 +1700,16 @@ gboolean SMSD_ReadDeleteSMS(GSM_SMSDConfig *Config)
 {
 	gboolean start;
 	GSM_MultiSMSMessage sms;
-	GSM_MultiSMSMessage **GetSMSData = NULL, **SortedSMS;
+	GSM_MultiSMSMessage **GetSMSData = NULL, **SortedSMS, **grown, *compact;
 	int allocated = 0;
 	GSM_Error error = ERR_NONE;
 	int GetSMSNumber = 0;
-	int i, j;
+	int i, j, processed;
+	gboolean result;
+	unsigned long long read_time;
 
 	/* Read messages from phone */
+	read_time = SMSD_MonotonicTime();
 	start=TRUE;
 	sms.Number = 0;
 	sms.SMS[0].Location = 0;
@@ -1386,39 +1722,31 @@ gboolean SMSD_ReadDeleteSMS(GSM_SMSDConfig *Config)
 			case ERR_NONE:
 				if (SMSD_ValidMessage(Config, &sms)) {
 					if (allocated <= GetSMSNumber + 2) {
-						GetSMSData = (GSM_MultiSMSMessage **)realloc(GetSMSData, (allocated + 20) * sizeof(GSM_MultiSMSMessage *));
-						if (GetSMSData == NULL) {
+						grown = (GSM_MultiSMSMessage **)realloc(GetSMSData, (allocated + 20) * sizeof(GSM_MultiSMSMessage *));
+						if (grown == NULL) {
 							SMSD_Log(DEBUG_ERROR, Config, "Failed to allocate memory");
+							SMSD_FreeMultiSMSList(GetSMSData);
 							return FALSE;
 						}
+						GetSMSData = grown;
 						allocated += 20;
 					}
-					GetSMSData[GetSMSNumber] = malloc(sizeof(GSM_MultiSMSMessage));
+					/* Store only used parts of the message until linked */
+					GetSMSData[GetSMSNumber] = SMSD_CompactMultiSMS(&sms);
 
 					if (GetSMSData[GetSMSNumber] == NULL) {
 						SMSD_Log(DEBUG_ERROR, Config, "Failed to allocate memory");
-						for (i = 0; GetSMSData[i] != NULL; i++) {
-							free(GetSMSData[i]);
-							GetSMSData[i] = NULL;
-						}
-						free(GetSMSData);
+						SMSD_FreeMultiSMSList(GetSMSData);
 						return FALSE;
 					}
 
-					*(GetSMSData[GetSMSNumber]) = sms;
 					GetSMSNumber++;
 					GetSMSData[GetSMSNumber] = NULL;
 				}
 				break;
 			default:
 				SMSD_LogError(DEBUG_INFO, Config, "Error getting SMS", error);
-				if (GetSMSData != NULL) {
-					for (i = 0; GetSMSData[i] != NULL; i++) {
-						free(GetSMSData[i]);
-						GetSMSData[i] = NULL;
-					}
-					free(GetSMSData);
-				}
+				SMSD_FreeMultiSMSList(GetSMSData);
 				return FALSE;
 		}
 		start = FALSE;
@@ -1436,37 +1764,63 @@ gboolean SMSD_ReadDeleteSMS(GSM_SMSDConfig *Config)
 	SortedSMS = (GSM_MultiSMSMessage **)malloc(allocated * sizeof(GSM_MultiSMSMessage *));
 	if (SortedSMS == NULL) {
 		SMSD_Log(DEBUG_ERROR, Config, "Failed to allocate memory for linking messages");
-		SMSD_Log(DEBUG_ERROR, Config, "Skipping linking messages, long messages will not be connected");
-		SortedSMS = GetSMSData;
-	} else {
-		/* Link messages */
-		error = GSM_LinkSMS(GSM_GetDebug(Config->gsm), GetSMSData, SortedSMS, TRUE);
-		if (error != ERR_NONE) return FALSE;
-
-		/* Free memory */
-		for (i = 0; GetSMSData[i] != NULL; i++) {
-			free(GetSMSData[i]);
-			GetSMSData[i] = NULL;
-		}
-		free(GetSMSData);
+		SMSD_FreeMultiSMSList(GetSMSData);
+		return FALSE;
+	}
+	SortedSMS[0] = NULL;
+
+	/* Link messages, linked ones are allocated in full size for backends */
+	error = GSM_LinkSMS(GSM_GetDebug(Config->gsm), GetSMSData, SortedSMS, TRUE);
+	SMSD_FreeMultiSMSList(GetSMSData);
+	if (error != ERR_NONE) {
+		SMSD_LogError(DEBUG_ERROR, Config, "Error linking messages", error);
+		SMSD_FreeMultiSMSList(SortedSMS);
+		return FALSE;
 	}
 
 	/* Process messages */
+	processed = 0;
+	result = TRUE;
 	for (i = 0; SortedSMS[i] != NULL; i++) {
 		/* Check multipart message parts */
 		if (!SMSD_CheckMultipart(Config, SortedSMS[i])) {
-			goto cleanup;
+			free(SortedSMS[i]);
+			continue;
 		}
 
 		/* Actually process the message */
 		error = SMSD_ProcessSMS(Config, SortedSMS[i]);
 		if (error != ERR_NONE) {
 			SMSD_LogError(DEBUG_INFO, Config, "Error processing SMS", error);
-			return FALSE;
+			for (j = i; SortedSMS[j] != NULL; j++) {
+				free(SortedSMS[j]);
+			}
+			result = FALSE;
+			break;
+		}
+		SMSD_MetricsObserve(Config->Status, SMSD_HISTOGRAM_RECEIVE_STORE, SMSD_MonotonicTime() - read_time);
+
+		/* Keep only used parts for deleting after commit */
+		compact = SMSD_CompactMultiSMS(SortedSMS[i]);
+		if (compact != NULL) {
+			free(SortedSMS[i]);
+			SortedSMS[i] = compact;
 		}
+		SortedSMS[processed++] = SortedSMS[i];
+	}
 
-		/* Delete processed messages */
-		for (j = 0; j < SortedSMS[i]->Number; j++) {
+	/* Make stored messages durable before deleting them from phone */
+	if (processed > 0) {
+		error = Config->Service->CommitInbox(Config);
+		if (error != ERR_NONE) {
+			SMSD_LogError(DEBUG_ERROR, Config, "Error committing received messages", error);
+			result = FALSE;
+		}
+	}
+
+	/* Delete processed messages */
+	for (i = 0; i < processed; i++) {
+		for (j = 0; result && j < SortedSMS[i]->Number; j++) {
 			SortedSMS[i]->SMS[j].Folder = 0;
 			error = GSM_DeleteSMS(Config->gsm, &SortedSMS[i]->SMS[j]);
 			switch (error) {
@@ -1475,16 +1829,13 @@ gboolean SMSD_ReadDeleteSMS(GSM_SMSDConfig *Config)
 					break;
 				default:
 					SMSD_LogError(DEBUG_INFO, Config, "Error deleting SMS", error);
-					return FALSE;
+					result = FALSE;
 			}
 		}
-
-cleanup:
 		free(SortedSMS[i]);
-		SortedSMS[i] = NULL;
 	}
 	free(SortedSMS);
-	return TRUE;
+	return result;
 }
 
 /**
@@ -1504,6 +1855,7 @@ gboolean SMSD_CheckSMSStatus(GSM_SMSDConfig *Config)
 	error = GSM_GetSMSStatus(Config->gsm,&SMSStatus);
 	if (error == ERR_NONE) {
 		new_message = (SMSStatus.SIMUsed + SMSStatus.PhoneUsed > 0);
+		SMSD_MetricsSetInboxQueue(Config->Status, SMSStatus.SIMUsed + SMSStatus.PhoneUsed);
 	} else if (error == ERR_NOTSUPPORTED || error == ERR_NOTIMPLEMENTED) {
 		/* Fallback to GetNext */
 		sms.Number = 0;
@@ -1529,23 +1881,27 @@ gboolean SMSD_CheckSMSStatus(GSM_SMSDConfig *Config)
  */
 void SMSD_PhoneStatus(GSM_SMSDConfig *Config) {
 	GSM_Error error;
+	GSM_BatteryCharge charge;
+	GSM_SignalQuality network;
 
+	/* Phone is read outside of status update */
 	if (Config->checkbattery) {
-		error = GSM_GetBatteryCharge(Config->gsm, &Config->Status->Charge);
+		error = GSM_GetBatteryCharge(Config->gsm, &charge);
 	} else {
 		error = ERR_UNKNOWN;
 	}
 	if (error != ERR_NONE) {
-		memset(&(Config->Status->Charge), 0, sizeof(Config->Status->Charge));
+		memset(&charge, 0, sizeof(charge));
 	}
 	if (Config->checksignal) {
-		error = GSM_GetSignalQuality(Config->gsm, &Config->Status->Network);
+		error = GSM_GetSignalQuality(Config->gsm, &network);
 	} else {
 		error = ERR_UNKNOWN;
 	}
 	if (error != ERR_NONE) {
-		memset(&(Config->Status->Network), 0, sizeof(Config->Status->Network));
+		memset(&network, 0, sizeof(network));
 	}
+	SMSD_MetricsSetPhoneStatus(Config->Status, &charge, &network);
 }
 
 /**
@@ -1554,10 +1910,9 @@ void SMSD_PhoneStatus(GSM_SMSDConfig *Config) {
 GSM_Error SMSD_SendSMS(GSM_SMSDConfig *Config)
 {
 	GSM_MultiSMSMessage  	sms;
-	GSM_DateTime         	Date;
 	GSM_Error            	error;
-	unsigned int         	j;
-	int			i, z;
+	int			i;
+	unsigned long long	send_time, refresh_time, now;
 
 	/* Clean structure before use */
 	for (i = 0; i < GSM_MAX_MULTI_SMS; i++) {
@@ -1570,11 +1925,15 @@ GSM_Error SMSD_SendSMS(GSM_SMSDConfig *Config)
 		/* No outbox sms */
 		return error;
 	}
+	if (error == ERR_BUSY) {
+		/* Backend has pending writes, try again in next loop */
+		return error;
+	}
 	if (error != ERR_NONE) {
 		/* Unknown error - escape */
 		SMSD_Log(DEBUG_INFO, Config, "Error in outbox on '%s'", Config->SMSID);
 		for (i = 0; i < sms.Number; i++) {
-			Config->Status->Failed++;
+			SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PARTS_FAILED, 1);
 			Config->Service->AddSentSMSInfo(&sms, Config, Config->SMSID, i+1, SMSD_SEND_ERROR, -1);
 		}
 		Config->Service->MoveSMS(&sms,Config, Config->SMSID, TRUE,FALSE);
@@ -1588,12 +1947,13 @@ GSM_Error SMSD_SendSMS(GSM_SMSDConfig *Config)
 	if (Config->SMSID[0] != 0 && strcmp(Config->prevSMSID, Config->SMSID) == 0) {
 		SMSD_Log(DEBUG_NOTICE, Config, "Same message as previous one: %s", Config->SMSID);
 		Config->retries++;
+		SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_SEND_RETRIES, 1);
 		if (Config->retries > Config->maxretries) {
 			Config->retries = 0;
 			strcpy(Config->prevSMSID, "");
 			SMSD_Log(DEBUG_INFO, Config, "Moved to errorbox: %s", Config->SMSID);
 			for (i=0;i<sms.Number;i++) {
-				Config->Status->Failed++;
+				SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PARTS_FAILED, 1);
 				Config->Service->AddSentSMSInfo(&sms, Config, Config->SMSID, i+1, SMSD_SEND_ERROR, -1);
 			}
 			Config->Service->MoveSMS(&sms,Config, Config->SMSID, TRUE,FALSE);
@@ -1647,40 +2007,36 @@ GSM_Error SMSD_SendSMS(GSM_SMSDConfig *Config)
 		SMSD_PhoneStatus(Config);
 		Config->TPMR = -1;
 		Config->SendingSMSStatus = ERR_TIMEOUT;
+		send_time = SMSD_MonotonicTime();
 		error = GSM_SendSMS(Config->gsm, &sms.SMS[i]);
 		if (error != ERR_NONE) {
 			SMSD_LogError(DEBUG_INFO, Config, "Error sending SMS", error);
 			Config->TPMR = -1;
 			goto failure_unsent;
 		}
-		j    = 0;
+		refresh_time = send_time;
 		while (!Config->shutdown) {
-			/* Update timestamp for SMS in backend */
-			Config->Service->RefreshSendStatus(Config, Config->SMSID);
-
-			GSM_GetCurrentDateTime(&Date);
-			z = Date.Second;
-			while (z == Date.Second) {
-				usleep(10000);
-				GSM_GetCurrentDateTime(&Date);
-				GSM_ReadDevice(Config->gsm, TRUE);
-				if (Config->SendingSMSStatus != ERR_TIMEOUT) {
-					break;
-				}
+			now = SMSD_MonotonicTime();
+			if (now >= refresh_time) {
+				/* Update timestamp for SMS in backend every second */
+				Config->Service->RefreshSendStatus(Config, Config->SMSID);
+				refresh_time = now + 1000;
 			}
+			GSM_ReadDevice(Config->gsm, TRUE);
 			if (Config->SendingSMSStatus != ERR_TIMEOUT) {
 				break;
 			}
-			j++;
-			if (j > Config->sendtimeout) {
+			if (now - send_time > Config->sendtimeout) {
 				break;
 			}
+			usleep(10000);
 		}
+		SMSD_MetricsObserve(Config->Status, SMSD_HISTOGRAM_PHONE_SEND, SMSD_MonotonicTime() - send_time);
 		if (Config->SendingSMSStatus != ERR_NONE) {
 			SMSD_LogError(DEBUG_INFO, Config, "Error getting send status of message", Config->SendingSMSStatus);
 			goto failure_unsent;
 		}
-		Config->Status->Sent++;
+		SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PARTS_SENT, 1);
 		error = Config->Service->AddSentSMSInfo(&sms, Config, Config->SMSID, i+1, SMSD_SEND_OK, Config->TPMR);
 		if (error != ERR_NONE) {
 			goto failure_sent;
@@ -1697,7 +2053,7 @@ failure_unsent:
 	if (Config->RunOnFailure != NULL) {
 		SMSD_RunOn(Config->RunOnFailure, NULL, Config, Config->SMSID);
 	}
-	Config->Status->Failed++;
+	SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PARTS_FAILED, 1);
 	Config->Service->AddSentSMSInfo(&sms, Config, Config->SMSID, i + 1, SMSD_SEND_SENDING_ERROR, Config->TPMR);
 	Config->Service->MoveSMS(&sms,Config, Config->SMSID, TRUE, FALSE);
 	return ERR_UNKNOWN;
@@ -1787,6 +2143,7 @@ GSM_Error SMSD_InitSharedMemory(GSM_SMSDConfig *Config, gboolean writable)
 		Config->Status->Failed = 0;
 		Config->Status->Sent = 0;
 		Config->Status->IMEI[0] = 0;
+		SMSD_MetricsInit(Config->Status);
 	}
 	return ERR_NONE;
 }
@@ -1842,6 +2199,88 @@ void SMSD_IncomingCallCallback(GSM_StateMachine *s, GSM_Call *call, void *user_d
 		SMSD_Log(DEBUG_INFO, Config, "Call callback: Unknown status %d\n", call->Status);
 	}
 }
+/**
+ * Timers driving the main loop.
+ */
+typedef enum {
+	SMSD_TIMER_RECEIVE = 0,
+	SMSD_TIMER_SEND,
+	SMSD_TIMER_STATUS,
+	SMSD_TIMER_RESET,
+	SMSD_TIMER_HARDRESET,
+	SMSD_TIMER_LAST
+} SMSD_Timer;
+
+/**
+ * Expiration of timer which is not running.
+ */
+#define SMSD_TIMER_NEVER (~0ULL)
+
+typedef struct {
+	/**
+	 * Monotonic time in miliseconds when timers expire.
+	 */
+	unsigned long long Due[SMSD_TIMER_LAST];
+} SMSD_Timers;
+
+/**
+ * Sets timer to expire after interval in miliseconds.
+ */
+static void SMSD_TimerStart(SMSD_Timers *timers, SMSD_Timer timer, unsigned int interval)
+{
+	timers->Due[timer] = SMSD_MonotonicTime() + interval;
+}
+
+static gboolean SMSD_TimerExpired(SMSD_Timers *timers, SMSD_Timer timer)
+{
+	return timers->Due[timer] <= SMSD_MonotonicTime();
+}
+
+/**
+ * Prepares timers for enabled activities, receiving, sending and
+ * status refresh happen immediately.
+ */
+static void SMSD_TimersInit(GSM_SMSDConfig *Config, SMSD_Timers *timers)
+{
+	timers->Due[SMSD_TIMER_RECEIVE] = Config->enable_receive ? 0 : SMSD_TIMER_NEVER;
+	timers->Due[SMSD_TIMER_SEND] = Config->enable_send ? 0 : SMSD_TIMER_NEVER;
+	timers->Due[SMSD_TIMER_STATUS] = Config->statusfrequency > 0 ? 0 : SMSD_TIMER_NEVER;
+	timers->Due[SMSD_TIMER_RESET] = SMSD_TIMER_NEVER;
+	if (Config->resetfrequency > 0) {
+		SMSD_TimerStart(timers, SMSD_TIMER_RESET, Config->resetfrequency);
+	}
+	timers->Due[SMSD_TIMER_HARDRESET] = SMSD_TIMER_NEVER;
+	if (Config->hardresetfrequency > 0) {
+		SMSD_TimerStart(timers, SMSD_TIMER_HARDRESET, Config->hardresetfrequency);
+	}
+}
+
+/**
+ * Sleeps until first timer expires or until SMSD is woken up, in which
+ * case outbox is checked immediately.
+ */
+static void SMSD_WaitForTimers(GSM_SMSDConfig *Config, SMSD_Timers *timers)
+{
+	unsigned long long next = SMSD_TIMER_NEVER, now;
+	int i;
+
+	for (i = 0; i < SMSD_TIMER_LAST; i++) {
+		if (timers->Due[i] < next) {
+			next = timers->Due[i];
+		}
+	}
+	now = SMSD_MonotonicTime();
+	if (next > now && !Config->wakeup && !Config->shutdown) {
+		SMSD_Wait(Config, next - now);
+	}
+	if (Config->wakeup) {
+		Config->wakeup = FALSE;
+		if (Config->enable_send) {
+			timers->Due[SMSD_TIMER_SEND] = 0;
+		}
+	}
+}
+
 /**
  * Main loop which takes care of connection to phone and processing of
  * messages.
@@ -1850,9 +2289,8 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 {
 	GSM_Error		error;
 	int                     errors = -1, initerrors=0;
- 	time_t			lastreceive = 0, lastreset = time(NULL), lasthardreset = time(NULL), lastnothingsent = 0, laststatus = 0;
-	time_t			lastloop = 0, current_time;
-	int i;
+	SMSD_Timers		timers;
+	unsigned long long	wait_start;
 	gboolean first_start = TRUE, force_reset = FALSE, force_hard_reset = FALSE;
 
 	Config->failure = ERR_NONE;
@@ -1871,12 +2309,27 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 		goto done;
 	}
 
+	/* Start writing to service in background */
+	error = SMSD_WriterStart(Config);
+	if (error != ERR_NONE) {
+		SMSD_Terminate(Config, "Failed to start backend writer, stopping Gammu smsd", error, TRUE, -1);
+		goto done_connected;
+	}
+
+	/* Prepare for wakeups from signals and other processes */
+	error = SMSD_InitWakeUp(Config);
+	if (error != ERR_NONE) {
+		SMSD_Terminate(Config, "Failed to prepare wakeup, stopping Gammu smsd", error, TRUE, -1);
+		goto done_connected;
+	}
+
 	Config->running = TRUE;
 
 	Config->SendingSMSStatus = ERR_NONE;
 
+	SMSD_TimersInit(Config, &timers);
+
 	while (!Config->shutdown) {
-		lastloop = time(NULL);
 		/* There were errors in communication - try to recover */
 		if (errors > 2 || first_start || force_reset || force_hard_reset) {
 			/* Should we disconnect from phone? */
@@ -1896,10 +2349,9 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 			if (initerrors++ > 3) {
 				SMSD_Log(DEBUG_INFO, Config, "Going to 30 seconds sleep because of too much connection errors");
 
-				for (i = 0; i < 60; i++) {
-					if (Config->shutdown)
-						break;
-					usleep(500000);
+				wait_start = SMSD_MonotonicTime();
+				while (!Config->shutdown && SMSD_MonotonicTime() - wait_start < 30000) {
+					SMSD_Wait(Config, 30000 - (SMSD_MonotonicTime() - wait_start));
 				}
 			}
 			SMSD_Log(DEBUG_INFO, Config, "Starting phone communication...");
@@ -1910,6 +2362,7 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 			}
 			switch (error) {
 			case ERR_NONE:
+				SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_PHONE_CONNECTS, 1);
 				if (Config->checksecurity && !SMSD_CheckSecurity(Config)) {
 					errors++;
 					initerrors++;
@@ -1947,14 +2400,18 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 				if (initerrors > 3 || force_reset ) {
 					error = GSM_Reset(Config->gsm, FALSE); /* soft reset */
 					SMSD_LogError(DEBUG_INFO, Config, "Soft reset return code", error);
-					lastreset = time(NULL);
+					if (Config->resetfrequency > 0) {
+						SMSD_TimerStart(&timers, SMSD_TIMER_RESET, Config->resetfrequency);
+					}
 					sleep(5);
 					force_reset = FALSE;
 				}
 				if (force_hard_reset) {
 					error = GSM_Reset(Config->gsm, TRUE); /* hard reset */
 					SMSD_LogError(DEBUG_INFO, Config, "Hard reset return code", error);
-					lasthardreset = time(NULL);
+					if (Config->hardresetfrequency > 0) {
+						SMSD_TimerStart(&timers, SMSD_TIMER_HARDRESET, Config->hardresetfrequency);
+					}
 					sleep(5);
 					force_hard_reset = FALSE;
 				}
@@ -1972,8 +2429,8 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 		}
 
 		/* Should we receive? */
-		if (Config->enable_receive && ((difftime(time(NULL), lastreceive) >= Config->receivefrequency) || (Config->SendingSMSStatus != ERR_NONE))) {
-	 		lastreceive = time(NULL);
+		if (Config->enable_receive && (SMSD_TimerExpired(&timers, SMSD_TIMER_RECEIVE) || (Config->SendingSMSStatus != ERR_NONE))) {
+			SMSD_TimerStart(&timers, SMSD_TIMER_RECEIVE, Config->receivefrequency > 0 ? Config->receivefrequency : Config->loopsleep);
 
 			/* Do we need to check security? */
 			if (Config->checksecurity) {
@@ -2000,41 +2457,36 @@ GSM_Error SMSD_MainLoop(GSM_SMSDConfig *Config, gboolean exit_on_failure, int ma
 
 
 		/* time for preventive reset */
-		current_time = time(NULL);
-		if (Config->resetfrequency > 0 && difftime(current_time, lastreset) >= Config->resetfrequency) {
+		if (SMSD_TimerExpired(&timers, SMSD_TIMER_RESET)) {
 			force_reset = TRUE;
 			continue;
 		}
-		if (Config->hardresetfrequency > 0 && difftime(current_time, lasthardreset) >= Config->hardresetfrequency) {
+		if (SMSD_TimerExpired(&timers, SMSD_TIMER_HARDRESET)) {
 			force_hard_reset = TRUE;
 			continue;
 		}
 
 		/* Send any queued messages */
-		current_time = time(NULL);
-		if (Config->enable_send && (difftime(current_time, lastnothingsent) >= Config->commtimeout)) {
+		if (SMSD_TimerExpired(&timers, SMSD_TIMER_SEND)) {
 			error = SMSD_SendSMS(Config);
 			if (error == ERR_EMPTY) {
-				lastnothingsent = current_time;
+				/* Check again after timeout or when woken up */
+				SMSD_TimerStart(&timers, SMSD_TIMER_SEND, Config->commtimeout);
+			} else if (error != ERR_NONE) {
+				/* Errors are handled in SMSD_SendSMS, just do not retry immediately */
+				SMSD_TimerStart(&timers, SMSD_TIMER_SEND, Config->loopsleep);
 			}
-			/* We don't care about other errors here, they are handled in SMSD_SendSMS */
 		}
 
 		/* Refresh phone status in shared memory and in service */
-		current_time = time(NULL);
-		if ((Config->statusfrequency > 0) && (difftime(current_time, laststatus) >= Config->statusfrequency)) {
+		if (SMSD_TimerExpired(&timers, SMSD_TIMER_STATUS)) {
 			SMSD_PhoneStatus(Config);
-			laststatus = current_time;
+			SMSD_TimerStart(&timers, SMSD_TIMER_STATUS, Config->statusfrequency);
 			Config->Service->RefreshPhoneStatus(Config);
 		}
 
-		/* Sleep some time before another loop */
-		current_time = time(NULL);
-		if (Config->loopsleep == 1) {
-			sleep(1);
-		} else if (difftime(current_time, lastloop) < Config->loopsleep) {
-			sleep(Config->loopsleep - difftime(current_time, lastloop));
-		}
+		/* Sleep until there is something to do */
+		SMSD_WaitForTimers(Config, &timers);
 	}
 	Config->Service->Free(Config);
 
@@ -2047,6 +2499,7 @@ done_connected:
 
 	GSM_SetFastSMSSending(Config->gsm,FALSE);
 done:
+	SMSD_FreeWakeUp(Config);
 	SMSD_Terminate(Config, "Stopping Gammu smsd", ERR_NONE, FALSE, 0);
 	return Config->failure;
 }
@@ -2066,6 +2519,36 @@ GSM_Error SMSD_InjectSMS(GSM_SMSDConfig		*Config, GSM_MultiSMSMessage *sms, char
 
 	/* Store message in outbox */
 	error = Config->Service->CreateOutboxSMS(sms, Config, NewID);
+	if (error == ERR_NONE) {
+		/* Let running daemon send it right now */
+		SMSD_WakeUpDaemon(Config);
+	}
+	return error;
+}
+
+/**
+ * Function to inject several messages to service backend at once.
+ */
+GSM_Error SMSD_InjectSMSBatch(GSM_SMSDConfig *Config, GSM_MultiSMSMessage *sms, int count, char **NewIDs)
+{
+	GSM_Error error;
+
+	if (count <= 0) {
+		return ERR_NONE;
+	}
+
+	/* Initialize service */
+	error = SMSD_Init(Config);
+	if (error != ERR_NONE) {
+		return error;
+	}
+
+	/* Store messages in outbox */
+	error = Config->Service->CreateOutboxSMSBatch(sms, count, Config, NewIDs);
+	if (error == ERR_NONE) {
+		/* Let running daemon send them right now */
+		SMSD_WakeUpDaemon(Config);
+	}
 	return error;
 }
 
@@ -2078,8 +2561,7 @@ GSM_Error SMSD_GetStatus(GSM_SMSDConfig *Config, GSM_SMSDStatus *status)
 	GSM_Error error;
 	/* Check for local instance */
 	if (Config->running) {
-		memcpy(status, Config->Status, sizeof(GSM_SMSDStatus));
-		return ERR_NONE;
+		return SMSD_CopyStatus(status, Config->Status);
 	}
 
 	/* Init shared memory */
@@ -2089,14 +2571,13 @@ GSM_Error SMSD_GetStatus(GSM_SMSDConfig *Config, GSM_SMSDStatus *status)
 	}
 
 	/* Copy data from shared memory */
-	memcpy(status, Config->Status, sizeof(GSM_SMSDStatus));
+	error = SMSD_CopyStatus(status, Config->Status);
 
 	/* Free shared memory */
-	error = SMSD_FreeSharedMemory(Config, FALSE);
-	if (error != ERR_NONE) {
-		return error;
+	if (SMSD_FreeSharedMemory(Config, FALSE) != ERR_NONE) {
+		return ERR_UNKNOWN;
 	}
-	return ERR_NONE;
+	return error;
 }
 
 GSM_Error SMSD_NoneFunction(void)
@@ -10,16 +10,25 @@
 #ifdef HAVE_SHM
 #include <sys/types.h>
 #endif
+#if defined(HAVE_SHM) && defined(HAVE_PTHREAD)
+#include <pthread.h>
+/**
+ * Other processes can wake up main loop through semaphore.
+ */
+#define SMSD_WAKEUP_SEMAPHORE
+#endif
 /* definition of dbobject */
 #if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
 #include "services/sql-core.h"
 #endif
 
 #define SMSD_SHM_KEY (0xface)
-#define SMSD_SHM_VERSION (1)
+#define SMSD_SHM_VERSION (2)
 #define SMSD_DB_VERSION (14)
 
 #include "log.h"
+#include "metrics.h"
+#include "writer.h"
 
 #include "../helper/array.h"
 
@@ -67,14 +76,40 @@ typedef struct {
 	 * Reads configuration specific for this backend.
 	 */
 	GSM_Error	(*ReadConfiguration) (GSM_SMSDConfig *Config);
+	/**
+	 * Makes messages saved by SaveInboxSMS durable, it is called
+	 * once per received batch before messages are deleted from
+	 * phone.
+	 */
+	GSM_Error	(*CommitInbox)        (GSM_SMSDConfig *Config);
+	/**
+	 * Stores several messages in outbox at once, NewIDs can be NULL.
+	 */
+	GSM_Error	(*CreateOutboxSMSBatch) (GSM_MultiSMSMessage *sms, int count, GSM_SMSDConfig *Config, char **NewIDs);
 } GSM_SMSDService;
 
+typedef enum {
+	/**
+	 * Do not sync saved messages to disk.
+	 */
+	SMSD_DURABILITY_NONE = 1,
+	/**
+	 * Sync all messages of received batch at once.
+	 */
+	SMSD_DURABILITY_BATCH,
+	/**
+	 * Sync every message immediately.
+	 */
+	SMSD_DURABILITY_MESSAGE
+} SMSD_Durability;
+
 struct _GSM_SMSDConfig {
 	const char	*ServiceName;
 	const char *program_name;
 	/* general options */
 	GSM_StringArray IncludeNumbersList, ExcludeNumbersList;
 	GSM_StringArray IncludeSMSCList, ExcludeSMSCList;
+	/* intervals in miliseconds */
 	unsigned int    commtimeout, 	 sendtimeout,   receivefrequency, statusfrequency;
 	unsigned int loopsleep;
 	int deliveryreportdelay;
@@ -93,10 +128,33 @@ struct _GSM_SMSDConfig {
 	gboolean enable_receive;
 	unsigned int maxretries;
 	int backend_retries;
+	/**
+	 * Journal of asynchronous backend writer, NULL when backend is
+	 * written synchronously.
+	 */
+	const char *backend_journal;
+	/**
+	 * Number of queued records kept in memory, rest is read back
+	 * from journal.
+	 */
+	int backend_queue_size;
 
 	/* options for FILES */
 	const char   *inboxpath, 	 *outboxpath, 	*sentsmspath;
 	const char   *errorsmspath, 	 *inboxformat,  *transmitformat, *outboxformat;
+	SMSD_Durability inboxdurability;
+	/**
+	 * Name (without serial) of last message stored in inbox.
+	 */
+	char inboxlastname[100];
+	/**
+	 * Serial of last message stored in inbox.
+	 */
+	int inboxlastserial;
+	/**
+	 * Inbox files which need to be synced on commit.
+	 */
+	GSM_StringArray inboxpending;
 
 	/* private variables required for work */
 	int		relativevalidity;
@@ -145,6 +203,11 @@ struct _GSM_SMSDConfig {
 	/* database data structure */
 	struct GSM_SMSDdbobj *db;
 	SQL_conn conn;
+	/**
+	 * Whether transaction is open, connection is not silently
+	 * reestablished then as transaction would be lost.
+	 */
+	gboolean	transaction;
 	/* configurable SQL queries */
 	char * SMSDSQL_queries[SQL_QUERY_LAST_NO];
 #endif
@@ -198,9 +261,37 @@ struct _GSM_SMSDConfig {
 #ifdef WIN32
 	char map_key[MAX_PATH + 20];
 	HANDLE map_handle;
+	/**
+	 * Event used to wake up main loop.
+	 */
+	HANDLE wakeup_event;
+#else
+	/**
+	 * Pipe used to wake up main loop.
+	 */
+	int wakeup_pipe[2];
 #endif
+#ifdef SMSD_WAKEUP_SEMAPHORE
+	/**
+	 * Semaphore posted by other processes to wake up main loop, -1
+	 * if not available.
+	 */
+	int wakeup_sem;
+	/**
+	 * Thread passing semaphore posts to wakeup pipe.
+	 */
+	pthread_t wakeup_thread;
+#endif
+	/**
+	 * Main loop should check outbox immediately.
+	 */
+	volatile gboolean wakeup;
 	GSM_SMSDStatus *Status;
 	GSM_SMSDService		*Service;
+	/**
+	 * Asynchronous backend writer, NULL when not running.
+	 */
+	struct _SMSD_Writer	*writer;
 };
 
 extern GSM_Error SMSD_NoneFunction		(void);
@@ -214,6 +305,26 @@ extern GSM_Error SMSD_NotSupportedFunction	(void);
 #define NOTIMPLEMENTED 	(void *) SMSD_NotImplementedFunction
 #define NOTSUPPORTED 	(void *) SMSD_NotSupportedFunction
 
+/**
+ * Checks whether message of given level is logged. Errors and important
+ * messages are always logged, others only when enabled by DebugLevel.
+ */
+#define SMSD_LogEnabled(level, Config) \
+	((level) == DEBUG_ERROR || (level) == DEBUG_INFO || ((level) & (Config)->debug_level) != 0)
+
+#ifdef __GNUC__
+/*
+ * Check level before calling the function, so that arguments of
+ * disabled messages are not evaluated at all.
+ */
+#define SMSD_Log(level, Config, ...) \
+	do { \
+		if (SMSD_LogEnabled(level, Config)) { \
+			(SMSD_Log)(level, Config, __VA_ARGS__); \
+		} \
+	} while (0)
+#endif
+
 /**
  * Checks whether database version is up to date.
  */
@@ -231,6 +342,16 @@ GSM_Error SMSD_CheckDBVersion(GSM_SMSDConfig *Config, int version);
  */
 void SMSD_Terminate(GSM_SMSDConfig *Config, const char *msg, GSM_Error error, gboolean exitprogram, int rc);
 
+/**
+ * Executes external command, passing message details in environment.
+ *
+ * \param command Command to execute.
+ * \param sms Message to pass to command, can be NULL.
+ * \param Config Pointer to SMSD configuration data.
+ * \param locations Backend locations of message.
+ */
+gboolean SMSD_RunOn(const char *command, GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, const char *locations);
+
 #endif
 
 /* How should editor hadle tabs in this file? Add editor commands here.
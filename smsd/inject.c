@@ -5,6 +5,7 @@
 /* Licensend under GNU GPL 2 */
 
 #include <gammu-smsd.h>
+#include <gammu-unicode.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -19,12 +20,28 @@
 #include "common.h"
 
 #include "../helper/message-cmdline.h"
+#include "../helper/string.h"
 
 #if !defined(WIN32) && (defined(HAVE_GETOPT) || defined(HAVE_GETOPT_LONG))
 #define HAVE_DEFAULT_CONFIG
 const char default_config[] = "/etc/gammu-smsdrc";
 #endif
 
+/**
+ * Maximal length of line in bulk input.
+ */
+#define BULK_LINE_LENGTH 4096
+
+/**
+ * Whether to read recipients from standard input.
+ */
+static gboolean bulk_mode = FALSE;
+
+/**
+ * Number of messages stored in single backend transaction.
+ */
+static int batch_size = 100;
+
 NORETURN void version(void)
 {
 	printf("Gammu-smsd-inject version %s\n", GAMMU_VERSION);
@@ -81,6 +98,7 @@ NORETURN void version(void)
 void help(void)
 {
 	printf("usage: gammu-smsd-inject [OPTION]... MSGTYPE RECIPIENT [MESSAGE_PARAMETER]...\n");
+	printf("       gammu-smsd-inject -b [OPTION]... MSGTYPE [MESSAGE_PARAMETER]...\n");
 	printf("options:\n");
 	print_option("h", "help", "shows this help");
 	print_option("v", "version", "shows version information");
@@ -88,6 +106,9 @@ void help(void)
 	print_option("L", "no-use-log", "do not use logging configuration from config file (default)");
 	print_option_param("c", "config", "CONFIG_FILE",
 			   "defines path to config file");
+	print_option("b", "bulk", "reads RECIPIENT[,TEXT] lines from standard input");
+	print_option_param("n", "batch-size", "COUNT",
+			   "number of messages stored at once in bulk mode (default 100)");
 	printf("\n");
 	printf("MSGTYPE and it's parameters are described in man page and Gammu documentation\n");
 }
@@ -109,15 +130,17 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 		{"config", 1, 0, 'c'},
 		{"use-log", 0, 0, 'l'},
 		{"no-use-log", 0, 0, 'L'},
+		{"bulk", 0, 0, 'b'},
+		{"batch-size", 1, 0, 'n'},
 		{0, 0, 0, 0}
 	};
 	int option_index;
 
 	while ((opt =
-		getopt_long(argc, argv, "+hvc:lL", long_options,
+		getopt_long(argc, argv, "+hvc:lLbn:", long_options,
 			    &option_index)) != -1) {
 #elif defined(HAVE_GETOPT)
-	while ((opt = getopt(argc, argv, "+hvc:lL")) != -1) {
+	while ((opt = getopt(argc, argv, "+hvc:lLbn:")) != -1) {
 #else
 	/* Poor mans getopt replacement */
 	int i, optind = -1;
@@ -143,6 +166,15 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 			case 'L':
 				params->use_log = FALSE;
 				break;
+			case 'b':
+				bulk_mode = TRUE;
+				break;
+			case 'n':
+				batch_size = atoi(optarg);
+				if (batch_size <= 0) {
+					wrong_params();
+				}
+				break;
 			case '?':
 				wrong_params();
 			case 'h':
@@ -169,10 +201,218 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 #ifndef WIN32
 #endif
 
+/**
+ * Parses bulk input line in form RECIPIENT[,TEXT]. Text can be enclosed
+ * in double quotes, quote inside is then written as two quotes.
+ */
+static gboolean parse_bulk_line(char *line, char **recipient, char **text)
+{
+	char *pos, *out;
+
+	*recipient = line;
+	*text = NULL;
+
+	pos = strchr(line, ',');
+	if (pos == NULL) {
+		return TRUE;
+	}
+	*pos++ = 0;
+
+	if (*pos != '"') {
+		*text = pos;
+		return TRUE;
+	}
+
+	*text = out = ++pos;
+	while (*pos != 0) {
+		if (*pos == '"') {
+			if (pos[1] != '"') {
+				*out = 0;
+				return pos[1] == 0;
+			}
+			pos++;
+		}
+		*out++ = *pos++;
+	}
+	/* Missing closing quote */
+	return FALSE;
+}
+
+/**
+ * Stores batch of messages and reports result.
+ */
+static gboolean inject_batch(GSM_SMSDConfig *config, GSM_MultiSMSMessage *sms, int count, char **newids, int line)
+{
+	GSM_Error error;
+
+	error = SMSD_InjectSMSBatch(config, sms, count, newids);
+	if (error != ERR_NONE) {
+		printf("Failed to inject messages ending on line %d: %s\n",
+		       line, GSM_ErrorString(error));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Reads recipients from standard input and injects messages in batches.
+ *
+ * Messages are encoded only when text changes, for same text only
+ * recipient and concatenation reference are stamped into already
+ * encoded message.
+ */
+static int inject_bulk(GSM_SMSDConfig *config, int argc, int startarg, char **argv)
+{
+	GSM_Error error;
+	GSM_Message_Type type = SMS_SMSD;
+	GSM_MultiSMSMessage *sms = NULL;
+	GSM_MultiPartSMSContext *context = NULL;
+	unsigned char number[(GSM_MAX_NUMBER_LENGTH + 1) * 2];
+	char **newids = NULL, **msg_argv = NULL;
+	char line[BULK_LINE_LENGTH], *recipient, *text, *encoded_text = NULL;
+	gboolean has_encoded = FALSE, template_text = FALSE;
+	int msg_argc, count = 0, total = 0, lineno = 0, i, ret = 0;
+	size_t len;
+
+	if (startarg >= argc) {
+		fprintf(stderr, "Message type not specified!\n");
+		return 1;
+	}
+	for (i = startarg + 1; i < argc; i++) {
+		if (strcasecmp(argv[i], "-text") == 0 || strcasecmp(argv[i], "-textutf8") == 0) {
+			template_text = TRUE;
+		}
+	}
+
+	sms = (GSM_MultiSMSMessage *)malloc(batch_size * sizeof(GSM_MultiSMSMessage));
+	context = (GSM_MultiPartSMSContext *)malloc(sizeof(GSM_MultiPartSMSContext));
+	newids = (char **)malloc(batch_size * sizeof(char *));
+	/* Program name, type, recipient, parameters and text */
+	msg_argv = (char **)malloc((argc - startarg + 5) * sizeof(char *));
+	if (sms == NULL || context == NULL || newids == NULL || msg_argv == NULL) {
+		printf("Failed to allocate memory for %d messages\n", batch_size);
+		ret = 1;
+		goto done;
+	}
+	for (i = 0; i < batch_size; i++) {
+		newids[i] = NULL;
+	}
+	for (i = 0; i < batch_size; i++) {
+		newids[i] = (char *)malloc(200);
+		if (newids[i] == NULL) {
+			printf("Failed to allocate memory for %d messages\n", batch_size);
+			ret = 1;
+			goto done;
+		}
+	}
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		lineno++;
+		len = strlen(line);
+		if (len > 0 && line[len - 1] != '\n' && !feof(stdin)) {
+			printf("Too long line %d\n", lineno);
+			ret = 4;
+			goto done;
+		}
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = 0;
+		}
+		if (len == 0 || line[0] == '#') {
+			continue;
+		}
+		if (!parse_bulk_line(line, &recipient, &text)) {
+			printf("Failed to parse line %d\n", lineno);
+			ret = 4;
+			goto done;
+		}
+		if (strlen(recipient) == 0 || strlen(recipient) > GSM_MAX_NUMBER_LENGTH) {
+			printf("Invalid recipient on line %d\n", lineno);
+			ret = 4;
+			goto done;
+		}
+
+		/* Encode message only if text has changed */
+		if (!has_encoded ||
+				(text == NULL && encoded_text != NULL) ||
+				(text != NULL && (encoded_text == NULL || strcmp(text, encoded_text) != 0))) {
+			if (text == NULL && !template_text && strcasecmp(argv[startarg], "TEXT") == 0) {
+				printf("Missing text on line %d\n", lineno);
+				ret = 4;
+				goto done;
+			}
+			msg_argc = 0;
+			msg_argv[msg_argc++] = argv[0];
+			msg_argv[msg_argc++] = argv[startarg];
+			msg_argv[msg_argc++] = recipient;
+			for (i = startarg + 1; i < argc; i++) {
+				msg_argv[msg_argc++] = argv[i];
+			}
+			if (text != NULL) {
+				msg_argv[msg_argc++] = (char *)"-textutf8";
+				msg_argv[msg_argc++] = text;
+			}
+			msg_argv[msg_argc] = NULL;
+
+			error = CreateMessage(&type, &context->Template, msg_argc, 1, msg_argv, NULL);
+			if (error != ERR_NONE) {
+				printf("Failed to create message on line %d: %s\n",
+				       lineno, GSM_ErrorString(error));
+				ret = 1;
+				goto done;
+			}
+			context->Reference = -1;
+			free(encoded_text);
+			encoded_text = (text == NULL) ? NULL : strdup(text);
+			has_encoded = TRUE;
+		}
+
+		EncodeUnicode(number, recipient, strlen(recipient));
+		error = GSM_StampMultiPartSMS(NULL, context, &sms[count], number, NULL, -1, -1);
+		if (error != ERR_NONE) {
+			printf("Failed to create message on line %d: %s\n",
+			       lineno, GSM_ErrorString(error));
+			ret = 1;
+			goto done;
+		}
+		newids[count][0] = 0;
+		count++;
+
+		if (count == batch_size) {
+			if (!inject_batch(config, sms, count, newids, lineno)) {
+				ret = 3;
+				goto done;
+			}
+			total += count;
+			count = 0;
+		}
+	}
+	if (count > 0) {
+		if (!inject_batch(config, sms, count, newids, lineno)) {
+			ret = 3;
+			goto done;
+		}
+		total += count;
+	}
+	printf("Written %d messages\n", total);
+
+done:
+	if (newids != NULL) {
+		for (i = 0; i < batch_size; i++) {
+			free(newids[i]);
+		}
+	}
+	free(newids);
+	free(msg_argv);
+	free(encoded_text);
+	free(context);
+	free(sms);
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	GSM_Error error;
-	int startarg;
+	int startarg, rc;
 	GSM_MultiSMSMessage sms;
 	GSM_Message_Type type = SMS_SMSD;
 	GSM_SMSDConfig *config;
@@ -216,11 +456,13 @@ int main(int argc, char **argv)
 #endif
 	}
 
-	error = CreateMessage(&type, &sms, argc, startarg, argv, NULL);
-	if (error != ERR_NONE) {
-		printf("Failed to create message: %s\n",
-		       GSM_ErrorString(error));
-		return 1;
+	if (!bulk_mode) {
+		error = CreateMessage(&type, &sms, argc, startarg, argv, NULL);
+		if (error != ERR_NONE) {
+			printf("Failed to create message: %s\n",
+			       GSM_ErrorString(error));
+			return 1;
+		}
 	}
 
 	config = SMSD_NewConfig(program_name);
@@ -233,6 +475,12 @@ int main(int argc, char **argv)
 		return 2;
 	}
 
+	if (bulk_mode) {
+		rc = inject_bulk(config, argc, startarg, argv);
+		SMSD_FreeConfig(config);
+		return rc;
+	}
+
 	error = SMSD_InjectSMS(config, &sms, newid);
 	if (error != ERR_NONE) {
 		printf("Failed to inject message: %s\n",
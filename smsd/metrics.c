@@ -0,0 +1,231 @@
+/**
+ * SMSD metrics in shared memory
+ */
+/* Licensend under GNU GPL 2 */
+
+#include <gammu-config.h>
+
+#include <string.h>
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <sched.h>
+#endif
+#if !defined(__GNUC__) && !defined(WIN32) && defined(HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+#include "metrics.h"
+
+/**
+ * Default upper bounds of histogram buckets in milliseconds.
+ */
+static const unsigned int SMSD_BucketLimits[SMSD_HISTOGRAM_BUCKETS] = {
+	5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 0
+};
+
+/**
+ * Maximal number of attempts to get consistent copy of status.
+ */
+#define SMSD_COPY_ATTEMPTS 1000
+
+/**
+ * Full memory barrier, ordering sequence updates against data.
+ */
+#if defined(__GNUC__)
+#define SMSD_BARRIER() __sync_synchronize()
+#elif defined(WIN32)
+#define SMSD_BARRIER() MemoryBarrier()
+#else
+#define SMSD_BARRIER()
+#endif
+
+/**
+ * Atomically replaces sequence by new value if it still holds old one.
+ * Without compiler support writers are serialized by mutex instead, all
+ * of them live in SMSD process. Without threads there is just one
+ * writer.
+ */
+#if defined(__GNUC__)
+#define SMSD_SEQUENCE_CAS(seq, old, new) __sync_bool_compare_and_swap(seq, old, new)
+#elif defined(WIN32)
+#define SMSD_SEQUENCE_CAS(seq, old, new) (InterlockedCompareExchange((volatile LONG *)(seq), (new), (old)) == (LONG)(old))
+#elif defined(HAVE_PTHREAD)
+#define SMSD_METRICS_MUTEX
+static pthread_mutex_t SMSD_MetricsMutex = PTHREAD_MUTEX_INITIALIZER;
+#else
+#define SMSD_SEQUENCE_CAS(seq, old, new) (*(seq) = (new), TRUE)
+#endif
+
+/**
+ * Gives up processor while other side of sequence lock is updating.
+ */
+#ifdef WIN32
+#define SMSD_YIELD() SwitchToThread()
+#else
+#define SMSD_YIELD() sched_yield()
+#endif
+
+unsigned long long SMSD_MonotonicTime(void)
+{
+#ifdef WIN32
+	return GetTickCount();
+#else
+	struct timeval tv;
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+#endif
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+/**
+ * Marks start of update, sequence becomes odd. Writers claim the
+ * sequence by switching it from even to odd value, so concurrent
+ * writers only wait for each other for duration of single update.
+ */
+static unsigned int SMSD_MetricsBegin(GSM_SMSDMetrics *Metrics)
+{
+	unsigned int start;
+
+#ifdef SMSD_METRICS_MUTEX
+	pthread_mutex_lock(&SMSD_MetricsMutex);
+	start = Metrics->Sequence;
+	Metrics->Sequence = start + 1;
+#else
+	while (TRUE) {
+		start = Metrics->Sequence;
+		if (start % 2 == 0 && SMSD_SEQUENCE_CAS(&Metrics->Sequence, start, start + 1)) {
+			break;
+		}
+		SMSD_YIELD();
+	}
+#endif
+	SMSD_BARRIER();
+	return start;
+}
+
+/**
+ * Marks end of update, sequence becomes even again.
+ */
+static void SMSD_MetricsEnd(GSM_SMSDMetrics *Metrics, unsigned int start)
+{
+	SMSD_BARRIER();
+	Metrics->Sequence = start + 2;
+#ifdef SMSD_METRICS_MUTEX
+	pthread_mutex_unlock(&SMSD_MetricsMutex);
+#endif
+}
+
+void SMSD_MetricsInit(GSM_SMSDStatus *Status)
+{
+	memset(&Status->Metrics, 0, sizeof(Status->Metrics));
+	memcpy(Status->Metrics.BucketLimits, SMSD_BucketLimits, sizeof(SMSD_BucketLimits));
+}
+
+void SMSD_MetricsAdd(GSM_SMSDStatus *Status, GSM_SMSDCounter counter, unsigned int value)
+{
+	unsigned int start;
+
+	if (Status == NULL) {
+		return;
+	}
+	start = SMSD_MetricsBegin(&Status->Metrics);
+	Status->Metrics.Counters[counter] += value;
+	/* Keep basic counters in sync with metrics */
+	switch (counter) {
+		case SMSD_COUNTER_PARTS_SENT:
+			Status->Sent += value;
+			break;
+		case SMSD_COUNTER_PARTS_FAILED:
+			Status->Failed += value;
+			break;
+		case SMSD_COUNTER_PARTS_RECEIVED:
+			Status->Received += value;
+			break;
+		default:
+			break;
+	}
+	SMSD_MetricsEnd(&Status->Metrics, start);
+}
+
+void SMSD_MetricsObserve(GSM_SMSDStatus *Status, GSM_SMSDHistogramType histogram, unsigned long long msec)
+{
+	GSM_SMSDHistogram *hist;
+	unsigned int start;
+	int i;
+
+	if (Status == NULL) {
+		return;
+	}
+
+	/* Last bucket catches everything */
+	for (i = 0; i < SMSD_HISTOGRAM_BUCKETS - 1; i++) {
+		if (msec <= Status->Metrics.BucketLimits[i]) {
+			break;
+		}
+	}
+
+	hist = &Status->Metrics.Histograms[histogram];
+	start = SMSD_MetricsBegin(&Status->Metrics);
+	hist->Buckets[i]++;
+	hist->Count++;
+	hist->Sum += msec;
+	SMSD_MetricsEnd(&Status->Metrics, start);
+}
+
+void SMSD_MetricsSetInboxQueue(GSM_SMSDStatus *Status, int count)
+{
+	unsigned int start;
+
+	if (Status == NULL) {
+		return;
+	}
+	start = SMSD_MetricsBegin(&Status->Metrics);
+	Status->Metrics.InboxQueue = count;
+	SMSD_MetricsEnd(&Status->Metrics, start);
+}
+
+void SMSD_MetricsSetPhoneStatus(GSM_SMSDStatus *Status, const GSM_BatteryCharge *Charge, const GSM_SignalQuality *Network)
+{
+	unsigned int start;
+
+	if (Status == NULL) {
+		return;
+	}
+	start = SMSD_MetricsBegin(&Status->Metrics);
+	Status->Charge = *Charge;
+	Status->Network = *Network;
+	SMSD_MetricsEnd(&Status->Metrics, start);
+}
+
+GSM_Error SMSD_CopyStatus(GSM_SMSDStatus *dest, const GSM_SMSDStatus *src)
+{
+	unsigned int start;
+	int attempt;
+
+	for (attempt = 0; attempt < SMSD_COPY_ATTEMPTS; attempt++) {
+		start = src->Metrics.Sequence;
+		if (start % 2 == 0) {
+			SMSD_BARRIER();
+			memcpy(dest, (const void *)src, sizeof(GSM_SMSDStatus));
+			SMSD_BARRIER();
+			if (src->Metrics.Sequence == start) {
+				return ERR_NONE;
+			}
+		}
+		SMSD_YIELD();
+	}
+	return ERR_TIMEOUT;
+}
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
@@ -0,0 +1,50 @@
+/**
+ * SMSD metrics in shared memory
+ */
+#ifndef __smsd_metrics_h__
+#define __smsd_metrics_h__
+
+#include <gammu-smsd.h>
+
+/**
+ * Returns monotonic time in milliseconds.
+ */
+extern unsigned long long SMSD_MonotonicTime(void);
+
+/**
+ * Initializes metrics to empty state with default bucket limits.
+ */
+extern void SMSD_MetricsInit(GSM_SMSDStatus *Status);
+
+/**
+ * Increments counter by given value. Sent, Failed and Received in
+ * status are updated together with matching counters. Status can be
+ * NULL when there is no shared memory (for example in injector).
+ */
+extern void SMSD_MetricsAdd(GSM_SMSDStatus *Status, GSM_SMSDCounter counter, unsigned int value);
+
+/**
+ * Records latency observation in milliseconds.
+ */
+extern void SMSD_MetricsObserve(GSM_SMSDStatus *Status, GSM_SMSDHistogramType histogram, unsigned long long msec);
+
+/**
+ * Records number of messages waiting in phone.
+ */
+extern void SMSD_MetricsSetInboxQueue(GSM_SMSDStatus *Status, int count);
+
+/**
+ * Records battery and signal state read from phone.
+ */
+extern void SMSD_MetricsSetPhoneStatus(GSM_SMSDStatus *Status, const GSM_BatteryCharge *Charge, const GSM_SignalQuality *Network);
+
+/**
+ * Makes consistent copy of status, retrying while writer updates it.
+ */
+extern GSM_Error SMSD_CopyStatus(GSM_SMSDStatus *dest, const GSM_SMSDStatus *src);
+
+#endif
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
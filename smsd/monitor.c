@@ -7,6 +7,8 @@
 #include <gammu-smsd.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <signal.h>
 #ifndef WIN32
 #include <unistd.h>
@@ -26,6 +28,29 @@ volatile gboolean terminate = FALSE;
 int delay_seconds = 20;
 int limit_loops = -1;
 gboolean compact = FALSE;
+gboolean metrics = FALSE;
+
+/**
+ * Names of counters in metrics output.
+ */
+const char * const counter_names[SMSD_COUNTER_LAST] = {
+	"phone_connects",
+	"db_reconnects",
+	"db_errors",
+	"parts_sent",
+	"parts_failed",
+	"send_retries",
+	"parts_received",
+};
+
+/**
+ * Names of histograms in metrics output.
+ */
+const char * const histogram_names[SMSD_HISTOGRAM_LAST] = {
+	"phone_send",
+	"db_query",
+	"receive_store",
+};
 
 void smsd_interrupt(int signum)
 {
@@ -92,6 +117,7 @@ void help(void)
 	print_option("h", "help", "shows this help");
 	print_option("v", "version", "shows version information");
 	print_option("C", "csv", "CSV output");
+	print_option("M", "metrics", "Prometheus/OpenMetrics text output");
 	print_option_param("c", "config", "CONFIG_FILE",
 			   "defines path to config file");
 	print_option_param("d", "delay", "DELAY",
@@ -121,15 +147,16 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 		{"loops", 1, 0, 'n'},
 		{"use-log", 0, 0, 'l'},
 		{"no-use-log", 0, 0, 'L'},
+		{"metrics", 0, 0, 'M'},
 		{0, 0, 0, 0}
 	};
 	int option_index;
 
 	while ((opt =
-		getopt_long(argc, argv, "+hvc:d:n:ClL", long_options,
+		getopt_long(argc, argv, "+hvc:d:n:ClLM", long_options,
 			    &option_index)) != -1) {
 #elif defined(HAVE_GETOPT)
-	while ((opt = getopt(argc, argv, "+hvc:d:n:ClL")) != -1) {
+	while ((opt = getopt(argc, argv, "+hvc:d:n:ClLM")) != -1) {
 #else
 	/* Poor mans getopt replacement */
 	int i, optind = -1;
@@ -152,6 +179,9 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 			case 'C':
 				compact = TRUE;
 				break;
+			case 'M':
+				metrics = TRUE;
+				break;
 			case 'd':
 				delay_seconds = atoi(optarg);
 				break;
@@ -186,8 +216,101 @@ int process_commandline(int argc, char **argv, SMSD_Parameters * params)
 
 }
 
-#ifndef WIN32
-#endif
+/**
+ * Prints label value with escaping as required by exposition format.
+ */
+void print_label(const char *value)
+{
+	for (; *value != 0; value++) {
+		switch (*value) {
+			case '\\':
+				printf("\\\\");
+				break;
+			case '"':
+				printf("\\\"");
+				break;
+			case '\n':
+				printf("\\n");
+				break;
+			default:
+				putchar(*value);
+				break;
+		}
+	}
+}
+
+/**
+ * Prints metric sample with phone label.
+ */
+void print_sample(const char *name, const char *suffix, const GSM_SMSDStatus *status, const char *le, long long value)
+{
+	printf("gammu_smsd_%s%s{phone=\"", name, suffix);
+	print_label(status->PhoneID);
+	if (le != NULL) {
+		printf("\",le=\"%s", le);
+	}
+	printf("\"} %lld\n", value);
+}
+
+/**
+ * Prints status in Prometheus text format, suitable for node exporter
+ * textfile collector.
+ */
+void print_metrics(const GSM_SMSDStatus *status)
+{
+	const GSM_SMSDHistogram *hist;
+	unsigned long long cumulative;
+	char le[20];
+	int i, j;
+
+	printf("# HELP gammu_smsd_info Information about SMSD instance.\n");
+	printf("# TYPE gammu_smsd_info gauge\n");
+	printf("gammu_smsd_info{phone=\"");
+	print_label(status->PhoneID);
+	printf("\",client=\"");
+	print_label(status->Client);
+	printf("\",imei=\"");
+	print_label(status->IMEI);
+	printf("\"} 1\n");
+
+	printf("# TYPE gammu_smsd_sent_total counter\n");
+	print_sample("sent", "_total", status, NULL, status->Sent);
+	printf("# TYPE gammu_smsd_received_total counter\n");
+	print_sample("received", "_total", status, NULL, status->Received);
+	printf("# TYPE gammu_smsd_failed_total counter\n");
+	print_sample("failed", "_total", status, NULL, status->Failed);
+
+	printf("# TYPE gammu_smsd_battery_percent gauge\n");
+	print_sample("battery_percent", "", status, NULL, status->Charge.BatteryPercent);
+	printf("# TYPE gammu_smsd_signal_percent gauge\n");
+	print_sample("signal_percent", "", status, NULL, status->Network.SignalPercent);
+	printf("# TYPE gammu_smsd_inbox_queue gauge\n");
+	print_sample("inbox_queue", "", status, NULL, status->Metrics.InboxQueue);
+
+	for (i = 0; i < SMSD_COUNTER_LAST; i++) {
+		printf("# TYPE gammu_smsd_%s_total counter\n", counter_names[i]);
+		print_sample(counter_names[i], "_total", status, NULL, status->Metrics.Counters[i]);
+	}
+
+	for (i = 0; i < SMSD_HISTOGRAM_LAST; i++) {
+		hist = &status->Metrics.Histograms[i];
+		printf("# TYPE gammu_smsd_%s_seconds histogram\n", histogram_names[i]);
+		cumulative = 0;
+		for (j = 0; j < SMSD_HISTOGRAM_BUCKETS; j++) {
+			cumulative += hist->Buckets[j];
+			if (status->Metrics.BucketLimits[j] == 0) {
+				strcpy(le, "+Inf");
+			} else {
+				sprintf(le, "%g", status->Metrics.BucketLimits[j] / 1000.0);
+			}
+			print_sample(histogram_names[i], "_seconds_bucket", status, le, cumulative);
+		}
+		printf("gammu_smsd_%s_seconds_sum{phone=\"", histogram_names[i]);
+		print_label(status->PhoneID);
+		printf("\"} %.3f\n", hist->Sum / 1000.0);
+		print_sample(histogram_names[i], "_seconds_count", status, NULL, hist->Count);
+	}
+}
 
 int main(int argc, char **argv)
 {
@@ -223,6 +346,11 @@ int main(int argc, char **argv)
 
 	process_commandline(argc, argv, &params);
 
+	/* Log messages would otherwise be mixed with metrics on stdout */
+	if (metrics) {
+		params.use_log = TRUE;
+	}
+
 	if (params.config_file == NULL) {
 #ifdef HAVE_DEFAULT_CONFIG
 		params.config_file = default_config;
@@ -253,7 +381,10 @@ int main(int argc, char **argv)
 			SMSD_FreeConfig(config);
 			return 3;
 		}
-		if (compact) {
+		if (metrics) {
+			print_metrics(&status);
+			fflush(stdout);
+		} else if (compact) {
 			printf("%s;%s;%s;%d;%d;%d;%d;%d\n",
 				 status.Client,
 				 status.PhoneID,
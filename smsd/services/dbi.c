@@ -9,6 +9,7 @@
  */
 
 #include <gammu.h>
+#include <gammu-config.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -23,9 +24,27 @@
 #endif
 #endif
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "../core.h"
 #include "sql.h"
 
+/**
+ * Number of open connections, libdbi is initialized globally and both
+ * main loop and backend writer connect.
+ */
+static int SMSDDBI_Users = 0;
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t SMSDDBI_Lock = PTHREAD_MUTEX_INITIALIZER;
+#define SMSDDBI_LOCK() pthread_mutex_lock(&SMSDDBI_Lock)
+#define SMSDDBI_UNLOCK() pthread_mutex_unlock(&SMSDDBI_Lock)
+#else
+#define SMSDDBI_LOCK()
+#define SMSDDBI_UNLOCK()
+#endif
+
 long long SMSDDBI_GetNumber(GSM_SMSDConfig * Config, SQL_result *res, unsigned int field)
 {
 	unsigned int type;
@@ -144,8 +163,12 @@ void SMSDDBI_Callback(dbi_conn Conn, void *Config)
 void SMSDDBI_Free(GSM_SMSDConfig * Config)
 {
 	if (Config->conn.dbi != NULL) {
+		SMSDDBI_LOCK();
 		dbi_conn_close(Config->conn.dbi);
-		dbi_shutdown();
+		if (--SMSDDBI_Users == 0) {
+			dbi_shutdown();
+		}
+		SMSDDBI_UNLOCK();
 		Config->conn.dbi = NULL;
 	}
 }
@@ -153,28 +176,37 @@ void SMSDDBI_Free(GSM_SMSDConfig * Config)
 /* Connects to database */
 static SQL_Error SMSDDBI_Connect(GSM_SMSDConfig * Config)
 {
-	int rc;
+	int rc = 1;
 	struct GSM_SMSDdbobj *db = Config->db;
 
-	rc = dbi_initialize(Config->driverspath);
+	SMSDDBI_LOCK();
+	if (SMSDDBI_Users == 0) {
+		rc = dbi_initialize(Config->driverspath);
+	}
 
 	if (rc == 0) {
-		SMSD_Log(DEBUG_ERROR, Config, "DBI did not find any drivers, try using DriversPath option");
 		dbi_shutdown();
+		SMSDDBI_UNLOCK();
+		SMSD_Log(DEBUG_ERROR, Config, "DBI did not find any drivers, try using DriversPath option");
 		return SQL_FAIL;
 	} else if (rc < 0) {
+		SMSDDBI_UNLOCK();
 		SMSD_Log(DEBUG_ERROR, Config, "DBI failed to initialize!");
 		return SQL_FAIL;
 	}
 
 	Config->conn.dbi = dbi_conn_new(Config->driver);
 	if (Config->conn.dbi == NULL) {
+		if (SMSDDBI_Users == 0) {
+			dbi_shutdown();
+		}
+		SMSDDBI_UNLOCK();
 		SMSD_Log(DEBUG_ERROR, Config, "DBI failed to init %s driver!", Config->driver);
-		dbi_shutdown();
 		return SQL_FAIL;
-	} else {
-		SMSD_Log(DEBUG_SQL, Config, "Using DBI driver '%s'", dbi_driver_get_name(dbi_conn_get_driver(Config->conn.dbi)));
 	}
+	SMSDDBI_Users++;
+	SMSDDBI_UNLOCK();
+	SMSD_Log(DEBUG_SQL, Config, "Using DBI driver '%s'", dbi_driver_get_name(dbi_conn_get_driver(Config->conn.dbi)));
 
 	dbi_conn_error_handler(Config->conn.dbi, SMSDDBI_Callback, Config);
 
@@ -322,6 +354,7 @@ struct GSM_SMSDdbobj SMSDDBI = {
 	SMSDDBI_GetDate,
 	SMSDDBI_GetBool,
 	SMSDDBI_QuoteString,
+	NULL,
 };
 
 /* How should editor hadle tabs in this file? Add editor commands here.
@@ -9,8 +9,12 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <fcntl.h>
 #ifdef WIN32
 #include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
 #endif
 #if defined HAVE_DIRENT_H && defined HAVE_SCANDIR && defined HAVE_ALPHASORT
 #define HAVE_DIRBROWSING
@@ -27,124 +31,305 @@
 #define chk_fwrite(data, size, count, file) \
 	if (fwrite(data, size, count, file) != count) goto fail;
 
-/* Save SMS from phone (called Inbox sms - it's in phone Inbox) somewhere */
-static GSM_Error SMSDFiles_SaveInboxSMS(GSM_MultiSMSMessage * sms, GSM_SMSDConfig * Config, char **Locations)
+/**
+ * Flushes file content to disk.
+ */
+static gboolean SMSDFiles_SyncFile(int fd)
+{
+#ifdef WIN32
+	return _commit(fd) == 0;
+#else
+	return fsync(fd) == 0;
+#endif
+}
+
+/**
+ * Flushes directory entries of inbox to disk, so that newly created
+ * names survive crash.
+ */
+static gboolean SMSDFiles_SyncInbox(GSM_SMSDConfig * Config)
+{
+#ifdef WIN32
+	/* Directories can not be synced on Windows, metadata is journaled */
+	return TRUE;
+#else
+	int fd;
+	gboolean ret;
+
+	fd = open(Config->inboxpath[0] == 0 ? "." : Config->inboxpath, O_RDONLY);
+	if (fd < 0) {
+		return FALSE;
+	}
+	ret = SMSDFiles_SyncFile(fd);
+	close(fd);
+	return ret;
+#endif
+}
+
+/**
+ * Moves temporary file to its final name. When exclusive is set, it
+ * fails with EEXIST if final name exists, otherwise existing file is
+ * replaced. In both cases no partially written file ever appears
+ * under final name.
+ */
+static int SMSDFiles_PublishFile(const char *TempName, const char *FullName, gboolean exclusive)
+{
+#ifdef WIN32
+	/* rename on Windows never replaces existing file */
+	if (!exclusive) {
+		unlink(FullName);
+	}
+	if (rename(TempName, FullName) != 0) {
+		if (errno == EACCES) {
+			errno = EEXIST;
+		}
+		return -1;
+	}
+	return 0;
+#else
+	if (!exclusive) {
+		return rename(TempName, FullName);
+	}
+	if (link(TempName, FullName) != 0) {
+		return -1;
+	}
+	unlink(TempName);
+	return 0;
+#endif
+}
+
+/**
+ * Writes single inbox file to temporary location.
+ */
+static GSM_Error SMSDFiles_WriteInboxFile(GSM_MultiSMSMessage * sms, int i, GSM_SMSDConfig * Config, const char *TempName)
 {
 	GSM_Error error = ERR_NONE;
-	int i, j;
-	unsigned char FileName[100], FullName[400], ext[4], buffer[64], buffer2[400];
-	gboolean done;
+	unsigned char buffer[64], buffer2[400];
 	FILE *file;
-	size_t locations_size = 0, locations_pos = 0;
+	int j;
 #ifdef GSM_ENABLE_BACKUP
 	GSM_SMS_Backup backup;
 #endif
+
+	/* Stale file from previous failure */
+	unlink(TempName);
+
+	if (strcasecmp(Config->inboxformat, "detail") == 0) {
+#ifndef GSM_ENABLE_BACKUP
+		SMSD_Log(DEBUG_ERROR, Config, "Saving in detail format not compiled in!");
+		return ERR_DISABLED;
+#else
+		for (j = 0; j < sms->Number; j++) {
+			backup.SMS[j] = &sms->SMS[j];
+		}
+		backup.SMS[sms->Number] = NULL;
+		error = GSM_AddSMSBackupFile(TempName, &backup);
+		if (error != ERR_NONE) {
+			return error;
+		}
+		if (Config->inboxdurability == SMSD_DURABILITY_MESSAGE) {
+			file = fopen(TempName, "rb");
+			if (file == NULL || !SMSDFiles_SyncFile(fileno(file))) {
+				goto fail;
+			}
+			fclose(file);
+		}
+		return ERR_NONE;
+#endif
+	}
+
+	file = fopen(TempName, "wb");
+	if (file == NULL) {
+		SMSD_LogErrno(Config, "Cannot save file!");
+		return ERR_CANTOPENFILE;
+	}
+
+	switch (sms->SMS[i].Coding) {
+		case SMS_Coding_Unicode_No_Compression:
+		case SMS_Coding_Default_No_Compression:
+			DecodeUnicode(sms->SMS[i].Text, buffer2);
+			if (strcasecmp(Config->inboxformat, "unicode") == 0) {
+				buffer[0] = 0xFE;
+				buffer[1] = 0xFF;
+				chk_fwrite(buffer, 1, 2, file);
+				chk_fwrite(sms->SMS[i].Text, 1, strlen(buffer2) * 2, file);
+			} else {
+				chk_fwrite(buffer2, 1, strlen(buffer2), file);
+			}
+			break;
+		case SMS_Coding_8bit:
+			chk_fwrite(sms->SMS[i].Text, 1, (size_t) sms->SMS[i].Length, file);
+		default:
+			break;
+	}
+	if (fflush(file) != 0) {
+		goto fail;
+	}
+	if (Config->inboxdurability == SMSD_DURABILITY_MESSAGE && !SMSDFiles_SyncFile(fileno(file))) {
+		goto fail;
+	}
+	if (fclose(file) != 0) {
+		file = NULL;
+		goto fail;
+	}
+	return ERR_NONE;
+fail:
+	SMSD_LogErrno(Config, "Cannot write file!");
+	if (file) {
+		fclose(file);
+	}
+	unlink(TempName);
+	return ERR_WRITING_FILE;
+}
+
+/* Save SMS from phone (called Inbox sms - it's in phone Inbox) somewhere */
+static GSM_Error SMSDFiles_SaveInboxSMS(GSM_MultiSMSMessage * sms, GSM_SMSDConfig * Config, char **Locations)
+{
+	GSM_Error error = ERR_NONE;
+	int i, j, length;
+	unsigned char FileName[100], FullName[400], TempName[400], BaseName[100], ext[4], buffer[64], buffer2[400];
+	gboolean done;
+	size_t locations_size = 0, locations_pos = 0;
+
 	*Locations = NULL;
 
-	j = 0;
+	/*
+	 * Messages with same timestamp and number are distinguished by
+	 * serial. We continue from last used one instead of probing
+	 * existing files, O_EXCL like publishing catches collisions with
+	 * files left from previous runs.
+	 */
+	DecodeUnicode(sms->SMS[0].Number, buffer2);
+	length = snprintf(BaseName, sizeof(BaseName), "%02d%02d%02d_%02d%02d%02d_%s",
+		sms->SMS[0].DateTime.Year, sms->SMS[0].DateTime.Month, sms->SMS[0].DateTime.Day,
+		sms->SMS[0].DateTime.Hour, sms->SMS[0].DateTime.Minute, sms->SMS[0].DateTime.Second, buffer2);
+	/* Number can be longer than fits into file name */
+	if (length < 0 || length >= (int)sizeof(BaseName)) {
+		SMSD_Log(DEBUG_ERROR, Config, "Cannot save message from %s. Number too long for file name", buffer2);
+		return ERR_CANTOPENFILE;
+	}
+	if (strcmp(BaseName, Config->inboxlastname) == 0) {
+		j = Config->inboxlastserial + 1;
+	} else {
+		j = 0;
+	}
+
 	done = FALSE;
 	for (i = 0; i < sms->Number && !done; i++) {
 		strcpy(ext, "txt");
 		if (sms->SMS[i].Coding == SMS_Coding_8bit)
 			strcpy(ext, "bin");
 		DecodeUnicode(sms->SMS[i].Number, buffer2);
-		/* we loop on yy for the first SMS assuming that if xxxx_yy_00.ext is absent,
-		   any xxxx_yy_01,02, must be garbage, that can be overwritten */
-		file = NULL;
-		do {
-			sprintf(FileName,
+
+		if ((sms->SMS[i].PDU == SMS_Status_Report) && strcasecmp(Config->deliveryreport, "log") == 0) {
+			strcpy(buffer, DecodeUnicodeString(sms->SMS[i].Number));
+			SMSD_Log(DEBUG_NOTICE, Config, "Delivery report: %s to %s, message reference 0x%02x",
+				 DecodeUnicodeString(sms->SMS[i].Text), buffer, sms->SMS[i].MessageReference);
+			continue;
+		}
+
+		sprintf(TempName, "%s.IN%d_%02i.tmp", Config->inboxpath, (int)getpid(), i);
+		error = SMSDFiles_WriteInboxFile(sms, i, Config, TempName);
+		if (error != ERR_NONE) {
+			return error;
+		}
+		if (strcasecmp(Config->inboxformat, "detail") == 0) {
+			/* All parts are stored in single file */
+			done = TRUE;
+		}
+
+		/* Publish under final name */
+		while (TRUE) {
+			if (j >= 100) {
+				SMSD_Log(DEBUG_ERROR, Config, "Cannot save %s. No available file names", BaseName);
+				unlink(TempName);
+				return ERR_CANTOPENFILE;
+			}
+			length = snprintf(FileName, sizeof(FileName),
 				"IN%02d%02d%02d_%02d%02d%02d_%02i_%s_%02i.%s",
 				sms->SMS[i].DateTime.Year, sms->SMS[i].DateTime.Month, sms->SMS[i].DateTime.Day,
 				sms->SMS[i].DateTime.Hour, sms->SMS[i].DateTime.Minute, sms->SMS[i].DateTime.Second, j, buffer2, i, ext);
+			if (length < 0 || length >= (int)sizeof(FileName)) {
+				SMSD_Log(DEBUG_ERROR, Config, "Cannot save message from %s. Number too long for file name", buffer2);
+				unlink(TempName);
+				return ERR_CANTOPENFILE;
+			}
 			strcpy(FullName, Config->inboxpath);
 			strcat(FullName, FileName);
-			if (file) {
-				fclose(file);
+			/* Following parts may overwrite garbage with same serial */
+			if (SMSDFiles_PublishFile(TempName, FullName, i == 0) == 0) {
+				break;
 			}
-			file = fopen(FullName, "r");
-		} while ((i == 0) && file != NULL && (++j < 100));
-
-		if (file) {
-			fclose(file);
-			file = NULL;
-			if (i == 0) {
-				SMSD_Log(DEBUG_ERROR, Config, "Cannot save %s. No available file names", FileName);
+			if (i != 0 || errno != EEXIST) {
+				SMSD_LogErrno(Config, "Cannot save file!");
+				unlink(TempName);
 				return ERR_CANTOPENFILE;
 			}
+			j++;
 		}
-		errno = 0;
+		strcpy(Config->inboxlastname, BaseName);
+		Config->inboxlastserial = j;
 
-		if ((sms->SMS[i].PDU == SMS_Status_Report) && strcasecmp(Config->deliveryreport, "log") == 0) {
-			strcpy(buffer, DecodeUnicodeString(sms->SMS[i].Number));
-			SMSD_Log(DEBUG_NOTICE, Config, "Delivery report: %s to %s, message reference 0x%02x",
-				 DecodeUnicodeString(sms->SMS[i].Text), buffer, sms->SMS[i].MessageReference);
-		} else {
-			if (locations_pos + strlen(FileName) + 2 >= locations_size) {
-				locations_size += strlen(FileName) + 30;
-				*Locations = (char *)realloc(*Locations, locations_size);
-				assert(*Locations != NULL);
-				if (locations_pos == 0) {
-					*Locations[0] = 0;
-				}
+		if (Config->inboxdurability == SMSD_DURABILITY_MESSAGE) {
+			if (!SMSDFiles_SyncInbox(Config)) {
+				SMSD_LogErrno(Config, "Cannot sync inbox!");
+				return ERR_WRITING_FILE;
 			}
-			strcat(*Locations, FileName);
-			strcat(*Locations, " ");
-			locations_pos += strlen(FileName) + 1;
-
-			if (strcasecmp(Config->inboxformat, "detail") == 0) {
-#ifndef GSM_ENABLE_BACKUP
-				SMSD_Log(DEBUG_ERROR, Config, "Saving in detail format not compiled in!");
-
-#else
-				for (j = 0; j < sms->Number; j++) {
-					backup.SMS[j] = &sms->SMS[j];
-				}
-				backup.SMS[sms->Number] = NULL;
-				error = GSM_AddSMSBackupFile(FullName, &backup);
-				done = TRUE;
-#endif
-			} else {
-				file = fopen(FullName, "wb");
-				if (file == NULL) {
-					SMSD_LogErrno(Config, "Cannot save file!");
-					return ERR_CANTOPENFILE;
-				}
-
-				switch (sms->SMS[i].Coding) {
-					case SMS_Coding_Unicode_No_Compression:
-					case SMS_Coding_Default_No_Compression:
-						DecodeUnicode(sms->SMS[i].Text, buffer2);
-						if (strcasecmp(Config->inboxformat, "unicode") == 0) {
-							buffer[0] = 0xFE;
-							buffer[1] = 0xFF;
-							chk_fwrite(buffer, 1, 2, file);
-							chk_fwrite(sms->SMS[i].Text, 1, strlen(buffer2) * 2, file);
-						} else {
-							chk_fwrite(buffer2, 1, strlen(buffer2), file);
-						}
-						break;
-					case SMS_Coding_8bit:
-						chk_fwrite(sms->SMS[i].Text, 1, (size_t) sms->SMS[i].Length, file);
-					default:
-						break;
-				}
-				fclose(file);
-				file = NULL;
+		} else if (Config->inboxdurability == SMSD_DURABILITY_BATCH) {
+			if (!GSM_StringArray_Add(&Config->inboxpending, FullName)) {
+				return ERR_MOREMEMORY;
 			}
+		}
 
-			if (error != ERR_NONE) {
-				return error;
+		if (locations_pos + strlen(FileName) + 2 >= locations_size) {
+			locations_size += strlen(FileName) + 30;
+			*Locations = (char *)realloc(*Locations, locations_size);
+			assert(*Locations != NULL);
+			if (locations_pos == 0) {
+				*Locations[0] = 0;
 			}
-
-			SMSD_Log(DEBUG_INFO, Config, "%s %s", (sms->SMS[i].PDU == SMS_Status_Report ? "Delivery report" : "Received"), FileName);
 		}
+		strcat(*Locations, FileName);
+		strcat(*Locations, " ");
+		locations_pos += strlen(FileName) + 1;
+
+		SMSD_Log(DEBUG_INFO, Config, "%s %s", (sms->SMS[i].PDU == SMS_Status_Report ? "Delivery report" : "Received"), FileName);
 	}
 	return ERR_NONE;
-fail:
-	if (file) {
-		fclose(file);
+}
+
+/**
+ * Syncs all files saved in current batch and inbox directory at once.
+ */
+static GSM_Error SMSDFiles_CommitInbox(GSM_SMSDConfig * Config)
+{
+	GSM_Error error = ERR_NONE;
+	size_t i;
+	int fd;
+
+	if (Config->inboxpending.used == 0) {
+		return ERR_NONE;
 	}
-	return ERR_WRITING_FILE;
+
+	for (i = 0; i < Config->inboxpending.used; i++) {
+		fd = open(Config->inboxpending.data[i], O_RDONLY);
+		if (fd < 0 || !SMSDFiles_SyncFile(fd)) {
+			SMSD_LogErrno(Config, "Cannot sync inbox file!");
+			error = ERR_WRITING_FILE;
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	if (!SMSDFiles_SyncInbox(Config)) {
+		SMSD_LogErrno(Config, "Cannot sync inbox!");
+		error = ERR_WRITING_FILE;
+	}
+
+	GSM_StringArray_Free(&Config->inboxpending);
+	GSM_StringArray_New(&Config->inboxpending);
+
+	return error;
 }
 
 /* Find one multi SMS to sending and return it (or return ERR_EMPTY)
@@ -586,6 +771,21 @@ fail:
 	return ERR_WRITING_FILE;
 }
 
+/* Adds several SMS to Outbox, every message has own files */
+static GSM_Error SMSDFiles_CreateOutboxSMSBatch(GSM_MultiSMSMessage * sms, int count, GSM_SMSDConfig * Config, char **NewIDs)
+{
+	GSM_Error error;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		error = SMSDFiles_CreateOutboxSMS(&sms[i], Config, NewIDs == NULL ? NULL : NewIDs[i]);
+		if (error != ERR_NONE) {
+			return error;
+		}
+	}
+	return ERR_NONE;
+}
+
 static GSM_Error SMSDFiles_AddSentSMSInfo(GSM_MultiSMSMessage * sms UNUSED, GSM_SMSDConfig * Config, char *ID UNUSED, int Part, GSM_SMSDSendingError err, int TPMR)
 {
 	if (err == SMSD_SEND_OK) {
@@ -599,6 +799,7 @@ static GSM_Error SMSDFiles_AddSentSMSInfo(GSM_MultiSMSMessage * sms UNUSED, GSM_
 GSM_Error SMSDFiles_ReadConfiguration(GSM_SMSDConfig *Config)
 {
 	static unsigned char	emptyPath[1] = "\0";
+	const char *str;
 
 	Config->inboxpath=INI_GetValue(Config->smsdcfgfile, "smsd", "inboxpath", FALSE);
 	if (Config->inboxpath == NULL) Config->inboxpath = emptyPath;
@@ -612,6 +813,18 @@ GSM_Error SMSDFiles_ReadConfiguration(GSM_SMSDConfig *Config)
 	}
 	SMSD_Log(DEBUG_NOTICE, Config, "Inbox is \"%s\" with format \"%s\"", Config->inboxpath, Config->inboxformat);
 
+	str = INI_GetValue(Config->smsdcfgfile, "smsd", "inboxdurability", FALSE);
+	if (str == NULL || strcasecmp(str, "batch") == 0) {
+		Config->inboxdurability = SMSD_DURABILITY_BATCH;
+	} else if (strcasecmp(str, "message") == 0) {
+		Config->inboxdurability = SMSD_DURABILITY_MESSAGE;
+	} else if (strcasecmp(str, "none") == 0) {
+		Config->inboxdurability = SMSD_DURABILITY_NONE;
+	} else {
+		SMSD_Log(DEBUG_ERROR, Config, "Invalid inbox durability \"%s\", using batch", str);
+		Config->inboxdurability = SMSD_DURABILITY_BATCH;
+	}
+
 
 	Config->outboxpath=INI_GetValue(Config->smsdcfgfile, "smsd", "outboxpath", FALSE);
 	if (Config->outboxpath == NULL) Config->outboxpath = emptyPath;
@@ -658,7 +871,9 @@ GSM_SMSDService SMSDFiles = {
 	SMSDFiles_AddSentSMSInfo,
 	NOTIMPLEMENTED,		/* RefreshSendStatus    */
 	NOTIMPLEMENTED,		/* RefreshPhoneStatus   */
-	SMSDFiles_ReadConfiguration
+	SMSDFiles_ReadConfiguration,
+	SMSDFiles_CommitInbox,
+	SMSDFiles_CreateOutboxSMSBatch
 };
 
 /* How should editor handle tabs in this file? Add editor commands here.
@@ -82,8 +82,14 @@ static SQL_Error SMSDMySQL_Connect(GSM_SMSDConfig * Config)
 	int error;
 	char *pport;
 	char *socketname = NULL;
+	char *host;
 
-	pport = strstr(Config->host, ":");
+	/* Configuration is shared with backend writer, parse copy */
+	host = strdup(Config->host);
+	if (host == NULL) {
+		return SQL_FAIL;
+	}
+	pport = strstr(host, ":");
 	if (pport) {
 		*pport++ = '\0';
 		/* Is it port or socket? */
@@ -99,9 +105,11 @@ static SQL_Error SMSDMySQL_Connect(GSM_SMSDConfig * Config)
 	}
 	if (Config->conn.my == NULL) {
 		SMSD_Log(DEBUG_ERROR, Config, "MySQL allocation failed!");
+		free(host);
 		return SQL_FAIL;
 	}
-	if (!mysql_real_connect(Config->conn.my, Config->host, Config->user, Config->password, Config->database, port, socketname, 0)) {
+	if (!mysql_real_connect(Config->conn.my, host, Config->user, Config->password, Config->database, port, socketname, 0)) {
+		free(host);
 		SMSD_Log(DEBUG_ERROR, Config, "Error connecting to database!");
 		SMSDMySQL_LogError(Config);
 		error = mysql_errno(Config->conn.my);
@@ -110,6 +118,7 @@ static SQL_Error SMSDMySQL_Connect(GSM_SMSDConfig * Config)
 		}
 		return SQL_FAIL;
 	}
+	free(host);
 
 	/* Try using utf8mb4 if MySQL server supports it */
 	if (mysql_query(Config->conn.my, "SET NAMES utf8mb4;") != 0) {
@@ -200,6 +209,7 @@ struct GSM_SMSDdbobj SMSDMySQL = {
 	SMSDMySQL_GetDate,
 	SMSDMySQL_GetBool,
 	SMSDMySQL_QuoteString,
+	NULL,
 };
 
 #endif
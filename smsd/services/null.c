@@ -18,7 +18,9 @@ GSM_SMSDService SMSDNull = {
 	NONEFUNCTION,		/* AddSentSMSInfo       */
 	NOTIMPLEMENTED,		/* RefreshSendStatus    */
 	NOTIMPLEMENTED,		/* RefreshPhoneStatus   */
-	NONEFUNCTION		/* ReadConfiguration    */
+	NONEFUNCTION,		/* ReadConfiguration    */
+	NONEFUNCTION,		/* CommitInbox          */
+	NONEFUNCTION		/* CreateOutboxSMSBatch */
 };
 
 /* How should editor handle tabs in this file? Add editor commands here.
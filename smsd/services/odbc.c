@@ -339,6 +339,35 @@ unsigned long SMSDODBC_AffectedRows(GSM_SMSDConfig * Config, SQL_result *res)
 	return count;
 }
 
+/* ODBC has no common statement for transactions, driver API is used */
+static SQL_Error SMSDODBC_Transaction(GSM_SMSDConfig * Config, SQL_Transaction command)
+{
+	SQLRETURN ret;
+	SQL_Error error = SQL_OK;
+
+	if (command == SQL_TRANSACTION_START) {
+		ret = SQLSetConnectAttr(Config->conn.odbc.dbc, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_OFF, 0);
+		if (!SQL_SUCCEEDED(ret)) {
+			SMSDODBC_LogError(Config, ret, SQL_HANDLE_DBC, Config->conn.odbc.dbc, "SQLSetConnectAttr(AUTOCOMMIT_OFF) failed");
+			return SQL_FAIL;
+		}
+		return SQL_OK;
+	}
+
+	ret = SQLEndTran(SQL_HANDLE_DBC, Config->conn.odbc.dbc, command == SQL_TRANSACTION_COMMIT ? SQL_COMMIT : SQL_ROLLBACK);
+	if (!SQL_SUCCEEDED(ret)) {
+		SMSDODBC_LogError(Config, ret, SQL_HANDLE_DBC, Config->conn.odbc.dbc, "SQLEndTran failed");
+		error = SQL_FAIL;
+	}
+
+	ret = SQLSetConnectAttr(Config->conn.odbc.dbc, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_ON, 0);
+	if (!SQL_SUCCEEDED(ret)) {
+		SMSDODBC_LogError(Config, ret, SQL_HANDLE_DBC, Config->conn.odbc.dbc, "SQLSetConnectAttr(AUTOCOMMIT_ON) failed");
+		error = SQL_FAIL;
+	}
+	return error;
+}
+
 struct GSM_SMSDdbobj SMSDODBC = {
 	SMSDODBC_Connect,
 	SMSDODBC_Query,
@@ -352,6 +381,7 @@ struct GSM_SMSDdbobj SMSDODBC = {
 	SMSDODBC_GetDate,
 	SMSDODBC_GetBool,
 	SMSDODBC_QuoteString,
+	SMSDODBC_Transaction,
 };
 
 /* How should editor hadle tabs in this file? Add editor commands here.
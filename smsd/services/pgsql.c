@@ -69,14 +69,18 @@ static SQL_Error SMSDPgSQL_Connect(GSM_SMSDConfig * Config)
 
 	unsigned int port = 5432;
 	char *pport;
+	char host[200];
 
-	pport = strstr(Config->host, ":");
+	/* Configuration is shared with backend writer, parse copy */
+	strncpy(host, Config->host, sizeof(host) - 1);
+	host[sizeof(host) - 1] = 0;
+	pport = strstr(host, ":");
 	if (pport) {
 		*pport++ = '\0';
 		port = atoi(pport);
 	}
 
-	sprintf(buf, "host = '%s' user = '%s' password = '%s' dbname = '%s' port = %d", Config->host, Config->user, Config->password, Config->database, port);
+	sprintf(buf, "host = '%s' user = '%s' password = '%s' dbname = '%s' port = %d", host, Config->user, Config->password, Config->database, port);
 
 	SMSDPgSQL_Free(Config);
 	Config->conn.pg = PQconnectdb(buf);
@@ -197,6 +201,7 @@ struct GSM_SMSDdbobj SMSDPgSQL = {
 	SMSDPgSQL_GetDate,
 	SMSDPgSQL_GetBool,
 	SMSDPgSQL_QuoteString,
+	NULL,
 };
 
 #endif
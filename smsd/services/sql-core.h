@@ -89,6 +89,13 @@ typedef enum {
 	SQL_BUG /* Internal error */
 } SQL_Error;
 
+/* transaction commands */
+typedef enum {
+	SQL_TRANSACTION_START,
+	SQL_TRANSACTION_COMMIT,
+	SQL_TRANSACTION_ROLLBACK
+} SQL_Transaction;
+
 /* types passed to NamedQuery */
 typedef enum {
 	SQL_TYPE_NONE, /* used at end of array */
@@ -150,6 +157,8 @@ struct GSM_SMSDdbobj {
 	time_t (* GetDate)(GSM_SMSDConfig *, SQL_result *, unsigned int);
 	gboolean (* GetBool)(GSM_SMSDConfig *, SQL_result *, unsigned int);
 	char * (* QuoteString)(GSM_SMSDConfig *, const char *);
+	/* NULL if transactions are controlled by SQL statements */
+	SQL_Error (* Transaction)(GSM_SMSDConfig *, SQL_Transaction);
 };
 
 /* database backends */
@@ -208,13 +208,17 @@ static SQL_Error SMSDSQL_Query(GSM_SMSDConfig * Config, const char *query, SQL_r
 	SQL_Error error = SQL_TIMEOUT;
 	int attempts = 1;
 	struct GSM_SMSDdbobj *db = Config->db;
+	unsigned long long query_time;
 
 	for (attempts = 1; attempts <= Config->backend_retries; attempts++) {
 		SMSD_Log(DEBUG_SQL, Config, "Execute SQL: %s", query);
+		query_time = SMSD_MonotonicTime();
 		error = db->Query(Config, query, res);
+		SMSD_MetricsObserve(Config->Status, SMSD_HISTOGRAM_DB_QUERY, SMSD_MonotonicTime() - query_time);
 		if (error == SQL_OK) {
 			return error;
 		}
+		SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_DB_ERRORS, 1);
 
 		if (error != SQL_TIMEOUT){
 			SMSD_Log(DEBUG_INFO, Config, "SQL failure: %d", error);
@@ -222,6 +226,11 @@ static SQL_Error SMSDSQL_Query(GSM_SMSDConfig * Config, const char *query, SQL_r
 		}
 
 		SMSD_Log(DEBUG_INFO, Config, "SQL failed (timeout): %s", query);
+		/* Reconnecting would silently drop open transaction */
+		if (Config->transaction) {
+			SMSD_Log(DEBUG_ERROR, Config, "Connection lost in transaction, aborting it");
+			return error;
+		}
 		/* We will try to reconnect */
 		SMSD_Log(DEBUG_INFO, Config, "reconnecting to database!");
 		while (error != SQL_OK && attempts < Config->backend_retries) {
@@ -229,6 +238,7 @@ static SQL_Error SMSDSQL_Query(GSM_SMSDConfig * Config, const char *query, SQL_r
 			sleep(attempts * attempts);
 			db->Free(Config);
 			error = db->Connect(Config);
+			SMSD_MetricsAdd(Config->Status, SMSD_COUNTER_DB_RECONNECTS, 1);
 			attempts++;
 		}
 	}
@@ -985,6 +995,119 @@ static GSM_Error SMSDSQL_CreateOutboxSMS(GSM_MultiSMSMessage * sms, GSM_SMSDConf
 	return ERR_NONE;
 }
 
+/**
+ * Executes query which does not return any data.
+ */
+static SQL_Error SMSDSQL_Execute(GSM_SMSDConfig * Config, const char *query)
+{
+	SQL_result res;
+	SQL_Error error;
+
+	error = SMSDSQL_Query(Config, query, &res);
+	if (error == SQL_OK) {
+		Config->db->FreeResult(Config, &res);
+	}
+	return error;
+}
+
+/**
+ * Returns statement for transaction command in current SQL dialect,
+ * NULL if it is not known.
+ */
+static const char *SMSDSQL_TransactionQuery(GSM_SMSDConfig * Config, SQL_Transaction command)
+{
+	const char *driver_name;
+
+	driver_name = SMSDSQL_SQLName(Config);
+
+	if (strcasecmp(driver_name, "mysql") == 0 || strcasecmp(driver_name, "native_mysql") == 0) {
+		switch (command) {
+			case SQL_TRANSACTION_START: return "START TRANSACTION";
+			case SQL_TRANSACTION_COMMIT: return "COMMIT";
+			case SQL_TRANSACTION_ROLLBACK: return "ROLLBACK";
+		}
+	} else if (strcasecmp(driver_name, "pgsql") == 0 || strcasecmp(driver_name, "native_pgsql") == 0) {
+		switch (command) {
+			case SQL_TRANSACTION_START: return "BEGIN";
+			case SQL_TRANSACTION_COMMIT: return "COMMIT";
+			case SQL_TRANSACTION_ROLLBACK: return "ROLLBACK";
+		}
+	} else if (strncasecmp(driver_name, "sqlite", 6) == 0) {
+		switch (command) {
+			case SQL_TRANSACTION_START: return "BEGIN TRANSACTION";
+			case SQL_TRANSACTION_COMMIT: return "COMMIT TRANSACTION";
+			case SQL_TRANSACTION_ROLLBACK: return "ROLLBACK TRANSACTION";
+		}
+	} else if (strcasecmp(driver_name, "freetds") == 0) {
+		switch (command) {
+			case SQL_TRANSACTION_START: return "BEGIN TRANSACTION";
+			case SQL_TRANSACTION_COMMIT: return "COMMIT TRANSACTION";
+			case SQL_TRANSACTION_ROLLBACK: return "ROLLBACK TRANSACTION";
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Executes transaction command, either using driver or by statement.
+ */
+static SQL_Error SMSDSQL_Transaction(GSM_SMSDConfig * Config, SQL_Transaction command)
+{
+	const char *query;
+
+	if (Config->db->Transaction != NULL) {
+		return Config->db->Transaction(Config, command);
+	}
+	query = SMSDSQL_TransactionQuery(Config, command);
+	if (query == NULL) {
+		return SQL_BUG;
+	}
+	return SMSDSQL_Execute(Config, query);
+}
+
+/* Adds several SMS to Outbox in single transaction */
+static GSM_Error SMSDSQL_CreateOutboxSMSBatch(GSM_MultiSMSMessage * sms, int count, GSM_SMSDConfig * Config, char **NewIDs)
+{
+	GSM_Error error = ERR_NONE;
+	SQL_Error sql_error;
+	int i;
+
+	if (Config->db->Transaction == NULL && SMSDSQL_TransactionQuery(Config, SQL_TRANSACTION_START) == NULL) {
+		SMSD_Log(DEBUG_ERROR, Config, "Transactions are not supported for %s, can not store messages at once", SMSDSQL_SQLName(Config));
+		return ERR_NOTSUPPORTED;
+	}
+
+	if (SMSDSQL_Transaction(Config, SQL_TRANSACTION_START) != SQL_OK) {
+		SMSD_Log(DEBUG_INFO, Config, "Failed to start transaction (%s)", __FUNCTION__);
+		return ERR_UNKNOWN;
+	}
+	Config->transaction = TRUE;
+
+	for (i = 0; i < count; i++) {
+		error = SMSDSQL_CreateOutboxSMS(&sms[i], Config, NewIDs == NULL ? NULL : NewIDs[i]);
+		if (error != ERR_NONE) {
+			break;
+		}
+	}
+
+	if (error != ERR_NONE) {
+		if (SMSDSQL_Transaction(Config, SQL_TRANSACTION_ROLLBACK) != SQL_OK) {
+			SMSD_Log(DEBUG_INFO, Config, "Failed to rollback transaction (%s)", __FUNCTION__);
+		}
+		Config->transaction = FALSE;
+		return error;
+	}
+
+	sql_error = SMSDSQL_Transaction(Config, SQL_TRANSACTION_COMMIT);
+	Config->transaction = FALSE;
+	if (sql_error != SQL_OK) {
+		SMSD_Log(DEBUG_INFO, Config, "Failed to commit transaction (%s)", __FUNCTION__);
+		return ERR_UNKNOWN;
+	}
+	SMSD_Log(DEBUG_NOTICE, Config, "Written %d messages in single transaction", count);
+	return ERR_NONE;
+}
+
 static GSM_Error SMSDSQL_AddSentSMSInfo(GSM_MultiSMSMessage * sms, GSM_SMSDConfig * Config, char *ID, int Part, GSM_SMSDSendingError err, int TPMR)
 {
 	SQL_result res;
@@ -1194,7 +1317,7 @@ GSM_Error SMSDSQL_ReadConfiguration(GSM_SMSDConfig *Config)
 	escape_char = SMSDSQL_EscapeChar(Config);
 #define ESCAPE_FIELD(x) escape_char, x, escape_char
 
-	locktime = Config->loopsleep * 8; /* reserve 8 sec per message */
+	locktime = Config->loopsleep * 8 / 1000; /* reserve 8 sec per message */
 	locktime = locktime < 60 ? 60 : locktime; /* Minimum time reserve is 60 sec */
 
 	if (SMSDSQL_option(Config, SQL_QUERY_DELETE_PHONE, "delete_phone",
@@ -1465,7 +1588,9 @@ GSM_SMSDService SMSDSQL = {
 	SMSDSQL_AddSentSMSInfo,
 	SMSDSQL_RefreshSendStatus,
 	SMSDSQL_RefreshPhoneStatus,
-	SMSDSQL_ReadConfiguration
+	SMSDSQL_ReadConfiguration,
+	NONEFUNCTION,		/* CommitInbox          */
+	SMSDSQL_CreateOutboxSMSBatch
 };
 
 /* How should editor hadle tabs in this file? Add editor commands here.
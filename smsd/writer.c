@@ -0,0 +1,1213 @@
+/**
+ * SMSD asynchronous backend writer
+ *
+ * Modem loop only appends records to journal and in-memory queue, the
+ * writer thread stores them in the backend using its own connection.
+ * Records are removed from journal once they are written, so nothing
+ * is lost while the backend is not reachable or when daemon is
+ * restarted.
+ */
+/* Licensend under GNU GPL 2 */
+
+#include <gammu-config.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#ifdef WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+#include "core.h"
+#include "writer.h"
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+#include "services/sql.h"
+#endif
+
+#ifdef HAVE_PTHREAD
+
+#define SMSD_JOURNAL_MAGIC "GSMDJRN"
+#define SMSD_JOURNAL_VERSION 1
+#define SMSD_RECORD_MAGIC 0x4a52534d
+
+/**
+ * Longest delay between retries of failed record in seconds.
+ */
+#define SMSD_WRITER_MAX_BACKOFF 60
+
+/**
+ * Journal is compacted once it contains at least this many bytes of
+ * written records and more than it contains queued ones.
+ */
+#define SMSD_JOURNAL_COMPACT_SIZE (256 * 1024)
+
+typedef enum {
+	SMSD_RECORD_INBOX = 1,
+	SMSD_RECORD_SENT,
+	SMSD_RECORD_MOVE,
+	SMSD_RECORD_SEND_STATUS,
+	SMSD_RECORD_PHONE_STATUS,
+	/**
+	 * Marks record with same sequence as written.
+	 */
+	SMSD_RECORD_DONE
+} SMSD_RecordType;
+
+typedef struct {
+	char Magic[8];
+	int Version;
+	/**
+	 * Journal is not portable, records contain raw messages.
+	 */
+	int SMSSize;
+} SMSD_JournalHeader;
+
+typedef struct {
+	unsigned int Magic;
+	int Type;
+	unsigned int Sequence;
+	unsigned int Size;
+	unsigned int Checksum;
+} SMSD_JournalRecord;
+
+/**
+ * Parameters of queued service call, followed by Number messages.
+ */
+typedef struct {
+	int Part;
+	int Error;
+	int TPMR;
+	int AlwaysDelete;
+	int Sent;
+	char ID[200];
+	char DT[40];
+	int Number;
+} SMSD_RecordData;
+
+typedef struct _SMSD_QueueEntry {
+	SMSD_RecordType Type;
+	unsigned int Sequence;
+	/**
+	 * Offset of payload in journal, -1 for records not journaled.
+	 */
+	long Offset;
+	size_t Size;
+	/**
+	 * Payload, NULL if it is kept only in journal.
+	 */
+	SMSD_RecordData *Data;
+	struct _SMSD_QueueEntry *Next;
+} SMSD_QueueEntry;
+
+struct _SMSD_Writer {
+	/**
+	 * Service doing actual writes.
+	 */
+	GSM_SMSDService *Backend;
+	/**
+	 * Configuration of main loop, which keeps its own backend
+	 * connection for reading outbox.
+	 */
+	GSM_SMSDConfig *Main;
+	/**
+	 * Copy of configuration with backend connection used only by
+	 * writer thread.
+	 */
+	GSM_SMSDConfig Config;
+	FILE *journal;
+	/**
+	 * Whether journal contains anything besides header.
+	 */
+	gboolean journal_used;
+	/**
+	 * Size of journal and of records in it which are still queued.
+	 */
+	long journal_size;
+	long journal_live;
+	pthread_t thread;
+	/**
+	 * Protects queue and journal.
+	 */
+	pthread_mutex_t queue_lock;
+	pthread_cond_t queue_cond;
+	SMSD_QueueEntry *head, *tail;
+	int queued;
+	int in_memory;
+	/**
+	 * Number of queued MoveSMS calls, outbox is not read until they
+	 * are written to avoid sending message twice.
+	 */
+	int pending_moves;
+	unsigned int sequence;
+	gboolean stop;
+};
+
+static unsigned int SMSD_JournalChecksum(const void *data, size_t size)
+{
+	const unsigned char *pos = data;
+	unsigned int hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= pos[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static gboolean SMSD_JournalSync(FILE *file)
+{
+	if (fflush(file) != 0) {
+		return FALSE;
+	}
+#ifdef WIN32
+	return _commit(fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+static size_t SMSD_RecordMaxSize(void)
+{
+	return sizeof(SMSD_RecordData) + GSM_MAX_MULTI_SMS * sizeof(GSM_SMSMessage);
+}
+
+/**
+ * Appends record to journal, has to be called with queue lock held.
+ */
+static GSM_Error SMSD_JournalAppend(GSM_SMSDConfig *Config, SMSD_RecordType type, unsigned int sequence, const void *data, size_t size, long *offset)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_JournalRecord record;
+	long start;
+
+	if (w->journal == NULL) {
+		return ERR_WRITING_FILE;
+	}
+	if (fseek(w->journal, 0, SEEK_END) != 0) {
+		goto fail;
+	}
+	start = ftell(w->journal);
+
+	record.Magic = SMSD_RECORD_MAGIC;
+	record.Type = type;
+	record.Sequence = sequence;
+	record.Size = size;
+	record.Checksum = SMSD_JournalChecksum(data, size);
+
+	if (fwrite(&record, sizeof(record), 1, w->journal) != 1) {
+		goto fail_truncate;
+	}
+	if (offset != NULL) {
+		*offset = start + sizeof(record);
+	}
+	if (size > 0 && fwrite(data, size, 1, w->journal) != 1) {
+		goto fail_truncate;
+	}
+	if (fflush(w->journal) != 0) {
+		goto fail_truncate;
+	}
+	w->journal_used = TRUE;
+	w->journal_size = start + sizeof(record) + size;
+	return ERR_NONE;
+
+fail_truncate:
+	/* Do not leave torn record, it would hide following ones */
+	fflush(w->journal);
+	if (ftruncate(fileno(w->journal), start) != 0) {
+		SMSD_LogErrno(Config, "Failed to truncate journal");
+	}
+fail:
+	SMSD_LogErrno(Config, "Failed to write to journal");
+	return ERR_WRITING_FILE;
+}
+
+/**
+ * Reads payload of record back from journal, has to be called with
+ * queue lock held.
+ */
+static SMSD_RecordData *SMSD_JournalLoad(GSM_SMSDConfig *Config, SMSD_QueueEntry *entry)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_RecordData *data;
+
+	data = (SMSD_RecordData *)malloc(entry->Size);
+	if (data == NULL) {
+		return NULL;
+	}
+	if (fseek(w->journal, entry->Offset, SEEK_SET) != 0 ||
+			fread(data, entry->Size, 1, w->journal) != 1) {
+		SMSD_LogErrno(Config, "Failed to read from journal");
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+static void SMSD_WriterFreeEntry(struct _SMSD_Writer *w, SMSD_QueueEntry *entry)
+{
+	if (entry->Offset >= 0) {
+		w->journal_live -= sizeof(SMSD_JournalRecord) + entry->Size;
+	}
+	if (entry->Data != NULL) {
+		w->in_memory--;
+		free(entry->Data);
+	}
+	free(entry);
+}
+
+/**
+ * Adds entry to end of queue, has to be called with queue lock held.
+ */
+static void SMSD_WriterLink(GSM_SMSDConfig *Config, SMSD_QueueEntry *entry)
+{
+	struct _SMSD_Writer *w = Config->writer;
+
+	/* Keep only limited number of records in memory */
+	if (entry->Data != NULL && entry->Offset >= 0 && w->in_memory >= Config->backend_queue_size) {
+		free(entry->Data);
+		entry->Data = NULL;
+	}
+	if (entry->Data != NULL) {
+		w->in_memory++;
+	}
+	if (entry->Offset >= 0) {
+		w->journal_live += sizeof(SMSD_JournalRecord) + entry->Size;
+	}
+
+	entry->Next = NULL;
+	if (w->tail == NULL) {
+		w->head = entry;
+	} else {
+		w->tail->Next = entry;
+	}
+	w->tail = entry;
+	w->queued++;
+	if (entry->Type == SMSD_RECORD_MOVE) {
+		w->pending_moves++;
+	}
+}
+
+/**
+ * Removes first entry from queue, has to be called with queue lock
+ * held.
+ */
+static void SMSD_WriterUnlink(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_QueueEntry *entry = w->head;
+
+	if (entry->Offset >= 0) {
+		SMSD_JournalAppend(Config, SMSD_RECORD_DONE, entry->Sequence, NULL, 0, NULL);
+	}
+	if (entry->Type == SMSD_RECORD_MOVE) {
+		w->pending_moves--;
+		/* Outbox can be read again */
+		if (w->pending_moves == 0) {
+			SMSD_WakeUp(w->Main);
+		}
+	}
+	w->head = entry->Next;
+	if (w->head == NULL) {
+		w->tail = NULL;
+	}
+	w->queued--;
+	SMSD_WriterFreeEntry(w, entry);
+}
+
+static void SMSD_JournalHeaderInit(SMSD_JournalHeader *header)
+{
+	memset(header, 0, sizeof(SMSD_JournalHeader));
+	strcpy(header->Magic, SMSD_JOURNAL_MAGIC);
+	header->Version = SMSD_JOURNAL_VERSION;
+	header->SMSSize = sizeof(GSM_SMSMessage);
+}
+
+/**
+ * Loads records which were not written in previous run and drops
+ * torn record at the end of journal.
+ */
+static GSM_Error SMSD_JournalOpen(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_JournalHeader header;
+	SMSD_JournalRecord record;
+	SMSD_QueueEntry *entry, *prev;
+	SMSD_RecordData *data;
+	long valid_end;
+
+	w->journal = fopen(Config->backend_journal, "r+b");
+	if (w->journal == NULL && errno == ENOENT) {
+		w->journal = fopen(Config->backend_journal, "w+b");
+	}
+	if (w->journal == NULL) {
+		SMSD_LogErrno(Config, "Failed to open journal");
+		return ERR_CANTOPENFILE;
+	}
+
+	if (fread(&header, sizeof(header), 1, w->journal) != 1) {
+		/* New journal */
+		SMSD_JournalHeaderInit(&header);
+		if (fseek(w->journal, 0, SEEK_SET) != 0 ||
+				ftruncate(fileno(w->journal), 0) != 0 ||
+				fwrite(&header, sizeof(header), 1, w->journal) != 1 ||
+				!SMSD_JournalSync(w->journal)) {
+			SMSD_LogErrno(Config, "Failed to create journal");
+			return ERR_WRITING_FILE;
+		}
+		w->journal_size = sizeof(header);
+		return ERR_NONE;
+	}
+	if (strcmp(header.Magic, SMSD_JOURNAL_MAGIC) != 0 ||
+			header.Version != SMSD_JOURNAL_VERSION ||
+			header.SMSSize != sizeof(GSM_SMSMessage)) {
+		SMSD_Log(DEBUG_ERROR, Config, "Journal %s was written by incompatible version of SMSD!", Config->backend_journal);
+		return ERR_FILENOTSUPPORTED;
+	}
+
+	valid_end = ftell(w->journal);
+	while (fread(&record, sizeof(record), 1, w->journal) == 1) {
+		if (record.Magic != SMSD_RECORD_MAGIC ||
+				record.Type < SMSD_RECORD_INBOX ||
+				record.Type > SMSD_RECORD_DONE ||
+				record.Size > SMSD_RecordMaxSize()) {
+			break;
+		}
+		if (record.Type == SMSD_RECORD_DONE) {
+			prev = NULL;
+			for (entry = w->head; entry != NULL; prev = entry, entry = entry->Next) {
+				if (entry->Sequence == record.Sequence) {
+					break;
+				}
+			}
+			if (entry != NULL) {
+				if (prev == NULL) {
+					w->head = entry->Next;
+				} else {
+					prev->Next = entry->Next;
+				}
+				if (w->tail == entry) {
+					w->tail = prev;
+				}
+				w->queued--;
+				if (entry->Type == SMSD_RECORD_MOVE) {
+					w->pending_moves--;
+				}
+				SMSD_WriterFreeEntry(w, entry);
+			}
+			valid_end = ftell(w->journal);
+			continue;
+		}
+		if (record.Size < sizeof(SMSD_RecordData)) {
+			break;
+		}
+		data = (SMSD_RecordData *)malloc(record.Size);
+		entry = (SMSD_QueueEntry *)malloc(sizeof(SMSD_QueueEntry));
+		if (data == NULL || entry == NULL) {
+			free(data);
+			free(entry);
+			return ERR_MOREMEMORY;
+		}
+		entry->Offset = ftell(w->journal);
+		if (fread(data, record.Size, 1, w->journal) != 1 ||
+				SMSD_JournalChecksum(data, record.Size) != record.Checksum) {
+			free(data);
+			free(entry);
+			break;
+		}
+		entry->Type = record.Type;
+		entry->Sequence = record.Sequence;
+		entry->Size = record.Size;
+		entry->Data = data;
+		SMSD_WriterLink(Config, entry);
+		if (record.Sequence >= w->sequence) {
+			w->sequence = record.Sequence + 1;
+		}
+		valid_end = ftell(w->journal);
+	}
+
+	fflush(w->journal);
+	if (ftruncate(fileno(w->journal), valid_end) != 0) {
+		SMSD_LogErrno(Config, "Failed to truncate journal");
+		return ERR_WRITING_FILE;
+	}
+	w->journal_used = (valid_end > (long)sizeof(header));
+	w->journal_size = valid_end;
+	if (w->queued > 0) {
+		SMSD_Log(DEBUG_INFO, Config, "Replaying %d records from journal", w->queued);
+	}
+	return ERR_NONE;
+}
+
+/**
+ * Journaled record taken into compacted journal.
+ */
+typedef struct {
+	SMSD_QueueEntry *Entry;
+	/**
+	 * Offset of payload in old and new journal.
+	 */
+	long Offset;
+	long NewOffset;
+	size_t Size;
+} SMSD_CompactRecord;
+
+/**
+ * Number of attempts to catch up with records appended while
+ * compacted journal is being written.
+ */
+#define SMSD_JOURNAL_COMPACT_ROUNDS 3
+
+/**
+ * Copies part of old journal to end of new one.
+ */
+static gboolean SMSD_JournalCopy(FILE *from, long offset, long size, FILE *to)
+{
+	char buffer[4096];
+	size_t chunk;
+
+	if (fseek(from, offset, SEEK_SET) != 0) {
+		return FALSE;
+	}
+	while (size > 0) {
+		chunk = size > (long)sizeof(buffer) ? sizeof(buffer) : (size_t)size;
+		if (fread(buffer, chunk, 1, from) != 1 || fwrite(buffer, chunk, 1, to) != 1) {
+			return FALSE;
+		}
+		size -= chunk;
+	}
+	return TRUE;
+}
+
+/**
+ * Rewrites journal with only queued records once written ones take
+ * most of it, has to be called with queue lock held.
+ *
+ * Queued records are listed under the lock, but they are copied and
+ * synced to new journal without it, so enqueueing is not blocked by
+ * disk writes. Records appended meanwhile are copied afterwards as
+ * well, the lock is taken again only to rename new journal over old
+ * one, so crash during compaction leaves either of them complete.
+ * Only writer thread removes records from journal, so listed ones stay
+ * in place while the lock is released.
+ */
+static void SMSD_JournalCompact(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_JournalHeader header;
+	SMSD_QueueEntry *entry, *last = NULL;
+	SMSD_CompactRecord *records;
+	FILE *file, *old;
+	char *name;
+	long dead, offset, copied, end, shift;
+	int count = 0, i, round;
+	gboolean ok = TRUE;
+
+	dead = w->journal_size - sizeof(SMSD_JournalHeader) - w->journal_live;
+	if (w->journal == NULL || dead < SMSD_JOURNAL_COMPACT_SIZE || dead <= w->journal_live) {
+		return;
+	}
+
+	/* List queued records */
+	records = (SMSD_CompactRecord *)malloc((w->queued + 1) * sizeof(SMSD_CompactRecord));
+	name = (char *)malloc(strlen(Config->backend_journal) + 5);
+	if (records == NULL || name == NULL) {
+		free(records);
+		free(name);
+		return;
+	}
+	offset = sizeof(SMSD_JournalHeader);
+	for (entry = w->head; entry != NULL; entry = entry->Next) {
+		if (entry->Offset < 0) {
+			continue;
+		}
+		records[count].Entry = entry;
+		records[count].Offset = entry->Offset;
+		records[count].Size = entry->Size;
+		records[count].NewOffset = offset + sizeof(SMSD_JournalRecord);
+		offset = records[count].NewOffset + entry->Size;
+		count++;
+	}
+	last = w->tail;
+	copied = w->journal_size;
+	fflush(w->journal);
+	pthread_mutex_unlock(&w->queue_lock);
+
+	/* Write new journal without blocking enqueueing */
+	sprintf(name, "%s.new", Config->backend_journal);
+	old = fopen(Config->backend_journal, "rb");
+	file = fopen(name, "w+b");
+	if (old == NULL || file == NULL) {
+		SMSD_LogErrno(Config, "Failed to create compacted journal");
+		ok = FALSE;
+	} else {
+		SMSD_JournalHeaderInit(&header);
+		ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+		for (i = 0; ok && i < count; i++) {
+			ok = SMSD_JournalCopy(old, records[i].Offset - sizeof(SMSD_JournalRecord),
+				sizeof(SMSD_JournalRecord) + records[i].Size, file);
+		}
+		if (ok) {
+			ok = SMSD_JournalSync(file);
+		}
+	}
+
+	/* Catch up with records appended meanwhile */
+	shift = offset - copied;
+	for (round = 0; TRUE; round++) {
+		pthread_mutex_lock(&w->queue_lock);
+		end = w->journal_size;
+		if (!ok || end == copied || round >= SMSD_JOURNAL_COMPACT_ROUNDS) {
+			break;
+		}
+		fflush(w->journal);
+		pthread_mutex_unlock(&w->queue_lock);
+		ok = (SMSD_JournalCopy(old, copied, end - copied, file) && SMSD_JournalSync(file));
+		copied = end;
+	}
+	if (old != NULL) {
+		fclose(old);
+	}
+	if (ok && end != copied) {
+		SMSD_Log(DEBUG_INFO, Config, "Journal is growing too fast, not compacting it now");
+		ok = FALSE;
+	} else if (!ok) {
+		SMSD_LogErrno(Config, "Failed to write compacted journal");
+	}
+	if (!ok) {
+		if (file != NULL) {
+			fclose(file);
+			remove(name);
+		}
+		free(records);
+		free(name);
+		return;
+	}
+
+#ifdef WIN32
+	/* Open file can not be replaced on Windows */
+	fclose(file);
+	fclose(w->journal);
+	ok = MoveFileEx(name, Config->backend_journal, MOVEFILE_REPLACE_EXISTING);
+	w->journal = fopen(Config->backend_journal, "r+b");
+	if (w->journal == NULL) {
+		SMSD_LogErrno(Config, "Failed to reopen journal");
+	}
+#else
+	ok = (rename(name, Config->backend_journal) == 0);
+	if (ok) {
+		fclose(w->journal);
+		w->journal = file;
+	} else {
+		fclose(file);
+	}
+#endif
+	if (!ok) {
+		SMSD_LogErrno(Config, "Failed to replace journal");
+		remove(name);
+		free(records);
+		free(name);
+		return;
+	}
+	free(name);
+
+	/* Listed records keep queue order, appended ones are shifted */
+	for (i = 0; i < count; i++) {
+		records[i].Entry->Offset = records[i].NewOffset;
+	}
+	free(records);
+	entry = (last == NULL) ? w->head : last->Next;
+	for (; entry != NULL; entry = entry->Next) {
+		if (entry->Offset >= 0) {
+			entry->Offset += shift;
+		}
+	}
+	w->journal_size = end + shift;
+	w->journal_used = (w->journal_size > (long)sizeof(SMSD_JournalHeader));
+	SMSD_Log(DEBUG_INFO, Config, "Compacted journal, %ld bytes of written records dropped", dead);
+}
+
+/**
+ * Performs queued service call.
+ */
+static GSM_Error SMSD_WriterApply(struct _SMSD_Writer *w, SMSD_QueueEntry *entry, gboolean commit)
+{
+	GSM_SMSDConfig *Config = &w->Config;
+	SMSD_RecordData *data = entry->Data;
+	GSM_MultiSMSMessage *sms;
+	GSM_Error error = ERR_NONE;
+	char *locations = NULL;
+
+	sms = (GSM_MultiSMSMessage *)malloc(sizeof(GSM_MultiSMSMessage));
+	if (sms == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	sms->Number = data->Number;
+	memcpy(sms->SMS, data + 1, data->Number * sizeof(GSM_SMSMessage));
+
+	switch (entry->Type) {
+		case SMSD_RECORD_INBOX:
+			error = w->Backend->SaveInboxSMS(sms, Config, &locations);
+			if (error == ERR_NONE && commit) {
+				error = w->Backend->CommitInbox(Config);
+			}
+			break;
+		case SMSD_RECORD_SENT:
+			/* Values of main loop at time of queueing, only writer uses this copy */
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+			strcpy(Config->DT, data->DT);
+#endif
+			strcpy((char *)Config->SMSID, data->ID);
+			error = w->Backend->AddSentSMSInfo(sms, Config, data->ID, data->Part, data->Error, data->TPMR);
+			break;
+		case SMSD_RECORD_MOVE:
+			error = w->Backend->MoveSMS(sms, Config, data->ID, data->AlwaysDelete, data->Sent);
+			break;
+		case SMSD_RECORD_SEND_STATUS:
+			error = w->Backend->RefreshSendStatus(Config, data->ID);
+			break;
+		case SMSD_RECORD_PHONE_STATUS:
+			error = w->Backend->RefreshPhoneStatus(Config);
+			break;
+		case SMSD_RECORD_DONE:
+			break;
+	}
+
+	/* RunOnReceive handling, now the message is stored */
+	if (entry->Type == SMSD_RECORD_INBOX && error == ERR_NONE && Config->RunOnReceive != NULL) {
+		SMSD_RunOn(Config->RunOnReceive, sms, Config, locations);
+	}
+	free(locations);
+	free(sms);
+	return error;
+}
+
+/**
+ * Decides what to do with record which could not be written. Returns
+ * TRUE if it should be dropped.
+ */
+static gboolean SMSD_WriterGiveUp(GSM_SMSDConfig *Config, SMSD_QueueEntry *entry, GSM_Error error, int failures)
+{
+	/* Backend does not do this at all */
+	if (error == ERR_NOTIMPLEMENTED || error == ERR_NOTSUPPORTED) {
+		return TRUE;
+	}
+	SMSD_Log(DEBUG_INFO, Config, "Failed to write queued record to backend: %s", GSM_ErrorString(error));
+	/* Refreshes are repeated by main loop anyway */
+	if (entry->Type == SMSD_RECORD_SEND_STATUS || entry->Type == SMSD_RECORD_PHONE_STATUS) {
+		return TRUE;
+	}
+	/* Received messages are already deleted from phone, keep trying */
+	if (entry->Type == SMSD_RECORD_INBOX || failures < Config->backend_retries) {
+		return FALSE;
+	}
+	/* Same fallback as synchronous sending does */
+	if (entry->Type == SMSD_RECORD_MOVE && !entry->Data->AlwaysDelete) {
+		SMSD_Log(DEBUG_INFO, Config, "Failed to move %s, moving to error box", entry->Data->ID);
+		entry->Data->AlwaysDelete = TRUE;
+		entry->Data->Sent = FALSE;
+		return FALSE;
+	}
+	SMSD_Log(DEBUG_ERROR, Config, "Giving up writing record %u to backend", entry->Sequence);
+	return TRUE;
+}
+
+static void *SMSD_WriterThread(void *arg)
+{
+	GSM_SMSDConfig *Config = arg;
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_QueueEntry *entry;
+	GSM_Error error;
+	struct timeval now;
+	struct timespec retry_at;
+	int failures = 0, backoff = 1;
+	gboolean commit;
+
+	pthread_mutex_lock(&w->queue_lock);
+	while (TRUE) {
+		entry = w->head;
+		if (entry == NULL) {
+			/* Everything is written, start journal from scratch */
+			if (w->journal_used) {
+				fflush(w->journal);
+				if (ftruncate(fileno(w->journal), sizeof(SMSD_JournalHeader)) == 0) {
+					w->journal_used = FALSE;
+				}
+			}
+			if (w->stop) {
+				break;
+			}
+			pthread_cond_wait(&w->queue_cond, &w->queue_lock);
+			continue;
+		}
+		/* Stop on shutdown unless backend keeps up */
+		if (w->stop && failures > 0) {
+			break;
+		}
+		if (entry->Data == NULL) {
+			entry->Data = SMSD_JournalLoad(Config, entry);
+			if (entry->Data == NULL) {
+				SMSD_Log(DEBUG_ERROR, Config, "Dropping record %u which can not be read from journal", entry->Sequence);
+				SMSD_WriterUnlink(Config);
+				continue;
+			}
+			w->in_memory++;
+		}
+		commit = (entry->Next == NULL || entry->Next->Type != SMSD_RECORD_INBOX);
+		pthread_mutex_unlock(&w->queue_lock);
+
+		error = SMSD_WriterApply(w, entry, commit);
+
+		pthread_mutex_lock(&w->queue_lock);
+		if (error == ERR_NONE) {
+			if (failures > 0) {
+				SMSD_Log(DEBUG_INFO, Config, "Backend is writable again, %d records queued", w->queued);
+			}
+			failures = 0;
+			backoff = 1;
+			SMSD_WriterUnlink(Config);
+			SMSD_JournalCompact(Config);
+			continue;
+		}
+		failures++;
+		if (SMSD_WriterGiveUp(Config, entry, error, failures)) {
+			failures = 0;
+			backoff = 1;
+			SMSD_WriterUnlink(Config);
+			SMSD_JournalCompact(Config);
+			continue;
+		}
+		if (w->stop) {
+			break;
+		}
+		/* Wait before next attempt, new records do not wake us */
+		gettimeofday(&now, NULL);
+		retry_at.tv_sec = now.tv_sec + backoff;
+		retry_at.tv_nsec = now.tv_usec * 1000;
+		while (!w->stop && pthread_cond_timedwait(&w->queue_cond, &w->queue_lock, &retry_at) != ETIMEDOUT);
+		if (backoff < SMSD_WRITER_MAX_BACKOFF) {
+			backoff *= 2;
+		}
+	}
+	pthread_mutex_unlock(&w->queue_lock);
+	return NULL;
+}
+
+/**
+ * Queues service call, payload is owned by queue afterwards.
+ */
+static GSM_Error SMSD_WriterEnqueue(GSM_SMSDConfig *Config, SMSD_RecordType type, SMSD_RecordData *data, size_t size, gboolean durable)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_QueueEntry *entry;
+	GSM_Error error;
+
+	entry = (SMSD_QueueEntry *)malloc(sizeof(SMSD_QueueEntry));
+	if (entry == NULL) {
+		free(data);
+		return ERR_MOREMEMORY;
+	}
+	entry->Type = type;
+	entry->Size = size;
+	entry->Data = data;
+	entry->Offset = -1;
+
+	pthread_mutex_lock(&w->queue_lock);
+	entry->Sequence = w->sequence++;
+	if (durable) {
+		error = SMSD_JournalAppend(Config, type, entry->Sequence, data, size, &entry->Offset);
+		if (error != ERR_NONE) {
+			pthread_mutex_unlock(&w->queue_lock);
+			free(data);
+			free(entry);
+			return error;
+		}
+	}
+	SMSD_WriterLink(Config, entry);
+	pthread_cond_signal(&w->queue_cond);
+	pthread_mutex_unlock(&w->queue_lock);
+	return ERR_NONE;
+}
+
+/**
+ * Allocates payload for queued service call.
+ */
+static SMSD_RecordData *SMSD_WriterPack(GSM_MultiSMSMessage *sms, const char *ID, size_t *size)
+{
+	SMSD_RecordData *data;
+	int number = (sms == NULL) ? 0 : sms->Number;
+
+	*size = sizeof(SMSD_RecordData) + number * sizeof(GSM_SMSMessage);
+	data = (SMSD_RecordData *)calloc(1, *size);
+	if (data == NULL) {
+		return NULL;
+	}
+	data->Number = number;
+	if (number > 0) {
+		memcpy(data + 1, sms->SMS, number * sizeof(GSM_SMSMessage));
+	}
+	if (ID != NULL) {
+		strncpy(data->ID, ID, sizeof(data->ID) - 1);
+	}
+	return data;
+}
+
+static GSM_Error SMSDWriter_Init(GSM_SMSDConfig *Config)
+{
+	return Config->writer->Backend->Init(Config);
+}
+
+static GSM_Error SMSDWriter_Free(GSM_SMSDConfig *Config)
+{
+	SMSD_WriterStop(Config);
+	return Config->Service->Free(Config);
+}
+
+static GSM_Error SMSDWriter_InitAfterConnect(GSM_SMSDConfig *Config)
+{
+	return Config->writer->Backend->InitAfterConnect(Config);
+}
+
+static GSM_Error SMSDWriter_SaveInboxSMS(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char **Locations)
+{
+	SMSD_RecordData *data;
+	size_t size;
+
+	/* Locations are passed to RunOnReceive by writer */
+	*Locations = NULL;
+
+	data = SMSD_WriterPack(sms, NULL, &size);
+	if (data == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	return SMSD_WriterEnqueue(Config, SMSD_RECORD_INBOX, data, size, TRUE);
+}
+
+static GSM_Error SMSDWriter_FindOutboxSMS(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char *ID)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	int pending;
+
+	pthread_mutex_lock(&w->queue_lock);
+	pending = w->pending_moves;
+	pthread_mutex_unlock(&w->queue_lock);
+	if (pending > 0) {
+		SMSD_Log(DEBUG_NOTICE, Config, "Waiting for %d messages to be moved in backend", pending);
+		return ERR_BUSY;
+	}
+
+	return w->Backend->FindOutboxSMS(sms, Config, ID);
+}
+
+static GSM_Error SMSDWriter_MoveSMS(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char *ID, gboolean alwaysDelete, gboolean sent)
+{
+	SMSD_RecordData *data;
+	size_t size;
+
+	data = SMSD_WriterPack(sms, ID, &size);
+	if (data == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	data->AlwaysDelete = alwaysDelete;
+	data->Sent = sent;
+	return SMSD_WriterEnqueue(Config, SMSD_RECORD_MOVE, data, size, TRUE);
+}
+
+static GSM_Error SMSDWriter_CreateOutboxSMS(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char *NewID)
+{
+	return Config->writer->Backend->CreateOutboxSMS(sms, Config, NewID);
+}
+
+static GSM_Error SMSDWriter_CreateOutboxSMSBatch(GSM_MultiSMSMessage *sms, int count, GSM_SMSDConfig *Config, char **NewIDs)
+{
+	return Config->writer->Backend->CreateOutboxSMSBatch(sms, count, Config, NewIDs);
+}
+
+static GSM_Error SMSDWriter_AddSentSMSInfo(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char *ID, int Part, GSM_SMSDSendingError err, int TPMR)
+{
+	SMSD_RecordData *data;
+	size_t size;
+
+	data = SMSD_WriterPack(sms, ID, &size);
+	if (data == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	data->Part = Part;
+	data->Error = err;
+	data->TPMR = TPMR;
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	strcpy(data->DT, Config->DT);
+#endif
+	return SMSD_WriterEnqueue(Config, SMSD_RECORD_SENT, data, size, TRUE);
+}
+
+/**
+ * Checks whether same refresh is already waiting at end of queue.
+ */
+static gboolean SMSD_WriterQueued(GSM_SMSDConfig *Config, SMSD_RecordType type, const char *ID)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	gboolean ret;
+
+	pthread_mutex_lock(&w->queue_lock);
+	ret = (w->tail != NULL && w->tail != w->head && w->tail->Type == type &&
+		(ID == NULL || strcmp(w->tail->Data->ID, ID) == 0));
+	pthread_mutex_unlock(&w->queue_lock);
+	return ret;
+}
+
+static GSM_Error SMSDWriter_RefreshSendStatus(GSM_SMSDConfig *Config, char *ID)
+{
+	SMSD_RecordData *data;
+	size_t size;
+
+	if (SMSD_WriterQueued(Config, SMSD_RECORD_SEND_STATUS, ID)) {
+		return ERR_NONE;
+	}
+	data = SMSD_WriterPack(NULL, ID, &size);
+	if (data == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	return SMSD_WriterEnqueue(Config, SMSD_RECORD_SEND_STATUS, data, size, FALSE);
+}
+
+static GSM_Error SMSDWriter_RefreshPhoneStatus(GSM_SMSDConfig *Config)
+{
+	SMSD_RecordData *data;
+	size_t size;
+
+	if (SMSD_WriterQueued(Config, SMSD_RECORD_PHONE_STATUS, NULL)) {
+		return ERR_NONE;
+	}
+	data = SMSD_WriterPack(NULL, NULL, &size);
+	if (data == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	return SMSD_WriterEnqueue(Config, SMSD_RECORD_PHONE_STATUS, data, size, FALSE);
+}
+
+static GSM_Error SMSDWriter_ReadConfiguration(GSM_SMSDConfig *Config)
+{
+	return Config->writer->Backend->ReadConfiguration(Config);
+}
+
+/**
+ * Received messages are durable once they are in journal.
+ */
+static GSM_Error SMSDWriter_CommitInbox(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	gboolean ret;
+
+	pthread_mutex_lock(&w->queue_lock);
+	ret = SMSD_JournalSync(w->journal);
+	pthread_mutex_unlock(&w->queue_lock);
+	if (!ret) {
+		SMSD_LogErrno(Config, "Failed to sync journal");
+		return ERR_WRITING_FILE;
+	}
+	return ERR_NONE;
+}
+
+static GSM_SMSDService SMSDWriter = {
+	SMSDWriter_Init,
+	SMSDWriter_Free,
+	SMSDWriter_InitAfterConnect,
+	SMSDWriter_SaveInboxSMS,
+	SMSDWriter_FindOutboxSMS,
+	SMSDWriter_MoveSMS,
+	SMSDWriter_CreateOutboxSMS,
+	SMSDWriter_AddSentSMSInfo,
+	SMSDWriter_RefreshSendStatus,
+	SMSDWriter_RefreshPhoneStatus,
+	SMSDWriter_ReadConfiguration,
+	SMSDWriter_CommitInbox,
+	SMSDWriter_CreateOutboxSMSBatch
+};
+
+/**
+ * Prepares copy of configuration for writer thread with its own
+ * backend connection, so that backend calls from main loop do not wait
+ * for writer.
+ */
+static GSM_Error SMSD_WriterConnect(struct _SMSD_Writer *w, GSM_SMSDConfig *Config)
+{
+	GSM_SMSDConfig *Copy = &w->Config;
+	GSM_Error error;
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	int i;
+#endif
+
+	memcpy(Copy, Config, sizeof(GSM_SMSDConfig));
+
+	/* Nothing backend changes can be shared with main loop */
+	GSM_StringArray_New(&Copy->inboxpending);
+	Copy->gammu_log_buffer = NULL;
+	Copy->gammu_log_buffer_size = 0;
+	Copy->connected = FALSE;
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	if (w->Backend == &SMSDSQL) {
+		memset(&Copy->conn, 0, sizeof(Copy->conn));
+		for (i = 0; i < SQL_QUERY_LAST_NO; i++) {
+			Copy->SMSDSQL_queries[i] = NULL;
+		}
+		for (i = 0; i < SQL_QUERY_LAST_NO; i++) {
+			if (Config->SMSDSQL_queries[i] == NULL) {
+				continue;
+			}
+			Copy->SMSDSQL_queries[i] = strdup(Config->SMSDSQL_queries[i]);
+			if (Copy->SMSDSQL_queries[i] == NULL) {
+				return ERR_MOREMEMORY;
+			}
+		}
+	}
+#endif
+
+	error = w->Backend->Init(Copy);
+	if (error != ERR_NONE) {
+		SMSD_Log(DEBUG_ERROR, Config, "Failed to connect backend writer: %s", GSM_ErrorString(error));
+		return error;
+	}
+	Copy->connected = TRUE;
+	return ERR_NONE;
+}
+
+/**
+ * Closes backend connection of writer thread.
+ */
+static void SMSD_WriterDisconnect(struct _SMSD_Writer *w)
+{
+	GSM_SMSDConfig *Copy = &w->Config;
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	int i;
+#endif
+
+	if (Copy->connected) {
+		w->Backend->Free(Copy);
+		Copy->connected = FALSE;
+	}
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	/* Freed by backend when it was connected */
+	if (w->Backend == &SMSDSQL) {
+		for (i = 0; i < SQL_QUERY_LAST_NO; i++) {
+			free(Copy->SMSDSQL_queries[i]);
+			Copy->SMSDSQL_queries[i] = NULL;
+		}
+	}
+#endif
+	GSM_StringArray_Free(&Copy->inboxpending);
+	free(Copy->gammu_log_buffer);
+	Copy->gammu_log_buffer = NULL;
+}
+
+static void SMSD_WriterFree(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+	SMSD_QueueEntry *entry;
+
+	while (w->head != NULL) {
+		entry = w->head;
+		w->head = entry->Next;
+		SMSD_WriterFreeEntry(w, entry);
+	}
+	if (w->journal != NULL) {
+		SMSD_JournalSync(w->journal);
+		fclose(w->journal);
+	}
+	SMSD_WriterDisconnect(w);
+	pthread_cond_destroy(&w->queue_cond);
+	pthread_mutex_destroy(&w->queue_lock);
+	Config->Service = w->Backend;
+	Config->writer = NULL;
+	free(w);
+}
+
+GSM_Error SMSD_WriterStart(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w;
+	GSM_Error error;
+
+	if (Config->backend_journal == NULL || Config->writer != NULL) {
+		return ERR_NONE;
+	}
+
+	w = (struct _SMSD_Writer *)calloc(1, sizeof(struct _SMSD_Writer));
+	if (w == NULL) {
+		return ERR_MOREMEMORY;
+	}
+	w->Backend = Config->Service;
+	w->Main = Config;
+	pthread_mutex_init(&w->queue_lock, NULL);
+	pthread_cond_init(&w->queue_cond, NULL);
+	Config->writer = w;
+
+	error = SMSD_JournalOpen(Config);
+	if (error != ERR_NONE) {
+		SMSD_WriterFree(Config);
+		return error;
+	}
+
+	error = SMSD_WriterConnect(w, Config);
+	if (error != ERR_NONE) {
+		SMSD_WriterFree(Config);
+		return error;
+	}
+
+	Config->Service = &SMSDWriter;
+	if (pthread_create(&w->thread, NULL, SMSD_WriterThread, Config) != 0) {
+		SMSD_LogErrno(Config, "Failed to start writer thread");
+		SMSD_WriterFree(Config);
+		return ERR_UNKNOWN;
+	}
+	SMSD_Log(DEBUG_NOTICE, Config, "Started asynchronous backend writer, journal %s", Config->backend_journal);
+	return ERR_NONE;
+}
+
+void SMSD_WriterStop(GSM_SMSDConfig *Config)
+{
+	struct _SMSD_Writer *w = Config->writer;
+
+	if (w == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&w->queue_lock);
+	w->stop = TRUE;
+	pthread_cond_broadcast(&w->queue_cond);
+	pthread_mutex_unlock(&w->queue_lock);
+	pthread_join(w->thread, NULL);
+
+	if (w->queued > 0) {
+		SMSD_Log(DEBUG_INFO, Config, "Stopped backend writer, %d records kept in journal", w->queued);
+	}
+	SMSD_WriterFree(Config);
+}
+
+#else
+
+GSM_Error SMSD_WriterStart(GSM_SMSDConfig *Config)
+{
+	if (Config->backend_journal == NULL) {
+		return ERR_NONE;
+	}
+	SMSD_Log(DEBUG_ERROR, Config, "Asynchronous backend writer needs threads support, which was not compiled in!");
+	return ERR_DISABLED;
+}
+
+void SMSD_WriterStop(GSM_SMSDConfig *Config UNUSED)
+{
+}
+
+#endif
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
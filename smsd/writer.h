@@ -0,0 +1,28 @@
+/**
+ * SMSD asynchronous backend writer
+ */
+#ifndef __smsd_writer_h__
+#define __smsd_writer_h__
+
+#include <gammu-smsd.h>
+
+/**
+ * Starts asynchronous writer if it is configured. Records left in
+ * journal from previous run are queued again before this returns.
+ *
+ * Once started, Config->Service is replaced by wrapper which queues
+ * all backend writes, original service is used by writer thread.
+ */
+extern GSM_Error SMSD_WriterStart(GSM_SMSDConfig *Config);
+
+/**
+ * Stops asynchronous writer, queued records which could not be
+ * written are kept in journal for next start.
+ */
+extern void SMSD_WriterStop(GSM_SMSDConfig *Config);
+
+#endif
+
+/* How should editor hadle tabs in this file? Add editor commands here.
+ * vim: noexpandtab sw=8 ts=8 sts=8:
+ */
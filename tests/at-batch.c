@@ -0,0 +1,196 @@
+/**
+ * Test for concatenated AT commands, uses fake phone which does not
+ * support battery charge, can be temporarily busy and counts command
+ * lines it gets.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/phone/at/atgen.h"
+
+GSM_StateMachine *s;
+
+char written[1000];
+size_t written_length = 0;
+
+char pending[1000];
+size_t pending_length = 0;
+
+/* Command lines received by phone */
+int lines = 0;
+char last_line[1000];
+
+/* Phone fails concatenated commands while busy */
+gboolean busy = FALSE;
+
+static int fake_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes)
+{
+	size_t length = pending_length;
+
+	if (length > nbytes) {
+		length = nbytes;
+	}
+	memcpy(buf, pending, length);
+	memmove(pending, pending + length, pending_length - length);
+	pending_length -= length;
+	return length;
+}
+
+static void queue(const char *data)
+{
+	test_result(pending_length + strlen(data) < sizeof(pending));
+	memcpy(pending + pending_length, data, strlen(data));
+	pending_length += strlen(data);
+}
+
+static int fake_write(GSM_StateMachine *sm UNUSED, const void *buf, size_t nbytes)
+{
+	test_result(written_length + nbytes < sizeof(written));
+	memcpy(written + written_length, buf, nbytes);
+	written_length += nbytes;
+	written[written_length] = 0;
+
+	if (nbytes == 0 || ((const char *)buf)[nbytes - 1] != '\r') {
+		return nbytes;
+	}
+
+	/* Echo and answer every command line */
+	lines++;
+	strcpy(last_line, written);
+	queue(written);
+	queue("\r\n");
+	if (strstr(written, "+CBC") != NULL) {
+		/* Whole line fails as one of commands is not supported */
+		queue("ERROR\r\n");
+	} else if (busy && strchr(written, ';') != NULL) {
+		/* SIM busy */
+		queue("+CME ERROR: 14\r\n");
+	} else if (strcmp(written, "AT+CSQ;+CSQ\r") == 0) {
+		queue("+CSQ: 20,99\r\n+CSQ: 20,99\r\nOK\r\n");
+	} else if (strcmp(written, "AT+CSQ\r") == 0) {
+		queue("+CSQ: 20,99\r\nOK\r\n");
+	} else {
+		queue("OK\r\n");
+	}
+	written_length = 0;
+	return nbytes;
+}
+
+GSM_Device_Functions FakeDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	fake_read,
+	fake_write
+};
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+	GSM_SignalQuality signal;
+	GSM_BatteryCharge battery;
+	GSM_AT_BatchCommand status[] = {
+		{"+CBC", "+CBC:", ID_GetBatteryCharge, ERR_NONE, FALSE},
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_NONE, FALSE},
+	};
+	GSM_AT_BatchCommand signals[] = {
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_NONE, FALSE},
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_NONE, FALSE},
+	};
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect AT driver to fake device */
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->Phone.Functions = &ATGENPhone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	s->Device.Functions = &FakeDevice;
+	s->Protocol.Functions = &ATProtocol;
+	s->ConnectionType = GCT_AT;
+	s->ReplyNum = 1;
+	s->opened = TRUE;
+	error = s->Protocol.Functions->Initialise(s);
+	gammu_test_result(error, "Initialise");
+
+	/* Probe, rejected batch and both commands separately */
+	s->Phone.Data.BatteryCharge = &battery;
+	s->Phone.Data.SignalQuality = &signal;
+	error = ATGEN_WaitForBatch(s, status, 2, 4);
+	gammu_test_result(error, "ATGEN_WaitForBatch");
+	test_result(s->Phone.Data.Priv.ATGEN.Batching == AT_AVAILABLE);
+	test_result(lines == 4);
+	test_result(status[0].Done && status[0].Error == ERR_NOTSUPPORTED);
+	test_result(status[1].Done && status[1].Error == ERR_NONE);
+	test_result(signal.SignalStrength == -73);
+
+	/* Rejected batch is not tried again */
+	lines = 0;
+	error = ATGEN_WaitForBatch(s, status, 2, 4);
+	gammu_test_result(error, "ATGEN_WaitForBatch");
+	test_result(lines == 2);
+	test_result(strcmp(last_line, "AT+CSQ\r") == 0);
+	test_result(status[0].Done && status[0].Error == ERR_NOTSUPPORTED);
+	test_result(status[1].Done && status[1].Error == ERR_NONE);
+
+	/* Temporary failure falls back to separate commands */
+	busy = TRUE;
+	lines = 0;
+	error = ATGEN_WaitForBatch(s, signals, 2, 4);
+	gammu_test_result(error, "ATGEN_WaitForBatch");
+	test_result(lines == 3);
+	test_result(signals[0].Done && signals[0].Error == ERR_NONE);
+	test_result(signals[1].Done && signals[1].Error == ERR_NONE);
+
+	/* And it does not prevent batch next time */
+	busy = FALSE;
+	lines = 0;
+	error = ATGEN_WaitForBatch(s, signals, 2, 4);
+	gammu_test_result(error, "ATGEN_WaitForBatch");
+	test_result(lines == 1);
+	test_result(strcmp(last_line, "AT+CSQ;+CSQ\r") == 0);
+	test_result(signals[0].Done && signals[0].Error == ERR_NONE);
+	test_result(signals[1].Done && signals[1].Error == ERR_NONE);
+	test_result(s->Phone.Data.Priv.ATGEN.FailedBatchCount == 1);
+
+	/* Battery charge is single command */
+	lines = 0;
+	error = GSM_GetBatteryCharge(s, &battery);
+	gammu_test_result_code(error, "GSM_GetBatteryCharge", ERR_NOTSUPPORTED);
+	test_result(lines == 1);
+	test_result(strcmp(last_line, "AT+CBC\r") == 0);
+
+	/* Signal quality is always read from phone */
+	lines = 0;
+	memset(&signal, 0, sizeof(signal));
+	error = GSM_GetSignalQuality(s, &signal);
+	gammu_test_result(error, "GSM_GetSignalQuality");
+	test_result(lines == 1);
+	test_result(signal.SignalStrength == -73);
+
+	s->Protocol.Functions->Terminate(s);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
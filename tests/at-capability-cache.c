@@ -0,0 +1,138 @@
+/* Test for storing and restoring AT capability cache */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../libgammu/protocol/protocol.h"	/* Needed for GSM_Protocol_Message */
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmphones.h"	/* Phone data */
+
+#include "common.h"
+
+extern GSM_Error ATGEN_SaveCapabilityCache(GSM_StateMachine *s);
+extern GSM_Error ATGEN_ReadCapabilityCache(GSM_StateMachine *s);
+
+int main(int argc, char **argv)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Phone_ATGENData *Priv;
+	GSM_Phone_Data *Data;
+	GSM_StateMachine *s;
+	GSM_Error error;
+
+	/* Check parameters */
+	if (argc != 2) {
+		printf("Not enough parameters!\nUsage: at-capability-cache directory\n");
+		return 1;
+	}
+
+	/* Configure state machine */
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	/* Allocates state machine */
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->CurrentConfig->CapabilityCache = strdup(argv[1]);
+
+	/* Fill in probed data */
+	Data = &s->Phone.Data;
+	Priv = &s->Phone.Data.Priv.ATGEN;
+	Data->ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	strcpy(Data->IMEI, "+CGSN: 350000000000001/../");
+	strcpy(Data->Version, "R1A001");
+	strcpy(Data->Manufacturer, "Sony Ericsson");
+	strcpy(Data->Model, "K750i");
+	Priv->Manufacturer = AT_Ericsson;
+	Priv->Mode = TRUE;
+	Priv->UnicodeCharset = AT_CHARSET_UCS2;
+	Priv->NormalCharset = AT_CHARSET_GSM;
+	Priv->IRACharset = AT_CHARSET_IRA;
+	Priv->GSMCharset = AT_CHARSET_GSM;
+	strcpy(Priv->PBKMemories, "\"ME\",\"SM\"");
+	Priv->PBKSBNR = AT_NOTAVAILABLE;
+	Priv->PBK_SPBR = AT_NOTAVAILABLE;
+	Priv->PBK_MPBR = AT_AVAILABLE;
+	Priv->PhoneSMSMemory = AT_AVAILABLE;
+	Priv->SIMSMSMemory = AT_AVAILABLE;
+	Priv->PhoneSaveSMS = AT_NOTAVAILABLE;
+	Priv->SIMSaveSMS = AT_AVAILABLE;
+	Priv->CNMIMode = 3;
+	Priv->CNMIProcedure = 1;
+	Priv->CNMIDeliverProcedure = 2;
+	GSM_AddPhoneFeature(Data->ModelInfo, F_OBEX);
+
+	/* Store it */
+	error = ATGEN_SaveCapabilityCache(s);
+	gammu_test_result(error, "ATGEN_SaveCapabilityCache");
+
+	/* Clear state as if we were reconnecting */
+	Data->Manufacturer[0] = 0;
+	Data->Model[0] = 0;
+	Priv->Manufacturer = 0;
+	Priv->Mode = FALSE;
+	Priv->UnicodeCharset = 0;
+	Priv->NormalCharset = 0;
+	Priv->IRACharset = 0;
+	Priv->GSMCharset = 0;
+	Priv->PBKMemories[0] = 0;
+	Priv->PBKSBNR = 0;
+	Priv->PBK_SPBR = 0;
+	Priv->PBK_MPBR = 0;
+	Priv->PhoneSMSMemory = 0;
+	Priv->SIMSMSMemory = 0;
+	Priv->PhoneSaveSMS = 0;
+	Priv->SIMSaveSMS = 0;
+	Priv->CNMIMode = -1;
+	Priv->CNMIProcedure = -1;
+	Priv->CNMIDeliverProcedure = -1;
+
+	/* Restore it */
+	error = ATGEN_ReadCapabilityCache(s);
+	gammu_test_result(error, "ATGEN_ReadCapabilityCache");
+
+	test_result(strcmp(Data->Manufacturer, "Sony Ericsson") == 0);
+	test_result(strcmp(Data->Model, "K750i") == 0);
+	test_result(Priv->Manufacturer == AT_Ericsson);
+	test_result(Priv->Mode == TRUE);
+	test_result(Priv->UnicodeCharset == AT_CHARSET_UCS2);
+	test_result(Priv->NormalCharset == AT_CHARSET_GSM);
+	test_result(Priv->IRACharset == AT_CHARSET_IRA);
+	test_result(Priv->GSMCharset == AT_CHARSET_GSM);
+	test_result(strcmp(Priv->PBKMemories, "\"ME\",\"SM\"") == 0);
+	test_result(Priv->PBKSBNR == AT_NOTAVAILABLE);
+	test_result(Priv->PBK_SPBR == AT_NOTAVAILABLE);
+	test_result(Priv->PBK_MPBR == AT_AVAILABLE);
+	test_result(Priv->PhoneSMSMemory == AT_AVAILABLE);
+	test_result(Priv->SIMSMSMemory == AT_AVAILABLE);
+	test_result(Priv->PhoneSaveSMS == AT_NOTAVAILABLE);
+	test_result(Priv->SIMSaveSMS == AT_AVAILABLE);
+	test_result(Priv->CNMIMode == 3);
+	test_result(Priv->CNMIProcedure == 1);
+	test_result(Priv->CNMIDeliverProcedure == 2);
+	test_result(GSM_IsPhoneFeatureAvailable(Data->ModelInfo, F_OBEX));
+
+	/* Firmware upgrade invalidates cache */
+	strcpy(Data->Version, "R1A002");
+	error = ATGEN_ReadCapabilityCache(s);
+	gammu_test_result_code(error, "ATGEN_ReadCapabilityCache firmware", ERR_INVALIDDATA);
+
+	/* Different phone has no cache */
+	strcpy(Data->IMEI, "350000000000002");
+	error = ATGEN_ReadCapabilityCache(s);
+	test_result(error != ERR_NONE);
+
+	/* Free state machine */
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
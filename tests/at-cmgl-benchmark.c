@@ -0,0 +1,118 @@
+/**
+ * Benchmark of AT reply splitting and SMS listing parsing on synthetic
+ * +CMGL reply with 5000 lines.
+ *
+ * The timings are printed for comparison, the test checks that the
+ * listing is correctly parsed.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "../libgammu/protocol/protocol.h"	/* Needed for GSM_Protocol_Message */
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/misc/misc.h"
+
+#define ITERATIONS 200
+#define MESSAGES 2500
+
+#define TEST_PDU "07912470338016000404C91010000050801208432400A0E8329BFD0E9A7E4F0B00F0A"
+
+extern GSM_Error ATGEN_ReplyGetMessageList(GSM_Protocol_Message *msg, GSM_StateMachine *s);
+
+static void report(const char *name, clock_t start)
+{
+	double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / ITERATIONS;
+	printf("%-30s %10.1f us/reply\n", name, us);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Phone_ATGENData *Priv;
+	GSM_StateMachine *s;
+	GSM_Protocol_Message msg;
+	GSM_Error error;
+	char *buffer, *pos;
+	clock_t start;
+	int i;
+
+	/* Build the reply */
+	buffer = malloc(MESSAGES * (strlen(TEST_PDU) + 40) + 100);
+	test_result(buffer != NULL);
+	pos = buffer;
+	pos += sprintf(pos, "AT+CMGL=4\r");
+	for (i = 0; i < MESSAGES; i++) {
+		pos += sprintf(pos, "\r\n+CMGL: %d,1,,%d\r\n%s", i + 1, (int)(strlen(TEST_PDU) / 2 - 8), TEST_PDU);
+	}
+	pos += sprintf(pos, "\r\nOK\r\n");
+
+	/* Allocates state machine */
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	GSM_SetDebugGlobal(FALSE, GSM_GetDebug(s));
+	GSM_SetDebugLevel("nothing", GSM_GetDebug(s));
+
+	/* Initialize AT engine */
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	Priv = &s->Phone.Data.Priv.ATGEN;
+	Priv->ReplyState = AT_Reply_OK;
+	Priv->Manufacturer = AT_Unknown;
+	Priv->SMSMode = SMS_AT_PDU;
+	Priv->SMSReadFolder = 1;
+
+	/* Init message */
+	msg.Type = 0;
+	msg.Length = pos - buffer;
+	msg.Buffer = buffer;
+	s->Phone.Data.RequestMsg = &msg;
+
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		SplitLines(msg.Buffer, msg.Length, &Priv->Lines, "\x0D\x0A", 2, "\"", 1, TRUE);
+	}
+	report("SplitLines", start);
+	test_result(GetLineCount(&Priv->Lines) == 2 * MESSAGES + 2);
+	test_result(LineEquals(msg.Buffer, &Priv->Lines, 2 * MESSAGES + 2, "OK"));
+	test_result(LineStartsWith(msg.Buffer, &Priv->Lines, 2, "+CMGL: 1,"));
+	test_result(!LineEquals(msg.Buffer, &Priv->Lines, 2, "+CMGL: 1"));
+
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		error = ATGEN_ReplyGetMessageList(&msg, s);
+		gammu_test_result(error, "ATGEN_ReplyGetMessageList");
+		test_result(Priv->SMSCount == MESSAGES);
+		test_result(strcmp(Priv->SMSCache[MESSAGES - 1].PDU, TEST_PDU) == 0);
+		test_result(Priv->SMSCache[MESSAGES - 1].State == 1);
+		free(Priv->SMSCache);
+		Priv->SMSCache = NULL;
+	}
+	report("ATGEN_ReplyGetMessageList", start);
+
+	/* Shorter reply reuses buffers and does not see old lines */
+	strcpy(buffer, "AT+CMGL=4\r\r\nOK\r\n");
+	msg.Length = strlen(buffer);
+	SplitLines(msg.Buffer, msg.Length, &Priv->Lines, "\x0D\x0A", 2, "\"", 1, TRUE);
+	test_result(GetLineCount(&Priv->Lines) == 2);
+	test_result(GetLineLength(msg.Buffer, &Priv->Lines, 3) == 0);
+	error = ATGEN_ReplyGetMessageList(&msg, s);
+	gammu_test_result(error, "ATGEN_ReplyGetMessageList");
+	test_result(Priv->SMSCount == 0);
+
+	FreeLines(&Priv->Lines);
+	GetLineString(NULL, NULL, 0);
+	free(buffer);
+
+	/* Free state machine */
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -35,6 +35,17 @@ int main(int argc UNUSED, char **argv UNUSED)
 	GSM_Phone_Data *Data;
 	GSM_SecurityCodeType Status;
 	GSM_SignalQuality Signal;
+	GSM_BatteryCharge Battery;
+	GSM_SMSMemoryStatus SMSStatus;
+	GSM_AT_BatchCommand status[] = {
+		{"+CBC", "+CBC:", ID_GetBatteryCharge, ERR_UNKNOWN, FALSE},
+		{"+CMGF=0", NULL, ID_GetSMSMode, ERR_UNKNOWN, FALSE},
+		{"+CSQ", "+CSQ:", ID_GetSignalQuality, ERR_UNKNOWN, FALSE},
+	};
+	GSM_AT_BatchCommand memories[] = {
+		{"+CPMS=\"SM\"", "+CPMS:", ID_GetSMSStatus, ERR_UNKNOWN, FALSE},
+		{"+CPMS=\"ME\"", "+CPMS:", ID_GetSMSStatus, ERR_UNKNOWN, FALSE},
+	};
 
 	/* Init locales to get proper encoding */
 	GSM_InitLocales(NULL);
@@ -80,6 +91,60 @@ int main(int argc UNUSED, char **argv UNUSED)
 	s->Phone.Data.RequestID = ID_GetFirmware;
 	do_test("AT+CGMR\r\nNokia N950 (RM-680 rev 1124)\r\nDFL61 HARMATTAN 2.2011.39-5 PR RM680\r\nLinux version 2.6.32.39-dfl61-20113701 #1 PREEMPT Mon Sep 12 11:29:43 EEST 2011 (armv7l)\r\nmatd version 0.4.5\r\nMCU Vp 92_11w21_v6 26-05-11 RM-680 (c) Nokia\r\nOK", AT_Reply_OK, ERR_NONE);
 
+	/* Concatenated commands */
+	s->Phone.Data.BatteryCharge = &Battery;
+	s->Phone.Data.SignalQuality = &Signal;
+	s->Phone.Data.RequestID = ID_ATBatch;
+	Priv->Batch = status;
+	Priv->BatchCount = 3;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\n+CBC: 0,80\r\n+CSQ: 20,99\r\nOK\r\n", AT_Reply_OK, ERR_NONE);
+	test_result(s->Phone.Data.RequestID == ID_None);
+	test_result(status[0].Done && status[0].Error == ERR_NONE);
+	test_result(status[1].Done && status[1].Error == ERR_NONE);
+	test_result(status[2].Done && status[2].Error == ERR_NONE);
+	test_result(Battery.BatteryPercent == 80);
+	test_result(Signal.SignalStrength == -73);
+
+	/* Same command twice gets one line each */
+	s->Phone.Data.SMSStatus = &SMSStatus;
+	s->Phone.Data.RequestID = ID_ATBatch;
+	Priv->Batch = memories;
+	Priv->BatchCount = 2;
+	do_test("AT+CPMS=\"SM\";+CPMS=\"ME\"\r\n+CPMS: 2,30,2,30,2,30\r\n+CPMS: 5,300,5,300,5,300\r\nOK\r\n", AT_Reply_OK, ERR_NONE);
+	test_result(memories[0].Done && memories[0].Error == ERR_NONE);
+	test_result(memories[1].Done && memories[1].Error == ERR_NONE);
+	test_result(SMSStatus.SIMUsed == 2 && SMSStatus.SIMSize == 30);
+	test_result(SMSStatus.PhoneUsed == 5 && SMSStatus.PhoneSize == 300);
+
+	/* Failed batch leaves commands to be sent separately */
+	status[0].Done = status[1].Done = status[2].Done = FALSE;
+	s->Phone.Data.RequestID = ID_ATBatch;
+	Priv->Batch = status;
+	Priv->BatchCount = 3;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\nERROR\r\n", AT_Reply_Error, ERR_NOTSUPPORTED);
+	test_result(s->Phone.Data.RequestID == ID_None);
+	test_result(!status[0].Done && !status[1].Done && !status[2].Done);
+
+	/* Only error right after echo is rejection of the line */
+	s->Phone.Data.RequestID = ID_ATBatch;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\n+CBC: 0,80\r\nERROR\r\n", AT_Reply_Error, ERR_UNKNOWN);
+	test_result(!status[0].Done && !status[1].Done && !status[2].Done);
+
+	/* Error codes are reported for the whole batch */
+	s->Phone.Data.RequestID = ID_ATBatch;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\n+CME ERROR: 14\r\n", AT_Reply_CMEError, ERR_NOSIM);
+	test_result(!status[0].Done && !status[1].Done && !status[2].Done);
+	s->Phone.Data.RequestID = ID_ATBatch;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\n+CME ERROR: 4\r\n", AT_Reply_CMEError, ERR_NOTSUPPORTED);
+	test_result(!status[0].Done && !status[1].Done && !status[2].Done);
+
+	/* Reply without prefixes can not be split */
+	s->Phone.Data.RequestID = ID_ATBatch;
+	do_test("AT+CBC;+CMGF=0;+CSQ\r\n0,80\r\n20,99\r\nOK\r\n", AT_Reply_OK, ERR_UNKNOWNRESPONSE);
+	test_result(!status[0].Done && !status[1].Done && !status[2].Done);
+	Priv->Batch = NULL;
+	Priv->BatchCount = 0;
+
 	/* Free state machine */
 	GSM_FreeStateMachine(s);
 
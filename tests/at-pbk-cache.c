@@ -0,0 +1,263 @@
+/**
+ * Test for phonebook cache on AT driver, uses fake phone which answers
+ * according to recorded session and checks that commands are sent in
+ * the same order as recorded.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/phone/at/atgen.h"
+
+#define BUFFER_SIZE 16384
+
+GSM_StateMachine *s;
+
+/* Recorded session and position of next command in it */
+char script[BUFFER_SIZE];
+char *script_pos;
+
+/* Number of commands answered by phone */
+int exchanges = 0;
+
+char written[1000];
+size_t written_length = 0;
+
+char pending[BUFFER_SIZE];
+size_t pending_length = 0;
+
+static int fake_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes)
+{
+	size_t length = pending_length;
+
+	if (length > nbytes) {
+		length = nbytes;
+	}
+	memcpy(buf, pending, length);
+	memmove(pending, pending + length, pending_length - length);
+	pending_length -= length;
+	return length;
+}
+
+static void queue(const char *data, size_t length)
+{
+	test_result(pending_length + length < sizeof(pending));
+	memcpy(pending + pending_length, data, length);
+	pending_length += length;
+}
+
+/**
+ * Returns length of line starting at pos, without line end.
+ */
+static size_t line_length(const char *pos)
+{
+	const char *end = strchr(pos, '\n');
+
+	if (end == NULL) {
+		return strlen(pos);
+	}
+	return end - pos;
+}
+
+static const char *next_line(const char *pos)
+{
+	pos += line_length(pos);
+	if (*pos == '\n') {
+		pos++;
+	}
+	return pos;
+}
+
+static int fake_write(GSM_StateMachine *sm UNUSED, const void *buf, size_t nbytes)
+{
+	size_t length;
+
+	test_result(written_length + nbytes < sizeof(written));
+	memcpy(written + written_length, buf, nbytes);
+	written_length += nbytes;
+	written[written_length] = 0;
+
+	if (nbytes == 0 || ((const char *)buf)[nbytes - 1] != '\r') {
+		return nbytes;
+	}
+
+	/* Command has to match recorded one */
+	length = line_length(script_pos);
+	if (length + 1 != written_length || strncmp(written, script_pos, length) != 0) {
+		fprintf(stderr, "Expected command: %.*s\n", (int)length, script_pos);
+		fprintf(stderr, "Received command: %s\n", written);
+		test_result(FALSE);
+	}
+
+	/* Echo it and send recorded reply */
+	exchanges++;
+	do {
+		length = line_length(script_pos);
+		queue(script_pos, length);
+		queue("\r\n", 2);
+		script_pos = (char *)next_line(script_pos);
+	} while (*script_pos != 0 && strncmp(script_pos, "AT", 2) != 0);
+
+	written_length = 0;
+	return nbytes;
+}
+
+GSM_Device_Functions FakeDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	fake_read,
+	fake_write
+};
+
+/**
+ * Reads next entry and checks its location and name.
+ */
+static void check_next(GSM_MemoryEntry *entry, gboolean start, int location, const char *name)
+{
+	GSM_Error error;
+
+	error = GSM_GetNextMemory(s, entry, start);
+	gammu_test_result(error, "GSM_GetNextMemory");
+	test_result(entry->Location == location);
+	test_result(entry->EntriesNum >= 2);
+	test_result(entry->Entries[1].EntryType == PBK_Text_Name);
+	test_result(strcmp(DecodeUnicodeString(entry->Entries[1].Text), name) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Phone_ATGENData *Priv;
+	GSM_Error error;
+	GSM_MemoryEntry entry;
+	FILE *f;
+	size_t len;
+
+	if (argc != 2) {
+		printf("Not enough parameters!\nUsage: at-pbk-cache session.dump\n");
+		return 1;
+	}
+
+	f = fopen(argv[1], "r");
+	if (f == NULL) {
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+	len = fread(script, 1, sizeof(script) - 1, f);
+	if (!feof(f)) {
+		printf("Could not read whole file %s\n", argv[1]);
+		fclose(f);
+		return 1;
+	}
+	script[len] = 0;
+	fclose(f);
+	script_pos = script;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect AT driver to fake device */
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->Phone.Functions = &ATGENPhone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	s->Device.Functions = &FakeDevice;
+	s->Protocol.Functions = &ATProtocol;
+	s->ConnectionType = GCT_AT;
+	s->ReplyNum = 1;
+	s->opened = TRUE;
+	error = s->Protocol.Functions->Initialise(s);
+	gammu_test_result(error, "Initialise");
+
+	/* Phone identification and charset are not part of the session */
+	Priv = &s->Phone.Data.Priv.ATGEN;
+	Priv->Manufacturer = AT_Unknown;
+	strcpy(s->Phone.Data.Manufacturer, "Unknown");
+	Priv->Charset = AT_CHARSET_UTF8;
+	Priv->UnicodeCharset = AT_CHARSET_UTF8;
+	Priv->NormalCharset = AT_CHARSET_UTF8;
+	Priv->GSMCharset = AT_CHARSET_UTF8;
+	Priv->IRACharset = AT_CHARSET_UTF8;
+
+	/* Whole memory is read in chunks, empty chunk is skipped */
+	memset(&entry, 0, sizeof(entry));
+	entry.MemoryType = MEM_SM;
+	check_next(&entry, TRUE, 1, "Jan Novak");
+	test_result(exchanges == 7);
+	test_result(Priv->PBKCacheCount == 3);
+
+	/* Rest of entries is served from cache */
+	check_next(&entry, FALSE, 3, "Wrapped Entry");
+	check_next(&entry, FALSE, 250, "Emergency");
+	error = GSM_GetNextMemory(s, &entry, FALSE);
+	gammu_test_result_code(error, "GSM_GetNextMemory", ERR_EMPTY);
+	test_result(exchanges == 7);
+
+	/* Writing entry invalidates cache */
+	memset(&entry, 0, sizeof(entry));
+	entry.MemoryType = MEM_SM;
+	entry.Location = 2;
+	entry.EntriesNum = 2;
+	entry.Entries[0].EntryType = PBK_Number_General;
+	EncodeUnicode(entry.Entries[0].Text, "604111222", 9);
+	entry.Entries[1].EntryType = PBK_Text_Name;
+	EncodeUnicode(entry.Entries[1].Text, "Petr", 4);
+	error = GSM_SetMemory(s, &entry);
+	gammu_test_result(error, "GSM_SetMemory");
+	test_result(exchanges == 8);
+	test_result(Priv->PBKCacheCount == 0);
+
+	entry.Location = 1;
+	check_next(&entry, FALSE, 2, "Petr");
+	test_result(exchanges == 11);
+	check_next(&entry, FALSE, 3, "Wrapped Entry");
+	test_result(exchanges == 11);
+
+	/* Deleting entry invalidates cache */
+	entry.Location = 1;
+	error = GSM_DeleteMemory(s, &entry);
+	gammu_test_result(error, "GSM_DeleteMemory");
+	test_result(exchanges == 12);
+	test_result(Priv->PBKCacheCount == 0);
+
+	entry.Location = 0;
+	check_next(&entry, FALSE, 2, "Petr");
+	test_result(exchanges == 15);
+
+	/* Rejected range falls back to reading entries one by one */
+	memset(&entry, 0, sizeof(entry));
+	entry.MemoryType = MEM_ON;
+	check_next(&entry, TRUE, 1, "Own");
+	test_result(exchanges == 20);
+	test_result(Priv->PBKCacheRange == AT_NOTAVAILABLE);
+	check_next(&entry, FALSE, 2, "Second");
+	test_result(exchanges == 21);
+
+	/* Whole session was used */
+	test_result(*script_pos == 0);
+
+	s->Phone.Functions->Terminate(s);
+	s->Protocol.Functions->Terminate(s);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,138 @@
+/**
+ * Test for waiting until AT phone is ready, uses fake device which
+ * answers AT commands.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/phone/at/atgen.h"
+
+GSM_StateMachine *s;
+
+char written[1000];
+size_t written_length = 0;
+
+char pending[1000];
+size_t pending_length = 0;
+
+/* Maximal number of bytes returned by single read */
+size_t chunk = 1000;
+
+static int fake_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes)
+{
+	size_t length = pending_length;
+
+	if (length > nbytes) {
+		length = nbytes;
+	}
+	if (length > chunk) {
+		length = chunk;
+	}
+	memcpy(buf, pending, length);
+	memmove(pending, pending + length, pending_length - length);
+	pending_length -= length;
+	return length;
+}
+
+static void queue(const char *data)
+{
+	test_result(pending_length + strlen(data) < sizeof(pending));
+	memcpy(pending + pending_length, data, strlen(data));
+	pending_length += strlen(data);
+}
+
+static int fake_write(GSM_StateMachine *sm UNUSED, const void *buf, size_t nbytes)
+{
+	test_result(written_length + nbytes < sizeof(written));
+	memcpy(written + written_length, buf, nbytes);
+	written_length += nbytes;
+	written[written_length] = 0;
+
+	/* Echo and answer every command */
+	if (nbytes > 0 && ((const char *)buf)[nbytes - 1] == '\r') {
+		queue(written);
+		queue("\r\nOK\r\n");
+		written_length = 0;
+	}
+	return nbytes;
+}
+
+GSM_Device_Functions FakeDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	fake_read,
+	fake_write
+};
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect AT driver to fake device */
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->Phone.Functions = &ATGENPhone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	s->Device.Functions = &FakeDevice;
+	s->Protocol.Functions = &ATProtocol;
+	s->ConnectionType = GCT_AT;
+	s->ReplyNum = 1;
+	s->opened = TRUE;
+	error = s->Protocol.Functions->Initialise(s);
+	gammu_test_result(error, "Initialise");
+
+	/* Prompt split into single bytes */
+	chunk = 1;
+	queue("\r\nsome junk\r\n> ");
+	error = ATGEN_WaitForPrompt(s, "> ", 1);
+	gammu_test_result(error, "ATGEN_WaitForPrompt");
+	test_result(pending_length == 0);
+
+	/* No prompt */
+	chunk = 1000;
+	queue("\r\nERROR\r\n");
+	error = ATGEN_WaitForPrompt(s, ">", 1);
+	gammu_test_result_code(error, "ATGEN_WaitForPrompt", ERR_TIMEOUT);
+
+	/* Phone is probed and error of previous request is kept */
+	s->Phone.Data.DispatchError = ERR_WRONGCRC;
+	error = ATGEN_WaitForReady(s, 500);
+	gammu_test_result(error, "ATGEN_WaitForReady");
+	test_result(s->Phone.Data.DispatchError == ERR_WRONGCRC);
+	test_result(pending_length == 0);
+
+	/* Fixed delay does not touch the phone */
+	GSM_AddPhoneFeature(s->Phone.Data.ModelInfo, F_FIXED_DELAYS);
+	error = ATGEN_WaitForReady(s, 10);
+	gammu_test_result(error, "ATGEN_WaitForReady");
+	test_result(written_length == 0 && pending_length == 0);
+
+	s->Protocol.Functions->Terminate(s);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,208 @@
+/**
+ * Test for converting bitmaps between phone formats, compares with
+ * pixel by pixel conversion and checks round trip.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+
+#include "../libgammu/service/gsmlogo.h"
+
+#define BUFFER_SIZE 2000
+
+/**
+ * Reference pixel setting in phone format.
+ */
+static void reference_set_point(GSM_Phone_Bitmap_Types Type, unsigned char *buffer, size_t x, size_t y, size_t width, size_t height)
+{
+	size_t pixel;
+
+	switch (Type) {
+	case GSM_NokiaStartupLogo:
+	case GSM_Nokia6210StartupLogo:
+	case GSM_Nokia7110StartupLogo:
+	case GSM_Nokia6510OperatorLogo:
+		buffer[(y / 8 * width) + x] |= 1 << (y % 8);
+		break;
+	case GSM_NokiaOperatorLogo:
+	case GSM_Nokia7110OperatorLogo:
+	case GSM_NokiaCallerLogo:
+	case GSM_EMSSmallPicture:
+	case GSM_EMSMediumPicture:
+	case GSM_EMSBigPicture:
+	case GSM_EMSVariablePicture:
+		pixel = width * y + x;
+		buffer[pixel / 8] |= 1 << (7 - (pixel % 8));
+		break;
+	case GSM_NokiaPictureImage:
+		buffer[(9 * y) + (x / 8)] |= 1 << (7 - (x % 8));
+		break;
+	case GSM_AlcatelBMMIPicture:
+		pixel = (height + 7) / 8;
+		buffer[(pixel * x) + (y / 8)] |= 1 << (7 - (y % 8));
+		break;
+	}
+}
+
+/**
+ * Fills bitmap with pseudo random pixels.
+ */
+static void fill_bitmap(GSM_Bitmap *bitmap, size_t width, size_t height, unsigned int seed)
+{
+	size_t x, y;
+
+	memset(bitmap, 0, sizeof(GSM_Bitmap));
+	bitmap->BitmapWidth = width;
+	bitmap->BitmapHeight = height;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) & 1) {
+				GSM_SetPointBitmap(bitmap, x, y);
+			}
+		}
+	}
+}
+
+/**
+ * Compares pixels of two bitmaps.
+ */
+static gboolean same_bitmap(GSM_Bitmap *a, GSM_Bitmap *b)
+{
+	size_t x, y;
+
+	if (a->BitmapWidth != b->BitmapWidth || a->BitmapHeight != b->BitmapHeight) {
+		return FALSE;
+	}
+	for (y = 0; y < a->BitmapHeight; y++) {
+		for (x = 0; x < a->BitmapWidth; x++) {
+			if (!GSM_IsPointBitmap(a, x, y) != !GSM_IsPointBitmap(b, x, y)) {
+				printf("Pixel %ld,%ld differs\n", (long)x, (long)y);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+static void check_type(GSM_Phone_Bitmap_Types Type, size_t width, size_t height)
+{
+	GSM_Bitmap bitmap, decoded, reference;
+	unsigned char buffer[BUFFER_SIZE], expected[BUFFER_SIZE];
+	size_t x, y, w, h;
+	int seed;
+
+	PHONE_GetBitmapWidthHeight(Type, &w, &h);
+	if (w != 0 || h != 0) {
+		width = w;
+		height = h;
+	}
+	printf("Type %d, %ldx%ld\n", Type, (long)width, (long)height);
+
+	for (seed = 0; seed < 4; seed++) {
+		fill_bitmap(&bitmap, width, height, seed);
+
+		/* Encoding has to match pixel by pixel one */
+		memset(buffer, 0, sizeof(buffer));
+		PHONE_EncodeBitmap(Type, (char *)buffer, &bitmap);
+		memset(expected, 0, sizeof(expected));
+		for (y = 0; y < height; y++) {
+			for (x = 0; x < width; x++) {
+				if (GSM_IsPointBitmap(&bitmap, x, y)) {
+					reference_set_point(Type, expected, x, y, width, height);
+				}
+			}
+		}
+		test_result(memcmp(buffer, expected, sizeof(buffer)) == 0);
+
+		/* Alcatel bitmaps can not be decoded */
+		if (Type == GSM_AlcatelBMMIPicture) {
+			continue;
+		}
+
+		/* Round trip */
+		memset(&decoded, 0xff, sizeof(decoded));
+		decoded.BitmapWidth = width;
+		decoded.BitmapHeight = height;
+		PHONE_DecodeBitmap(Type, (char *)buffer, &decoded);
+		test_result(same_bitmap(&bitmap, &decoded));
+	}
+
+	/* Reversing */
+	fill_bitmap(&bitmap, width, height, 42);
+	reference = bitmap;
+	GSM_ReverseBitmap(&bitmap);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			test_result(!GSM_IsPointBitmap(&bitmap, x, y) == !!GSM_IsPointBitmap(&reference, x, y));
+		}
+	}
+	GSM_ReverseBitmap(&bitmap);
+	test_result(same_bitmap(&bitmap, &reference));
+}
+
+/**
+ * Checks resizing with pixel by pixel copy.
+ */
+static void check_resize(size_t width, size_t height, size_t new_width, size_t new_height)
+{
+	GSM_Bitmap bitmap, resized, reference;
+	size_t x, y, dx, dy;
+	size_t startx, starty, setx, sety;
+
+	fill_bitmap(&bitmap, width, height, width * 7 + height);
+	GSM_ResizeBitmap(&resized, &bitmap, new_width, new_height);
+
+	memset(&reference, 0, sizeof(reference));
+	reference.BitmapWidth = new_width;
+	reference.BitmapHeight = new_height;
+	startx = (width > new_width) ? (width - new_width) / 2 : 0;
+	setx = (width < new_width) ? (new_width - width) / 2 : 0;
+	starty = (height > new_height) ? (height - new_height) / 2 : 0;
+	sety = (height < new_height) ? (new_height - height) / 2 : 0;
+	for (y = starty; y < height && y - starty < new_height; y++) {
+		for (x = startx; x < width && x - startx < new_width; x++) {
+			dx = setx + x - startx;
+			dy = sety + y - starty;
+			if (GSM_IsPointBitmap(&bitmap, x, y)) {
+				GSM_SetPointBitmap(&reference, dx, dy);
+			}
+		}
+	}
+	test_result(same_bitmap(&resized, &reference));
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	check_type(GSM_NokiaOperatorLogo, 0, 0);
+	check_type(GSM_NokiaCallerLogo, 0, 0);
+	check_type(GSM_NokiaPictureImage, 0, 0);
+	check_type(GSM_Nokia7110OperatorLogo, 0, 0);
+	check_type(GSM_Nokia6510OperatorLogo, 0, 0);
+	check_type(GSM_NokiaStartupLogo, 0, 0);
+	check_type(GSM_Nokia6210StartupLogo, 0, 0);
+	check_type(GSM_Nokia7110StartupLogo, 0, 0);
+	check_type(GSM_EMSSmallPicture, 0, 0);
+	check_type(GSM_EMSMediumPicture, 0, 0);
+	check_type(GSM_EMSBigPicture, 0, 0);
+	check_type(GSM_EMSVariablePicture, 40, 21);
+	check_type(GSM_AlcatelBMMIPicture, 13, 11);
+	check_type(GSM_AlcatelBMMIPicture, 72, 28);
+
+	check_resize(72, 14, 72, 14);
+	check_resize(72, 14, 78, 21);
+	check_resize(78, 21, 72, 14);
+	check_resize(96, 65, 84, 48);
+	check_resize(13, 5, 101, 21);
+	check_resize(101, 21, 13, 5);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
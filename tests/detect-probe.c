@@ -0,0 +1,192 @@
+/**
+ * Test for concurrent probing of devices in gammu-detect, uses pty
+ * modem stand-ins.
+ */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "common.h"
+#include "../gammu-detect/probe.h"
+
+/**
+ * Pty emulating phone.
+ */
+typedef struct {
+	int master;
+	char slave[100];
+	gboolean answer;
+	volatile gboolean stop;
+	pthread_t thread;
+} StandIn;
+
+static void reply(StandIn *modem, const char *command)
+{
+	const char *answer = "\r\nOK\r\n";
+
+	if (strncmp(command, "AT+CGMI", 7) == 0) {
+		answer = "\r\nPtyMaker\r\n\r\nOK\r\n";
+	} else if (strncmp(command, "AT+CGMM", 7) == 0) {
+		answer = "\r\nStandIn 1\r\n\r\nOK\r\n";
+	} else if (strncmp(command, "AT+CSCS?", 8) == 0) {
+		answer = "\r\n+CSCS: \"GSM\"\r\n\r\nOK\r\n";
+	} else if (strncmp(command, "AT+CSCS=?", 9) == 0) {
+		answer = "\r\n+CSCS: (\"GSM\",\"IRA\")\r\n\r\nOK\r\n";
+	}
+	if (write(modem->master, command, strlen(command)) < 0 ||
+			write(modem->master, answer, strlen(answer)) < 0) {
+		modem->stop = TRUE;
+	}
+}
+
+static void *standin_thread(void *arg)
+{
+	StandIn *modem = arg;
+	char command[200], c;
+	size_t pos = 0;
+	struct timeval timeout;
+	fd_set fds;
+
+	while (!modem->stop) {
+		FD_ZERO(&fds);
+		FD_SET(modem->master, &fds);
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 50000;
+		if (select(modem->master + 1, &fds, NULL, NULL, &timeout) <= 0) {
+			continue;
+		}
+		/* Slave might not be opened yet */
+		if (read(modem->master, &c, 1) != 1) {
+			usleep(10000);
+			continue;
+		}
+		if (!modem->answer) {
+			continue;
+		}
+		if (pos < sizeof(command) - 1) {
+			command[pos++] = c;
+		}
+		if (c == '\r') {
+			command[pos] = 0;
+			reply(modem, command);
+			pos = 0;
+		}
+	}
+	return NULL;
+}
+
+static void standin_start(StandIn *modem, gboolean answer)
+{
+	modem->master = posix_openpt(O_RDWR | O_NOCTTY);
+	test_result(modem->master >= 0);
+	test_result(grantpt(modem->master) == 0);
+	test_result(unlockpt(modem->master) == 0);
+	strcpy(modem->slave, ptsname(modem->master));
+	modem->answer = answer;
+	modem->stop = FALSE;
+	test_result(pthread_create(&modem->thread, NULL, standin_thread, modem) == 0);
+}
+
+static void standin_stop(StandIn *modem)
+{
+	modem->stop = TRUE;
+	pthread_join(modem->thread, NULL);
+	close(modem->master);
+}
+
+static ProbeDevice *make_devices(StandIn *modem, StandIn *silent)
+{
+	ProbeDevice *devices;
+
+	devices = calloc(3, sizeof(ProbeDevice));
+	test_result(devices != NULL);
+
+	devices[0].Device = strdup(modem->slave);
+	devices[0].Connection = strdup("at");
+	devices[0].Key = strdup("usb-PtyMaker_StandIn-00");
+
+	devices[1].Device = strdup(silent->slave);
+	devices[1].Connection = strdup("blueat");
+	devices[1].Key = strdup("pci-0000:00:1d.0-usb-0:1.2:1.0");
+
+	devices[2].Device = strdup("/dev/nonexisting-gammu-device");
+	devices[2].Connection = strdup("at");
+	devices[2].Key = strdup("/dev/nonexisting-gammu-device");
+
+	return devices;
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	StandIn modem, silent;
+	ProbeDevice *devices;
+	char cache_file[] = "/tmp/gammu-detect-cacheXXXXXX";
+	int fd;
+	time_t start;
+
+	fd = mkstemp(cache_file);
+	test_result(fd >= 0);
+	close(fd);
+
+	standin_start(&modem, TRUE);
+	standin_start(&silent, FALSE);
+
+	/* Probe all devices */
+	devices = make_devices(&modem, &silent);
+	start = time(NULL);
+	probe_devices(devices, 3, cache_file, FALSE);
+	printf("Probing took %ld seconds\n", (long)(time(NULL) - start));
+
+	test_result(devices[0].Found && !devices[0].Cached);
+	test_result(strcmp(devices[0].Connection, "at") == 0);
+	test_result(strcmp(devices[0].Manufacturer, "PtyMaker") == 0);
+	test_result(strcmp(devices[0].Model, "StandIn 1") == 0);
+	test_result(!devices[1].Found);
+	test_result(!devices[2].Found);
+	probe_free(devices, 3);
+
+	/* Working device is now taken from cache, even when it does not answer */
+	modem.answer = FALSE;
+	devices = make_devices(&modem, &silent);
+	probe_devices(devices, 3, cache_file, FALSE);
+	test_result(devices[0].Found && devices[0].Cached);
+	test_result(strcmp(devices[0].Manufacturer, "PtyMaker") == 0);
+	test_result(strcmp(devices[0].Model, "StandIn 1") == 0);
+	test_result(!devices[1].Found && !devices[1].Cached);
+	probe_free(devices, 3);
+
+	/* Refresh probes again and drops device from cache */
+	devices = make_devices(&modem, &silent);
+	free(devices[0].Connection);
+	devices[0].Connection = strdup("blueat");
+	probe_devices(devices, 1, cache_file, TRUE);
+	test_result(!devices[0].Found && !devices[0].Cached);
+	probe_free(devices, 3);
+
+	devices = make_devices(&modem, &silent);
+	free(devices[0].Connection);
+	devices[0].Connection = strdup("blueat");
+	probe_devices(devices, 1, cache_file, FALSE);
+	test_result(!devices[0].Found && !devices[0].Cached);
+	probe_free(devices, 3);
+
+	standin_stop(&modem);
+	standin_stop(&silent);
+	unlink(cache_file);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
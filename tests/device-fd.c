@@ -0,0 +1,85 @@
+/**
+ * Test for getting device file descriptor for event loop integration.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+
+GSM_StateMachine *s;
+
+int main(int argc, char **argv)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Config *cfg;
+	GSM_Error error;
+#if defined(GSM_ENABLE_SERIALDEVICE) && !defined(WIN32) && !defined(DJGPP)
+	int fds[2];
+#endif
+
+	if (argc != 2) {
+		printf("Usage: device-fd DUMMY_PATH\n");
+		return 1;
+	}
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Nothing to watch without connection */
+	test_result(GSM_GetDeviceFD(NULL) == -1);
+	test_result(GSM_GetDeviceFD(s) == -1);
+
+	cfg = GSM_GetConfig(s, 0);
+	free(cfg->Device);
+	cfg->Device = strdup(argv[1]);
+	free(cfg->Connection);
+	cfg->Connection = strdup("none");
+	strcpy(cfg->Model, "dummy");
+	GSM_SetConfigNum(s, 1);
+
+	/* Dummy phone does not use any descriptor */
+	error = GSM_InitConnection(s, 1);
+	gammu_test_result(error, "GSM_InitConnection");
+	test_result(GSM_IsConnected(s));
+	test_result(GSM_GetDeviceFD(s) == -1);
+
+	error = GSM_TerminateConnection(s);
+	gammu_test_result(error, "GSM_TerminateConnection");
+	test_result(GSM_GetDeviceFD(s) == -1);
+
+#if defined(GSM_ENABLE_SERIALDEVICE) && !defined(WIN32) && !defined(DJGPP)
+	/* Serial device gives its descriptor only while connected */
+	test_result(pipe(fds) == 0);
+	s->Device.Functions = &SerialDevice;
+	s->Device.Data.Serial.hPhone = fds[0];
+	s->Phone.Functions = &DUMMYPhone;
+	test_result(GSM_GetDeviceFD(s) == -1);
+	s->opened = TRUE;
+	test_result(GSM_GetDeviceFD(s) == fds[0]);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	close(fds[0]);
+	close(fds[1]);
+#endif
+
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
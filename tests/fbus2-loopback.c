@@ -0,0 +1,333 @@
+/**
+ * Test for FBUS2 framing using loopback device.
+ *
+ * Frames written by the protocol are checked, reflected back as if phone
+ * sent them and must be reassembled to original message. Every message
+ * and every burst of acknowledgements has to be written at once, unless
+ * phone needs them immediately.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/protocol/nokia/fbus2.h"
+
+#define LOOPBACK_SIZE 10000
+
+GSM_StateMachine *s;
+
+unsigned char written[LOOPBACK_SIZE];
+int written_length = 0;
+int writes = 0;
+
+/* Device fails all writes */
+gboolean broken = FALSE;
+
+unsigned char pending[LOOPBACK_SIZE];
+int pending_length = 0;
+
+unsigned char received[LOOPBACK_SIZE];
+int received_length = 0;
+int received_type = 0;
+int dispatched = 0;
+
+static int loopback_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes)
+{
+	int length = pending_length;
+
+	if ((size_t)length > nbytes) {
+		length = nbytes;
+	}
+	memcpy(buf, pending, length);
+	memmove(pending, pending + length, pending_length - length);
+	pending_length -= length;
+	return length;
+}
+
+static int loopback_write(GSM_StateMachine *sm UNUSED, const void *buf, size_t nbytes)
+{
+	if (broken) {
+		return 0;
+	}
+	test_result(written_length + nbytes <= sizeof(written));
+	memcpy(written + written_length, buf, nbytes);
+	written_length += nbytes;
+	writes++;
+	return nbytes;
+}
+
+static GSM_Error loopback_dispatch(GSM_StateMachine *sm)
+{
+	GSM_Protocol_Message *msg = sm->Phone.Data.RequestMsg;
+
+	memcpy(received, msg->Buffer, msg->Length);
+	received_length = msg->Length;
+	received_type = msg->Type;
+	dispatched++;
+	return ERR_NONE;
+}
+
+GSM_Device_Functions LoopbackDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	loopback_read,
+	loopback_write
+};
+
+GSM_Phone_Functions LoopbackPhone;
+
+/**
+ * Checks frame at given position using bytewise checksums and returns
+ * its length.
+ */
+static int check_frame(const unsigned char *frame, int available)
+{
+	int length, i;
+	unsigned char even = 0, odd = 0;
+
+	test_result(available >= 8);
+	test_result(frame[0] == FBUS2_FRAME_ID);
+	test_result(frame[1] == FBUS2_DEVICE_PHONE);
+	test_result(frame[2] == FBUS2_DEVICE_PC);
+
+	length = frame[4] * 256 + frame[5];
+	length = 6 + length + (length % 2);
+	test_result(available >= length + 2);
+
+	for (i = 0; i < length; i += 2) {
+		even ^= frame[i];
+	}
+	for (i = 1; i < length; i += 2) {
+		odd ^= frame[i];
+	}
+	test_result(frame[length] == even);
+	test_result(frame[length + 1] == odd);
+
+	return length + 2;
+}
+
+/**
+ * Copies frame to receive queue as if it was sent by phone.
+ */
+static void reflect_frame(const unsigned char *frame, int length)
+{
+	int i;
+	unsigned char *copy = pending + pending_length;
+
+	memcpy(copy, frame, length);
+	copy[1] = FBUS2_DEVICE_PC;
+	copy[2] = FBUS2_DEVICE_PHONE;
+	copy[length - 2] = 0;
+	copy[length - 1] = 0;
+	for (i = 0; i < length - 2; i++) {
+		copy[length - 2 + (i % 2)] ^= copy[i];
+	}
+	pending_length += length;
+}
+
+/**
+ * Checks that acknowledgements were written in as few writes as the
+ * window allows and returns their count.
+ */
+static int check_acks(int type)
+{
+	int pos = 0, acks = 0;
+
+	if (written_length == 0) {
+		return 0;
+	}
+	while (pos < written_length) {
+		test_result(written[pos + 3] == FBUS2_ACK_BYTE);
+		test_result(written[pos + 6] == type);
+		pos += check_frame(written + pos, written_length - pos);
+		acks++;
+	}
+	test_result(writes == (acks + FBUS2_ACK_WINDOW - 1) / FBUS2_ACK_WINDOW);
+	return acks;
+}
+
+static void reset_log(void)
+{
+	written_length = 0;
+	writes = 0;
+}
+
+void do_test(int length)
+{
+	unsigned char msg[3000];
+	int i, pos, frames, expected_frames;
+	GSM_Error error;
+
+	for (i = 0; i < length; i++) {
+		msg[i] = (i * 7 + length) & 0xff;
+	}
+	expected_frames = (length + FBUS2_MAX_TRANSMIT_LENGTH - 1) / FBUS2_MAX_TRANSMIT_LENGTH;
+
+	/* Whole message has to be written at once */
+	reset_log();
+	error = s->Protocol.Functions->WriteMessage(s, msg, length, 0x40);
+	gammu_test_result(error, "WriteMessage");
+	test_result(writes == 1);
+
+	pos = 0;
+	frames = 0;
+	while (pos < written_length) {
+		i = check_frame(written + pos, written_length - pos);
+		test_result(written[pos + 3] == 0x40);
+		reflect_frame(written + pos, i);
+		pos += i;
+		frames++;
+	}
+	test_result(frames == expected_frames);
+
+	/* Phone sends the same frames back, all acks go out at once */
+	reset_log();
+	dispatched = 0;
+	test_result(GSM_ReadDevice(s, FALSE) > 0);
+	test_result(dispatched == 1);
+	test_result(received_type == 0x40);
+	test_result(received_length == length);
+	test_result(memcmp(received, msg, length) == 0);
+	test_result(check_acks(0x40) == expected_frames);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Protocol_FBUS2Data *d;
+	unsigned char msg[300];
+	int pos, i, frames;
+	int lengths[] = {1, 2, 3, 7, 8, 9, 17, 119, 120, 121, 239, 240, 241, 333, 1000, 2999};
+	GSM_Error error;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect protocol to loopback device without initialisation */
+	LoopbackPhone.DispatchMessage = loopback_dispatch;
+	s->Phone.Functions = &LoopbackPhone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "unknown", NULL);
+	s->Device.Functions = &LoopbackDevice;
+	s->Protocol.Functions = &FBUS2Protocol;
+	s->ConnectionType = GCT_FBUS2;
+	s->opened = TRUE;
+	d = &s->Protocol.Data.FBUS2;
+	memset(d, 0, sizeof(GSM_Protocol_FBUS2Data));
+	d->MsgRXState = RX_Sync;
+
+	for (i = 0; i < (int)(sizeof(lengths) / sizeof(lengths[0])); i++) {
+		do_test(lengths[i]);
+	}
+
+	/* Incomplete message, acks are written at the end of the burst */
+	for (i = 0; i < (int)sizeof(msg); i++) {
+		msg[i] = i & 0xff;
+	}
+	reset_log();
+	error = s->Protocol.Functions->WriteMessage(s, msg, sizeof(msg), 0x41);
+	gammu_test_result(error, "WriteMessage");
+	pos = 0;
+	for (frames = 0; frames < 2; frames++) {
+		i = check_frame(written + pos, written_length - pos);
+		reflect_frame(written + pos, i);
+		pos += i;
+	}
+	reset_log();
+	dispatched = 0;
+	test_result(GSM_ReadDevice(s, FALSE) > 0);
+	test_result(dispatched == 0);
+	test_result(check_acks(0x41) == 2);
+
+	/* Acks which were not flushed go out together with next message */
+	reset_log();
+	error = s->Protocol.Functions->WriteMessage(s, msg, sizeof(msg), 0x42);
+	gammu_test_result(error, "WriteMessage");
+	reflect_frame(written, check_frame(written, written_length));
+	reset_log();
+	for (i = 0; i < pending_length; i++) {
+		s->Protocol.Functions->StateMachine(s, pending[i]);
+	}
+	pending_length = 0;
+	test_result(writes == 0);
+	test_result(d->AckLength == FBUS2_ACK_LENGTH);
+
+	error = s->Protocol.Functions->WriteMessage(s, msg, 10, 0x43);
+	gammu_test_result(error, "WriteMessage");
+	test_result(writes == 1);
+	test_result(d->AckLength == 0);
+	pos = check_frame(written, written_length);
+	test_result(written[3] == FBUS2_ACK_BYTE);
+	test_result(written[6] == 0x42);
+	test_result(written[pos + 3] == 0x43);
+	test_result(pos + check_frame(written + pos, written_length - pos) == written_length);
+
+	/* Phone which needs acks immediately gets each one separately */
+	GSM_AddPhoneFeature(s->Phone.Data.ModelInfo, F_FBUS2_IMMEDIATE_ACK);
+	reset_log();
+	error = s->Protocol.Functions->WriteMessage(s, msg, sizeof(msg), 0x44);
+	gammu_test_result(error, "WriteMessage");
+	pos = 0;
+	for (frames = 0; frames < 3; frames++) {
+		i = check_frame(written + pos, written_length - pos);
+		reflect_frame(written + pos, i);
+		pos += i;
+	}
+	reset_log();
+	dispatched = 0;
+	test_result(GSM_ReadDevice(s, FALSE) > 0);
+	test_result(dispatched == 1);
+	test_result(writes == 3);
+	pos = 0;
+	for (frames = 0; frames < 3; frames++) {
+		test_result(written[pos + 3] == FBUS2_ACK_BYTE);
+		test_result(written[pos + 6] == 0x44);
+		pos += check_frame(written + pos, written_length - pos);
+	}
+	test_result(pos == written_length);
+	test_result(d->AckLength == 0);
+
+	/* Failed ack fails the request instead of dispatching reply */
+	reset_log();
+	error = s->Protocol.Functions->WriteMessage(s, msg, 10, 0x45);
+	gammu_test_result(error, "WriteMessage");
+	reflect_frame(written, check_frame(written, written_length));
+	broken = TRUE;
+	dispatched = 0;
+	s->Phone.Data.RequestID = ID_GetModel;
+	s->Phone.Data.DispatchError = ERR_TIMEOUT;
+	error = ERR_NONE;
+	for (i = 0; i < pending_length; i++) {
+		error = s->Protocol.Functions->StateMachine(s, pending[i]);
+	}
+	pending_length = 0;
+	gammu_test_result_code(error, "StateMachine", ERR_DEVICEWRITEERROR);
+	test_result(dispatched == 0);
+	test_result(s->Phone.Data.RequestID == ID_None);
+	test_result(s->Phone.Data.DispatchError == ERR_DEVICEWRITEERROR);
+	test_result(d->MsgRXState == RX_Sync);
+	broken = FALSE;
+
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
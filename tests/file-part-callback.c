@@ -0,0 +1,101 @@
+/**
+ * Test for streaming file data to callback, uses dummy phone.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+
+GSM_StateMachine *s;
+
+char streamed[1000];
+size_t streamed_length = 0;
+int calls = 0;
+
+static void file_part(GSM_StateMachine *sm, GSM_File *File UNUSED, const unsigned char *buffer, size_t length, void *user_data)
+{
+	test_result(sm == s);
+	test_result(user_data == &calls);
+	test_result(streamed_length + length < sizeof(streamed));
+	memcpy(streamed + streamed_length, buffer, length);
+	streamed_length += length;
+	calls++;
+}
+
+int main(int argc, char **argv)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Config *cfg;
+	GSM_File File;
+	GSM_Error error;
+	int Handle, Size;
+	const char expected[] = "This is testing file5!";
+
+	if (argc != 2) {
+		printf("Usage: file-part-callback DUMMY_PATH\n");
+		return 1;
+	}
+
+	GSM_InitLocales(NULL);
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	cfg = GSM_GetConfig(s, 0);
+	free(cfg->Device);
+	cfg->Device = strdup(argv[1]);
+	free(cfg->Connection);
+	cfg->Connection = strdup("none");
+	strcpy(cfg->Model, "dummy");
+	GSM_SetConfigNum(s, 1);
+
+	error = GSM_InitConnection(s, 1);
+	gammu_test_result(error, "GSM_InitConnection");
+
+	GSM_SetFilePartCallback(s, file_part, &calls);
+
+	memset(&File, 0, sizeof(File));
+	EncodeUnicode(File.ID_FullName, "file5", 5);
+	error = ERR_NONE;
+	while (error == ERR_NONE) {
+		error = GSM_GetFilePart(s, &File, &Handle, &Size);
+	}
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+
+	test_result(calls > 0);
+	test_result(File.Used == strlen(expected));
+	test_result(streamed_length == strlen(expected));
+	test_result(memcmp(streamed, expected, streamed_length) == 0);
+	free(File.Buffer);
+
+	/* Without callback nothing is streamed */
+	GSM_SetFilePartCallback(s, NULL, NULL);
+	calls = 0;
+	memset(&File, 0, sizeof(File));
+	EncodeUnicode(File.ID_FullName, "file5", 5);
+	error = GSM_GetFilePart(s, &File, &Handle, &Size);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(calls == 0);
+	test_result(File.Buffer != NULL && memcmp(File.Buffer, expected, File.Used) == 0);
+	free(File.Buffer);
+
+	error = GSM_TerminateConnection(s);
+	gammu_test_result(error, "GSM_TerminateConnection");
+
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
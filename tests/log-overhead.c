@@ -0,0 +1,107 @@
+/**
+ * Benchmark of logging overhead with disabled logging.
+ *
+ * Disabled messages must not evaluate their arguments, the timings are
+ * printed for comparison with enabled logging.
+ */
+
+#include <gammu.h>
+#include <gammu-smsd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "../libgammu/debug.h"
+#include "../smsd/core.h"
+
+#define ITERATIONS 200000
+
+static int evaluated = 0;
+
+/**
+ * Argument which counts how many times it was evaluated.
+ */
+static const char *expensive(void)
+{
+	evaluated++;
+	return "+420800123456";
+}
+
+static void report(const char *name, clock_t start)
+{
+	double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ITERATIONS;
+	printf("%-30s %10.1f ns/message\n", name, ns);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_SMSDConfig *Config;
+	GSM_StateMachine *s;
+	clock_t start;
+	int i;
+
+	/* SMSD log with disabled debug level */
+	Config = SMSD_NewConfig("log-overhead");
+	test_result(Config != NULL);
+	Config->debug_level = 0;
+	Config->log_type = SMSD_LOG_FILE;
+	Config->log_handle = tmpfile();
+	Config->use_timestamps = FALSE;
+	test_result(Config->log_handle != NULL);
+
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		SMSD_Log(DEBUG_NOTICE, Config, "Sending SMS %d to %s", i, expensive());
+	}
+	report("SMSD_Log disabled", start);
+#ifdef __GNUC__
+	test_result(evaluated == 0);
+#endif
+
+	Config->debug_level = DEBUG_NOTICE;
+	evaluated = 0;
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		SMSD_Log(DEBUG_NOTICE, Config, "Sending SMS %d to %s", i, expensive());
+	}
+	report("SMSD_Log enabled", start);
+	test_result(evaluated == ITERATIONS);
+	test_result(ftell(Config->log_handle) > 0);
+
+	SMSD_FreeConfig(Config);
+
+	/* Gammu debug log */
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	GSM_SetDebugGlobal(FALSE, GSM_GetDebug(s));
+	GSM_SetDebugLevel("nothing", GSM_GetDebug(s));
+
+	evaluated = 0;
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		smprintf(s, "Sending SMS %d to %s\n", i, expensive());
+	}
+	report("smprintf disabled", start);
+#ifdef __GNUC__
+	test_result(evaluated == 0);
+#endif
+
+	GSM_SetDebugFileDescriptor(tmpfile(), TRUE, GSM_GetDebug(s));
+	GSM_SetDebugLevel("textall", GSM_GetDebug(s));
+	evaluated = 0;
+	start = clock();
+	for (i = 0; i < ITERATIONS; i++) {
+		smprintf(s, "Sending SMS %d to %s\n", i, expensive());
+	}
+	report("smprintf enabled", start);
+	test_result(evaluated == ITERATIONS);
+
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
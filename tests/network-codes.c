@@ -18,6 +18,108 @@ int single_test(const char *string, const char *expected)
 	return 0;
 }
 
+int country_test(const char *string, const char *expected)
+{
+	const char *ret;
+	ret = GSM_GetCountryName(string);
+	if (strcmp(DecodeUnicodeConsole(ret), expected) != 0) {
+		printf("Result %s did not match %s\n", DecodeUnicodeConsole(ret), expected);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Checks that lookup finds every table entry, returning first one
+ * for duplicate codes.
+ */
+int table_test(void)
+{
+	int i, j;
+	const char *name;
+
+	for (i = 0; GSM_Networks[i].Code[0] != 0; i++) {
+		for (j = 0; strcmp(GSM_Networks[j].Code, GSM_Networks[i].Code) != 0; j++);
+		name = GSM_LookupNetworkName(GSM_Networks[i].Code);
+		if (name != GSM_Networks[j].Name) {
+			printf("Lookup of network %s failed\n", GSM_Networks[i].Code);
+			return 1;
+		}
+	}
+	for (i = 0; GSM_Countries[i].Code[0] != 0; i++) {
+		for (j = 0; strcmp(GSM_Countries[j].Code, GSM_Countries[i].Code) != 0; j++);
+		name = GSM_LookupCountryName(GSM_Countries[i].Code);
+		if (name != GSM_Countries[j].Name) {
+			printf("Lookup of country %s failed\n", GSM_Countries[i].Code);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Checks that encoded names match table and that returned names are
+ * not overwritten by following calls.
+ */
+int encoded_test(void)
+{
+	int i, j;
+	const unsigned char *first, *second;
+	unsigned char expected[200];
+
+	for (i = 0; GSM_Networks[i].Code[0] != 0; i++) {
+		for (j = 0; strcmp(GSM_Networks[j].Code, GSM_Networks[i].Code) != 0; j++);
+		EncodeUnicode(expected, GSM_Networks[j].Name, strlen(GSM_Networks[j].Name));
+		if (mywstrncmp(GSM_GetNetworkName(GSM_Networks[i].Code), expected, -1) != TRUE) {
+			printf("Encoded name of network %s does not match\n", GSM_Networks[i].Code);
+			return 1;
+		}
+	}
+	for (i = 0; GSM_Countries[i].Code[0] != 0; i++) {
+		for (j = 0; strcmp(GSM_Countries[j].Code, GSM_Countries[i].Code) != 0; j++);
+		EncodeUnicode(expected, GSM_Countries[j].Name, strlen(GSM_Countries[j].Name));
+		if (mywstrncmp(GSM_GetCountryName(GSM_Countries[i].Code), expected, -1) != TRUE) {
+			printf("Encoded name of country %s does not match\n", GSM_Countries[i].Code);
+			return 1;
+		}
+	}
+
+	first = GSM_GetNetworkName("247 01");
+	second = GSM_GetNetworkName("99999");
+	if (strcmp(DecodeUnicodeConsole(first), "LMT") != 0 ||
+			strcmp(DecodeUnicodeConsole(second), "GammuTel") != 0 ||
+			GSM_GetNetworkName("24701") != first) {
+		printf("Encoded network name was overwritten\n");
+		return 1;
+	}
+	first = GSM_GetCountryName("230");
+	second = GSM_GetCountryName("247");
+	if (strcmp(DecodeUnicodeConsole(first), "Czech Republic") != 0 ||
+			strcmp(DecodeUnicodeConsole(second), "Latvia") != 0 ||
+			GSM_GetCountryName("230 01") != first) {
+		printf("Encoded country name was overwritten\n");
+		return 1;
+	}
+	return 0;
+}
+
+int bulk_test(void)
+{
+	const char *codes[] = {"230 03", "99999", "00000", "262901", "26292"};
+	const char *names[5];
+
+	GSM_LookupNetworkNames(codes, names, 5);
+	if (strcmp(names[0], "Vodafone") != 0 ||
+			strcmp(names[1], "GammuTel") != 0 ||
+			names[2] != NULL ||
+			strcmp(names[3], "Debitel") != 0 ||
+			strcmp(names[4], "Nash Technologies") != 0) {
+		printf("Bulk lookup failed\n");
+		return 1;
+	}
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int rc = 0;
@@ -26,6 +128,16 @@ int main(int argc, char **argv)
 	rc |= single_test("24701", "LMT");
 	rc |= single_test("99999", "GammuTel");
 	rc |= single_test("00000", "unknown");
+	rc |= single_test("338 05", "Digicel");
+	rc |= single_test("338 050", "Digicel");
+	rc |= single_test("2470", "unknown");
+	rc |= single_test("247 01x", "unknown");
+	rc |= country_test("247 01", "Latvia");
+	rc |= country_test("230", "Czech Republic");
+	rc |= country_test("000", "unknown");
+	rc |= table_test();
+	rc |= encoded_test();
+	rc |= bulk_test();
 
 	return rc;
 }
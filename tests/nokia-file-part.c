@@ -0,0 +1,331 @@
+/**
+ * Test for Nokia filesystem 2 downloads, uses fake protocol which
+ * answers requests as phone with configurable limits on file part size.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+
+#define FILE_SIZE 100001
+#define MAX_REQUESTS 1000
+
+GSM_StateMachine *s;
+
+/**
+ * Content of file in phone.
+ */
+unsigned char data[FILE_SIZE];
+int data_size = FILE_SIZE;
+
+/**
+ * Phone behavior, zero means no limit.
+ */
+int limit_part = 0;
+int reject_above = 0;
+gboolean wrong_crc = FALSE;
+
+/**
+ * Sizes of requested file parts.
+ */
+int requests[MAX_REQUESTS];
+int requests_count = 0;
+
+/**
+ * Reply waiting for dispatch.
+ */
+unsigned char reply_buffer[FILE_SIZE + 100];
+GSM_Protocol_Message reply;
+gboolean reply_pending = FALSE;
+
+/**
+ * Data passed to callback.
+ */
+unsigned char streamed[FILE_SIZE];
+size_t streamed_length = 0;
+
+/**
+ * Checksum as computed by phone, bit by bit.
+ */
+static int phone_crc(const unsigned char *ptr, int len)
+{
+	int acc, i, accx;
+
+	accx = 0;
+	acc  = 0xffff;
+	while (len--) {
+		accx = (accx & 0xffff00ff) | (acc & 0xff00);
+		acc  = (acc  & 0xffff00ff) | (*ptr++ << 8);
+		for (i = 0; i < 8; i++) {
+			acc <<= 1;
+			if (acc & 0x10000)     acc ^= 0x1021;
+			if (accx & 0x80000000) acc ^= 0x1021;
+			accx <<= 1;
+		}
+	}
+	return acc & 0xffff;
+}
+
+static void put_int(unsigned char *buffer, int value)
+{
+	buffer[0] = (value >> 24) & 0xff;
+	buffer[1] = (value >> 16) & 0xff;
+	buffer[2] = (value >> 8) & 0xff;
+	buffer[3] = value & 0xff;
+}
+
+static int get_int(const unsigned char *buffer)
+{
+	return (buffer[0] << 24) + (buffer[1] << 16) + (buffer[2] << 8) + buffer[3];
+}
+
+static GSM_Error fake_write_message(GSM_StateMachine *sm UNUSED, unsigned const char *buffer, int length UNUSED, int type)
+{
+	int pos, size, crc;
+
+	test_result(type == 0x6D);
+	memset(reply_buffer, 0, 40);
+	reply.Type = 0x6D;
+	reply.Length = 40;
+	reply_buffer[3] = buffer[3] + 1;
+
+	switch (buffer[3]) {
+		case 0x6C:
+			/* File info */
+			put_int(reply_buffer + 10, data_size);
+			break;
+		case 0x72:
+			/* Open file */
+			put_int(reply_buffer + 6, 0x1234);
+			break;
+		case 0x5E:
+			/* File part */
+			test_result(get_int(buffer + 6) == 0x1234);
+			pos = get_int(buffer + 10);
+			size = get_int(buffer + 14);
+			test_result(requests_count < MAX_REQUESTS);
+			requests[requests_count++] = size;
+			if (reject_above != 0 && size > reject_above) {
+				/* Truncated reply */
+				reply.Length = 8;
+				break;
+			}
+			if (limit_part != 0 && size > limit_part) {
+				size = limit_part;
+			}
+			if (size > data_size - pos) {
+				size = data_size - pos;
+			}
+			put_int(reply_buffer + 6, size);
+			memcpy(reply_buffer + 10, data + pos, size);
+			reply.Length = 10 + size;
+			break;
+		case 0x66:
+			/* Checksum */
+			crc = phone_crc(data, data_size);
+			if (wrong_crc) {
+				crc ^= 1;
+			}
+			reply_buffer[6] = crc / 256;
+			reply_buffer[7] = crc % 256;
+			break;
+		case 0x74:
+			/* Close file */
+			break;
+		default:
+			test_result(FALSE);
+	}
+	reply.Buffer = reply_buffer;
+	reply_pending = TRUE;
+	return ERR_NONE;
+}
+
+static GSM_Error fake_state_machine(GSM_StateMachine *sm, unsigned char rx_char UNUSED)
+{
+	if (reply_pending) {
+		reply_pending = FALSE;
+		sm->Phone.Data.RequestMsg = &reply;
+		sm->Phone.Data.DispatchError = sm->Phone.Functions->DispatchMessage(sm);
+	}
+	return ERR_NONE;
+}
+
+static GSM_Error fake_none(GSM_StateMachine *sm UNUSED)
+{
+	return ERR_NONE;
+}
+
+GSM_Protocol_Functions FakeProtocol = {
+	fake_write_message,
+	fake_state_machine,
+	fake_none,
+	fake_none,
+	fake_none
+};
+
+static int fake_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes UNUSED)
+{
+	if (!reply_pending) {
+		return 0;
+	}
+	((char *)buf)[0] = 0;
+	return 1;
+}
+
+GSM_Device_Functions FakeDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	fake_read,
+	NONEFUNCTION
+};
+
+static void file_part(GSM_StateMachine *sm, GSM_File *File UNUSED, const unsigned char *buffer, size_t length, void *user_data UNUSED)
+{
+	test_result(sm == s);
+	test_result(streamed_length + length <= sizeof(streamed));
+	memcpy(streamed + streamed_length, buffer, length);
+	streamed_length += length;
+}
+
+/**
+ * Downloads file and returns final error code.
+ */
+static GSM_Error download(GSM_File *File)
+{
+	GSM_Error error = ERR_NONE;
+	int Handle, Size;
+
+	memset(File, 0, sizeof(GSM_File));
+	EncodeUnicode(File->ID_FullName, "d:/test.bin", 11);
+	requests_count = 0;
+	streamed_length = 0;
+	while (error == ERR_NONE) {
+		error = GSM_GetFilePart(s, File, &Handle, &Size);
+	}
+	return error;
+}
+
+static int max_request(int first)
+{
+	int i, result = 0;
+
+	for (i = first; i < requests_count; i++) {
+		if (requests[i] > result) {
+			result = requests[i];
+		}
+	}
+	return result;
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+	GSM_File File;
+	int i;
+
+	for (i = 0; i < FILE_SIZE; i++) {
+		data[i] = (i * 7 + i / 251) & 0xff;
+	}
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect Nokia driver to fake protocol */
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->Phone.Functions = &N6510Phone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "RM-93", NULL);
+	test_result(GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_FILES2));
+	s->Device.Functions = &FakeDevice;
+	s->Protocol.Functions = &FakeProtocol;
+	s->ReplyNum = 1;
+	s->opened = TRUE;
+
+	/* Streamed to callback, part size grows up to limit */
+	GSM_SetFilePartCallback(s, file_part, NULL);
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(File.Buffer == NULL);
+	test_result(File.Used == FILE_SIZE);
+	test_result(streamed_length == FILE_SIZE);
+	test_result(memcmp(streamed, data, FILE_SIZE) == 0);
+	test_result(requests[0] == 1000);
+	test_result(requests[1] == 2000);
+	test_result(max_request(0) == 16000);
+
+	/* Phone sending smaller parts is not asked for more */
+	GSM_SetFilePartCallback(s, NULL, NULL);
+	limit_part = 3000;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(File.Used == FILE_SIZE);
+	test_result(File.Buffer != NULL && memcmp(File.Buffer, data, FILE_SIZE) == 0);
+	test_result(max_request(0) == 4000);
+	free(File.Buffer);
+	limit_part = 0;
+
+	/* Rejected part is requested again with smaller size */
+	reject_above = 4000;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(File.Used == FILE_SIZE);
+	test_result(memcmp(File.Buffer, data, FILE_SIZE) == 0);
+	test_result(requests[3] == 8000);
+	test_result(requests[4] == 1000);
+	test_result(max_request(4) == 4000);
+	free(File.Buffer);
+
+	/* Limit is not kept for next file */
+	reject_above = 0;
+	data_size = 40000;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(File.Used == 40000);
+	test_result(requests[0] == 1000);
+	test_result(max_request(0) == 16000);
+	free(File.Buffer);
+
+	/* Truncated reply is not read */
+	reject_above = 500;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_UNKNOWNRESPONSE);
+	test_result(requests_count == 1);
+	free(File.Buffer);
+	reject_above = 0;
+
+	/* Checksum covers data of odd length */
+	data_size = 12345;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_EMPTY);
+	test_result(File.Used == 12345);
+	free(File.Buffer);
+
+	wrong_crc = TRUE;
+	error = download(&File);
+	gammu_test_result_code(error, "GSM_GetFilePart", ERR_WRONGCRC);
+	free(File.Buffer);
+
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
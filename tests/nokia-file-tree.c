@@ -0,0 +1,310 @@
+/**
+ * Test for walking Nokia filesystem 2, uses fake protocol which answers
+ * folder listings of deep and wide folder tree.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+
+/**
+ * Number of files in wide folder.
+ */
+#define WIDE 300
+/**
+ * Number of nested folders.
+ */
+#define DEEP 40
+
+#define MAX_ENTRIES (WIDE + 2 * DEEP + 10)
+
+GSM_StateMachine *s;
+
+/**
+ * Folder listing being sent.
+ */
+char listing[MAX_ENTRIES][20];
+gboolean listing_folder[MAX_ENTRIES];
+int listing_count = 0, listing_pos = 0;
+
+/**
+ * Reply waiting for dispatch.
+ */
+unsigned char reply_buffer[200];
+GSM_Protocol_Message reply;
+gboolean reply_pending = FALSE;
+
+/**
+ * Entries returned by walk.
+ */
+char walked[MAX_ENTRIES][400];
+int walked_count = 0;
+
+static void add_entry(const char *name, gboolean folder)
+{
+	test_result(listing_count < MAX_ENTRIES);
+	strcpy(listing[listing_count], name);
+	listing_folder[listing_count] = folder;
+	listing_count++;
+}
+
+/**
+ * Prepares content of folder, phone uses a: for d: and b: for a:.
+ */
+static void list_folder(const unsigned char *request)
+{
+	char path[400], name[20];
+	const char *pos;
+	int i, depth = 0;
+
+	strcpy(path, DecodeUnicodeString(request));
+	test_result(strlen(path) >= 4);
+	test_result(strcmp(path + strlen(path) - 2, "/*") == 0);
+	path[strlen(path) - 2] = 0;
+
+	listing_count = 0;
+	listing_pos = 0;
+	if (strcmp(path, "a:") == 0) {
+		add_entry("wide", TRUE);
+		add_entry("deep0", TRUE);
+	} else if (strcmp(path, "a:/wide") == 0) {
+		for (i = 0; i < WIDE; i++) {
+			sprintf(name, "f%03d", i);
+			add_entry(name, FALSE);
+		}
+	} else if (strncmp(path, "a:/deep0", 8) == 0) {
+		for (pos = path; *pos != 0; pos++) {
+			if (*pos == '/') depth++;
+		}
+		if (depth < DEEP) {
+			sprintf(name, "deep%d", depth);
+			add_entry(name, TRUE);
+		}
+		add_entry("leaf", FALSE);
+	} else {
+		/* Memory card is empty */
+		test_result(strcmp(path, "b:") == 0);
+	}
+}
+
+static void prepare_reply(void)
+{
+	memset(reply_buffer, 0, sizeof(reply_buffer));
+	reply.Type = 0x6D;
+	reply.Buffer = reply_buffer;
+	reply_buffer[3] = 0x69;
+	reply.Length = 40;
+
+	if (listing_count == 0) {
+		reply_buffer[4] = 0x0E;
+		listing_pos = 1;
+		return;
+	}
+	reply_buffer[4] = (listing_pos == listing_count - 1) ? 0x00 : 0x0D;
+	if (listing_folder[listing_pos]) {
+		reply_buffer[29] = 0x10;
+	} else {
+		reply_buffer[13] = 100;
+	}
+	EncodeUnicode(reply_buffer + 32, listing[listing_pos], strlen(listing[listing_pos]));
+	reply.Length = 32 + 2 * strlen(listing[listing_pos]) + 2;
+	listing_pos++;
+}
+
+static GSM_Error fake_write_message(GSM_StateMachine *sm UNUSED, unsigned const char *buffer, int length UNUSED, int type)
+{
+	test_result(type == 0x6D);
+
+	switch (buffer[3]) {
+		case 0x68:
+			/* Folder listing */
+			list_folder(buffer + 6);
+			break;
+		case 0x6C:
+			/* Folder info */
+			memset(reply_buffer, 0, sizeof(reply_buffer));
+			reply.Type = 0x6D;
+			reply.Buffer = reply_buffer;
+			reply.Length = 40;
+			reply_buffer[3] = 0x6D;
+			reply_buffer[29] = 0x10;
+			reply_pending = TRUE;
+			break;
+		default:
+			test_result(FALSE);
+	}
+	return ERR_NONE;
+}
+
+static gboolean fake_pending(void)
+{
+	return reply_pending || listing_pos < listing_count || (listing_count == 0 && listing_pos == 0);
+}
+
+static GSM_Error fake_state_machine(GSM_StateMachine *sm, unsigned char rx_char UNUSED)
+{
+	if (!reply_pending) {
+		if (!fake_pending()) {
+			return ERR_NONE;
+		}
+		prepare_reply();
+	}
+	reply_pending = FALSE;
+	sm->Phone.Data.RequestMsg = &reply;
+	sm->Phone.Data.DispatchError = sm->Phone.Functions->DispatchMessage(sm);
+	return ERR_NONE;
+}
+
+static GSM_Error fake_none(GSM_StateMachine *sm UNUSED)
+{
+	return ERR_NONE;
+}
+
+GSM_Protocol_Functions FakeProtocol = {
+	fake_write_message,
+	fake_state_machine,
+	fake_none,
+	fake_none,
+	fake_none
+};
+
+static int fake_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes UNUSED)
+{
+	if (!fake_pending()) {
+		return 0;
+	}
+	((char *)buf)[0] = 0;
+	return 1;
+}
+
+GSM_Device_Functions FakeDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	fake_read,
+	NONEFUNCTION
+};
+
+/**
+ * Checks that entry is consistent and its parent was returned before.
+ */
+static void check_entry(GSM_File *File)
+{
+	char id[400], name[300];
+	char *last;
+	int i, level = 1;
+
+	strcpy(id, DecodeUnicodeString(File->ID_FullName));
+	strcpy(name, DecodeUnicodeString(File->Name));
+	for (i = 0; id[i] != 0; i++) {
+		if (id[i] == '/') level++;
+	}
+	test_result(File->Level == level);
+
+	last = strrchr(id, '/');
+	if (last == NULL) {
+		test_result(File->Folder);
+		test_result(strlen(name) > 0);
+		return;
+	}
+	test_result(strcmp(last + 1, name) == 0);
+	*last = 0;
+	for (i = 0; i < walked_count; i++) {
+		if (strcmp(walked[i], id) == 0) return;
+	}
+	test_result(FALSE);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+	GSM_File File;
+	gboolean start;
+	char id[400];
+	int folders = 0, files = 0, max_level = 0;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect Nokia driver to fake protocol */
+	s->CurrentConfig = GSM_GetConfig(s, 0);
+	s->Phone.Functions = &N6510Phone;
+	s->Phone.Data.ModelInfo = GetModelData(NULL, NULL, "RM-93", NULL);
+	test_result(GSM_IsPhoneFeatureAvailable(s->Phone.Data.ModelInfo, F_FILES2));
+	s->Device.Functions = &FakeDevice;
+	s->Protocol.Functions = &FakeProtocol;
+	s->ReplyNum = 1;
+	s->opened = TRUE;
+	listing_pos = 1;
+
+	/* Whole tree, parents come before children */
+	start = TRUE;
+	while (TRUE) {
+		error = GSM_GetNextFileFolder(s, &File, start);
+		if (error == ERR_EMPTY) break;
+		gammu_test_result(error, "GSM_GetNextFileFolder");
+		start = FALSE;
+
+		check_entry(&File);
+		test_result(walked_count < MAX_ENTRIES);
+		strcpy(walked[walked_count++], DecodeUnicodeString(File.ID_FullName));
+		if (File.Folder) {
+			folders++;
+		} else {
+			files++;
+			test_result(File.Used == 100);
+		}
+		if (File.Level > max_level) {
+			max_level = File.Level;
+		}
+	}
+	printf("Walked %d folders and %d files, %d levels\n", folders, files, max_level);
+	test_result(folders == 2 + 1 + DEEP);
+	test_result(files == WIDE + DEEP);
+	test_result(max_level == DEEP + 2);
+	test_result(s->Phone.Data.Priv.N6510.FilesLocationsUsed == 0);
+
+	/* Listing of wide folder */
+	memset(&File, 0, sizeof(File));
+	EncodeUnicode(File.ID_FullName, "d:/wide", 7);
+	start = TRUE;
+	files = 0;
+	while (TRUE) {
+		error = GSM_GetFolderListing(s, &File, start);
+		if (error == ERR_EMPTY) break;
+		gammu_test_result(error, "GSM_GetFolderListing");
+		start = FALSE;
+		test_result(!File.Folder);
+		strcpy(id, DecodeUnicodeString(File.ID_FullName));
+		test_result(strncmp(id, "d:/wide/f", 9) == 0);
+		test_result(strcmp(id + 8, DecodeUnicodeString(File.Name)) == 0);
+		files++;
+	}
+	test_result(files == WIDE);
+
+	s->Phone.Functions->Terminate(s);
+	test_result(s->Phone.Data.Priv.N6510.FilesCache == NULL);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
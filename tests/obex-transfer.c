@@ -0,0 +1,387 @@
+/**
+ * Test for OBEX file transfers using scripted phone, covers packet size
+ * negotiation and Single Response Mode for GET and PUT.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+#include "../libgammu/gsmcomon.h"
+#include "../libgammu/gsmphones.h"	/* Phone data */
+#include "../libgammu/protocol/obex/obex.h"
+#include "../libgammu/phone/obex/obexfunc.h"
+
+#define BUFFER_SIZE 100000
+
+GSM_StateMachine *s;
+
+/**
+ * Data sent by phone and not yet read.
+ */
+unsigned char pending[BUFFER_SIZE];
+int pending_length = 0;
+
+/**
+ * Whether phone confirms Single Response Mode when asked for it.
+ */
+gboolean phone_srm = TRUE;
+/**
+ * Whether phone asks to wait after first PUT packet.
+ */
+gboolean phone_wait = FALSE;
+/**
+ * Whether phone is in Single Response Mode for current operation.
+ */
+gboolean srm_active = FALSE;
+/**
+ * Whether phone waits for next packet before continuing.
+ */
+gboolean srm_wait = FALSE;
+
+/**
+ * Statistics of requests received by phone.
+ */
+int requests_get = 0;
+int requests_put = 0;
+int responses = 0;
+gboolean srm_requested = FALSE;
+int advertised_frame = 0;
+
+/**
+ * File phone sends for GET and data received by PUT.
+ */
+unsigned char phone_file[BUFFER_SIZE];
+int phone_file_length = 0;
+int phone_file_pos = 0;
+int phone_part = 0;
+unsigned char received[BUFFER_SIZE];
+int received_length = 0;
+
+static void respond(int code, const unsigned char *headers, int length)
+{
+	test_result(pending_length + length + 3 <= BUFFER_SIZE);
+	pending[pending_length++] = code;
+	pending[pending_length++] = (length + 3) / 256;
+	pending[pending_length++] = (length + 3) % 256;
+	memcpy(pending + pending_length, headers, length);
+	pending_length += length;
+	responses++;
+}
+
+/**
+ * Sends next part of file as response to GET.
+ */
+static void respond_part(gboolean confirm_srm)
+{
+	unsigned char headers[2000];
+	int length = 0, size;
+	gboolean last;
+
+	if (confirm_srm) {
+		headers[length++] = 0x97;
+		headers[length++] = 0x01;
+	}
+	size = phone_file_length - phone_file_pos;
+	if (size > phone_part) {
+		size = phone_part;
+	}
+	last = (phone_file_pos + size == phone_file_length);
+	headers[length++] = last ? 0x49 : 0x48;
+	headers[length++] = (size + 3) / 256;
+	headers[length++] = (size + 3) % 256;
+	memcpy(headers + length, phone_file + phone_file_pos, size);
+	length += size;
+	phone_file_pos += size;
+	respond(last ? 0xA0 : 0x90, headers, length);
+}
+
+/**
+ * Walks headers of request and stores what phone is interested in.
+ */
+static void parse_headers(const unsigned char *buf, int pos, int length)
+{
+	int size;
+
+	while (pos < length) {
+		switch (buf[pos] & 0xc0) {
+		case 0x80:
+			if (buf[pos] == 0x97) {
+				srm_requested = (buf[pos + 1] == 0x01);
+			}
+			pos += 2;
+			break;
+		case 0xc0:
+			pos += 5;
+			break;
+		default:
+			size = buf[pos + 1] * 256 + buf[pos + 2];
+			test_result(size >= 3);
+			if (buf[pos] == 0x48 || buf[pos] == 0x49) {
+				memcpy(received + received_length, buf + pos + 3, size - 3);
+				received_length += size - 3;
+			}
+			pos += size;
+			break;
+		}
+	}
+}
+
+static int script_read(GSM_StateMachine *sm UNUSED, void *buf, size_t nbytes)
+{
+	int length = pending_length;
+
+	if ((size_t)length > nbytes) {
+		length = nbytes;
+	}
+	memcpy(buf, pending, length);
+	memmove(pending, pending + length, pending_length - length);
+	pending_length -= length;
+	return length;
+}
+
+static int script_write(GSM_StateMachine *sm UNUSED, const void *data, size_t nbytes)
+{
+	const unsigned char *buf = data;
+	unsigned char headers[20];
+	int length;
+
+	test_result(nbytes >= 3);
+	length = buf[1] * 256 + buf[2];
+	test_result(length == (int)nbytes);
+
+	switch (buf[0]) {
+	case 0x80:
+		/* Connect, we announce 8 KiB packets */
+		advertised_frame = buf[5] * 256 + buf[6];
+		headers[0] = 0x10;
+		headers[1] = 0x00;
+		headers[2] = 0x20;
+		headers[3] = 0x00;
+		headers[4] = 0xCB;
+		headers[5] = 0x00;
+		headers[6] = 0x00;
+		headers[7] = 0x00;
+		headers[8] = 0x01;
+		respond(0xA0, headers, 9);
+		break;
+	case 0x85:
+		/* Set path */
+		respond(0xA0, NULL, 0);
+		break;
+	case 0x83:
+		/* Get */
+		requests_get++;
+		if (requests_get == 1) {
+			srm_requested = FALSE;
+			parse_headers(buf, 3, length);
+			srm_active = srm_requested && phone_srm;
+			respond_part(srm_active);
+			/* Whole file goes out without further requests */
+			while (srm_active && phone_file_pos < phone_file_length) {
+				respond_part(FALSE);
+			}
+		} else {
+			test_result(!srm_active);
+			respond_part(FALSE);
+		}
+		break;
+	case 0x02:
+	case 0x82:
+		/* Put */
+		requests_put++;
+		if (requests_put == 1) {
+			srm_requested = FALSE;
+			parse_headers(buf, 3, length);
+			srm_active = srm_requested && phone_srm;
+		} else {
+			parse_headers(buf, 3, length);
+		}
+		if (buf[0] == 0x82) {
+			respond(0xA0, NULL, 0);
+		} else if (!srm_active) {
+			respond(0x90, NULL, 0);
+		} else if (requests_put == 1) {
+			/* Confirm Single Response Mode, optionally asking to wait */
+			headers[0] = 0x97;
+			headers[1] = 0x01;
+			headers[2] = 0x98;
+			headers[3] = 0x01;
+			respond(0x90, headers, phone_wait ? 4 : 2);
+			srm_wait = phone_wait;
+		} else if (srm_wait) {
+			/* Continue without waiting */
+			respond(0x90, NULL, 0);
+			srm_wait = FALSE;
+		}
+		break;
+	default:
+		printf("Unexpected request 0x%02x\n", buf[0]);
+		test_result(FALSE);
+	}
+	return nbytes;
+}
+
+GSM_Device_Functions ScriptDevice = {
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	NONEFUNCTION,
+	script_read,
+	script_write
+};
+
+static void reset_phone(GSM_PhoneModel *model)
+{
+	pending_length = 0;
+	requests_get = 0;
+	requests_put = 0;
+	responses = 0;
+	srm_active = FALSE;
+	srm_wait = FALSE;
+	received_length = 0;
+	phone_file_pos = 0;
+	s->Phone.Data.ModelInfo = model;
+}
+
+static void check_connect(GSM_PhoneModel *model, int advertised, int frame)
+{
+	GSM_Error error;
+
+	reset_phone(model);
+	s->Phone.Data.Priv.OBEXGEN.Service = 0;
+	error = OBEXGEN_Connect(s, OBEX_BrowsingFolders);
+	gammu_test_result(error, "OBEXGEN_Connect");
+	test_result(advertised_frame == advertised);
+	test_result(s->Phone.Data.Priv.OBEXGEN.FrameSize == frame);
+}
+
+static void check_get(GSM_PhoneModel *model, gboolean srm, int size, int part, int expected_requests)
+{
+	GSM_File file;
+	GSM_Error error;
+	int handle, got, i;
+
+	reset_phone(model);
+	phone_srm = srm;
+	phone_part = part;
+	phone_file_length = size;
+	for (i = 0; i < size; i++) {
+		phone_file[i] = (i * 13 + size) & 0xff;
+	}
+
+	memset(&file, 0, sizeof(file));
+	EncodeUnicode(file.ID_FullName, "a.bin", 5);
+	error = OBEXGEN_GetFilePart(s, &file, &handle, &got);
+	gammu_test_result_code(error, "OBEXGEN_GetFilePart", ERR_EMPTY);
+
+	printf("GET %d bytes in %d requests\n", got, requests_get);
+	test_result(got == size);
+	test_result(file.Used == (size_t)size);
+	test_result(memcmp(file.Buffer, phone_file, size) == 0);
+	test_result(requests_get == expected_requests);
+	test_result(pending_length == 0);
+	free(file.Buffer);
+}
+
+static void check_put(GSM_PhoneModel *model, gboolean srm, gboolean wait, int size, int expected_responses)
+{
+	GSM_File file;
+	GSM_Error error;
+	int pos = 0, handle = 0, i;
+
+	reset_phone(model);
+	phone_srm = srm;
+	phone_wait = wait;
+
+	memset(&file, 0, sizeof(file));
+	EncodeUnicode(file.ID_FullName, "dir", 3);
+	EncodeUnicode(file.Name, "b.bin", 5);
+	file.Used = size;
+	file.Buffer = (unsigned char *)malloc(size);
+	test_result(file.Buffer != NULL);
+	for (i = 0; i < size; i++) {
+		file.Buffer[i] = (i * 7 + size) & 0xff;
+	}
+
+	do {
+		error = OBEXGEN_AddFilePart(s, &file, &pos, &handle);
+	} while (error == ERR_NONE);
+	gammu_test_result_code(error, "OBEXGEN_AddFilePart", ERR_EMPTY);
+
+	/* Set path is answered as well */
+	responses -= 2;
+	printf("PUT %d bytes in %d requests, %d responses\n", received_length, requests_put, responses);
+	test_result(received_length == size);
+	test_result(memcmp(received, file.Buffer, size) == 0);
+	test_result(responses == expected_responses);
+	test_result(pending_length == 0);
+	free(file.Buffer);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_PhoneModel plain = {"obex", "obex", "", {0}};
+	GSM_PhoneModel small = {"obex", "obex", "", {F_OBEX_SMALL_FRAME, 0}};
+	GSM_PhoneModel nosrm = {"obex", "obex", "", {F_OBEX_NO_SRM, 0}};
+	GSM_Error error;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	/* Connect OBEX driver to scripted phone */
+	s->CurrentConfig = &s->Config[0];
+	s->ReplyNum = 1;
+	s->Phone.Functions = &OBEXGENPhone;
+	s->Device.Functions = &ScriptDevice;
+	s->Protocol.Functions = &OBEXProtocol;
+	s->opened = TRUE;
+	error = s->Protocol.Functions->Initialise(s);
+	gammu_test_result(error, "Initialise");
+	s->Phone.Data.ModelInfo = &plain;
+	error = OBEXGEN_InitialiseVars(s);
+	gammu_test_result(error, "OBEXGEN_InitialiseVars");
+
+	/* Frame size negotiation */
+	check_connect(&small, 0x0400, 0x0400);
+	check_connect(&plain, 0xFFFF, 0x2000);
+
+	/* GET in Single Response Mode needs only one request */
+	check_get(&plain, TRUE, 5000, 1000, 1);
+	check_get(&plain, TRUE, 700, 1000, 1);
+	/* Phone ignoring Single Response Mode or feature disabling it */
+	check_get(&plain, FALSE, 5000, 1000, 5);
+	check_get(&nosrm, TRUE, 5000, 1000, 5);
+
+	/* PUT in Single Response Mode is answered on first and last packet */
+	check_put(&plain, TRUE, FALSE, 30000, 2);
+	/* Phone asking to wait answers one more packet */
+	check_put(&plain, TRUE, TRUE, 30000, 3);
+	/* Without Single Response Mode every packet is answered */
+	check_put(&plain, FALSE, FALSE, 30000, 4);
+	check_put(&nosrm, TRUE, FALSE, 30000, 4);
+	/* File fitting into one packet */
+	check_put(&plain, TRUE, FALSE, 100, 1);
+
+	OBEXGEN_FreeVars(s);
+	s->Protocol.Functions->Terminate(s);
+	s->opened = FALSE;
+	s->Phone.Functions = NULL;
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
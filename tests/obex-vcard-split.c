@@ -20,7 +20,7 @@
 extern GSM_Error OBEXGEN_InitLUID(GSM_StateMachine *s, const char *Name,
 		const gboolean Recalculate,
 		const char *Header,
-		char **Data, int **Offsets, int *Count,
+		char **Data, size_t *DataLength, int **Offsets, int *Count,
 		char ***LUIDStorage, int *LUIDCount,
 		int **IndexStorage, int *IndexCount);
 
@@ -33,6 +33,7 @@ int main(int argc, char **argv)
 	size_t len;
 	GSM_StateMachine *s;
 	GSM_Error error;
+    size_t DataLength;
     int *Offsets;
     int Count;
 	char **LUIDStorage;
@@ -89,7 +90,7 @@ int main(int argc, char **argv)
 	GSM_SetDebugGlobal(TRUE, debug_info);
 
 	/* Parse data */
-	error = OBEXGEN_InitLUID(s, "", TRUE, "BEGIN:VCARD", &buffer, &Offsets, &Count, &LUIDStorage, &LUIDCount, &IndexStorage, &IndexCount);
+	error = OBEXGEN_InitLUID(s, "", TRUE, "BEGIN:VCARD", &buffer, &DataLength, &Offsets, &Count, &LUIDStorage, &LUIDCount, &IndexStorage, &IndexCount);
 
 	/* Free state machine */
 	GSM_FreeStateMachine(s);
@@ -98,6 +99,7 @@ int main(int argc, char **argv)
 
 	gammu_test_result(error, "OBEXGEN_InitLUID");
     test_result(atoi(argv[2]) == Count);
+    test_result(DataLength == len);
 
 	return 0;
 }
@@ -0,0 +1,241 @@
+/**
+ * Test for encoding message once and stamping it for several
+ * recipients, result has to match direct encoding.
+ */
+
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+
+#define RECIPIENTS 3
+
+/**
+ * Parses IDs from UDH text, unused IDs hold encoding time otherwise.
+ */
+static void parse_udh(GSM_Debug_Info *debug_info, GSM_MultiSMSMessage *SMS)
+{
+	int i;
+
+	for (i = 0; i < SMS->Number; i++) {
+		if (SMS->SMS[i].UDH.Type != UDH_NoUDH) {
+			GSM_DecodeUDHHeader(debug_info, &SMS->SMS[i].UDH);
+		} else {
+			SMS->SMS[i].UDH.ID8bit = -1;
+			SMS->SMS[i].UDH.ID16bit = -1;
+		}
+	}
+}
+
+/**
+ * Returns concatenation reference parsed from UDH, -1 if there is none.
+ */
+static int parsed_reference(const GSM_MultiSMSMessage *SMS)
+{
+	if (SMS->SMS[0].UDH.Type == UDH_NoUDH) {
+		return -1;
+	}
+	if (SMS->SMS[0].UDH.ID16bit != -1) {
+		return SMS->SMS[0].UDH.ID16bit;
+	}
+	return SMS->SMS[0].UDH.ID8bit;
+}
+
+/**
+ * Plain text messages are not decoded by library, use their text as
+ * long text.
+ */
+static gboolean decode_text(GSM_MultiPartSMSInfo *Info, GSM_MultiSMSMessage *SMS)
+{
+	size_t length = 0;
+	int i;
+
+	for (i = 0; i < SMS->Number; i++) {
+		if (SMS->SMS[i].UDH.Type != UDH_NoUDH ||
+				(SMS->SMS[i].Coding != SMS_Coding_Default_No_Compression &&
+				 SMS->SMS[i].Coding != SMS_Coding_Unicode_No_Compression)) {
+			return FALSE;
+		}
+		length += UnicodeLength(SMS->SMS[i].Text);
+	}
+
+	Info->Entries[0].Buffer = (unsigned char *)malloc((length + 1) * 2);
+	test_result(Info->Entries[0].Buffer != NULL);
+	Info->Entries[0].Buffer[0] = 0;
+	Info->Entries[0].Buffer[1] = 0;
+	for (i = 0; i < SMS->Number; i++) {
+		CopyUnicodeString(Info->Entries[0].Buffer + UnicodeLength(Info->Entries[0].Buffer) * 2, SMS->SMS[i].Text);
+	}
+	Info->Entries[0].ID = SMS_ConcatenatedTextLong;
+	Info->EntriesNum = 1;
+	Info->UnicodeCoding = (SMS->SMS[0].Coding == SMS_Coding_Unicode_No_Compression);
+	Info->Class = SMS->SMS[0].Class;
+	return TRUE;
+}
+
+/**
+ * Encodes message both ways and compares results.
+ */
+static void check_message(GSM_Debug_Info *debug_info, GSM_MultiPartSMSInfo *Info, int *linked)
+{
+	const char *numbers[RECIPIENTS] = {"+420800123456", "800123457", "+12025550123"};
+	GSM_MultiSMSMessage *expected, *stamped;
+	GSM_MultiPartSMSContext *context;
+	GSM_SMSValidity validity;
+	GSM_Error error, error2;
+	unsigned char number[(GSM_MAX_NUMBER_LENGTH + 1) * 2];
+	int r, i, reference, first;
+
+	expected = (GSM_MultiSMSMessage *)calloc(1, sizeof(GSM_MultiSMSMessage));
+	stamped = (GSM_MultiSMSMessage *)calloc(1, sizeof(GSM_MultiSMSMessage));
+	context = (GSM_MultiPartSMSContext *)calloc(1, sizeof(GSM_MultiPartSMSContext));
+	test_result(expected != NULL && stamped != NULL && context != NULL);
+
+	/* Template is filled the way gammu-smsd-inject does it */
+	error = GSM_EncodeMultiPartSMS(debug_info, Info, &context->Template);
+	context->Reference = -1;
+
+	for (r = 0; r < RECIPIENTS; r++) {
+		EncodeUnicode(number, numbers[r], strlen(numbers[r]));
+		validity.Format = SMS_Validity_RelativeFormat;
+		validity.Relative = SMS_VALID_1_Day + r;
+		reference = 0x1200 + r;
+
+		/* Encoding the way callers do it without context */
+		memset(expected, 0, sizeof(GSM_MultiSMSMessage));
+		Info->Reference = reference;
+		error2 = GSM_EncodeMultiPartSMS(debug_info, Info, expected);
+		Info->Reference = -1;
+		test_result(error == error2);
+		if (error != ERR_NONE) {
+			break;
+		}
+		for (i = 0; i < expected->Number; i++) {
+			CopyUnicodeString(expected->SMS[i].Number, number);
+			expected->SMS[i].SMSC.Validity = validity;
+			expected->SMS[i].MessageReference = 10 + r;
+		}
+
+		error2 = GSM_StampMultiPartSMS(debug_info, context, stamped, number, &validity, 10 + r, reference);
+		gammu_test_result(error2, "GSM_StampMultiPartSMS");
+		test_result(stamped->Number == expected->Number);
+
+		parse_udh(debug_info, expected);
+		parse_udh(debug_info, stamped);
+		for (i = 0; i < expected->Number; i++) {
+			/* Both encodings are stamped with their own time */
+			expected->SMS[i].DateTime = stamped->SMS[i].DateTime;
+			expected->SMS[i].SMSCTime = stamped->SMS[i].SMSCTime;
+			test_result(memcmp(&expected->SMS[i], &stamped->SMS[i], sizeof(GSM_SMSMessage)) == 0);
+		}
+
+		/* Reference is stored where library parses it */
+		if (parsed_reference(stamped) != -1) {
+			if (stamped->SMS[0].UDH.ID16bit != -1) {
+				test_result(stamped->SMS[0].UDH.ID16bit == reference);
+			} else {
+				test_result(stamped->SMS[0].UDH.ID8bit == reference % 256);
+			}
+			if (r == 0) {
+				(*linked)++;
+			}
+		}
+	}
+
+	/* Every recipient gets next reference, starting with template one */
+	if (error == ERR_NONE && parsed_reference(stamped) != -1) {
+		memcpy(expected, &context->Template, sizeof(GSM_MultiSMSMessage));
+		parse_udh(debug_info, expected);
+		first = parsed_reference(expected);
+
+		for (r = 0; r < RECIPIENTS; r++) {
+			error = GSM_StampMultiPartSMS(debug_info, context, stamped, NULL, NULL, -1, -1);
+			gammu_test_result(error, "GSM_StampMultiPartSMS");
+			parse_udh(debug_info, stamped);
+			reference = parsed_reference(stamped);
+			if (stamped->SMS[0].UDH.ID16bit != -1) {
+				test_result(reference == (first + r) % 65536);
+			} else {
+				test_result(reference == (first + r) % 256);
+			}
+		}
+	}
+
+	free(expected);
+	free(stamped);
+	free(context);
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+	GSM_SMS_Backup Backup;
+	GSM_MultiSMSMessage **SortedSMS, **InputSMS;
+	GSM_MultiPartSMSInfo SMSInfo;
+	int i, count, decoded = 0, linked = 0;
+
+	/* Check parameters */
+	if (argc != 2) {
+		printf("Not enough parameters!\nUsage: sms-encode-template file.smsbackup\n");
+		return 1;
+	}
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	/* Read the backup */
+	error = GSM_ReadSMSBackupFile(argv[1], &Backup);
+	gammu_test_result(error, "GSM_ReadSMSBackupFile");
+
+	/* Calculate number of messages */
+	count = 0;
+	while (Backup.SMS[count] != NULL) {
+		count++;
+	}
+
+	SortedSMS = (GSM_MultiSMSMessage **) malloc((count + 1) * sizeof(GSM_MultiSMSMessage *));
+	InputSMS = (GSM_MultiSMSMessage **) malloc((count + 1) * sizeof(GSM_MultiSMSMessage *));
+	test_result(SortedSMS != NULL && InputSMS != NULL);
+
+	for (i = 0; i < count; i++) {
+		InputSMS[i] = (GSM_MultiSMSMessage *)malloc(sizeof(GSM_MultiSMSMessage));
+		test_result(InputSMS[i] != NULL);
+		InputSMS[i]->Number = 1;
+		InputSMS[i]->SMS[0] = *Backup.SMS[i];
+	}
+	InputSMS[i] = NULL;
+
+	error = GSM_LinkSMS(debug_info, InputSMS, SortedSMS, TRUE);
+	gammu_test_result(error, "GSM_LinkSMS");
+
+	for (i = 0; i < count; i++) {
+		free(InputSMS[i]);
+	}
+
+	/* Re-encode every message which can be decoded */
+	for (i = 0; SortedSMS[i] != NULL; i++) {
+		GSM_ClearMultiPartSMSInfo(&SMSInfo);
+		if (GSM_DecodeMultiPartSMS(debug_info, &SMSInfo, SortedSMS[i], TRUE) ||
+				decode_text(&SMSInfo, SortedSMS[i])) {
+			check_message(debug_info, &SMSInfo, &linked);
+			decoded++;
+		}
+		GSM_FreeMultiPartSMSInfo(&SMSInfo);
+		free(SortedSMS[i]);
+	}
+	printf("Checked %d messages, %d linked\n", decoded, linked);
+
+	GSM_FreeSMSBackup(&Backup);
+	free(InputSMS);
+	free(SortedSMS);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,48 @@
+/**
+ * Test for reading SMSD intervals from configuration.
+ */
+
+#include <gammu.h>
+#include <gammu-smsd.h>
+#include <stdio.h>
+#include <limits.h>
+
+#include "common.h"
+#include "../smsd/core.h"
+
+int main(int argc, char **argv)
+{
+	GSM_SMSDConfig *Config;
+	GSM_Error error;
+
+	if (argc != 2) {
+		printf("Usage: smsd-interval SMSDRC\n");
+		return 1;
+	}
+
+	Config = SMSD_NewConfig("smsd-interval");
+	test_result(Config != NULL);
+
+	error = SMSD_ReadConfig(argv[1], Config, TRUE);
+	gammu_test_result(error, "SMSD_ReadConfig");
+
+	/* Too big values are limited to what fits in miliseconds */
+	test_result(Config->commtimeout == UINT_MAX / 1000 * 1000);
+	test_result(Config->sendtimeout == UINT_MAX / 1000 * 1000);
+	test_result(Config->resetfrequency == UINT_MAX / 1000 * 1000);
+
+	/* Fractions are rounded to miliseconds */
+	test_result(Config->receivefrequency == 250);
+
+	/* Invalid values are replaced by defaults */
+	test_result(Config->statusfrequency == 15000);
+	test_result(Config->loopsleep == 1000);
+
+	SMSD_FreeConfig(Config);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,162 @@
+/**
+ * Test for SMSD metrics accounting.
+ */
+
+#include <gammu-config.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "common.h"
+#include <gammu-smsd.h>
+#include "../smsd/metrics.h"
+
+#ifdef HAVE_PTHREAD
+#define WRITERS 4
+#define UPDATES 200000
+
+static GSM_SMSDStatus shared;
+
+static void *writer(void *data UNUSED)
+{
+	int i;
+
+	for (i = 0; i < UPDATES; i++) {
+		SMSD_MetricsObserve(&shared, SMSD_HISTOGRAM_PHONE_SEND, i % 20);
+		SMSD_MetricsAdd(&shared, SMSD_COUNTER_PARTS_SENT, 1);
+	}
+	return NULL;
+}
+
+/**
+ * Several threads update metrics without lock while copies are made.
+ */
+static void test_concurrent(void)
+{
+	pthread_t threads[WRITERS];
+	GSM_SMSDStatus copy;
+	GSM_SMSDHistogram *hist;
+	unsigned long long total;
+	GSM_Error error;
+	int i, j, copies = 0;
+
+	memset(&shared, 0, sizeof(shared));
+	SMSD_MetricsInit(&shared);
+
+	for (i = 0; i < WRITERS; i++) {
+		test_result(pthread_create(&threads[i], NULL, writer, NULL) == 0);
+	}
+
+	/* Every copy has histogram count matching its buckets */
+	while (shared.Metrics.Counters[SMSD_COUNTER_PARTS_SENT] < WRITERS * UPDATES) {
+		error = SMSD_CopyStatus(&copy, &shared);
+		if (error == ERR_TIMEOUT) {
+			continue;
+		}
+		gammu_test_result(error, "SMSD_CopyStatus");
+		test_result(copy.Metrics.Sequence % 2 == 0);
+		test_result((unsigned long long)copy.Sent == copy.Metrics.Counters[SMSD_COUNTER_PARTS_SENT]);
+		hist = &copy.Metrics.Histograms[SMSD_HISTOGRAM_PHONE_SEND];
+		total = 0;
+		for (j = 0; j < SMSD_HISTOGRAM_BUCKETS; j++) {
+			total += hist->Buckets[j];
+		}
+		test_result(total == hist->Count);
+		copies++;
+	}
+
+	for (i = 0; i < WRITERS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	/* No update is lost */
+	test_result(shared.Metrics.Counters[SMSD_COUNTER_PARTS_SENT] == WRITERS * UPDATES);
+	test_result(shared.Sent == WRITERS * UPDATES);
+	test_result(shared.Metrics.Histograms[SMSD_HISTOGRAM_PHONE_SEND].Count == WRITERS * UPDATES);
+	test_result(shared.Metrics.Sequence == 2 * 2 * WRITERS * UPDATES);
+	printf("Made %d consistent copies while updating\n", copies);
+}
+#endif
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_SMSDStatus status, copy;
+	GSM_BatteryCharge charge;
+	GSM_SignalQuality network;
+	GSM_Error error;
+	unsigned long long start;
+
+	memset(&status, 0, sizeof(status));
+	SMSD_MetricsInit(&status);
+	test_result(status.Metrics.BucketLimits[0] == 5);
+	test_result(status.Metrics.BucketLimits[SMSD_HISTOGRAM_BUCKETS - 1] == 0);
+
+	/* Counters */
+	SMSD_MetricsAdd(&status, SMSD_COUNTER_PARTS_SENT, 1);
+	SMSD_MetricsAdd(&status, SMSD_COUNTER_PARTS_SENT, 2);
+	SMSD_MetricsAdd(NULL, SMSD_COUNTER_PARTS_SENT, 1);
+	test_result(status.Metrics.Counters[SMSD_COUNTER_PARTS_SENT] == 3);
+	test_result(status.Metrics.Counters[SMSD_COUNTER_PARTS_FAILED] == 0);
+
+	/* Basic counters follow matching metrics */
+	SMSD_MetricsAdd(&status, SMSD_COUNTER_PARTS_FAILED, 4);
+	SMSD_MetricsAdd(&status, SMSD_COUNTER_PARTS_RECEIVED, 5);
+	test_result(status.Sent == 3);
+	test_result(status.Failed == 4);
+	test_result(status.Received == 5);
+	test_result(status.Metrics.Counters[SMSD_COUNTER_PARTS_RECEIVED] == 5);
+
+	/* Histogram buckets, bounds are inclusive */
+	SMSD_MetricsObserve(&status, SMSD_HISTOGRAM_DB_QUERY, 0);
+	SMSD_MetricsObserve(&status, SMSD_HISTOGRAM_DB_QUERY, 5);
+	SMSD_MetricsObserve(&status, SMSD_HISTOGRAM_DB_QUERY, 6);
+	SMSD_MetricsObserve(&status, SMSD_HISTOGRAM_DB_QUERY, 1000000);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_DB_QUERY].Buckets[0] == 2);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_DB_QUERY].Buckets[1] == 1);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_DB_QUERY].Buckets[SMSD_HISTOGRAM_BUCKETS - 1] == 1);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_DB_QUERY].Count == 4);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_DB_QUERY].Sum == 1000011);
+	test_result(status.Metrics.Histograms[SMSD_HISTOGRAM_PHONE_SEND].Count == 0);
+
+	SMSD_MetricsSetInboxQueue(&status, 7);
+	test_result(status.Metrics.InboxQueue == 7);
+
+	/* Phone status */
+	memset(&charge, 0, sizeof(charge));
+	memset(&network, 0, sizeof(network));
+	charge.BatteryPercent = 42;
+	network.SignalStrength = -73;
+	SMSD_MetricsSetPhoneStatus(&status, &charge, &network);
+	SMSD_MetricsSetPhoneStatus(NULL, &charge, &network);
+	test_result(status.Charge.BatteryPercent == 42);
+	test_result(status.Network.SignalStrength == -73);
+
+	/* Every update leaves sequence even */
+	test_result(status.Metrics.Sequence % 2 == 0);
+	test_result(status.Metrics.Sequence == 20);
+
+	/* Consistent copy */
+	error = SMSD_CopyStatus(&copy, &status);
+	gammu_test_result(error, "SMSD_CopyStatus");
+	test_result(memcmp(&copy, &status, sizeof(status)) == 0);
+
+	/* Copy while update is in progress fails */
+	status.Metrics.Sequence++;
+	error = SMSD_CopyStatus(&copy, &status);
+	gammu_test_result_code(error, "SMSD_CopyStatus", ERR_TIMEOUT);
+
+	/* Monotonic time */
+	start = SMSD_MonotonicTime();
+	test_result(SMSD_MonotonicTime() >= start);
+
+#ifdef HAVE_PTHREAD
+	test_concurrent();
+#endif
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,392 @@
+/**
+ * Test for asynchronous SMSD backend writer.
+ *
+ * Uses backend which lets writer store messages only when allowed, so
+ * that main loop calls can be checked not to wait for writer and
+ * journal can be checked not to grow while queue never drains.
+ */
+
+#include <gammu.h>
+#include <gammu-smsd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "../smsd/core.h"
+#include "../smsd/writer.h"
+
+/**
+ * Journal grows by this much without compaction.
+ */
+#define UNCOMPACTED_SIZE (4 * 1024 * 1024)
+
+/**
+ * Limit for journal size, compaction keeps it much smaller.
+ */
+#define JOURNAL_LIMIT (1024 * 1024)
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Number of messages backend may store, -1 for unlimited.
+ */
+static int tokens = -1;
+/**
+ * Whether backend fails to store messages.
+ */
+static gboolean failing = FALSE;
+static gboolean in_save = FALSE;
+static int saved = 0;
+static int failed = 0;
+static int *saved_location = NULL;
+static int saved_size = 0;
+static int produced = 0;
+
+static GSM_SMSDConfig *main_config = NULL;
+static GSM_SMSDConfig *writer_config = NULL;
+static int inits = 0;
+static int frees = 0;
+static char sent_dt[40];
+static char sent_id[200];
+
+static GSM_Error TestInit(GSM_SMSDConfig *Config)
+{
+	pthread_mutex_lock(&lock);
+	inits++;
+	writer_config = Config;
+	pthread_mutex_unlock(&lock);
+	return ERR_NONE;
+}
+
+static GSM_Error TestFree(GSM_SMSDConfig *Config)
+{
+	test_result(Config == writer_config);
+	frees++;
+	return ERR_NONE;
+}
+
+static GSM_Error TestNone(GSM_SMSDConfig *Config UNUSED)
+{
+	return ERR_NONE;
+}
+
+static GSM_Error TestSaveInboxSMS(GSM_MultiSMSMessage *sms, GSM_SMSDConfig *Config, char **Locations)
+{
+	GSM_Error error = ERR_NONE;
+
+	test_result(Config == writer_config);
+	*Locations = NULL;
+
+	pthread_mutex_lock(&lock);
+	in_save = TRUE;
+	pthread_cond_broadcast(&cond);
+	while (tokens == 0 && !failing) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	if (failing) {
+		failed++;
+		error = ERR_UNKNOWN;
+	} else {
+		if (tokens > 0) {
+			tokens--;
+		}
+		test_result(saved < saved_size);
+		saved_location[saved++] = sms->SMS[0].Location;
+	}
+	in_save = FALSE;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	return error;
+}
+
+static GSM_Error TestFindOutboxSMS(GSM_MultiSMSMessage *sms UNUSED, GSM_SMSDConfig *Config, char *ID UNUSED)
+{
+	test_result(Config == main_config);
+	return ERR_EMPTY;
+}
+
+static GSM_Error TestMoveSMS(GSM_MultiSMSMessage *sms UNUSED, GSM_SMSDConfig *Config UNUSED, char *ID UNUSED, gboolean alwaysDelete UNUSED, gboolean sent UNUSED)
+{
+	return ERR_NONE;
+}
+
+static GSM_Error TestCreateOutboxSMS(GSM_MultiSMSMessage *sms UNUSED, GSM_SMSDConfig *Config UNUSED, char *NewID UNUSED)
+{
+	return ERR_NONE;
+}
+
+static GSM_Error TestAddSentSMSInfo(GSM_MultiSMSMessage *sms UNUSED, GSM_SMSDConfig *Config, char *ID, int Part UNUSED, GSM_SMSDSendingError err UNUSED, int TPMR UNUSED)
+{
+	test_result(Config == writer_config);
+	pthread_mutex_lock(&lock);
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	strcpy(sent_dt, Config->DT);
+#endif
+	strcpy(sent_id, ID);
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	return ERR_NONE;
+}
+
+static GSM_Error TestRefreshSendStatus(GSM_SMSDConfig *Config UNUSED, char *ID UNUSED)
+{
+	return ERR_NONE;
+}
+
+static GSM_Error TestCreateOutboxSMSBatch(GSM_MultiSMSMessage *sms UNUSED, int count UNUSED, GSM_SMSDConfig *Config UNUSED, char **NewIDs UNUSED)
+{
+	return ERR_NONE;
+}
+
+static GSM_SMSDService TestService = {
+	TestInit,
+	TestFree,
+	TestNone,
+	TestSaveInboxSMS,
+	TestFindOutboxSMS,
+	TestMoveSMS,
+	TestCreateOutboxSMS,
+	TestAddSentSMSInfo,
+	TestRefreshSendStatus,
+	TestNone,
+	TestNone,
+	TestNone,
+	TestCreateOutboxSMSBatch
+};
+
+static void queue_message(GSM_SMSDConfig *Config, int location)
+{
+	GSM_MultiSMSMessage sms;
+	GSM_Error error;
+	char *locations = NULL;
+
+	memset(&sms, 0, sizeof(sms));
+	sms.Number = 1;
+	sms.SMS[0].Location = location;
+	error = Config->Service->SaveInboxSMS(&sms, Config, &locations);
+	gammu_test_result(error, "SaveInboxSMS");
+	free(locations);
+}
+
+static void wait_saved(int count)
+{
+	pthread_mutex_lock(&lock);
+	while (saved < count) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void allow(int count)
+{
+	pthread_mutex_lock(&lock);
+	tokens = count;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Queues messages while writer is storing and compacting them, at most
+ * 16 ahead of it.
+ */
+static void *producer(void *arg)
+{
+	int i, count = *(int *)arg, first = saved;
+
+	for (i = 0; i < count; i++) {
+		pthread_mutex_lock(&lock);
+		while (saved < first + i - 16) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+		queue_message(main_config, 5000 + i);
+		pthread_mutex_lock(&lock);
+		produced++;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+	}
+	return NULL;
+}
+
+static long journal_size(const char *name)
+{
+	struct stat sb;
+
+	test_result(stat(name, &sb) == 0);
+	return sb.st_size;
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_SMSDConfig *Config;
+	GSM_MultiSMSMessage sms;
+	GSM_Error error;
+	char journal[100], compacted[110], id[200];
+	long size, max_size = 0;
+	int i, count, first;
+	pthread_t thread;
+
+	sprintf(journal, "smsd-writer-%d.journal", (int)getpid());
+	sprintf(compacted, "%s.new", journal);
+	remove(journal);
+
+	count = UNCOMPACTED_SIZE / sizeof(GSM_SMSMessage) + 1;
+	saved_size = 2 * count + 10;
+	saved_location = (int *)malloc(saved_size * sizeof(int));
+	test_result(saved_location != NULL);
+
+	Config = SMSD_NewConfig("smsd-writer");
+	test_result(Config != NULL);
+	main_config = Config;
+	Config->debug_level = 0;
+	Config->log_type = SMSD_LOG_FILE;
+	Config->log_handle = stderr;
+	Config->use_timestamps = FALSE;
+	Config->RunOnReceive = NULL;
+	Config->Status = NULL;
+	Config->Service = &TestService;
+	Config->backend_journal = journal;
+	Config->backend_queue_size = 1;
+	Config->backend_retries = 1;
+
+	/* Writer has its own backend connection */
+	error = SMSD_WriterStart(Config);
+	gammu_test_result(error, "SMSD_WriterStart");
+	test_result(inits == 1);
+	test_result(writer_config != NULL && writer_config != Config);
+
+	/* Main loop does not wait for writer stuck in backend */
+	allow(0);
+	queue_message(Config, 1);
+	pthread_mutex_lock(&lock);
+	while (!in_save) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+	error = Config->Service->FindOutboxSMS(&sms, Config, id);
+	test_result(error == ERR_EMPTY);
+
+	/* Sent info is written with values it was queued with */
+	memset(&sms, 0, sizeof(sms));
+	sms.Number = 1;
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	strcpy(Config->DT, "2015-01-01 10:00:00");
+#endif
+	strcpy((char *)Config->SMSID, "first");
+	strcpy(id, "first");
+	error = Config->Service->AddSentSMSInfo(&sms, Config, id, 1, SMSD_SEND_OK, 1);
+	gammu_test_result(error, "AddSentSMSInfo");
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	strcpy(Config->DT, "2015-01-01 11:00:00");
+#endif
+	strcpy((char *)Config->SMSID, "second");
+	pthread_mutex_lock(&lock);
+	tokens = 1;
+	pthread_cond_broadcast(&cond);
+	while (sent_id[0] == 0) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+	test_result(strcmp(sent_id, "first") == 0);
+#if defined(HAVE_MYSQL_MYSQL_H) || defined(HAVE_POSTGRESQL_LIBPQ_FE_H) || defined(LIBDBI_FOUND) || defined(ODBC_FOUND)
+	test_result(strcmp(sent_dt, "2015-01-01 10:00:00") == 0);
+#endif
+	test_result(saved == 1 && saved_location[0] == 1);
+
+	/* Journal does not grow while queue never drains */
+	allow(0);
+	first = saved;
+	queue_message(Config, 1000);
+	queue_message(Config, 1001);
+	for (i = 0; i < count; i++) {
+		queue_message(Config, 1002 + i);
+		pthread_mutex_lock(&lock);
+		tokens++;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+		wait_saved(first + i + 1);
+		size = journal_size(journal);
+		if (size > max_size) {
+			max_size = size;
+		}
+	}
+	printf("Journal size at most %ld bytes for %d messages\n", max_size, count);
+	test_result(max_size < JOURNAL_LIMIT);
+
+	/* Messages loaded back from compacted journal are intact */
+	for (i = 0; i < count; i++) {
+		test_result(saved_location[first + i] == 1000 + i);
+	}
+
+	/* Records which can not be written are kept for next start */
+	pthread_mutex_lock(&lock);
+	failing = TRUE;
+	pthread_cond_broadcast(&cond);
+	while (failed == 0) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+	SMSD_WriterStop(Config);
+	test_result(Config->Service == &TestService);
+	test_result(frees == 1);
+
+	failing = FALSE;
+	allow(-1);
+	error = SMSD_WriterStart(Config);
+	gammu_test_result(error, "SMSD_WriterStart");
+	test_result(inits == 2);
+	wait_saved(first + count + 2);
+	test_result(saved_location[first + count] == 1000 + count);
+	test_result(saved_location[first + count + 1] == 1001 + count);
+
+	/* Records queued while journal is compacted are kept */
+	allow(0);
+	first = saved;
+	max_size = 0;
+	test_result(pthread_create(&thread, NULL, producer, &count) == 0);
+	for (i = 0; i < count; i++) {
+		/* Keep few messages queued so that journal is not truncated */
+		pthread_mutex_lock(&lock);
+		while (produced < i + 8 && produced < count) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		tokens++;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+		wait_saved(first + i + 1);
+		size = journal_size(journal);
+		if (size > max_size) {
+			max_size = size;
+		}
+	}
+	test_result(pthread_join(thread, NULL) == 0);
+	printf("Journal size at most %ld bytes while queueing concurrently\n", max_size);
+	test_result(max_size < JOURNAL_LIMIT);
+	for (i = 0; i < count; i++) {
+		test_result(saved_location[first + i] == 5000 + i);
+	}
+	SMSD_WriterStop(Config);
+	test_result(frees == 2);
+
+	/* Everything written, only header is left */
+	test_result(journal_size(journal) < 100);
+	test_result(access(compacted, F_OK) != 0);
+
+	remove(journal);
+	free(saved_location);
+	Config->log_handle = NULL;
+	Config->log_type = SMSD_LOG_NONE;
+	Config->Service = NULL;
+	SMSD_FreeConfig(Config);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
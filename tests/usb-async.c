@@ -0,0 +1,326 @@
+/**
+ * Test for asynchronous USB reading, libusb transfer functions are
+ * replaced by simulated ones which complete transfers on request.
+ */
+
+#include <libusb.h>
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "../libgammu/gsmstate.h"	/* Needed for state machine internals */
+
+#define MAX_TRANSFERS 10
+#define MAX_CHUNKS 100
+#define CHUNK_SIZE 4096
+
+GSM_StateMachine *s;
+
+/**
+ * Transfers submitted and not yet completed, in order of submission.
+ */
+struct libusb_transfer *inflight[MAX_TRANSFERS];
+int inflight_count = 0;
+gboolean cancelled[MAX_TRANSFERS];
+
+/**
+ * Data phone sends, one chunk per completed transfer.
+ */
+unsigned char chunks[MAX_CHUNKS][CHUNK_SIZE];
+int chunk_length[MAX_CHUNKS];
+int chunks_first = 0, chunks_count = 0;
+
+/**
+ * Simulated failures.
+ */
+gboolean no_device = FALSE;
+gboolean stuck = FALSE;
+int events_fail = 0;
+
+/**
+ * Statistics of libusb calls.
+ */
+int allocated = 0;
+int freed = 0;
+int closed = 0;
+int exited = 0;
+gboolean freed_inflight = FALSE;
+
+static char fake_context, fake_handle;
+
+static int find_inflight(struct libusb_transfer *transfer)
+{
+	int i;
+
+	for (i = 0; i < inflight_count; i++) {
+		if (inflight[i] == transfer) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void complete(int pos, enum libusb_transfer_status status)
+{
+	struct libusb_transfer *transfer = inflight[pos];
+
+	memmove(inflight + pos, inflight + pos + 1, (inflight_count - pos - 1) * sizeof(inflight[0]));
+	memmove(cancelled + pos, cancelled + pos + 1, (inflight_count - pos - 1) * sizeof(cancelled[0]));
+	inflight_count--;
+	transfer->status = status;
+	transfer->callback(transfer);
+}
+
+int LIBUSB_CALL libusb_init(libusb_context **ctx)
+{
+	*ctx = (libusb_context *)&fake_context;
+	return 0;
+}
+
+void LIBUSB_CALL libusb_exit(libusb_context *ctx)
+{
+	test_result(ctx == (libusb_context *)&fake_context);
+	exited++;
+}
+
+struct libusb_transfer * LIBUSB_CALL libusb_alloc_transfer(int iso_packets)
+{
+	allocated++;
+	return calloc(1, sizeof(struct libusb_transfer));
+}
+
+void LIBUSB_CALL libusb_free_transfer(struct libusb_transfer *transfer)
+{
+	if (find_inflight(transfer) != -1) {
+		freed_inflight = TRUE;
+		return;
+	}
+	freed++;
+	free(transfer);
+}
+
+int LIBUSB_CALL libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+	test_result(inflight_count < MAX_TRANSFERS);
+	test_result(transfer->dev_handle == (libusb_device_handle *)&fake_handle);
+	cancelled[inflight_count] = FALSE;
+	inflight[inflight_count++] = transfer;
+	return 0;
+}
+
+int LIBUSB_CALL libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	int pos = find_inflight(transfer);
+
+	if (pos == -1) {
+		return LIBUSB_ERROR_NOT_FOUND;
+	}
+	cancelled[pos] = TRUE;
+	return 0;
+}
+
+int LIBUSB_CALL libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+	struct libusb_transfer *transfer;
+	int i;
+
+	test_result(ctx == (libusb_context *)&fake_context);
+
+	if (events_fail > 0) {
+		events_fail--;
+		return LIBUSB_ERROR_IO;
+	}
+	if (stuck) {
+		return 0;
+	}
+
+	/* Cancelled transfers complete first */
+	for (i = 0; i < inflight_count; ) {
+		if (cancelled[i]) {
+			complete(i, LIBUSB_TRANSFER_CANCELLED);
+		} else {
+			i++;
+		}
+	}
+
+	if (no_device && inflight_count > 0) {
+		no_device = FALSE;
+		complete(0, LIBUSB_TRANSFER_NO_DEVICE);
+		return 0;
+	}
+
+	/* Each chunk completes oldest transfer, which is resubmitted */
+	while (chunks_count > 0 && inflight_count > 0) {
+		transfer = inflight[0];
+		test_result(chunk_length[chunks_first] <= transfer->length);
+		memcpy(transfer->buffer, chunks[chunks_first], chunk_length[chunks_first]);
+		transfer->actual_length = chunk_length[chunks_first];
+		chunks_first++;
+		chunks_count--;
+		complete(0, LIBUSB_TRANSFER_COMPLETED);
+	}
+
+	return 0;
+}
+
+int LIBUSB_CALL libusb_set_interface_alt_setting(libusb_device_handle *dev, int interface_number, int alternate_setting)
+{
+	return 0;
+}
+
+int LIBUSB_CALL libusb_release_interface(libusb_device_handle *dev, int interface_number)
+{
+	return 0;
+}
+
+void LIBUSB_CALL libusb_close(libusb_device_handle *dev_handle)
+{
+	test_result(dev_handle == (libusb_device_handle *)&fake_handle);
+	test_result(inflight_count == 0);
+	closed++;
+}
+
+static void add_chunk(const unsigned char *data, int length)
+{
+	test_result(chunks_first + chunks_count < MAX_CHUNKS);
+	memcpy(chunks[chunks_first + chunks_count], data, length);
+	chunk_length[chunks_first + chunks_count] = length;
+	chunks_count++;
+}
+
+static void start(void)
+{
+	GSM_Error error;
+
+	error = GSM_USB_Init(s);
+	gammu_test_result(error, "GSM_USB_Init");
+	s->Device.Data.USB.handle = (libusb_device_handle *)&fake_handle;
+	s->Device.Data.USB.ep_read = 0x82;
+
+	error = GSM_USB_StartAsync(s);
+	gammu_test_result(error, "GSM_USB_StartAsync");
+	test_result(s->Device.Data.USB.async);
+	test_result(inflight_count == GSM_USB_READ_TRANSFERS);
+}
+
+/**
+ * Reads given amount of data, allowing few empty reads.
+ */
+static int read_all(unsigned char *buffer, int length)
+{
+	int pos = 0, ret, empty = 0;
+
+	while (pos < length && empty < 10) {
+		ret = GSM_USB_Read(s, buffer + pos, length - pos);
+		if (ret < 0) {
+			return ret;
+		}
+		if (ret == 0) {
+			empty++;
+		}
+		pos += ret;
+	}
+	return pos;
+}
+
+int main(int argc UNUSED, char **argv UNUSED)
+{
+	GSM_Debug_Info *debug_info;
+	GSM_Error error;
+	unsigned char chunk[CHUNK_SIZE];
+	unsigned char *buffer;
+	int i, j, ret, length;
+
+	debug_info = GSM_GetGlobalDebug();
+	GSM_SetDebugFileDescriptor(stderr, FALSE, debug_info);
+	GSM_SetDebugLevel("textall", debug_info);
+
+	s = GSM_AllocStateMachine();
+	test_result(s != NULL);
+	debug_info = GSM_GetDebug(s);
+	GSM_SetDebugGlobal(TRUE, debug_info);
+
+	buffer = malloc(MAX_CHUNKS * CHUNK_SIZE);
+	test_result(buffer != NULL);
+
+	/* Data arrive in order */
+	start();
+	test_result(GSM_USB_Read(s, buffer, 100) == 0);
+	add_chunk((const unsigned char *)"abc", 3);
+	add_chunk((const unsigned char *)"defg", 4);
+	add_chunk((const unsigned char *)"h", 1);
+	ret = read_all(buffer, 8);
+	test_result(ret == 8);
+	test_result(memcmp(buffer, "abcdefgh", 8) == 0);
+	test_result(inflight_count == GSM_USB_READ_TRANSFERS);
+
+	/* More data than initial ring buffer holds */
+	length = 0;
+	for (i = 0; i < 40; i++) {
+		for (j = 0; j < CHUNK_SIZE; j++) {
+			chunk[j] = (i + j) % 251;
+		}
+		add_chunk(chunk, CHUNK_SIZE);
+		length += CHUNK_SIZE;
+	}
+	test_result(length > GSM_USB_RING_SIZE);
+	ret = read_all(buffer, length);
+	test_result(ret == length);
+	test_result(s->Device.Data.USB.ring_size >= (size_t)length);
+	for (i = 0; i < 40; i++) {
+		for (j = 0; j < CHUNK_SIZE; j++) {
+			test_result(buffer[i * CHUNK_SIZE + j] == (i + j) % 251);
+		}
+	}
+
+	/* Disconnected device is reported once data are read */
+	add_chunk((const unsigned char *)"xyz", 3);
+	ret = GSM_USB_Read(s, buffer, 100);
+	test_result(ret == 3);
+	no_device = TRUE;
+	ret = GSM_USB_Read(s, buffer, 100);
+	test_result(ret == -1);
+	test_result(inflight_count == GSM_USB_READ_TRANSFERS - 1);
+
+	/* Clean stop frees everything */
+	error = GSM_USB_Terminate(s);
+	gammu_test_result(error, "GSM_USB_Terminate");
+	test_result(inflight_count == 0);
+	test_result(allocated == freed);
+	test_result(!freed_inflight);
+	test_result(closed == 1);
+	test_result(exited == 1);
+
+	/* Event handling errors while stopping are retried */
+	start();
+	events_fail = 3;
+	error = GSM_USB_Terminate(s);
+	gammu_test_result(error, "GSM_USB_Terminate");
+	test_result(inflight_count == 0);
+	test_result(allocated == freed);
+	test_result(closed == 2);
+	test_result(exited == 2);
+
+	/* Transfers which never complete are not freed */
+	start();
+	stuck = TRUE;
+	error = GSM_USB_Terminate(s);
+	test_result(error == ERR_DEVICEBUSY);
+	test_result(inflight_count == GSM_USB_READ_TRANSFERS);
+	test_result(!freed_inflight);
+	test_result(allocated == freed + GSM_USB_READ_TRANSFERS);
+	test_result(closed == 2);
+	test_result(exited == 2);
+	test_result(s->Device.Data.USB.handle == NULL);
+	test_result(s->Device.Data.USB.context == NULL);
+
+	free(buffer);
+	GSM_FreeStateMachine(s);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */
@@ -0,0 +1,76 @@
+/**
+ * Bulk vCard parser testing.
+ *
+ * Generates phonebook dump with many vCards (similar to telecom/pb.vcf
+ * read over OBEX) and parses it sequentially. Reports time needed for
+ * parsing, what can be used as benchmark.
+ *
+ * Optional parameter specifies number of contacts (default is 5000).
+ */
+#include <gammu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+
+#define DEFAULT_CONTACTS 5000
+
+int main(int argc, char **argv)
+{
+	size_t pos = 0, len = 0, alloc;
+	GSM_MemoryEntry pbk;
+	GSM_Error error;
+	char *buffer;
+	int i, count = 0, contacts = DEFAULT_CONTACTS;
+	clock_t start;
+	char name[100];
+
+	if (argc == 2) {
+		contacts = atoi(argv[1]);
+	}
+
+	/* Generate phonebook data */
+	alloc = (size_t)contacts * 200 + 1;
+	buffer = (char *)malloc(alloc);
+	test_result(buffer != NULL);
+
+	for (i = 0; i < contacts; i++) {
+		len += sprintf(buffer + len,
+			"BEGIN:VCARD\r\n"
+			"VERSION:2.1\r\n"
+			"N:Surname%d;Name%d\r\n"
+			"TEL;CELL:+420%09d\r\n"
+			"EMAIL:contact%d@example.com\r\n"
+			"END:VCARD\r\n",
+			i, i, i, i);
+	}
+	buffer[len] = 0;
+
+	/* Parse it */
+	start = clock();
+	while (1) {
+		error = GSM_DecodeVCARDLength(NULL, buffer, len, &pos, &pbk, SonyEricsson_VCard21);
+		if (error == ERR_EMPTY) {
+			break;
+		}
+		gammu_test_result(error, "GSM_DecodeVCARDLength");
+		count++;
+	}
+	printf("Parsed %d contacts in %.3f seconds\n", count,
+		(double)(clock() - start) / CLOCKS_PER_SEC);
+
+	/* Check results */
+	test_result(count == contacts);
+	sprintf(name, "Name%d", contacts - 1);
+	test_result(strcmp(DecodeUnicodeString(pbk.Entries[1].Text), name) == 0);
+
+	free(buffer);
+
+	return 0;
+}
+
+/* Editor configuration
+ * vim: noexpandtab sw=8 ts=8 sts=8 tw=72:
+ */